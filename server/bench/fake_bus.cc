@@ -0,0 +1,335 @@
+/*  =========================================================================
+    fake_bus - In-process message bus, without malamute
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fake_bus.h"
+#include <fty_log.h>
+#include <memory>
+#include <vector>
+
+namespace srr {
+
+FakeBroker::FakeBroker()
+{
+    m_thread = std::thread([this]() {
+        run();
+    });
+}
+
+FakeBroker::FakeBroker(Scheduler scheduler)
+    : m_scheduler(scheduler)
+{
+}
+
+FakeBroker::~FakeBroker()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void FakeBroker::receive(const std::string& client, const std::string& queue, messagebus::MessageListener listener)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queues[queue][client] = listener;
+}
+
+void FakeBroker::stopReceiving(const std::string& client, const std::string& queue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        found = m_queues.find(queue);
+    if (found != m_queues.end()) {
+        found->second.erase(client);
+    }
+}
+
+void FakeBroker::subscribe(const std::string& client, const std::string& topic, messagebus::MessageListener listener)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_topics[topic][client] = listener;
+}
+
+void FakeBroker::unsubscribe(const std::string& client, const std::string& topic)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        found = m_topics.find(topic);
+    if (found != m_topics.end()) {
+        found->second.erase(client);
+    }
+}
+
+void FakeBroker::disconnect(const std::string& client)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& queue : m_queues) {
+        queue.second.erase(client);
+    }
+    for (auto& topic : m_topics) {
+        topic.second.erase(client);
+    }
+}
+
+void FakeBroker::deliver(const std::string& queue, const messagebus::Message& message, std::chrono::milliseconds delay)
+{
+    if (m_scheduler) {
+        auto delivery = std::make_shared<Delivery>(Delivery{Clock::time_point(), 0, false, queue, message});
+        if (delay.count() <= 0) {
+            dispatch(*delivery);
+        } else {
+            m_scheduler(delay, [this, delivery]() {
+                dispatch(*delivery);
+            });
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t              sequence = m_sequence++;
+        const Clock::time_point     time     = Clock::now() + delay;
+        m_deliveries.emplace(std::make_pair(time, sequence), Delivery{time, sequence, false, queue, message});
+    }
+    m_cv.notify_all();
+}
+
+void FakeBroker::publish(const std::string& topic, const messagebus::Message& message)
+{
+    if (m_scheduler) {
+        Delivery delivery{Clock::time_point(), 0, true, topic, message};
+        dispatch(delivery);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t              sequence = m_sequence++;
+        const Clock::time_point     time     = Clock::now();
+        m_deliveries.emplace(std::make_pair(time, sequence), Delivery{time, sequence, true, topic, message});
+    }
+    m_cv.notify_all();
+}
+
+void FakeBroker::tap(Tap tap)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_taps.push_back(tap);
+}
+
+uint64_t FakeBroker::delivered() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_delivered;
+}
+
+uint64_t FakeBroker::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+void FakeBroker::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        if (m_deliveries.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+
+        auto next = m_deliveries.begin();
+        if (next->second.m_time > Clock::now()) {
+            m_cv.wait_until(lock, next->second.m_time);
+            continue;
+        }
+
+        Delivery delivery = std::move(next->second);
+        m_deliveries.erase(next);
+
+        // listeners may send messages
+        lock.unlock();
+        dispatch(delivery);
+        lock.lock();
+    }
+}
+
+void FakeBroker::dispatch(Delivery& delivery)
+{
+    std::vector<messagebus::MessageListener> listeners;
+    std::vector<Tap>                         taps;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!delivery.m_topic) {
+            taps = m_taps;
+        }
+
+        auto& destinations = delivery.m_topic ? m_topics : m_queues;
+        auto  found        = destinations.find(delivery.m_destination);
+        if (found != destinations.end() && !found->second.empty()) {
+            if (delivery.m_topic) {
+                for (const auto& listener : found->second) {
+                    listeners.push_back(listener.second);
+                }
+            } else {
+                // mailbox of the addressee, as malamute does, or the first client receiving the queue
+                auto to       = delivery.m_message.metaData().find(messagebus::Message::TO);
+                auto receiver = to != delivery.m_message.metaData().end() ? found->second.find(to->second)
+                                                                          : found->second.end();
+                listeners.push_back(
+                    receiver != found->second.end() ? receiver->second : found->second.begin()->second);
+            }
+        }
+
+        if (listeners.empty()) {
+            m_dropped++;
+        } else {
+            m_delivered++;
+        }
+    }
+
+    for (const auto& tap : taps) {
+        tap(delivery.m_destination, delivery.m_message);
+    }
+
+    if (listeners.empty()) {
+        log_warning("Message to %s dropped: no receiver", delivery.m_destination.c_str());
+        return;
+    }
+
+    for (const auto& listener : listeners) {
+        try {
+            listener(delivery.m_message);
+        } catch (const std::exception& ex) {
+            log_error("Listener of %s failed: %s", delivery.m_destination.c_str(), ex.what());
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FakeMessageBus::FakeMessageBus(FakeBroker& broker, const std::string& clientName)
+    : m_broker(broker)
+    , m_clientName(clientName)
+{
+}
+
+FakeMessageBus::~FakeMessageBus()
+{
+    m_broker.disconnect(m_clientName);
+}
+
+void FakeMessageBus::connect()
+{
+    // nothing to connect to
+}
+
+void FakeMessageBus::publish(const std::string& topic, const messagebus::Message& message)
+{
+    m_broker.publish(topic, stamp(message));
+}
+
+void FakeMessageBus::subscribe(const std::string& topic, messagebus::MessageListener messageListener)
+{
+    m_broker.subscribe(m_clientName, topic, messageListener);
+}
+
+void FakeMessageBus::unsubscribe(const std::string& topic, messagebus::MessageListener /*messageListener*/)
+{
+    m_broker.unsubscribe(m_clientName, topic);
+}
+
+void FakeMessageBus::sendRequest(const std::string& requestQueue, const messagebus::Message& message)
+{
+    m_broker.deliver(requestQueue, stamp(message));
+}
+
+void FakeMessageBus::sendRequest(
+    const std::string& requestQueue, const messagebus::Message& message, messagebus::MessageListener messageListener)
+{
+    auto replyTo = message.metaData().find(messagebus::Message::REPLY_TO);
+    if (replyTo == message.metaData().end()) {
+        throw messagebus::MessageBusException("Request without reply queue");
+    }
+    receive(replyTo->second, messageListener);
+    sendRequest(requestQueue, message);
+}
+
+void FakeMessageBus::sendReply(const std::string& replyQueue, const messagebus::Message& message)
+{
+    m_broker.deliver(replyQueue, stamp(message));
+}
+
+void FakeMessageBus::receive(const std::string& queue, messagebus::MessageListener messageListener)
+{
+    m_broker.receive(m_clientName, queue, messageListener);
+}
+
+messagebus::Message FakeMessageBus::request(
+    const std::string& requestQueue, const messagebus::Message& message, int receiveTimeOut)
+{
+    const std::string correlationId = messagebus::generateUuid();
+    const std::string replyQueue    = m_clientName + ".request." + correlationId;
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    received = false;
+    messagebus::Message     reply;
+
+    receive(replyQueue, [&](messagebus::Message answer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reply    = answer;
+        received = true;
+        cv.notify_all();
+    });
+
+    messagebus::Message query = message;
+    query.metaData()[messagebus::Message::CORRELATION_ID] = correlationId;
+    query.metaData()[messagebus::Message::REPLY_TO]       = replyQueue;
+    sendRequest(requestQueue, query);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    const bool done = cv.wait_for(lock, std::chrono::seconds(receiveTimeOut), [&]() {
+        return received;
+    });
+    lock.unlock();
+
+    m_broker.stopReceiving(m_clientName, replyQueue);
+    if (!done) {
+        throw messagebus::MessageBusException("Request timed out");
+    }
+    return reply;
+}
+
+const std::string& FakeMessageBus::clientName() const
+{
+    return m_clientName;
+}
+
+messagebus::Message FakeMessageBus::stamp(const messagebus::Message& message) const
+{
+    messagebus::Message stamped = message;
+    stamped.metaData().emplace(messagebus::Message::FROM, m_clientName);
+    return stamped;
+}
+
+} // namespace srr
@@ -0,0 +1,145 @@
+/*  =========================================================================
+    fake_bus - In-process message bus, without malamute
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fty_common_messagebus.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace srr {
+
+/**
+ * Broker of the fake clients: messages are delivered one at a time by its thread, in the order of their delivery
+ * time, then of their sending. A listener may send or deliver messages, it must not block.
+ * A broker with a scheduler has no thread: the messages without delay are delivered in the thread sending them, the
+ * others by the scheduler (timers of a virtual time event loop, for the simulations).
+ */
+class FakeBroker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    // run task after delay
+    using Scheduler = std::function<void(std::chrono::milliseconds delay, std::function<void()> task)>;
+    // message delivered to queue, seen before its receiver gets it
+    using Tap = std::function<void(const std::string& queue, const messagebus::Message& message)>;
+
+    FakeBroker();
+    explicit FakeBroker(Scheduler scheduler);
+    ~FakeBroker();
+
+    FakeBroker(const FakeBroker&) = delete;
+    FakeBroker& operator=(const FakeBroker&) = delete;
+
+    // mailbox queue of client
+    void receive(const std::string& client, const std::string& queue, messagebus::MessageListener listener);
+    void stopReceiving(const std::string& client, const std::string& queue);
+    void subscribe(const std::string& client, const std::string& topic, messagebus::MessageListener listener);
+    void unsubscribe(const std::string& client, const std::string& topic);
+    void disconnect(const std::string& client);
+
+    // to the mailbox queue of the client set in TO, or of any client receiving queue. Dropped if nobody does.
+    void deliver(const std::string& queue, const messagebus::Message& message,
+        std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    void publish(const std::string& topic, const messagebus::Message& message);
+
+    // called from the delivering thread for every message delivered to a queue, it must not block
+    void tap(Tap tap);
+
+    // messages delivered and dropped so far
+    uint64_t delivered() const;
+    uint64_t dropped() const;
+
+private:
+    struct Delivery
+    {
+        Clock::time_point   m_time;
+        uint64_t            m_sequence;
+        bool                m_topic;
+        std::string         m_destination;
+        messagebus::Message m_message;
+    };
+
+    Scheduler m_scheduler;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_cv;
+    bool                    m_stop      = false;
+    uint64_t                m_sequence  = 0;
+    uint64_t                m_delivered = 0;
+    uint64_t                m_dropped   = 0;
+
+    // by delivery time and sequence
+    std::map<std::pair<Clock::time_point, uint64_t>, Delivery> m_deliveries;
+
+    // listeners by queue (or topic), then by client
+    std::map<std::string, std::map<std::string, messagebus::MessageListener>> m_queues;
+    std::map<std::string, std::map<std::string, messagebus::MessageListener>> m_topics;
+    std::vector<Tap>                                                          m_taps;
+
+    std::thread m_thread;
+
+    void run();
+    void dispatch(Delivery& delivery);
+};
+
+/**
+ * messagebus::MessageBus client of a FakeBroker: same interface as the malamute client, delivery in the process.
+ */
+class FakeMessageBus : public messagebus::MessageBus
+{
+public:
+    FakeMessageBus(FakeBroker& broker, const std::string& clientName);
+    ~FakeMessageBus() override;
+
+    void connect() override;
+
+    void publish(const std::string& topic, const messagebus::Message& message) override;
+    void subscribe(const std::string& topic, messagebus::MessageListener messageListener) override;
+    void unsubscribe(const std::string& topic, messagebus::MessageListener messageListener = {}) override;
+
+    void sendRequest(const std::string& requestQueue, const messagebus::Message& message) override;
+    void sendRequest(const std::string& requestQueue, const messagebus::Message& message,
+        messagebus::MessageListener messageListener) override;
+    void sendReply(const std::string& replyQueue, const messagebus::Message& message) override;
+    void receive(const std::string& queue, messagebus::MessageListener messageListener) override;
+
+    // synchronous request, receiveTimeOut in seconds
+    messagebus::Message request(
+        const std::string& requestQueue, const messagebus::Message& message, int receiveTimeOut) override;
+
+    const std::string& clientName() const;
+
+private:
+    FakeBroker& m_broker;
+    std::string m_clientName;
+
+    messagebus::Message stamp(const messagebus::Message& message) const;
+};
+
+} // namespace srr
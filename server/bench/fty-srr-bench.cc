@@ -0,0 +1,346 @@
+/*  =========================================================================
+    fty-srr-bench - End-to-end save/restore benchmark of the SRR worker
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+ * Runs SrrWorker::requestSave and requestRestore against the mock agents of an in-process message bus, for each
+ * case of a matrix of payload sizes, feature counts and agent latencies. The median of the runs of each case is
+ * written as JSON and compared to a baseline report, if given: the exit code is 1 if a case got slower than the
+ * tolerance allows.
+ */
+
+#include "fake_bus.h"
+#include "fty-srr.h"
+#include "fty_srr_groups.h"
+#include "fty_srr_worker.h"
+#include "measure.h"
+#include "mock_agents.h"
+#include "report.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <fty/command-line.h>
+#include <fty/string-utils.h>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+using namespace srr;
+
+static constexpr const char* BENCH_AGENT_NAME = "fty-srr-bench";
+static constexpr const char* BENCH_PASSPHRASE = "Bench-Passphrase-1";
+
+namespace {
+
+struct BenchCase
+{
+    size_t m_payloadSize;
+    size_t m_features;
+    int    m_latencyMs;
+};
+
+// 512, 64K, 16M, 1G
+size_t parseSize(const std::string& text)
+{
+    size_t       end  = 0;
+    const size_t size = std::stoul(text, &end);
+    const char   unit = end < text.size() ? static_cast<char>(std::toupper(text[end])) : '\0';
+    switch (unit) {
+        case 'K':
+            return size << 10;
+        case 'M':
+            return size << 20;
+        case 'G':
+            return size << 30;
+        default:
+            return size;
+    }
+}
+
+std::vector<size_t> parseList(const std::string& text, bool sizes)
+{
+    std::vector<size_t> values;
+    for (const auto& value : fty::split(text, ",", fty::SplitOption::Trim)) {
+        if (value == "all") {
+            values.push_back(std::numeric_limits<size_t>::max());
+        } else {
+            values.push_back(sizes ? parseSize(value) : std::stoul(value));
+        }
+    }
+    return values;
+}
+
+// groups holding at least features features, in restore order. features is set to their number of features.
+std::vector<std::string> selectGroups(size_t& features)
+{
+    std::vector<const SrrGroupStruct*> groups;
+    for (const auto& group : g_srrGroupMap) {
+        groups.push_back(&group.second);
+    }
+    std::sort(groups.begin(), groups.end(), [](const SrrGroupStruct* l, const SrrGroupStruct* r) {
+        return l->m_restoreOrder < r->m_restoreOrder;
+    });
+
+    std::vector<std::string> selected;
+    size_t                   count = 0;
+    for (const auto* group : groups) {
+        if (count >= features) {
+            break;
+        }
+        selected.push_back(group->m_id);
+        count += group->m_fp.size();
+    }
+    features = count;
+    return selected;
+}
+
+std::map<std::string, std::string> workerParameters(size_t poolSize)
+{
+    std::map<std::string, std::string> parameters;
+    parameters[AGENT_NAME_KEY]        = BENCH_AGENT_NAME;
+    parameters[ENDPOINT_KEY]          = "";
+    parameters[SRR_VERSION_KEY]       = ACTIVE_VERSION;
+    parameters[REQUEST_TIMEOUT_KEY]   = "600000";
+    parameters[ENABLE_REBOOT_KEY]     = "false";
+    parameters[INTEGRITY_SCHEME_KEY]  = INTEGRITY_SCHEME_DEFAULT;
+    parameters[CONTINUOUS_BACKUP_KEY] = "false";
+    parameters[TWO_PHASE_RESTORE_KEY] = TWO_PHASE_RESTORE_DEFAULT;
+    parameters[BUS_POOL_SIZE_KEY]     = std::to_string(poolSize);
+    parameters[RESTORE_DELAY_KEY]     = "0";
+    return parameters;
+}
+
+std::string saveRequest(const std::vector<std::string>& groups)
+{
+    SrrSaveRequest request;
+    request.m_passphrase = BENCH_PASSPHRASE;
+    request.m_group_list = groups;
+
+    cxxtools::SerializationInfo si;
+    si <<= request;
+    return dto::srr::serializeJson(si, false);
+}
+
+std::string restoreRequest(const std::string& saveJson)
+{
+    SrrSaveResponse response;
+    dto::srr::deserializeJson(saveJson) >>= response;
+
+    auto data    = std::make_shared<SrrRestoreRequestDataV2>();
+    data->m_data = response.m_data;
+
+    SrrRestoreRequest request;
+    request.m_version    = response.m_version;
+    request.m_checksum   = response.m_checksum;
+    request.m_passphrase = BENCH_PASSPHRASE;
+    request.m_data_ptr   = data;
+
+    cxxtools::SerializationInfo si;
+    si <<= request;
+    return dto::srr::serializeJson(si, false);
+}
+
+std::string caseName(const std::string& operation, const BenchCase& benchCase)
+{
+    return operation + "/size=" + std::to_string(benchCase.m_payloadSize) +
+           "/features=" + std::to_string(benchCase.m_features) + "/latency=" + std::to_string(benchCase.m_latencyMs);
+}
+
+// median of the runs of run(), which returns the status of the request
+BenchResult measure(const std::string& name, unsigned runs, uint64_t bytes, const MockAgents& agents,
+    const std::function<std::string()>& run)
+{
+    std::vector<double> wallMs;
+    std::vector<double> peakRssKb;
+    std::vector<double> allocations;
+    std::vector<double> allocatedBytes;
+    std::vector<double> requests;
+
+    for (unsigned i = 0; i < runs; i++) {
+        const uint64_t requestsBefore = agents.requests();
+
+        Measure           runMeasure;
+        const std::string status = run();
+        runMeasure.stop();
+
+        if (status != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+            throw std::runtime_error(name + " failed with status " + status);
+        }
+
+        wallMs.push_back(runMeasure.wallMs());
+        peakRssKb.push_back(static_cast<double>(runMeasure.peakRssKb()));
+        allocations.push_back(static_cast<double>(runMeasure.allocations()));
+        allocatedBytes.push_back(static_cast<double>(runMeasure.allocatedBytes()));
+        requests.push_back(static_cast<double>(agents.requests() - requestsBefore));
+    }
+
+    BenchResult result;
+    result.m_name           = name;
+    result.m_runs           = runs;
+    result.m_wallMs         = median(wallMs);
+    result.m_bytes          = bytes;
+    result.m_bytesPerSec    = result.m_wallMs > 0 ? static_cast<double>(bytes) * 1000.0 / result.m_wallMs : 0;
+    result.m_peakRssKb      = static_cast<uint64_t>(*std::max_element(peakRssKb.begin(), peakRssKb.end()));
+    result.m_allocations    = static_cast<uint64_t>(median(allocations));
+    result.m_allocatedBytes = static_cast<uint64_t>(median(allocatedBytes));
+
+    result.m_extra["agent_requests"] = median(requests);
+    return result;
+}
+
+void runCase(const BenchCase& benchCase, unsigned runs, size_t poolSize, bool save, bool restore,
+    BenchReport& report)
+{
+    size_t                         features = benchCase.m_features;
+    const std::vector<std::string> groups   = selectGroups(features);
+
+    BenchCase actual  = benchCase;
+    actual.m_features = features;
+
+    // declared first: the broker outlives its clients
+    FakeBroker broker;
+
+    MockAgentOptions options;
+    options.m_payloadSize = benchCase.m_payloadSize;
+    options.m_latency     = std::chrono::milliseconds(benchCase.m_latencyMs);
+    MockAgents agents(broker, options);
+
+    FakeMessageBus bus(broker, BENCH_AGENT_NAME);
+    bus.connect();
+    SrrWorker worker(bus, workerParameters(poolSize), {"1.0", "2.0", "2.1", "2.2"},
+        [&broker](const std::string& clientId) {
+            return std::unique_ptr<messagebus::MessageBus>(new FakeMessageBus(broker, clientId));
+        });
+
+    const uint64_t    bytes           = static_cast<uint64_t>(benchCase.m_payloadSize) * features;
+    const std::string saveRequestJson = saveRequest(groups);
+    std::string       saveJson;
+
+    auto doSave = [&]() {
+        dto::UserData response = worker.requestSave(saveRequestJson);
+        saveJson               = response.back();
+        return response.front();
+    };
+
+    if (save) {
+        BenchResult result = measure(caseName("save", actual), runs, bytes, agents, doSave);
+        std::cerr << result.m_name << ": " << result.m_wallMs << " ms" << std::endl;
+        report.add(result);
+    }
+
+    if (restore) {
+        if (saveJson.empty()) {
+            doSave();
+        }
+        const std::string restoreJson = restoreRequest(saveJson);
+
+        BenchResult result = measure(caseName("restore", actual), runs, bytes, agents, [&]() {
+            return worker.requestRestore(restoreJson).front();
+        });
+        std::cerr << result.m_name << ": " << result.m_wallMs << " ms" << std::endl;
+        report.add(result);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    ftylog_setInstance(BENCH_AGENT_NAME, "");
+    ftylog_setLogLevelError(ftylog_getInstance());
+
+    bool        help       = false;
+    std::string sizes      = "1K,64K,1M,16M";
+    std::string features   = "1,4,all";
+    std::string latencies  = "0,10";
+    std::string operations = "save,restore";
+    std::string output;
+    std::string baseline;
+    int         runs      = 3;
+    int         poolSize  = 4;
+    int         tolerance = 10;
+
+    // clang-format off
+    fty::CommandLine cmd("### - SRR end-to-end benchmark\n      Usage: fty-srr-bench [options]", {
+        {"--help|-h", help, "Show this help"},
+        {"--sizes|-s", sizes, "Payload sizes of a feature, comma separated, with an optional K/M/G unit (default 1K,64K,1M,16M)"},
+        {"--features|-f", features, "Feature counts, comma separated, rounded up to whole groups, or all (default 1,4,all)"},
+        {"--latencies|-l", latencies, "Agent latencies in milliseconds, comma separated (default 0,10)"},
+        {"--operations", operations, "Operations to run: save, restore or both (default save,restore)"},
+        {"--runs|-r", runs, "Runs of each case, the median is reported (default 3)"},
+        {"--pool|-p", poolSize, "Bus clients of the worker, 0 for one shared client (default 4)"},
+        {"--output|-o", output, "File where the JSON report is written (default standard output)"},
+        {"--baseline|-b", baseline, "JSON report to compare the results to"},
+        {"--tolerance|-t", tolerance, "Slowdown allowed against the baseline, in percent (default 10)"}
+    });
+    // clang-format on
+
+    if (auto res = cmd.parse(argc, argv); !res) {
+        std::cerr << res.error() << std::endl;
+        std::cout << cmd.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (help) {
+        std::cout << cmd.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    BenchReport report("save-restore");
+
+    try {
+        const bool save    = operations.find("save") != std::string::npos;
+        const bool restore = operations.find("restore") != std::string::npos;
+
+        for (size_t size : parseList(sizes, true)) {
+            for (size_t count : parseList(features, false)) {
+                for (size_t latency : parseList(latencies, false)) {
+                    BenchCase benchCase{size, count, static_cast<int>(latency)};
+                    runCase(benchCase, static_cast<unsigned>(std::max(1, runs)), static_cast<size_t>(poolSize), save,
+                        restore, report);
+                }
+            }
+        }
+
+        if (output.empty()) {
+            std::cout << report.json() << std::endl;
+        } else {
+            report.write(output);
+        }
+
+        if (!baseline.empty()) {
+            const size_t regressions = report.compare(BenchReport::load(baseline), tolerance / 100.0, std::cerr);
+            if (regressions > 0) {
+                std::cerr << "### - " << regressions << " case(s) slower than the baseline" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "### - Error: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,406 @@
+/*  =========================================================================
+    fty-srr-dto-bench - Microbenchmarks of the DTO serialization layer
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+ * Time, throughput and allocations of one call of the operator<<= / operator>>= of the DTOs, of the JSON
+ * (de)serialization of a save response and of a restore request, and of the data integrity digests.
+ * Payloads are realistic (JSON documents of configuration, opaque text, binary) or adversarial (deeply nested or
+ * very wide JSON, strings made of escapes). Results have the format of fty-srr-bench, per call.
+ */
+
+#include "dto/common.h"
+#include "dto/request.h"
+#include "dto/response.h"
+#include "helpers/data_integrity.h"
+#include "measure.h"
+#include "report.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <fty/command-line.h>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+#include <iostream>
+#include <memory>
+#include <random>
+
+using namespace srr;
+
+namespace {
+
+struct DtoCase
+{
+    std::string           m_name;
+    uint64_t              m_bytes; // payload handled by one call
+    std::function<void()> m_call;
+};
+
+// results are added here, so that the calls are not optimized away
+volatile size_t g_sink = 0;
+
+// configuration-like JSON document of about size bytes
+std::string jsonPayload(size_t size)
+{
+    std::string payload = "{\"items\":[";
+    for (size_t i = 0; payload.size() < size; i++) {
+        if (i > 0) {
+            payload += ",";
+        }
+        payload += "{\"id\":" + std::to_string(i) + ",\"name\":\"item-" + std::to_string(i) +
+                   "\",\"enabled\":true,\"timeout\":30,\"address\":\"10.0.0." + std::to_string(i % 255) + "\"}";
+    }
+    payload += "]}";
+    return payload;
+}
+
+std::string textPayload(size_t size)
+{
+    std::mt19937 random(1);
+    std::string  payload;
+    payload.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        payload += (i % 8 == 7) ? ' ' : static_cast<char>('a' + random() % 26);
+    }
+    return payload;
+}
+
+// not valid UTF-8: sent in base64
+std::string binaryPayload(size_t size)
+{
+    std::mt19937 random(1);
+    std::string  payload;
+    payload.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        payload += static_cast<char>(random() % 256);
+    }
+    return payload;
+}
+
+// JSON string made of characters to escape
+std::string escapedPayload(size_t size)
+{
+    std::string payload = "{\"value\":\"";
+    while (payload.size() < size) {
+        payload += "\\\"\\\\\\n\\t\\u0001";
+    }
+    payload += "\"}";
+    return payload;
+}
+
+std::string nestedPayload(size_t depth)
+{
+    return std::string(depth, '[') + "0" + std::string(depth, ']');
+}
+
+std::string widePayload(size_t keys)
+{
+    std::string payload = "{";
+    for (size_t i = 0; i < keys; i++) {
+        payload += (i > 0 ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    payload += "}";
+    return payload;
+}
+
+dto::srr::FeatureAndStatus makeFeature(const std::string& payload)
+{
+    dto::srr::FeatureAndStatus feature;
+    feature.mutable_feature()->set_version("1.0");
+    feature.mutable_feature()->set_data(payload);
+    feature.mutable_status()->set_status(dto::srr::Status::SUCCESS);
+    return feature;
+}
+
+Group makeGroup(size_t features, const std::string& payload, const std::string& scheme)
+{
+    Group group;
+    group.m_group_id         = "group-bench";
+    group.m_group_name       = "group-bench";
+    group.m_integrity_scheme = scheme;
+    for (size_t i = 0; i < features; i++) {
+        SrrFeature feature;
+        feature.m_feature_name       = "feature-" + std::to_string(i);
+        feature.m_feature_and_status = makeFeature(payload);
+        group.m_features.push_back(feature);
+    }
+    evalDataIntegrity(group);
+    return group;
+}
+
+SrrSaveResponse makeSaveResponse(size_t groups, size_t features, const std::string& payload)
+{
+    SrrSaveResponse response;
+    response.m_status  = dto::srr::statusToString(dto::srr::Status::SUCCESS);
+    response.m_version = "2.0";
+    for (size_t i = 0; i < groups; i++) {
+        response.m_data.push_back(makeGroup(features, payload, ""));
+        response.m_data.back().m_group_id += "-" + std::to_string(i);
+    }
+    return response;
+}
+
+void addFeatureCases(std::vector<DtoCase>& cases, const std::string& kind, const std::string& label,
+    const std::string& payload)
+{
+    auto feature = std::make_shared<dto::srr::FeatureAndStatus>(makeFeature(payload));
+    auto si      = std::make_shared<cxxtools::SerializationInfo>();
+    *si <<= *feature;
+
+    cases.push_back({"feature/serialize/" + kind + "/" + label, payload.size(), [feature]() {
+                         cxxtools::SerializationInfo out;
+                         out <<= *feature;
+                         g_sink = g_sink + out.memberCount();
+                     }});
+    cases.push_back({"feature/deserialize/" + kind + "/" + label, payload.size(), [si]() {
+                         dto::srr::FeatureAndStatus out;
+                         *si >>= out;
+                         g_sink = g_sink + out.feature().data().size();
+                     }});
+}
+
+std::vector<DtoCase> buildCases(bool large)
+{
+    std::vector<DtoCase> cases;
+
+    std::vector<std::pair<size_t, std::string>> sizes = {{1 << 10, "1K"}, {64 << 10, "64K"}, {1 << 20, "1M"}};
+    if (large) {
+        sizes.push_back({64 << 20, "64M"});
+    }
+
+    // realistic payloads
+    for (const auto& size : sizes) {
+        addFeatureCases(cases, "json", size.second, jsonPayload(size.first));
+        addFeatureCases(cases, "text", size.second, textPayload(size.first));
+        addFeatureCases(cases, "binary", size.second, binaryPayload(size.first));
+    }
+
+    // adversarial payloads
+    addFeatureCases(cases, "escaped", "1M", escapedPayload(1 << 20));
+    addFeatureCases(cases, "nested", "depth=512", nestedPayload(512));
+    addFeatureCases(cases, "wide", "keys=100000", widePayload(100000));
+
+    for (const auto& size : sizes) {
+        const std::string payload = jsonPayload(size.first);
+        const std::string label   = "8x" + size.second;
+        const uint64_t    bytes   = payload.size() * 8;
+
+        auto group   = std::make_shared<Group>(makeGroup(8, payload, ""));
+        auto groupSi = std::make_shared<cxxtools::SerializationInfo>();
+        *groupSi <<= *group;
+
+        cases.push_back({"group/serialize/" + label, bytes, [group]() {
+                             cxxtools::SerializationInfo out;
+                             out <<= *group;
+                             g_sink = g_sink + out.memberCount();
+                         }});
+        cases.push_back({"group/deserialize/" + label, bytes, [groupSi]() {
+                             Group out;
+                             *groupSi >>= out;
+                             g_sink = g_sink + out.m_features.size();
+                         }});
+
+        // 3 groups of 4 features, to and from the JSON sent on the bus
+        auto response     = std::make_shared<SrrSaveResponse>(makeSaveResponse(3, 4, payload));
+        auto responseJson = std::make_shared<std::string>();
+        {
+            cxxtools::SerializationInfo si;
+            si <<= *response;
+            *responseJson = dto::srr::serializeJson(si, false);
+        }
+        const std::string responseLabel = "3x4x" + size.second;
+
+        cases.push_back({"save_response/to_json/" + responseLabel, payload.size() * 12, [response]() {
+                             cxxtools::SerializationInfo si;
+                             si <<= *response;
+                             g_sink = g_sink + dto::srr::serializeJson(si, false).size();
+                         }});
+        cases.push_back({"save_response/from_json/" + responseLabel, payload.size() * 12, [responseJson]() {
+                             SrrSaveResponse out;
+                             dto::srr::deserializeJson(*responseJson) >>= out;
+                             g_sink = g_sink + out.m_data.size();
+                         }});
+
+        auto restoreData    = std::make_shared<SrrRestoreRequestDataV2>();
+        restoreData->m_data = response->m_data;
+
+        auto restore          = std::make_shared<SrrRestoreRequest>();
+        restore->m_version    = "2.0";
+        restore->m_passphrase = "Bench-Passphrase-1";
+        restore->m_data_ptr   = restoreData;
+
+        auto restoreJson = std::make_shared<std::string>();
+        {
+            cxxtools::SerializationInfo si;
+            si <<= *restore;
+            *restoreJson = dto::srr::serializeJson(si, false);
+        }
+
+        cases.push_back({"restore_request/to_json/" + responseLabel, payload.size() * 12, [restore]() {
+                             cxxtools::SerializationInfo si;
+                             si <<= *restore;
+                             g_sink = g_sink + dto::srr::serializeJson(si, false).size();
+                         }});
+        cases.push_back({"restore_request/from_json/" + responseLabel, payload.size() * 12, [restoreJson]() {
+                             SrrRestoreRequest out;
+                             dto::srr::deserializeJson(*restoreJson) >>= out;
+                             g_sink = g_sink + out.m_data_ptr->getSrrFeatures().size();
+                         }});
+
+        auto digestPayload = std::make_shared<std::string>(payload);
+        cases.push_back({"sha256/" + size.second, payload.size(), [digestPayload]() {
+                             g_sink = g_sink + evalSha256(*digestPayload).size();
+                         }});
+
+        for (const std::string scheme : {"legacy", INTEGRITY_SCHEME_MERKLE}) {
+            auto integrityGroup = std::make_shared<Group>(makeGroup(8, payload, scheme == "legacy" ? "" : scheme));
+            cases.push_back({"integrity/" + scheme + "/" + label, bytes, [integrityGroup]() {
+                                 evalDataIntegrity(*integrityGroup);
+                                 g_sink = g_sink + integrityGroup->m_data_integrity.size();
+                             }});
+        }
+    }
+
+    return cases;
+}
+
+// per call: calls are batched until a batch lasts minTime, the median of the batches is reported
+BenchResult runCase(const DtoCase& dtoCase, unsigned runs, std::chrono::milliseconds minTime)
+{
+    uint64_t calls = 1;
+    while (calls < (uint64_t(1) << 24)) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            dtoCase.m_call();
+        }
+        if (std::chrono::steady_clock::now() - start >= minTime) {
+            break;
+        }
+        calls *= 2;
+    }
+
+    std::vector<double> wallMs;
+    std::vector<double> allocations;
+    std::vector<double> allocatedBytes;
+    uint64_t            peakRss = 0;
+
+    for (unsigned run = 0; run < runs; run++) {
+        Measure batch;
+        for (uint64_t i = 0; i < calls; i++) {
+            dtoCase.m_call();
+        }
+        batch.stop();
+
+        wallMs.push_back(batch.wallMs() / static_cast<double>(calls));
+        allocations.push_back(static_cast<double>(batch.allocations()) / static_cast<double>(calls));
+        allocatedBytes.push_back(static_cast<double>(batch.allocatedBytes()) / static_cast<double>(calls));
+        peakRss = std::max(peakRss, batch.peakRssKb());
+    }
+
+    BenchResult result;
+    result.m_name           = dtoCase.m_name;
+    result.m_runs           = runs;
+    result.m_wallMs         = median(wallMs);
+    result.m_bytes          = dtoCase.m_bytes;
+    result.m_bytesPerSec    = result.m_wallMs > 0 ? static_cast<double>(dtoCase.m_bytes) * 1000.0 / result.m_wallMs : 0;
+    result.m_peakRssKb      = peakRss;
+    result.m_allocations    = static_cast<uint64_t>(median(allocations));
+    result.m_allocatedBytes = static_cast<uint64_t>(median(allocatedBytes));
+
+    result.m_extra["calls_per_batch"] = static_cast<double>(calls);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    ftylog_setInstance("fty-srr-dto-bench", "");
+    ftylog_setLogLevelError(ftylog_getInstance());
+
+    bool        help  = false;
+    bool        large = false;
+    std::string filter;
+    std::string output;
+    std::string baseline;
+    int         runs      = 5;
+    int         minTimeMs = 200;
+    int         tolerance = 10;
+
+    // clang-format off
+    fty::CommandLine cmd("### - SRR DTO microbenchmarks\n      Usage: fty-srr-dto-bench [options]", {
+        {"--help|-h", help, "Show this help"},
+        {"--filter|-f", filter, "Only run the cases whose name contains this text"},
+        {"--large|-L", large, "Add the cases of 64M payloads"},
+        {"--runs|-r", runs, "Batches of each case, the median is reported (default 5)"},
+        {"--min-time|-m", minTimeMs, "Minimum duration of a batch in milliseconds (default 200)"},
+        {"--output|-o", output, "File where the JSON report is written (default standard output)"},
+        {"--baseline|-b", baseline, "JSON report to compare the results to"},
+        {"--tolerance|-t", tolerance, "Slowdown allowed against the baseline, in percent (default 10)"}
+    });
+    // clang-format on
+
+    if (auto res = cmd.parse(argc, argv); !res) {
+        std::cerr << res.error() << std::endl;
+        std::cout << cmd.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (help) {
+        std::cout << cmd.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    BenchReport report("dto");
+
+    try {
+        for (const auto& dtoCase : buildCases(large)) {
+            if (!filter.empty() && dtoCase.m_name.find(filter) == std::string::npos) {
+                continue;
+            }
+            BenchResult result = runCase(dtoCase, static_cast<unsigned>(std::max(1, runs)),
+                std::chrono::milliseconds(std::max(1, minTimeMs)));
+            std::cerr << result.m_name << ": " << result.m_wallMs << " ms, " << result.m_allocations
+                      << " allocations" << std::endl;
+            report.add(result);
+        }
+
+        if (output.empty()) {
+            std::cout << report.json() << std::endl;
+        } else {
+            report.write(output);
+        }
+
+        if (!baseline.empty()) {
+            const size_t regressions = report.compare(BenchReport::load(baseline), tolerance / 100.0, std::cerr);
+            if (regressions > 0) {
+                std::cerr << "### - " << regressions << " case(s) slower than the baseline" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "### - Error: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,339 @@
+/*  =========================================================================
+    fty-srr-replay - Save and restore timed against the agent replies of a capture
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+ * Runs SrrWorker::requestSave and requestRestore against agents replaying a capture (captureFile of the
+ * configuration): the groups whose features were saved in the capture are saved, then restored from that save, with
+ * the recorded payloads and latencies. The median of the runs is written as JSON and compared to a baseline report,
+ * if given, as fty-srr-bench does.
+ */
+
+#include "fake_bus.h"
+#include "fty-srr.h"
+#include "fty_srr_capture.h"
+#include "fty_srr_groups.h"
+#include "fty_srr_worker.h"
+#include "measure.h"
+#include "replay_agents.h"
+#include "report.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <fty/command-line.h>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+#include <iostream>
+#include <memory>
+#include <set>
+
+using namespace srr;
+
+static constexpr const char* REPLAY_AGENT_NAME = "fty-srr-replay";
+static constexpr const char* REPLAY_PASSPHRASE = "Replay-Passphrase-1";
+
+namespace {
+
+// groups with a feature saved in the capture
+std::vector<std::string> capturedGroups(const std::vector<SrrExchange>& exchanges)
+{
+    std::set<std::string> features;
+    for (const auto& exchange : exchanges) {
+        if (exchange.m_action != "save") {
+            continue;
+        }
+        try {
+            for (const auto& feature : requestFeatures(exchange.m_action, exchange.m_request)) {
+                features.insert(feature);
+            }
+        } catch (const std::exception& ex) {
+            log_warning("Recorded save request skipped: %s", ex.what());
+        }
+    }
+
+    std::vector<std::string> groups;
+    for (const auto& group : g_srrGroupMap) {
+        for (const auto& feature : group.second.m_fp) {
+            if (features.count(feature.m_feature) > 0) {
+                groups.push_back(group.first);
+                break;
+            }
+        }
+    }
+    return groups;
+}
+
+// features prepared in the capture: their agents supported the two-phase restore
+std::string capturedTwoPhaseFeatures(const std::vector<SrrExchange>& exchanges)
+{
+    std::set<std::string> features;
+    for (const auto& exchange : exchanges) {
+        if (exchange.m_action != "prepare") {
+            continue;
+        }
+        try {
+            for (const auto& feature : requestFeatures(exchange.m_action, exchange.m_request)) {
+                features.insert(feature);
+            }
+        } catch (const std::exception& ex) {
+            log_warning("Recorded prepare request skipped: %s", ex.what());
+        }
+    }
+
+    std::string list;
+    for (const auto& feature : features) {
+        list += (list.empty() ? "" : ",") + feature;
+    }
+    return list;
+}
+
+std::map<std::string, std::string> workerParameters(
+    size_t poolSize, const std::string& twoPhaseFeatures, unsigned restoreDelay, std::chrono::milliseconds timeout)
+{
+    std::map<std::string, std::string> parameters;
+    parameters[AGENT_NAME_KEY]         = REPLAY_AGENT_NAME;
+    parameters[ENDPOINT_KEY]           = "";
+    parameters[SRR_VERSION_KEY]        = ACTIVE_VERSION;
+    parameters[REQUEST_TIMEOUT_KEY]    = std::to_string(timeout.count());
+    parameters[ENABLE_REBOOT_KEY]      = "false";
+    parameters[INTEGRITY_SCHEME_KEY]   = INTEGRITY_SCHEME_DEFAULT;
+    parameters[CONTINUOUS_BACKUP_KEY]  = "false";
+    parameters[TWO_PHASE_RESTORE_KEY]  = twoPhaseFeatures.empty() ? "false" : "true";
+    parameters[TWO_PHASE_FEATURES_KEY] = twoPhaseFeatures;
+    parameters[BUS_POOL_SIZE_KEY]      = std::to_string(poolSize);
+    parameters[RESTORE_DELAY_KEY]      = std::to_string(restoreDelay);
+    return parameters;
+}
+
+std::string saveRequest(const std::vector<std::string>& groups)
+{
+    SrrSaveRequest request;
+    request.m_passphrase = REPLAY_PASSPHRASE;
+    request.m_group_list = groups;
+
+    cxxtools::SerializationInfo si;
+    si <<= request;
+    return dto::srr::serializeJson(si, false);
+}
+
+// restore request of a save response, and the bytes of data of its features
+std::string restoreRequest(const std::string& saveJson, uint64_t& bytes)
+{
+    SrrSaveResponse response;
+    dto::srr::deserializeJson(saveJson) >>= response;
+
+    bytes = 0;
+    for (const auto& group : response.m_data) {
+        for (const auto& feature : group.m_features) {
+            bytes += feature.m_feature_and_status.feature().data().size();
+        }
+    }
+
+    auto data    = std::make_shared<SrrRestoreRequestDataV2>();
+    data->m_data = response.m_data;
+
+    SrrRestoreRequest request;
+    request.m_version    = response.m_version;
+    request.m_checksum   = response.m_checksum;
+    request.m_passphrase = REPLAY_PASSPHRASE;
+    request.m_data_ptr   = data;
+
+    cxxtools::SerializationInfo si;
+    si <<= request;
+    return dto::srr::serializeJson(si, false);
+}
+
+// median of the runs of run(), which returns the status of the request
+BenchResult measure(const std::string& name, unsigned runs, uint64_t bytes, const ReplayAgents& agents,
+    const std::function<std::string()>& run)
+{
+    std::vector<double> wallMs;
+    std::vector<double> peakRssKb;
+    std::vector<double> allocations;
+    std::vector<double> allocatedBytes;
+    uint64_t            unmatched = 0;
+
+    for (unsigned i = 0; i < runs; i++) {
+        const uint64_t unmatchedBefore = agents.unmatched();
+
+        Measure           runMeasure;
+        const std::string status = run();
+        runMeasure.stop();
+
+        if (status != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+            throw std::runtime_error(name + " failed with status " + status + ", " +
+                                     std::to_string(agents.unmatched() - unmatchedBefore) + " request(s) not recorded");
+        }
+        unmatched += agents.unmatched() - unmatchedBefore;
+
+        wallMs.push_back(runMeasure.wallMs());
+        peakRssKb.push_back(static_cast<double>(runMeasure.peakRssKb()));
+        allocations.push_back(static_cast<double>(runMeasure.allocations()));
+        allocatedBytes.push_back(static_cast<double>(runMeasure.allocatedBytes()));
+    }
+
+    BenchResult result;
+    result.m_name           = name;
+    result.m_runs           = runs;
+    result.m_wallMs         = median(wallMs);
+    result.m_bytes          = bytes;
+    result.m_bytesPerSec    = result.m_wallMs > 0 ? static_cast<double>(bytes) * 1000.0 / result.m_wallMs : 0;
+    result.m_peakRssKb      = static_cast<uint64_t>(*std::max_element(peakRssKb.begin(), peakRssKb.end()));
+    result.m_allocations    = static_cast<uint64_t>(median(allocations));
+    result.m_allocatedBytes = static_cast<uint64_t>(median(allocatedBytes));
+
+    result.m_extra["unmatched_requests"] = static_cast<double>(unmatched) / runs;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    ftylog_setInstance(REPLAY_AGENT_NAME, "");
+    ftylog_setLogLevelError(ftylog_getInstance());
+
+    bool        help       = false;
+    bool        onePhase   = false;
+    std::string operations = "save,restore";
+    std::string capture;
+    std::string output;
+    std::string baseline;
+    int         runs         = 1;
+    int         poolSize     = 4;
+    int         speed        = 100;
+    int         restoreDelay = 0;
+    int         timeout      = 60000;
+    int         tolerance    = 10;
+
+    // clang-format off
+    fty::CommandLine cmd("### - SRR save and restore replayed from a capture\n      Usage: fty-srr-replay [options]", {
+        {"--help|-h", help, "Show this help"},
+        {"--capture|-c", capture, "Capture file written by fty-srr (captureFile of its configuration)"},
+        {"--operations", operations, "Operations to run: save, restore or both (default save,restore)"},
+        {"--speed|-s", speed, "Recorded latencies applied, in percent, 0 to answer at once (default 100)"},
+        {"--one-phase", onePhase, "Restore without the prepare and commit steps, if the capture was made so"},
+        {"--timeout", timeout, "Timeout of a request to an agent in milliseconds, the ones timed out in the capture wait for it (default 60000)"},
+        {"--restore-delay|-d", restoreDelay, "Seconds given to an agent to apply a restored feature (default 0)"},
+        {"--runs|-r", runs, "Runs of each operation, the median is reported (default 1)"},
+        {"--pool|-p", poolSize, "Bus clients of the worker, 0 for one shared client (default 4)"},
+        {"--output|-o", output, "File where the JSON report is written (default standard output)"},
+        {"--baseline|-b", baseline, "JSON report to compare the results to"},
+        {"--tolerance|-t", tolerance, "Slowdown allowed against the baseline, in percent (default 10)"}
+    });
+    // clang-format on
+
+    if (auto res = cmd.parse(argc, argv); !res) {
+        std::cerr << res.error() << std::endl;
+        std::cout << cmd.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (help || capture.empty()) {
+        std::cout << cmd.help() << std::endl;
+        return help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    BenchReport report("replay");
+
+    try {
+        const bool save    = operations.find("save") != std::string::npos;
+        const bool restore = operations.find("restore") != std::string::npos;
+
+        const std::vector<SrrExchange> exchanges = SrrCapture::load(capture);
+        const std::vector<std::string> groups    = capturedGroups(exchanges);
+        if (groups.empty()) {
+            throw std::runtime_error("No save of a known feature in " + capture);
+        }
+        std::cerr << exchanges.size() << " exchanges, " << groups.size() << " group(s) saved" << std::endl;
+
+        // declared first: the broker outlives its clients
+        FakeBroker broker;
+
+        ReplayOptions options;
+        options.m_speed = std::max(0, speed) / 100.0;
+        ReplayAgents agents(broker, exchanges, options);
+
+        FakeMessageBus bus(broker, REPLAY_AGENT_NAME);
+        bus.connect();
+        SrrWorker worker(bus,
+            workerParameters(static_cast<size_t>(std::max(0, poolSize)),
+                onePhase ? std::string() : capturedTwoPhaseFeatures(exchanges),
+                static_cast<unsigned>(std::max(0, restoreDelay)), std::chrono::milliseconds(std::max(1000, timeout))),
+            {"1.0", "2.0", "2.1", "2.2"}, [&broker](const std::string& clientId) {
+                return std::unique_ptr<messagebus::MessageBus>(new FakeMessageBus(broker, clientId));
+            });
+
+        const unsigned    runCount        = static_cast<unsigned>(std::max(1, runs));
+        const std::string saveRequestJson = saveRequest(groups);
+        std::string       saveJson;
+        uint64_t          bytes = 0;
+
+        auto doSave = [&]() {
+            dto::UserData response = worker.requestSave(saveRequestJson);
+            saveJson               = response.back();
+            return response.front();
+        };
+
+        if (save) {
+            BenchResult result = measure("replay/save", runCount, 0, agents, doSave);
+            restoreRequest(saveJson, result.m_bytes);
+            std::cerr << result.m_name << ": " << result.m_wallMs << " ms" << std::endl;
+            report.add(result);
+        }
+
+        if (restore) {
+            if (saveJson.empty()) {
+                const std::string status = doSave();
+                if (status != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+                    throw std::runtime_error("Save of the restored payload failed with status " + status);
+                }
+            }
+            const std::string restoreJson = restoreRequest(saveJson, bytes);
+
+            BenchResult result = measure("replay/restore", runCount, bytes, agents, [&]() {
+                return worker.requestRestore(restoreJson).front();
+            });
+            std::cerr << result.m_name << ": " << result.m_wallMs << " ms" << std::endl;
+            report.add(result);
+        }
+
+        if (output.empty()) {
+            std::cout << report.json() << std::endl;
+        } else {
+            report.write(output);
+        }
+
+        if (!baseline.empty()) {
+            const size_t regressions = report.compare(BenchReport::load(baseline), tolerance / 100.0, std::cerr);
+            if (regressions > 0) {
+                std::cerr << "### - " << regressions << " operation(s) slower than the baseline" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "### - Error: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,495 @@
+/*  =========================================================================
+    fty-srr-sim - Virtual time simulation of restore scenarios
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+ * Replays restore scenarios against the mock agents on a virtual clock: request timeouts, agent latencies and the
+ * delays given to the agents between features take no wall time, thousands of restores run in seconds.
+ * Each scenario is drawn from a seed: nominal, one agent failing one step, a slow agent, an agent timing out, a
+ * feature missing from the payload or a corrupted one. All the scenarios are run with each scheduling policy, the
+ * simulated makespan of the restore and the downtime (from the first change sent to an agent to the end of the
+ * restore) are reported by policy and scenario kind.
+ */
+
+#include "fake_bus.h"
+#include "fty-srr.h"
+#include "fty_srr_groups.h"
+#include "fty_srr_worker.h"
+#include "helpers/clock.h"
+#include "helpers/event_loop.h"
+#include "mock_agents.h"
+#include "report.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fty/command-line.h>
+#include <fty/string-utils.h>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+
+using namespace srr;
+
+static constexpr const char* SIM_AGENT_NAME = "fty-srr-sim";
+static constexpr const char* SIM_PASSPHRASE = "Sim-Passphrase-1";
+static constexpr const char* SIM_SESSION    = "Sim-Session-1";
+
+static constexpr const char* SCENARIO_NOMINAL   = "nominal";
+static constexpr const char* SCENARIO_FAILURE   = "failure";
+static constexpr const char* SCENARIO_SLOW      = "slow";
+static constexpr const char* SCENARIO_TIMEOUT   = "timeout";
+static constexpr const char* SCENARIO_MISSING   = "missing";
+static constexpr const char* SCENARIO_CORRUPTED = "corrupted";
+static constexpr const char* SCENARIO_ALL       = "all";
+
+namespace {
+
+// configuration of the worker which drives the order and the overlap of the requests to the agents
+struct Policy
+{
+    std::string m_name;
+    bool        m_twoPhase;
+    size_t      m_poolSize; // features saved at once for the rollback snapshot, 0: one shared client
+};
+
+const std::vector<Policy> POLICIES = {
+    {"sequential", false, 0},
+    {"parallel-snapshot", false, 4},
+    {"two-phase", true, 0},
+    {"two-phase-parallel", true, 4},
+};
+
+const std::vector<std::string> KINDS = {
+    SCENARIO_NOMINAL, SCENARIO_FAILURE, SCENARIO_SLOW, SCENARIO_TIMEOUT, SCENARIO_MISSING, SCENARIO_CORRUPTED};
+
+// steps of a restore an agent may fail
+const std::vector<std::string> FAILING_ACTIONS = {"save", "prepare", "reset", "restore", "commit"};
+
+// requests which change the configuration of an agent
+bool isChange(const std::string& action)
+{
+    return action == "reset" || action == "restore" || action == "commit";
+}
+
+struct SimOptions
+{
+    MockAgentOptions          m_agents;
+    std::chrono::milliseconds m_timeout{60000};
+    unsigned                  m_restoreDelay = 6;
+    std::string               m_integrityScheme;
+};
+
+struct Scenario
+{
+    std::string               m_kind;
+    std::string               m_agent;  // failing, slow or timing out
+    std::string               m_action; // failed by m_agent
+    std::chrono::milliseconds m_latency{0};
+    std::string               m_group; // of the missing or corrupted feature
+    std::string               m_feature;
+};
+
+struct Outcome
+{
+    std::string m_status;
+    uint64_t    m_makespanMs = 0;
+    uint64_t    m_downtimeMs = 0;
+    uint64_t    m_requests   = 0;
+    size_t      m_prepared   = 0; // features left prepared by the restore
+};
+
+struct Stats
+{
+    std::vector<double>           m_makespanMs;
+    std::vector<double>           m_downtimeMs;
+    std::vector<double>           m_requests;
+    std::map<std::string, size_t> m_statuses;
+    double                        m_wallMs   = 0;
+    size_t                        m_prepared = 0;
+
+    void add(const Outcome& outcome, double wallMs)
+    {
+        m_makespanMs.push_back(static_cast<double>(outcome.m_makespanMs));
+        m_downtimeMs.push_back(static_cast<double>(outcome.m_downtimeMs));
+        m_requests.push_back(static_cast<double>(outcome.m_requests));
+        m_statuses[outcome.m_status]++;
+        m_wallMs += wallMs;
+        m_prepared += outcome.m_prepared;
+    }
+};
+
+// value below which ratio of the values are
+double percentile(std::vector<double> values, double ratio)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(ratio * static_cast<double>(values.size())))];
+}
+
+// messages with a delay are delivered by the timers of the event loop sending them, on its virtual clock
+void loopScheduler(std::chrono::milliseconds delay, std::function<void()> task)
+{
+    EventLoop* loop = EventLoop::current();
+    if (!loop) {
+        throw std::logic_error("Delayed message sent outside of an event loop");
+    }
+    loop->schedule(delay, task);
+}
+
+std::map<std::string, std::string> workerParameters(const Policy& policy, const SimOptions& options)
+{
+    std::map<std::string, std::string> parameters;
+    parameters[AGENT_NAME_KEY]        = SIM_AGENT_NAME;
+    parameters[ENDPOINT_KEY]          = "";
+    parameters[SRR_VERSION_KEY]       = ACTIVE_VERSION;
+    parameters[REQUEST_TIMEOUT_KEY]   = std::to_string(options.m_timeout.count());
+    parameters[ENABLE_REBOOT_KEY]     = "false";
+    parameters[INTEGRITY_SCHEME_KEY]  = options.m_integrityScheme;
+    parameters[CONTINUOUS_BACKUP_KEY] = "false";
+    parameters[TWO_PHASE_RESTORE_KEY] = policy.m_twoPhase ? "true" : "false";
+    parameters[BUS_POOL_SIZE_KEY]     = std::to_string(policy.m_poolSize);
+    parameters[RESTORE_DELAY_KEY]     = std::to_string(options.m_restoreDelay);
+    if (policy.m_twoPhase) {
+        // every mock agent supports prepare/commit/abort
+        std::string features;
+        for (const auto& feature : g_srrFeatureMap) {
+            features += (features.empty() ? "" : ",") + feature.first;
+        }
+        parameters[TWO_PHASE_FEATURES_KEY] = features;
+    }
+    return parameters;
+}
+
+SrrWorker::BusFactory busFactory(FakeBroker& broker)
+{
+    return [&broker](const std::string& clientId) {
+        return std::unique_ptr<messagebus::MessageBus>(new FakeMessageBus(broker, clientId));
+    };
+}
+
+// payload of a save of all the groups, the one restored by the scenarios
+SrrSaveResponse savedPayload(const SimOptions& options)
+{
+    auto       clock = std::make_shared<VirtualClock>();
+    FakeBroker broker(loopScheduler);
+    MockAgents agents(broker, options.m_agents);
+
+    FakeMessageBus bus(broker, SIM_AGENT_NAME);
+    bus.connect();
+    SrrWorker worker(bus, workerParameters(POLICIES.front(), options), {"1.0", "2.0", "2.1", "2.2"}, busFactory(broker),
+        clock);
+
+    SrrSaveRequest request;
+    request.m_passphrase = SIM_PASSPHRASE;
+    for (const auto& group : g_srrGroupMap) {
+        request.m_group_list.push_back(group.first);
+    }
+
+    cxxtools::SerializationInfo requestSi;
+    requestSi <<= request;
+
+    dto::UserData response = worker.requestSave(dto::srr::serializeJson(requestSi, false));
+    if (response.front() != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+        throw std::runtime_error("Save of the payload failed with status " + response.front());
+    }
+
+    SrrSaveResponse saved;
+    dto::srr::deserializeJson(response.back()) >>= saved;
+    return saved;
+}
+
+Scenario drawScenario(std::mt19937& random, const SrrSaveResponse& saved, const SimOptions& options)
+{
+    auto pick = [&random](size_t count) {
+        return std::uniform_int_distribution<size_t>(0, count - 1)(random);
+    };
+
+    Scenario scenario;
+    scenario.m_kind  = KINDS[pick(KINDS.size())];
+    scenario.m_agent = std::next(g_agentToQueue.begin(), static_cast<long>(pick(g_agentToQueue.size())))->first;
+
+    const Group& group = saved.m_data[pick(saved.m_data.size())];
+    scenario.m_group   = group.m_group_id;
+    if (!group.m_features.empty()) {
+        scenario.m_feature = group.m_features[pick(group.m_features.size())].m_feature_name;
+    }
+
+    if (scenario.m_kind == SCENARIO_FAILURE) {
+        scenario.m_action = FAILING_ACTIONS[pick(FAILING_ACTIONS.size())];
+    } else if (scenario.m_kind == SCENARIO_SLOW) {
+        // slower than usual, still within the timeout
+        const int64_t timeout = options.m_timeout.count();
+        scenario.m_latency    = std::chrono::milliseconds(
+            std::uniform_int_distribution<int64_t>(std::min<int64_t>(1000, timeout / 2), timeout / 2)(random));
+    } else if (scenario.m_kind == SCENARIO_TIMEOUT) {
+        scenario.m_latency = options.m_timeout + std::chrono::milliseconds(1000);
+    }
+
+    return scenario;
+}
+
+std::string restoreRequest(SrrSaveResponse payload, const Scenario& scenario)
+{
+    for (auto& group : payload.m_data) {
+        if (group.m_group_id != scenario.m_group) {
+            continue;
+        }
+        for (auto feature = group.m_features.begin(); feature != group.m_features.end(); feature++) {
+            if (feature->m_feature_name != scenario.m_feature) {
+                continue;
+            }
+            if (scenario.m_kind == SCENARIO_MISSING) {
+                group.m_features.erase(feature);
+            } else if (scenario.m_kind == SCENARIO_CORRUPTED) {
+                auto* data = feature->m_feature_and_status.mutable_feature()->mutable_data();
+                data->insert(data->begin(), ' ');
+            }
+            break;
+        }
+    }
+
+    auto data    = std::make_shared<SrrRestoreRequestDataV2>();
+    data->m_data = payload.m_data;
+
+    SrrRestoreRequest request;
+    request.m_version      = payload.m_version;
+    request.m_checksum     = payload.m_checksum;
+    request.m_passphrase   = SIM_PASSPHRASE;
+    request.m_sessionToken = SIM_SESSION;
+    request.m_data_ptr     = data;
+
+    cxxtools::SerializationInfo si;
+    si <<= request;
+    return dto::srr::serializeJson(si, false);
+}
+
+Outcome runScenario(const Policy& policy, const Scenario& scenario, const std::string& restoreJson,
+    const SimOptions& options)
+{
+    auto clock = std::make_shared<VirtualClock>();
+
+    // declared first: the broker outlives its clients
+    FakeBroker broker(loopScheduler);
+
+    std::map<std::string, MockAgentOptions> byAgent;
+    MockAgentOptions                        affected = options.m_agents;
+    if (scenario.m_kind == SCENARIO_FAILURE) {
+        affected.m_failingActions.insert(scenario.m_action);
+        byAgent[scenario.m_agent] = affected;
+    } else if (scenario.m_kind == SCENARIO_SLOW || scenario.m_kind == SCENARIO_TIMEOUT) {
+        affected.m_latency        = scenario.m_latency;
+        byAgent[scenario.m_agent] = affected;
+    }
+    MockAgents agents(broker, options.m_agents, byAgent);
+
+    // first request changing the configuration of an agent, the replies come back on the reply queue
+    const std::string replyQueue  = std::string(SIM_AGENT_NAME) + ".reply";
+    Clock::time_point firstChange = Clock::time_point::max();
+    broker.tap([&](const std::string& queue, const messagebus::Message& message) {
+        auto subject = message.metaData().find(messagebus::Message::SUBJECT);
+        if (queue != replyQueue && subject != message.metaData().end() && isChange(subject->second)) {
+            firstChange = std::min(firstChange, clock->now());
+        }
+    });
+
+    FakeMessageBus bus(broker, SIM_AGENT_NAME);
+    bus.connect();
+    SrrWorker worker(bus, workerParameters(policy, options), {"1.0", "2.0", "2.1", "2.2"}, busFactory(broker), clock);
+
+    const Clock::time_point start    = clock->now();
+    dto::UserData           response = worker.requestRestore(restoreJson);
+    const Clock::time_point end      = clock->now();
+
+    Outcome outcome;
+    outcome.m_status     = response.front();
+    outcome.m_makespanMs = elapsedMs(*clock, start);
+    outcome.m_downtimeMs = firstChange < end ? elapsedMs(*clock, firstChange) : 0;
+    outcome.m_requests   = agents.requests();
+    outcome.m_prepared   = agents.prepared();
+    return outcome;
+}
+
+BenchResult toResult(const std::string& name, const Stats& stats)
+{
+    BenchResult result;
+    result.m_name   = name;
+    result.m_runs   = stats.m_makespanMs.size();
+    result.m_wallMs = stats.m_wallMs;
+
+    result.m_extra["makespan_ms_p50"] = percentile(stats.m_makespanMs, 0.5);
+    result.m_extra["makespan_ms_p95"] = percentile(stats.m_makespanMs, 0.95);
+    result.m_extra["makespan_ms_max"] = percentile(stats.m_makespanMs, 1.0);
+    result.m_extra["downtime_ms_p50"] = percentile(stats.m_downtimeMs, 0.5);
+    result.m_extra["downtime_ms_p95"] = percentile(stats.m_downtimeMs, 0.95);
+    result.m_extra["downtime_ms_max"] = percentile(stats.m_downtimeMs, 1.0);
+    result.m_extra["agent_requests"]  = median(stats.m_requests);
+    result.m_extra["prepared_left"]   = static_cast<double>(stats.m_prepared);
+    for (const auto& status : stats.m_statuses) {
+        result.m_extra["status_" + status.first] = static_cast<double>(status.second);
+    }
+    return result;
+}
+
+void printRow(const std::string& policy, const std::string& kind, const Stats& stats)
+{
+    const auto success = stats.m_statuses.find(dto::srr::statusToString(dto::srr::Status::SUCCESS));
+    const auto count   = stats.m_makespanMs.size();
+
+    std::cerr << std::left << std::setw(20) << policy << std::setw(11) << kind << std::right << std::setw(7) << count
+              << std::fixed << std::setprecision(1) << std::setw(11) << percentile(stats.m_makespanMs, 0.5) / 1000
+              << std::setw(11) << percentile(stats.m_makespanMs, 0.95) / 1000 << std::setw(11)
+              << percentile(stats.m_downtimeMs, 0.5) / 1000 << std::setw(11)
+              << percentile(stats.m_downtimeMs, 0.95) / 1000 << std::setw(10)
+              << (success != stats.m_statuses.end() && count > 0 ? 100.0 * success->second / count : 0.0) << "%"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    ftylog_setInstance(SIM_AGENT_NAME, "");
+
+    bool        help      = false;
+    bool        verbose   = false;
+    std::string policies  = SCENARIO_ALL;
+    std::string integrity = INTEGRITY_SCHEME_DEFAULT;
+    std::string output;
+    int         scenarios    = 1000;
+    int         seed         = 1;
+    int         latency      = 200;
+    int         jitter       = 100;
+    int         timeout      = 60000;
+    int         restoreDelay = 6;
+    int         payloadSize  = 1024;
+
+    // clang-format off
+    fty::CommandLine cmd("### - SRR restore simulation on a virtual clock\n      Usage: fty-srr-sim [options]", {
+        {"--help|-h", help, "Show this help"},
+        {"--verbose|-v", verbose, "Log the errors of the worker"},
+        {"--scenarios|-n", scenarios, "Restore scenarios run with each policy (default 1000)"},
+        {"--seed|-s", seed, "Seed of the scenarios (default 1)"},
+        {"--policies|-p", policies, "Policies, comma separated: sequential, parallel-snapshot, two-phase, two-phase-parallel or all (default all)"},
+        {"--integrity|-i", integrity, "Integrity scheme of the restored payload: legacy or merkle-sha256 (default legacy)"},
+        {"--latency|-l", latency, "Latency of the agents in milliseconds (default 200)"},
+        {"--jitter|-j", jitter, "Random latency added, up to, in milliseconds (default 100)"},
+        {"--timeout|-t", timeout, "Timeout of a request to an agent in milliseconds (default 60000)"},
+        {"--restore-delay|-d", restoreDelay, "Seconds given to an agent to apply a restored feature (default 6)"},
+        {"--payload", payloadSize, "Bytes of the data of a feature (default 1024)"},
+        {"--output|-o", output, "File where the JSON report is written (default standard output)"}
+    });
+    // clang-format on
+
+    if (auto res = cmd.parse(argc, argv); !res) {
+        std::cerr << res.error() << std::endl;
+        std::cout << cmd.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (help) {
+        std::cout << cmd.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if (verbose) {
+        ftylog_setLogLevelError(ftylog_getInstance());
+    } else {
+        // failures are the point of most scenarios
+        ftylog_setLogLevelFatal(ftylog_getInstance());
+    }
+
+    SimOptions options;
+    options.m_agents.m_payloadSize = static_cast<size_t>(std::max(0, payloadSize));
+    options.m_agents.m_latency     = std::chrono::milliseconds(std::max(0, latency));
+    options.m_agents.m_jitter      = std::chrono::milliseconds(std::max(0, jitter));
+    options.m_timeout              = std::chrono::milliseconds(std::max(1000, timeout));
+    options.m_restoreDelay         = static_cast<unsigned>(std::max(0, restoreDelay));
+    options.m_integrityScheme      = integrity;
+
+    BenchReport report("restore-simulation");
+
+    try {
+        std::vector<Policy> selected;
+        for (const auto& name : fty::split(policies, ",", fty::SplitOption::Trim)) {
+            auto policy = std::find_if(POLICIES.begin(), POLICIES.end(), [&](const Policy& p) {
+                return p.m_name == name;
+            });
+            if (name == SCENARIO_ALL) {
+                selected = POLICIES;
+            } else if (policy == POLICIES.end()) {
+                throw std::invalid_argument("Unknown policy " + name);
+            } else {
+                selected.push_back(*policy);
+            }
+        }
+
+        const SrrSaveResponse saved = savedPayload(options);
+
+        // the same scenarios for all the policies
+        std::mt19937          random(static_cast<uint32_t>(seed));
+        std::vector<Scenario> drawn;
+        for (int i = 0; i < scenarios; i++) {
+            drawn.push_back(drawScenario(random, saved, options));
+        }
+
+        std::cerr << std::left << std::setw(20) << "policy" << std::setw(11) << "scenario" << std::right
+                  << std::setw(7) << "runs" << std::setw(11) << "span p50 s" << std::setw(11) << "span p95 s"
+                  << std::setw(11) << "down p50 s" << std::setw(11) << "down p95 s" << std::setw(11) << "success"
+                  << std::endl;
+
+        for (const auto& policy : selected) {
+            std::map<std::string, Stats> byKind;
+
+            for (const auto& scenario : drawn) {
+                const std::string restoreJson = restoreRequest(saved, scenario);
+
+                const auto    wallStart = std::chrono::steady_clock::now();
+                const Outcome outcome   = runScenario(policy, scenario, restoreJson, options);
+                const double  wallMs =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+                byKind[scenario.m_kind].add(outcome, wallMs);
+                byKind[SCENARIO_ALL].add(outcome, wallMs);
+            }
+
+            for (const auto& kind : byKind) {
+                printRow(policy.m_name, kind.first, kind.second);
+                report.add(toResult("policy=" + policy.m_name + "/scenario=" + kind.first, kind.second));
+            }
+        }
+
+        if (output.empty()) {
+            std::cout << report.json() << std::endl;
+        } else {
+            report.write(output);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "### - Error: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/*  =========================================================================
+    measure - Wall time, allocations and peak RSS of a benchmark run
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "measure.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+// counted replacement of the global allocation functions, the other forms of new and delete end up here
+static std::atomic<uint64_t> g_allocationCount{0};
+static std::atomic<uint64_t> g_allocationBytes{0};
+
+void* operator new(std::size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace srr {
+
+AllocationCounters allocations()
+{
+    AllocationCounters counters;
+    counters.m_count = g_allocationCount.load(std::memory_order_relaxed);
+    counters.m_bytes = g_allocationBytes.load(std::memory_order_relaxed);
+    return counters;
+}
+
+uint64_t peakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoull(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+bool resetPeakRss()
+{
+    // 5: reset the peak resident set size of the process
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Measure::Measure()
+{
+    resetPeakRss();
+    m_startAllocations = srr::allocations();
+    m_start            = std::chrono::steady_clock::now();
+}
+
+void Measure::stop()
+{
+    m_wall = std::chrono::steady_clock::now() - m_start;
+
+    const AllocationCounters end = srr::allocations();
+    m_allocations.m_count        = end.m_count - m_startAllocations.m_count;
+    m_allocations.m_bytes        = end.m_bytes - m_startAllocations.m_bytes;
+    m_peakRssKb                  = srr::peakRssKb();
+}
+
+double Measure::wallMs() const
+{
+    return std::chrono::duration<double, std::milli>(m_wall).count();
+}
+
+uint64_t Measure::allocations() const
+{
+    return m_allocations.m_count;
+}
+
+uint64_t Measure::allocatedBytes() const
+{
+    return m_allocations.m_bytes;
+}
+
+uint64_t Measure::peakRssKb() const
+{
+    return m_peakRssKb;
+}
+
+} // namespace srr
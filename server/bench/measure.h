@@ -0,0 +1,67 @@
+/*  =========================================================================
+    measure - Wall time, allocations and peak RSS of a benchmark run
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace srr {
+
+// operator new calls of the process since it started, counted by the benchmark executables only
+struct AllocationCounters
+{
+    uint64_t m_count = 0;
+    uint64_t m_bytes = 0;
+};
+
+AllocationCounters allocations();
+
+// peak resident set size of the process (VmHWM), in KiB. 0 if unknown.
+uint64_t peakRssKb();
+// restart the peak from the current RSS, false if the kernel does not support it
+bool resetPeakRss();
+
+/**
+ * Measure of a run, from its construction to stop(). The peak RSS is the one of the process, reset at the start:
+ * runs must not overlap.
+ */
+class Measure
+{
+public:
+    Measure();
+
+    void stop();
+
+    double   wallMs() const;
+    uint64_t allocations() const;
+    uint64_t allocatedBytes() const;
+    uint64_t peakRssKb() const;
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::duration   m_wall{0};
+    AllocationCounters                    m_startAllocations;
+    AllocationCounters                    m_allocations;
+    uint64_t                              m_peakRssKb = 0;
+};
+
+} // namespace srr
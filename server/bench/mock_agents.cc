@@ -0,0 +1,290 @@
+/*  =========================================================================
+    mock_agents - Stand-in SRR agents answering with synthetic payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "mock_agents.h"
+#include "fty_srr_groups.h"
+#include <fty_common_dto.h>
+#include <fty_log.h>
+#include <stdexcept>
+
+using namespace dto::srr;
+
+namespace srr {
+
+static constexpr const char* MOCK_VERSION = "1.0";
+
+// size bytes of data, deterministic for a seed
+static std::string syntheticPayload(size_t size, bool json, uint32_t seed)
+{
+    static constexpr const char* PREFIX = "{\"payload\":\"";
+    static constexpr const char* SUFFIX = "\"}";
+
+    const size_t framing = json ? std::char_traits<char>::length(PREFIX) + std::char_traits<char>::length(SUFFIX) : 0;
+    const size_t body    = size > framing ? size - framing : 0;
+
+    std::string payload;
+    payload.reserve(framing + body);
+    if (json) {
+        payload += PREFIX;
+    }
+
+    std::mt19937 random(seed);
+    for (size_t i = 0; i < body; i++) {
+        payload += static_cast<char>('a' + random() % 26);
+    }
+
+    if (json) {
+        payload += SUFFIX;
+    }
+    return payload;
+}
+
+MockAgent::MockAgent(
+    FakeBroker& broker, const std::string& agentName, const std::string& queue, const MockAgentOptions& options)
+    : m_broker(broker)
+    , m_bus(broker, agentName)
+    , m_agentName(agentName)
+    , m_options(options)
+    , m_random(options.m_seed)
+    , m_payload(syntheticPayload(options.m_payloadSize, options.m_jsonPayload, options.m_seed))
+{
+    m_bus.connect();
+    m_bus.receive(queue, [this](messagebus::Message message) {
+        onRequest(message);
+    });
+}
+
+const std::string& MockAgent::name() const
+{
+    return m_agentName;
+}
+
+uint64_t MockAgent::requests() const
+{
+    return m_requests;
+}
+
+uint64_t MockAgent::failures() const
+{
+    return m_failures;
+}
+
+size_t MockAgent::prepared() const
+{
+    return m_prepared.size();
+}
+
+void MockAgent::onRequest(messagebus::Message message)
+{
+    m_requests++;
+
+    const auto& metaData = message.metaData();
+    auto        replyTo  = metaData.find(messagebus::Message::REPLY_TO);
+    auto        subject  = metaData.find(messagebus::Message::SUBJECT);
+    if (replyTo == metaData.end() || subject == metaData.end()) {
+        log_warning("Mock agent %s: request without reply queue or subject dropped", m_agentName.c_str());
+        return;
+    }
+
+    messagebus::Message reply;
+    reply.metaData()[messagebus::Message::SUBJECT] = subject->second;
+    reply.metaData()[messagebus::Message::FROM]    = m_agentName;
+    reply.metaData()[messagebus::Message::STATUS]  = "ok";
+
+    auto from = metaData.find(messagebus::Message::FROM);
+    if (from != metaData.end()) {
+        reply.metaData()[messagebus::Message::TO] = from->second;
+    }
+    auto correlationId = metaData.find(messagebus::Message::CORRELATION_ID);
+    if (correlationId != metaData.end()) {
+        reply.metaData()[messagebus::Message::CORRELATION_ID] = correlationId->second;
+    }
+
+    try {
+        reply.userData() = answer(subject->second, message.userData());
+    } catch (const std::exception& ex) {
+        reply.metaData()[messagebus::Message::STATUS] = "ko";
+        reply.userData()                              = {ex.what()};
+    }
+
+    m_broker.deliver(replyTo->second, reply, latency());
+}
+
+dto::UserData MockAgent::answer(const std::string& subject, dto::UserData& data)
+{
+    dto::UserData reply;
+
+    if (subject == "save") {
+        Query query;
+        data >> query;
+
+        std::map<FeatureName, FeatureAndStatus> features;
+        for (int i = 0; i < query.save().features_size(); i++) {
+            FeatureAndStatus& feature = features[query.save().features(i)];
+            if (fails(subject)) {
+                feature.mutable_status()->set_status(Status::FAILED);
+                feature.mutable_status()->set_error("Mock failure");
+            } else {
+                feature.mutable_feature()->set_version(MOCK_VERSION);
+                feature.mutable_feature()->set_data(m_payload);
+                feature.mutable_status()->set_status(Status::SUCCESS);
+            }
+        }
+        reply << createSaveResponse(features, MOCK_VERSION);
+    } else if (subject == "restore" || subject == "prepare") {
+        Query query;
+        data >> query;
+
+        std::map<FeatureName, FeatureStatus> statuses;
+        for (const auto& feature : query.restore().map_features_data()) {
+            if (fails(subject)) {
+                statuses[feature.first].set_status(Status::FAILED);
+                continue;
+            }
+            statuses[feature.first].set_status(Status::SUCCESS);
+            if (subject == "restore") {
+                m_revisions[feature.first]++;
+            } else {
+                m_prepared.insert(feature.first);
+            }
+        }
+        reply << createRestoreResponse(statuses);
+    } else if (subject == "commit" || subject == "abort") {
+        // restore query naming the prepared features, without their data
+        Query query;
+        data >> query;
+
+        if (query.restore().session_token().empty()) {
+            throw std::invalid_argument("Missing session token");
+        }
+
+        std::map<FeatureName, FeatureStatus> statuses;
+        for (const auto& feature : query.restore().map_features_data()) {
+            const auto& featureName = feature.first;
+            if (m_prepared.count(featureName) == 0) {
+                statuses[featureName].set_status(Status::FAILED);
+                statuses[featureName].set_error("Feature not prepared");
+                m_failures++;
+                continue;
+            }
+            if (fails(subject)) {
+                statuses[featureName].set_status(Status::FAILED);
+                continue;
+            }
+            statuses[featureName].set_status(Status::SUCCESS);
+            m_prepared.erase(featureName);
+            if (subject == "commit") {
+                m_revisions[featureName]++;
+            }
+        }
+        reply << createRestoreResponse(statuses);
+    } else if (subject == "reset") {
+        Query query;
+        data >> query;
+
+        std::map<FeatureName, FeatureStatus> statuses;
+        for (int i = 0; i < query.reset().features_size(); i++) {
+            statuses[query.reset().features(i)].set_status(fails(subject) ? Status::FAILED : Status::SUCCESS);
+            m_revisions[query.reset().features(i)]++;
+        }
+        reply << createResetResponse(statuses);
+    } else if (subject == "revision") {
+        if (data.empty()) {
+            throw std::invalid_argument("Missing feature name");
+        }
+        reply.push_back(m_agentName + "-" + std::to_string(m_revisions[data.front()]));
+    } else {
+        throw std::invalid_argument("Unsupported action " + subject);
+    }
+
+    return reply;
+}
+
+bool MockAgent::fails(const std::string& action)
+{
+    if (m_options.m_failingActions.count(action) > 0) {
+        m_failures++;
+        return true;
+    }
+    if (m_options.m_failureRate <= 0.0) {
+        return false;
+    }
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(m_random) >= m_options.m_failureRate) {
+        return false;
+    }
+    m_failures++;
+    return true;
+}
+
+std::chrono::milliseconds MockAgent::latency()
+{
+    if (m_options.m_jitter.count() <= 0) {
+        return m_options.m_latency;
+    }
+    return m_options.m_latency +
+           std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(0, m_options.m_jitter.count())(m_random));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MockAgents::MockAgents(
+    FakeBroker& broker, const MockAgentOptions& defaults, const std::map<std::string, MockAgentOptions>& byAgent)
+{
+    for (const auto& agent : g_agentToQueue) {
+        auto options = byAgent.find(agent.first);
+        m_agents[agent.first].reset(
+            new MockAgent(broker, agent.first, agent.second, options != byAgent.end() ? options->second : defaults));
+    }
+}
+
+MockAgent& MockAgents::agent(const std::string& agentName)
+{
+    return *m_agents.at(agentName);
+}
+
+uint64_t MockAgents::requests() const
+{
+    uint64_t requests = 0;
+    for (const auto& agent : m_agents) {
+        requests += agent.second->requests();
+    }
+    return requests;
+}
+
+uint64_t MockAgents::failures() const
+{
+    uint64_t failures = 0;
+    for (const auto& agent : m_agents) {
+        failures += agent.second->failures();
+    }
+    return failures;
+}
+
+size_t MockAgents::prepared() const
+{
+    size_t prepared = 0;
+    for (const auto& agent : m_agents) {
+        prepared += agent.second->prepared();
+    }
+    return prepared;
+}
+
+} // namespace srr
@@ -0,0 +1,113 @@
+/*  =========================================================================
+    mock_agents - Stand-in SRR agents answering with synthetic payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fake_bus.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fty_userdata_dto.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+
+namespace srr {
+
+struct MockAgentOptions
+{
+    size_t                    m_payloadSize = 1024; // bytes of the data of a saved feature
+    bool                      m_jsonPayload = true; // data is a JSON document, else opaque text
+    std::chrono::milliseconds m_latency{0};         // time to answer a request
+    std::chrono::milliseconds m_jitter{0};          // random latency added, up to
+    double                    m_failureRate = 0.0;  // ratio of the features answered with a failure
+    uint32_t                  m_seed        = 1;
+    std::set<std::string>     m_failingActions;     // actions always answered with a failure
+};
+
+/**
+ * Agent answering save, restore, reset, prepare, commit, abort and revision requests on its queue, as the real
+ * agents do, with synthetic data. The revision of a feature changes when it is restored, committed or reset.
+ * A commit or an abort must come with a session token, for a feature prepared before.
+ * Requests are handled by the thread delivering them: the one of the broker, or the sender's if it has a scheduler.
+ */
+class MockAgent
+{
+public:
+    MockAgent(FakeBroker& broker, const std::string& agentName, const std::string& queue,
+        const MockAgentOptions& options);
+
+    MockAgent(const MockAgent&) = delete;
+    MockAgent& operator=(const MockAgent&) = delete;
+
+    const std::string& name() const;
+
+    // requests received, and features answered with a failure
+    uint64_t requests() const;
+    uint64_t failures() const;
+    // features prepared, neither committed nor aborted yet
+    size_t prepared() const;
+
+private:
+    FakeBroker&      m_broker;
+    FakeMessageBus   m_bus;
+    std::string      m_agentName;
+    MockAgentOptions m_options;
+    std::mt19937     m_random;
+    std::string      m_payload; // data of the saved features, generated once
+
+    std::map<std::string, uint64_t> m_revisions;
+    std::set<std::string>           m_prepared;
+
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_failures{0};
+
+    void onRequest(messagebus::Message message);
+    // reply data of a request with subject
+    dto::UserData answer(const std::string& subject, dto::UserData& data);
+
+    bool                      fails(const std::string& action);
+    std::chrono::milliseconds latency();
+};
+
+/**
+ * One mock agent per agent of g_agentToQueue: config, asset, alert, security wallet, USM, automatic groups and
+ * EMC4J. The options of an agent default to the ones given for all.
+ */
+class MockAgents
+{
+public:
+    MockAgents(FakeBroker& broker, const MockAgentOptions& defaults,
+        const std::map<std::string, MockAgentOptions>& byAgent = {});
+
+    MockAgent& agent(const std::string& agentName);
+
+    uint64_t requests() const;
+    uint64_t failures() const;
+    size_t   prepared() const;
+
+private:
+    std::map<std::string, std::unique_ptr<MockAgent>> m_agents;
+};
+
+} // namespace srr
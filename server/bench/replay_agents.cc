@@ -0,0 +1,130 @@
+/*  =========================================================================
+    replay_agents - Stand-in SRR agents answering with the replies of a capture
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "replay_agents.h"
+#include "fty_srr_groups.h"
+#include <fty_log.h>
+
+namespace srr {
+
+std::string replayKey(const std::string& agentName, const std::string& action, const dto::UserData& frames)
+{
+    std::string key = agentName + "/" + action;
+    for (const auto& feature : requestFeatures(action, frames)) {
+        key += "/" + feature;
+    }
+    return key;
+}
+
+ReplayAgents::ReplayAgents(
+    FakeBroker& broker, const std::vector<SrrExchange>& exchanges, const ReplayOptions& options)
+    : m_broker(broker)
+    , m_options(options)
+{
+    std::map<std::string, std::string> queues(g_agentToQueue.begin(), g_agentToQueue.end());
+    for (const auto& exchange : exchanges) {
+        queues.emplace(exchange.m_agent, exchange.m_queue);
+        try {
+            m_recorded[replayKey(exchange.m_agent, exchange.m_action, exchange.m_request)].m_exchanges.push_back(
+                exchange);
+        } catch (const std::exception& ex) {
+            log_warning("Recorded %s request to %s skipped: %s", exchange.m_action.c_str(), exchange.m_agent.c_str(),
+                ex.what());
+        }
+    }
+
+    for (const auto& queue : queues) {
+        const std::string agentName = queue.first;
+
+        m_buses.emplace_back(new FakeMessageBus(broker, agentName));
+        m_buses.back()->connect();
+        m_buses.back()->receive(queue.second, [this, agentName](messagebus::Message message) {
+            onRequest(agentName, message);
+        });
+    }
+}
+
+uint64_t ReplayAgents::served() const
+{
+    return m_served;
+}
+
+uint64_t ReplayAgents::unmatched() const
+{
+    return m_unmatched;
+}
+
+void ReplayAgents::onRequest(const std::string& agentName, messagebus::Message message)
+{
+    const auto& metaData = message.metaData();
+    auto        replyTo  = metaData.find(messagebus::Message::REPLY_TO);
+    auto        subject  = metaData.find(messagebus::Message::SUBJECT);
+    if (replyTo == metaData.end() || subject == metaData.end()) {
+        log_warning("Replay agent %s: request without reply queue or subject dropped", agentName.c_str());
+        return;
+    }
+
+    messagebus::Message reply;
+    reply.metaData()[messagebus::Message::SUBJECT] = subject->second;
+    reply.metaData()[messagebus::Message::FROM]    = agentName;
+    reply.metaData()[messagebus::Message::STATUS]  = "ok";
+
+    auto from = metaData.find(messagebus::Message::FROM);
+    if (from != metaData.end()) {
+        reply.metaData()[messagebus::Message::TO] = from->second;
+    }
+    auto correlationId = metaData.find(messagebus::Message::CORRELATION_ID);
+    if (correlationId != metaData.end()) {
+        reply.metaData()[messagebus::Message::CORRELATION_ID] = correlationId->second;
+    }
+
+    const SrrExchange* exchange = nullptr;
+    try {
+        auto recorded = m_recorded.find(replayKey(agentName, subject->second, message.userData()));
+        if (recorded != m_recorded.end()) {
+            Recorded& replies = recorded->second;
+            exchange          = &replies.m_exchanges[std::min(replies.m_next, replies.m_exchanges.size() - 1)];
+            replies.m_next++;
+        }
+    } catch (const std::exception& ex) {
+        log_warning("Replay agent %s: invalid %s request: %s", agentName.c_str(), subject->second.c_str(), ex.what());
+    }
+
+    if (!exchange) {
+        m_unmatched++;
+        reply.metaData()[messagebus::Message::STATUS] = "ko";
+        reply.userData()                              = {"Not recorded"};
+        m_broker.deliver(replyTo->second, reply);
+        return;
+    }
+
+    m_served++;
+    if (!exchange->m_error.empty()) {
+        // timed out when captured
+        return;
+    }
+    const double latencyMs = static_cast<double>(exchange->m_latencyMs) * m_options.m_speed;
+
+    reply.userData() = exchange->m_reply;
+    m_broker.deliver(replyTo->second, reply, std::chrono::milliseconds(static_cast<int64_t>(latencyMs)));
+}
+
+} // namespace srr
@@ -0,0 +1,80 @@
+/*  =========================================================================
+    replay_agents - Stand-in SRR agents answering with the replies of a capture
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fake_bus.h"
+#include "fty_srr_capture.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+struct ReplayOptions
+{
+    double m_speed = 1.0; // factor of the recorded latencies, 0: replies sent at once
+};
+
+/**
+ * One agent per agent of g_agentToQueue and of the capture, answering a request with the reply recorded for a
+ * request of the same action on the same features. The replies recorded for identical requests are served in their
+ * order, the last one again once all were. A request timed out in the capture is left unanswered, one which was not
+ * recorded is answered with an error.
+ * Requests are handled by the thread delivering them: the one of the broker, or the sender's if it has a scheduler.
+ */
+class ReplayAgents
+{
+public:
+    ReplayAgents(FakeBroker& broker, const std::vector<SrrExchange>& exchanges, const ReplayOptions& options);
+
+    ReplayAgents(const ReplayAgents&) = delete;
+    ReplayAgents& operator=(const ReplayAgents&) = delete;
+
+    // requests answered with a recorded reply, and the ones which were not recorded
+    uint64_t served() const;
+    uint64_t unmatched() const;
+
+private:
+    struct Recorded
+    {
+        std::vector<SrrExchange> m_exchanges;
+        size_t                   m_next = 0;
+    };
+
+    FakeBroker&                                  m_broker;
+    ReplayOptions                                m_options;
+    std::vector<std::unique_ptr<FakeMessageBus>> m_buses;
+    std::map<std::string, Recorded>              m_recorded; // by key
+
+    std::atomic<uint64_t> m_served{0};
+    std::atomic<uint64_t> m_unmatched{0};
+
+    void onRequest(const std::string& agentName, messagebus::Message message);
+};
+
+// key of an exchange of agentName: the action and the features of the request
+std::string replayKey(const std::string& agentName, const std::string& action, const dto::UserData& frames);
+
+} // namespace srr
@@ -0,0 +1,168 @@
+/*  =========================================================================
+    report - Machine-readable results of a benchmark and baseline comparison
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "report.h"
+#include "fty_srr_exception.h"
+#include <algorithm>
+#include <fstream>
+#include <fty_common_dto.h>
+#include <sstream>
+
+namespace srr {
+
+static constexpr const char* SI_BENCHMARK       = "benchmark";
+static constexpr const char* SI_RESULTS         = "results";
+static constexpr const char* SI_NAME            = "name";
+static constexpr const char* SI_RUNS            = "runs";
+static constexpr const char* SI_WALL_MS         = "wall_ms";
+static constexpr const char* SI_BYTES           = "bytes";
+static constexpr const char* SI_BYTES_PER_SEC   = "bytes_per_sec";
+static constexpr const char* SI_PEAK_RSS_KB     = "peak_rss_kb";
+static constexpr const char* SI_ALLOCATIONS     = "allocations";
+static constexpr const char* SI_ALLOCATED_BYTES = "allocated_bytes";
+static constexpr const char* SI_EXTRA           = "extra";
+
+void operator<<=(cxxtools::SerializationInfo& si, const BenchResult& result)
+{
+    si.addMember(SI_NAME) <<= result.m_name;
+    si.addMember(SI_RUNS) <<= result.m_runs;
+    si.addMember(SI_WALL_MS) <<= result.m_wallMs;
+    si.addMember(SI_BYTES) <<= result.m_bytes;
+    si.addMember(SI_BYTES_PER_SEC) <<= result.m_bytesPerSec;
+    si.addMember(SI_PEAK_RSS_KB) <<= result.m_peakRssKb;
+    si.addMember(SI_ALLOCATIONS) <<= result.m_allocations;
+    si.addMember(SI_ALLOCATED_BYTES) <<= result.m_allocatedBytes;
+
+    cxxtools::SerializationInfo& extraSi = si.addMember(SI_EXTRA);
+    extraSi.setCategory(cxxtools::SerializationInfo::Category::Object);
+    for (const auto& extra : result.m_extra) {
+        extraSi.addMember(extra.first) <<= extra.second;
+    }
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, BenchResult& result)
+{
+    si.getMember(SI_NAME) >>= result.m_name;
+    si.getMember(SI_RUNS) >>= result.m_runs;
+    si.getMember(SI_WALL_MS) >>= result.m_wallMs;
+    si.getMember(SI_BYTES) >>= result.m_bytes;
+    si.getMember(SI_BYTES_PER_SEC) >>= result.m_bytesPerSec;
+    si.getMember(SI_PEAK_RSS_KB) >>= result.m_peakRssKb;
+    si.getMember(SI_ALLOCATIONS) >>= result.m_allocations;
+    si.getMember(SI_ALLOCATED_BYTES) >>= result.m_allocatedBytes;
+
+    const cxxtools::SerializationInfo* extraSi = si.findMember(SI_EXTRA);
+    if (extraSi != nullptr) {
+        for (const auto& extra : *extraSi) {
+            extra >>= result.m_extra[extra.name()];
+        }
+    }
+}
+
+BenchReport::BenchReport(const std::string& benchmark)
+    : m_benchmark(benchmark)
+{
+}
+
+void BenchReport::add(const BenchResult& result)
+{
+    m_results.push_back(result);
+}
+
+const std::vector<BenchResult>& BenchReport::results() const
+{
+    return m_results;
+}
+
+std::string BenchReport::json() const
+{
+    cxxtools::SerializationInfo si;
+    si.addMember(SI_BENCHMARK) <<= m_benchmark;
+    si.addMember(SI_RESULTS) <<= m_results;
+    return dto::srr::serializeJson(si);
+}
+
+void BenchReport::write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        throw SrrException("Failed to create " + path);
+    }
+    file << json();
+    if (!file.flush()) {
+        throw SrrException("Failed to write " + path);
+    }
+}
+
+BenchReport BenchReport::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw SrrException("Failed to open " + path);
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+
+    cxxtools::SerializationInfo si = dto::srr::deserializeJson(content.str());
+
+    BenchReport report("");
+    si.getMember(SI_BENCHMARK) >>= report.m_benchmark;
+    si.getMember(SI_RESULTS) >>= report.m_results;
+    return report;
+}
+
+size_t BenchReport::compare(const BenchReport& baseline, double tolerance, std::ostream& os) const
+{
+    size_t regressions = 0;
+    for (const auto& result : m_results) {
+        auto reference = std::find_if(baseline.m_results.begin(), baseline.m_results.end(), [&](const BenchResult& r) {
+            return r.m_name == result.m_name;
+        });
+        if (reference == baseline.m_results.end()) {
+            os << result.m_name << ": not in the baseline" << std::endl;
+            continue;
+        }
+        if (reference->m_wallMs <= 0) {
+            continue;
+        }
+
+        const double ratio  = result.m_wallMs / reference->m_wallMs;
+        const bool   slower = ratio > 1.0 + tolerance;
+        if (slower) {
+            regressions++;
+        }
+        os << result.m_name << ": " << result.m_wallMs << " ms, baseline " << reference->m_wallMs << " ms ("
+           << static_cast<int>((ratio - 1.0) * 100.0) << "%)" << (slower ? " REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+double median(std::vector<double> values)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+} // namespace srr
@@ -0,0 +1,78 @@
+/*  =========================================================================
+    report - Machine-readable results of a benchmark and baseline comparison
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cxxtools/serializationinfo.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+// median of the runs of one case of the matrix
+class BenchResult
+{
+public:
+    std::string m_name; // unique in a report, key of the baseline comparison
+    uint64_t    m_runs           = 0;
+    double      m_wallMs         = 0;
+    uint64_t    m_bytes          = 0; // payload processed by one run
+    double      m_bytesPerSec    = 0;
+    uint64_t    m_peakRssKb      = 0;
+    uint64_t    m_allocations    = 0;
+    uint64_t    m_allocatedBytes = 0;
+    // values specific to a benchmark
+    std::map<std::string, double> m_extra;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const BenchResult& result);
+void operator>>=(const cxxtools::SerializationInfo& si, BenchResult& result);
+
+class BenchReport
+{
+public:
+    explicit BenchReport(const std::string& benchmark);
+
+    void add(const BenchResult& result);
+
+    const std::vector<BenchResult>& results() const;
+
+    // JSON document of the report
+    std::string json() const;
+    void        write(const std::string& path) const;
+    static BenchReport load(const std::string& path);
+
+    // print the cases slower than the baseline by more than tolerance (0.1: 10%), returns their number.
+    // Cases missing from the baseline are reported but do not count.
+    size_t compare(const BenchReport& baseline, double tolerance, std::ostream& os) const;
+
+private:
+    std::string              m_benchmark;
+    std::vector<BenchResult> m_results;
+};
+
+// median of values, 0 if empty
+double median(std::vector<double> values);
+
+} // namespace srr
@@ -20,10 +20,40 @@
  */
 
 #include "dto/common.h"
+#include "fty_srr_exception.h"
+#include "helpers/base64.h"
+#include <cstdio>
 
 namespace srr {
 
+bool hasBase64Data(const std::string& version)
+{
+    unsigned major = 0;
+    unsigned minor = 0;
+    if (std::sscanf(version.c_str(), "%u.%u", &major, &minor) != 2) {
+        return false;
+    }
+    return major > 2 || (major == 2 && minor >= 2);
+}
+
+static void setOpaqueData(cxxtools::SerializationInfo& si, cxxtools::SerializationInfo& data, const std::string& value,
+    bool base64Data)
+{
+    if (base64Data && isBinaryPayload(value)) {
+        data <<= base64Encode(value);
+        si.addMember(SI_DATA_ENCODING) <<= DATA_ENCODING_BASE64;
+        si.addMember(SI_CONTENT_TYPE) <<= CONTENT_TYPE_OCTET_STREAM;
+    } else {
+        data <<= value;
+    }
+}
+
 void operator<<=(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStatus& fs)
+{
+    serializeFeature(si, fs, false);
+}
+
+void serializeFeature(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStatus& fs, bool base64Data)
 {
     si.addMember(SI_VERSION) <<= fs.feature().version();
     si.addMember(SI_STATUS) <<= dto::srr::statusToString(fs.status().status());
@@ -37,7 +67,7 @@ void operator<<=(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStat
 
         if (dataSi.category() == cxxtools::SerializationInfo::Category::Void ||
             dataSi.category() == cxxtools::SerializationInfo::Category::Value || dataSi.isNull()) {
-            data <<= feature.data();
+            setOpaqueData(si, data, feature.data(), base64Data);
         } else {
             dataSi.setName(SI_DATA);
             data = dataSi;
@@ -47,7 +77,7 @@ void operator<<=(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStat
 
     } catch (const std::exception& /* e */) {
         // put the data as a string if they are not in Json
-        data <<= feature.data();
+        setOpaqueData(si, data, feature.data(), base64Data);
     }
 }
 
@@ -69,6 +99,16 @@ void operator>>=(const cxxtools::SerializationInfo& si, dto::srr::FeatureAndStat
 
     if (dataSi.category() == cxxtools::SerializationInfo::Category::Value) {
         dataSi >>= data;
+
+        const cxxtools::SerializationInfo* encodingSi = si.findMember(SI_DATA_ENCODING);
+        if (encodingSi != nullptr) {
+            std::string encoding;
+            *encodingSi >>= encoding;
+            if (encoding != DATA_ENCODING_BASE64) {
+                throw SrrException("Unsupported data encoding " + encoding);
+            }
+            data = base64Decode(data);
+        }
     } else {
         dataSi.setName("");
         data = dto::srr::serializeJson(dataSi);
@@ -77,9 +117,27 @@ void operator>>=(const cxxtools::SerializationInfo& si, dto::srr::FeatureAndStat
     fs.mutable_feature()->set_data(data);
 }
 
+void operator<<=(cxxtools::SerializationInfo& si, const BulkDescriptor& bulk)
+{
+    si.addMember(SI_PATH) <<= bulk.m_path;
+    si.addMember(SI_SIZE) <<= bulk.m_size;
+    si.addMember(SI_DIGEST) <<= bulk.m_digest;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, BulkDescriptor& bulk)
+{
+    si.getMember(SI_PATH) >>= bulk.m_path;
+    if (si.findMember(SI_SIZE) != nullptr) {
+        si.getMember(SI_SIZE) >>= bulk.m_size;
+    }
+    if (si.findMember(SI_DIGEST) != nullptr) {
+        si.getMember(SI_DIGEST) >>= bulk.m_digest;
+    }
+}
+
 void operator<<=(cxxtools::SerializationInfo& si, const SrrFeature& f)
 {
-    si.addMember(f.m_feature_name) <<= f.m_feature_and_status;
+    serializeFeature(si.addMember(f.m_feature_name), f.m_feature_and_status, f.m_base64Data);
 }
 
 void operator>>=(const cxxtools::SerializationInfo& si, SrrFeature& f)
@@ -88,6 +146,7 @@ void operator>>=(const cxxtools::SerializationInfo& si, SrrFeature& f)
 
     f.m_feature_name = tmpSi.name();
     tmpSi >>= f.m_feature_and_status;
+    f.m_base64Data = tmpSi.findMember(SI_DATA_ENCODING) != nullptr;
 }
 
 void operator<<=(cxxtools::SerializationInfo& si, const FeatureInfo& resp)
@@ -108,6 +167,16 @@ void operator<<=(cxxtools::SerializationInfo& si, const Group& resp)
     si.addMember(SI_GROUP_NAME) <<= resp.m_group_name;
     si.addMember(SI_DATA_INTEGRITY) <<= resp.m_data_integrity;
     si.addMember(SI_FEATURES) <<= resp.m_features;
+
+    if (!resp.m_integrity_scheme.empty()) {
+        si.addMember(SI_INTEGRITY_SCHEME) <<= resp.m_integrity_scheme;
+
+        cxxtools::SerializationInfo& digests = si.addMember(SI_FEATURES_INTEGRITY);
+        digests.setCategory(cxxtools::SerializationInfo::Category::Object);
+        for (const auto& digest : resp.m_features_integrity) {
+            digests.addMember(digest.first) <<= digest.second;
+        }
+    }
 }
 
 void operator>>=(const cxxtools::SerializationInfo& si, Group& resp)
@@ -116,6 +185,17 @@ void operator>>=(const cxxtools::SerializationInfo& si, Group& resp)
     si.getMember(SI_GROUP_NAME) >>= resp.m_group_name;
     si.getMember(SI_DATA_INTEGRITY) >>= resp.m_data_integrity;
     si.getMember(SI_FEATURES) >>= resp.m_features;
+
+    if (si.findMember(SI_INTEGRITY_SCHEME) != nullptr) {
+        si.getMember(SI_INTEGRITY_SCHEME) >>= resp.m_integrity_scheme;
+
+        const cxxtools::SerializationInfo* digests = si.findMember(SI_FEATURES_INTEGRITY);
+        if (digests != nullptr) {
+            for (const auto& digest : *digests) {
+                digest >>= resp.m_features_integrity[digest.name()];
+            }
+        }
+    }
 }
 
 void operator<<=(cxxtools::SerializationInfo& si, const GroupInfo& resp)
@@ -22,7 +22,9 @@
 #pragma once
 
 #include <cxxtools/serializationinfo.h>
+#include <cstdint>
 #include <fty_common_dto.h>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -40,13 +42,65 @@ static constexpr const char* SI_GROUPS      = "groups";
 static constexpr const char* SI_FEATURES    = "features";
 static constexpr const char* SI_PASSPHRASE  = "passphrase";
 
+// si feature fields
+static constexpr const char* SI_DATA_ENCODING = "data_encoding";
+static constexpr const char* SI_CONTENT_TYPE  = "content_type";
+
+// opaque (non JSON) feature data is stored base64 encoded instead of as an escaped JSON string, from the payload
+// version 2.2. Older payloads keep the escaped string: their digests were computed over it.
+static constexpr const char* DATA_ENCODING_BASE64      = "base64";
+static constexpr const char* CONTENT_TYPE_OCTET_STREAM = "application/octet-stream";
+static constexpr const char* VERSION_BASE64_DATA       = "2.2";
+
+// true if the payload version stores opaque data base64 encoded
+bool hasBase64Data(const std::string& version);
+
+// si bulk transfer fields
+static constexpr const char* SI_BULK   = "bulk";
+static constexpr const char* SI_PATH   = "path";
+static constexpr const char* SI_SIZE   = "size";
+static constexpr const char* SI_DIGEST = "digest";
+
+// si snapshot fields
+static constexpr const char* SI_SNAPSHOT_ID = "snapshot_id";
+static constexpr const char* SI_SNAPSHOT    = "snapshot";
+static constexpr const char* SI_SNAPSHOTS   = "snapshots";
+static constexpr const char* SI_TIMESTAMP   = "timestamp";
+
+// si duration estimate fields
+static constexpr const char* SI_OPERATION   = "operation";
+static constexpr const char* SI_DURATION_MS = "duration_ms";
+static constexpr const char* SI_SAMPLES     = "samples";
+
 // si group fields
 static constexpr const char* SI_GROUP_ID       = "group_id";
 static constexpr const char* SI_GROUP_NAME     = "group_name";
 static constexpr const char* SI_DATA_INTEGRITY = "data_integrity";
 
+// merkle integrity scheme: one digest per feature, group data integrity is the root over them
+static constexpr const char* SI_INTEGRITY_SCHEME     = "integrity_scheme";
+static constexpr const char* SI_FEATURES_INTEGRITY   = "features_integrity";
+static constexpr const char* INTEGRITY_SCHEME_MERKLE = "merkle-sha256";
+
+// opaque data as an escaped string (payload versions before 2.2)
 void operator<<=(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStatus& fs);
 void operator>>=(const cxxtools::SerializationInfo& si, dto::srr::FeatureAndStatus& fs);
+// opaque data base64 encoded if base64Data is set and it is not valid UTF-8 or mostly escaped
+void serializeFeature(cxxtools::SerializationInfo& si, const dto::srr::FeatureAndStatus& fs, bool base64Data);
+
+// Local file holding a payload too large to be sent through the message bus
+class BulkDescriptor
+{
+public:
+    BulkDescriptor(){};
+
+    std::string m_path;
+    uint64_t    m_size = 0;
+    std::string m_digest; // sha256 of the file content
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const BulkDescriptor& bulk);
+void operator>>=(const cxxtools::SerializationInfo& si, BulkDescriptor& bulk);
 
 class SrrFeature
 {
@@ -54,6 +108,8 @@ public:
     SrrFeature(){};
     std::string                m_feature_name;
     dto::srr::FeatureAndStatus m_feature_and_status;
+    // write opaque data base64 encoded: set for the payload versions supporting it, or read from the payload
+    bool m_base64Data = false;
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrFeature& f);
@@ -80,6 +136,9 @@ public:
     std::string             m_group_name;
     std::string             m_data_integrity;
     std::vector<SrrFeature> m_features;
+
+    std::string                        m_integrity_scheme;   // empty: digest over the whole feature list
+    std::map<std::string, std::string> m_features_integrity; // merkle scheme only: feature name -> digest
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const Group& resp);
@@ -48,11 +48,34 @@ const std::vector<SrrFeature> SrrRestoreRequestDataV2::getSrrFeatures() const
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// base64 encoded data in an older payload would not match its digests: the payload is invalid
+static void checkDataEncoding(const std::string& version, const std::vector<SrrFeature>& features)
+{
+    if (hasBase64Data(version)) {
+        return;
+    }
+    for (const auto& feature : features) {
+        if (feature.m_base64Data) {
+            throw std::runtime_error("Feature " + feature.m_feature_name + ": base64 encoded data requires version " +
+                                     VERSION_BASE64_DATA);
+        }
+    }
+}
+
 void operator<<=(cxxtools::SerializationInfo& si, const SrrSaveRequest& req)
 {
     si.addMember(SI_PASSPHRASE) <<= req.m_passphrase;
     si.addMember(SI_GROUP_LIST) <<= req.m_group_list;
     si.addMember(SESSION_TOKEN) <<= req.m_sessionToken;
+    if (!req.m_bulk.m_path.empty()) {
+        si.addMember(SI_BULK) <<= req.m_bulk;
+    }
+    if (req.m_incremental) {
+        si.addMember(SI_INCREMENTAL) <<= req.m_incremental;
+    }
+    if (!req.m_idempotencyKey.empty()) {
+        si.addMember(SI_IDEMPOTENCY_KEY) <<= req.m_idempotencyKey;
+    }
 }
 
 void operator>>=(const cxxtools::SerializationInfo& si, SrrSaveRequest& req)
@@ -60,6 +83,15 @@ void operator>>=(const cxxtools::SerializationInfo& si, SrrSaveRequest& req)
     si.getMember(SI_PASSPHRASE) >>= req.m_passphrase;
     si.getMember(SI_GROUP_LIST) >>= req.m_group_list;
     si.getMember(SESSION_TOKEN) >>= req.m_sessionToken;
+    if (si.findMember(SI_BULK) != nullptr) {
+        si.getMember(SI_BULK) >>= req.m_bulk;
+    }
+    if (si.findMember(SI_INCREMENTAL) != nullptr) {
+        si.getMember(SI_INCREMENTAL) >>= req.m_incremental;
+    }
+    if (si.findMember(SI_IDEMPOTENCY_KEY) != nullptr) {
+        si.getMember(SI_IDEMPOTENCY_KEY) >>= req.m_idempotencyKey;
+    }
 }
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreRequest& req)
@@ -68,6 +100,9 @@ void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreRequest& req)
     si.addMember(SI_PASSPHRASE) <<= req.m_passphrase;
     si.addMember(SI_CHECKSUM) <<= req.m_checksum;
     si.addMember(SESSION_TOKEN) <<= req.m_sessionToken;
+    if (!req.m_idempotencyKey.empty()) {
+        si.addMember(SI_IDEMPOTENCY_KEY) <<= req.m_idempotencyKey;
+    }
 
     if (req.m_version == "1.0") {
         auto dataPtr = std::dynamic_pointer_cast<SrrRestoreRequestDataV1>(req.m_data_ptr);
@@ -76,7 +111,7 @@ void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreRequest& req)
         } else {
             throw std::runtime_error("Invalid data pointer");
         }
-    } else if (req.m_version == "2.0" || req.m_version == "2.1") {
+    } else if (req.m_version == "2.0" || req.m_version == "2.1" || req.m_version == "2.2") {
         auto dataPtr = std::dynamic_pointer_cast<SrrRestoreRequestDataV2>(req.m_data_ptr);
         if (dataPtr) {
             si.addMember(SI_DATA) <<= dataPtr->m_data;
@@ -94,20 +129,59 @@ void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreRequest& req)
     si.getMember(SI_PASSPHRASE) >>= req.m_passphrase;
     si.getMember(SI_CHECKSUM) >>= req.m_checksum;
     si.getMember(SESSION_TOKEN) >>= req.m_sessionToken;
+    if (si.findMember(SI_IDEMPOTENCY_KEY) != nullptr) {
+        si.getMember(SI_IDEMPOTENCY_KEY) >>= req.m_idempotencyKey;
+    }
 
     if (req.m_version == "1.0") {
         std::shared_ptr<SrrRestoreRequestData> dataPtr(new SrrRestoreRequestDataV1);
 
         si.getMember(SI_DATA) >>= std::dynamic_pointer_cast<SrrRestoreRequestDataV1>(dataPtr)->m_data;
+        checkDataEncoding(req.m_version, std::dynamic_pointer_cast<SrrRestoreRequestDataV1>(dataPtr)->m_data);
         req.m_data_ptr = dataPtr;
-    } else if (req.m_version == "2.0" || req.m_version == "2.1") {
+    } else if (req.m_version == "2.0" || req.m_version == "2.1" || req.m_version == "2.2") {
         std::shared_ptr<SrrRestoreRequestData> dataPtr(new SrrRestoreRequestDataV2);
 
         si.getMember(SI_DATA) >>= std::dynamic_pointer_cast<SrrRestoreRequestDataV2>(dataPtr)->m_data;
+        for (const auto& group : std::dynamic_pointer_cast<SrrRestoreRequestDataV2>(dataPtr)->m_data) {
+            checkDataEncoding(req.m_version, group.m_features);
+        }
         req.m_data_ptr = dataPtr;
     } else {
         throw std::runtime_error("Data version is not supported");
     }
 }
 
+void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreSnapshotRequest& req)
+{
+    si.addMember(SI_SNAPSHOT_ID) <<= req.m_snapshotId;
+    si.addMember(SI_PASSPHRASE) <<= req.m_passphrase;
+    si.addMember(SESSION_TOKEN) <<= req.m_sessionToken;
+    if (!req.m_idempotencyKey.empty()) {
+        si.addMember(SI_IDEMPOTENCY_KEY) <<= req.m_idempotencyKey;
+    }
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreSnapshotRequest& req)
+{
+    si.getMember(SI_SNAPSHOT_ID) >>= req.m_snapshotId;
+    si.getMember(SI_PASSPHRASE) >>= req.m_passphrase;
+    si.getMember(SESSION_TOKEN) >>= req.m_sessionToken;
+    if (si.findMember(SI_IDEMPOTENCY_KEY) != nullptr) {
+        si.getMember(SI_IDEMPOTENCY_KEY) >>= req.m_idempotencyKey;
+    }
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrEstimateRequest& req)
+{
+    si.addMember(SI_OPERATION) <<= req.m_operation;
+    si.addMember(SI_GROUP_LIST) <<= req.m_group_list;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrEstimateRequest& req)
+{
+    si.getMember(SI_OPERATION) >>= req.m_operation;
+    si.getMember(SI_GROUP_LIST) >>= req.m_group_list;
+}
+
 } // namespace srr
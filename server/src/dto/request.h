@@ -30,7 +30,10 @@
 namespace srr {
 
 // si save request fields
-static constexpr const char* SI_GROUP_LIST = "group_list";
+static constexpr const char* SI_GROUP_LIST      = "group_list";
+static constexpr const char* SI_INCREMENTAL     = "incremental";
+// si save and restore requests: a retried request with the same key gets the result of the first one
+static constexpr const char* SI_IDEMPOTENCY_KEY = "idempotency_key";
 
 class SrrSaveRequest
 {
@@ -40,6 +43,11 @@ public:
     std::string              m_passphrase;
     std::string              m_sessionToken;
     std::vector<std::string> m_group_list;
+    // if set, the response payload is written to this local file instead of the message bus
+    BulkDescriptor m_bulk;
+    // only fetch the features whose revision changed since the latest snapshot of the local store
+    bool        m_incremental = false;
+    std::string m_idempotencyKey;
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrSaveRequest& req);
@@ -78,10 +86,39 @@ public:
     std::string              m_passphrase;
     std::string              m_sessionToken;
     std::string              m_checksum;
+    std::string              m_idempotencyKey;
     SrrRestoreRequestDataPtr m_data_ptr;
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreRequest& req);
 void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreRequest& req);
 
+// restore of a snapshot kept in the local store
+class SrrRestoreSnapshotRequest
+{
+public:
+    SrrRestoreSnapshotRequest() = default;
+
+    std::string m_snapshotId;
+    std::string m_passphrase;
+    std::string m_sessionToken;
+    std::string m_idempotencyKey;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreSnapshotRequest& req);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreSnapshotRequest& req);
+
+// estimate of a save or a restore of groups, from the duration history
+class SrrEstimateRequest
+{
+public:
+    SrrEstimateRequest() = default;
+
+    std::string              m_operation; // "save" or "restore"
+    std::vector<std::string> m_group_list;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrEstimateRequest& req);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrEstimateRequest& req);
+
 } // namespace srr
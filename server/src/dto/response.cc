@@ -47,6 +47,9 @@ void operator<<=(cxxtools::SerializationInfo& si, const SrrSaveResponse& resp)
     }
     si.addMember(SI_CHECKSUM) <<= resp.m_checksum;
     si.addMember(SI_DATA) <<= resp.m_data;
+    if (!resp.m_bulk.m_path.empty()) {
+        si.addMember(SI_BULK) <<= resp.m_bulk;
+    }
 }
 
 void operator>>=(const cxxtools::SerializationInfo& si, SrrSaveResponse& resp)
@@ -58,6 +61,37 @@ void operator>>=(const cxxtools::SerializationInfo& si, SrrSaveResponse& resp)
     }
     si.getMember(SI_CHECKSUM) >>= resp.m_checksum;
     si.getMember(SI_DATA) >>= resp.m_data;
+    if (si.findMember(SI_BULK) != nullptr) {
+        si.getMember(SI_BULK) >>= resp.m_bulk;
+    }
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const MemoryPeak& peak)
+{
+    si.addMember(SI_NAME) <<= peak.m_name;
+    si.addMember(SI_PEAK) <<= peak.m_peak;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, MemoryPeak& peak)
+{
+    si.getMember(SI_NAME) >>= peak.m_name;
+    si.getMember(SI_PEAK) >>= peak.m_peak;
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const MemoryUsage& usage)
+{
+    si.addMember(SI_BUDGET) <<= usage.m_budget;
+    si.addMember(SI_PEAK) <<= usage.m_peak;
+    si.addMember(SI_KINDS) <<= usage.m_kinds;
+    si.addMember(SI_PHASES) <<= usage.m_phases;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, MemoryUsage& usage)
+{
+    si.getMember(SI_BUDGET) >>= usage.m_budget;
+    si.getMember(SI_PEAK) >>= usage.m_peak;
+    si.getMember(SI_KINDS) >>= usage.m_kinds;
+    si.getMember(SI_PHASES) >>= usage.m_phases;
 }
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreResponse& resp)
@@ -67,6 +101,9 @@ void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreResponse& resp
         si.addMember(SI_ERROR) <<= resp.m_error;
     }
     si.addMember(SI_STATUS_LIST) <<= resp.m_status_list;
+    if (resp.m_memory.m_peak > 0) {
+        si.addMember(SI_MEMORY) <<= resp.m_memory;
+    }
 }
 
 void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreResponse& resp)
@@ -76,6 +113,119 @@ void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreResponse& resp
         si.getMember(SI_ERROR) >>= resp.m_error;
     }
     si.getMember(SI_STATUS_LIST) >>= resp.m_status_list;
+    if (si.findMember(SI_MEMORY) != nullptr) {
+        si.getMember(SI_MEMORY) >>= resp.m_memory;
+    }
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SnapshotInfo& info)
+{
+    si.addMember(SI_SNAPSHOT_ID) <<= info.m_id;
+    si.addMember(SI_TIMESTAMP) <<= info.m_timestamp;
+    si.addMember(SI_VERSION) <<= info.m_version;
+    si.addMember(SI_STATUS) <<= info.m_status;
+    si.addMember(SI_GROUPS) <<= info.m_groups;
+    si.addMember(SI_SIZE) <<= info.m_size;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SnapshotInfo& info)
+{
+    si.getMember(SI_SNAPSHOT_ID) >>= info.m_id;
+    si.getMember(SI_TIMESTAMP) >>= info.m_timestamp;
+    si.getMember(SI_VERSION) >>= info.m_version;
+    si.getMember(SI_STATUS) >>= info.m_status;
+    si.getMember(SI_GROUPS) >>= info.m_groups;
+    si.getMember(SI_SIZE) >>= info.m_size;
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrSnapshotResponse& resp)
+{
+    si.addMember(SI_STATUS) <<= resp.m_status;
+    if (resp.m_status != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+        si.addMember(SI_ERROR) <<= resp.m_error;
+    }
+    si.addMember(SI_SNAPSHOT) <<= resp.m_snapshot;
+    if (resp.m_memory.m_peak > 0) {
+        si.addMember(SI_MEMORY) <<= resp.m_memory;
+    }
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrSnapshotResponse& resp)
+{
+    si.getMember(SI_STATUS) >>= resp.m_status;
+    if (si.findMember(SI_ERROR) != nullptr) {
+        si.getMember(SI_ERROR) >>= resp.m_error;
+    }
+    si.getMember(SI_SNAPSHOT) >>= resp.m_snapshot;
+    if (si.findMember(SI_MEMORY) != nullptr) {
+        si.getMember(SI_MEMORY) >>= resp.m_memory;
+    }
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrSnapshotListResponse& resp)
+{
+    si.addMember(SI_SNAPSHOTS) <<= resp.m_snapshots;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrSnapshotListResponse& resp)
+{
+    si.getMember(SI_SNAPSHOTS) >>= resp.m_snapshots;
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const FeatureEstimate& estimate)
+{
+    si.addMember(SI_NAME) <<= estimate.m_name;
+    si.addMember(SI_DURATION_MS) <<= estimate.m_durationMs;
+    si.addMember(SI_SIZE) <<= estimate.m_size;
+    si.addMember(SI_SAMPLES) <<= estimate.m_samples;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, FeatureEstimate& estimate)
+{
+    si.getMember(SI_NAME) >>= estimate.m_name;
+    si.getMember(SI_DURATION_MS) >>= estimate.m_durationMs;
+    si.getMember(SI_SIZE) >>= estimate.m_size;
+    si.getMember(SI_SAMPLES) >>= estimate.m_samples;
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const GroupEstimate& estimate)
+{
+    si.addMember(SI_GROUP_ID) <<= estimate.m_group_id;
+    si.addMember(SI_DURATION_MS) <<= estimate.m_durationMs;
+    si.addMember(SI_SIZE) <<= estimate.m_size;
+    si.addMember(SI_FEATURES) <<= estimate.m_features;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, GroupEstimate& estimate)
+{
+    si.getMember(SI_GROUP_ID) >>= estimate.m_group_id;
+    si.getMember(SI_DURATION_MS) >>= estimate.m_durationMs;
+    si.getMember(SI_SIZE) >>= estimate.m_size;
+    si.getMember(SI_FEATURES) >>= estimate.m_features;
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrEstimateResponse& resp)
+{
+    si.addMember(SI_STATUS) <<= resp.m_status;
+    if (resp.m_status != dto::srr::statusToString(dto::srr::Status::SUCCESS)) {
+        si.addMember(SI_ERROR) <<= resp.m_error;
+    }
+    si.addMember(SI_OPERATION) <<= resp.m_operation;
+    si.addMember(SI_DURATION_MS) <<= resp.m_durationMs;
+    si.addMember(SI_SIZE) <<= resp.m_size;
+    si.addMember(SI_GROUPS) <<= resp.m_groups;
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrEstimateResponse& resp)
+{
+    si.getMember(SI_STATUS) >>= resp.m_status;
+    if (si.findMember(SI_ERROR) != nullptr) {
+        si.getMember(SI_ERROR) >>= resp.m_error;
+    }
+    si.getMember(SI_OPERATION) >>= resp.m_operation;
+    si.getMember(SI_DURATION_MS) >>= resp.m_durationMs;
+    si.getMember(SI_SIZE) >>= resp.m_size;
+    si.getMember(SI_GROUPS) >>= resp.m_groups;
 }
 
 } // namespace srr
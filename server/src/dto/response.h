@@ -35,6 +35,41 @@ static constexpr const char* SI_PASSPHRASE_VALIDATION  = "passphrase_validation"
 // si restore response fields
 static constexpr const char* SI_STATUS_LIST = "status_list";
 
+// si memory usage fields
+static constexpr const char* SI_MEMORY = "memory";
+static constexpr const char* SI_BUDGET = "budget";
+static constexpr const char* SI_PEAK   = "peak";
+static constexpr const char* SI_KINDS  = "kinds";
+static constexpr const char* SI_PHASES = "phases";
+
+// peak of the memory held by a job for a kind of data or during a phase, in bytes
+class MemoryPeak
+{
+public:
+    MemoryPeak(){};
+
+    std::string m_name;
+    uint64_t    m_peak = 0;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const MemoryPeak& peak);
+void operator>>=(const cxxtools::SerializationInfo& si, MemoryPeak& peak);
+
+// memory accounted to a job, estimated from the size of the data it holds
+class MemoryUsage
+{
+public:
+    MemoryUsage(){};
+
+    uint64_t                m_budget = 0; // 0: no budget
+    uint64_t                m_peak   = 0; // 0: the job was not accounted
+    std::vector<MemoryPeak> m_kinds;
+    std::vector<MemoryPeak> m_phases;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const MemoryUsage& usage);
+void operator>>=(const cxxtools::SerializationInfo& si, MemoryUsage& usage);
+
 class SrrListResponse
 {
 public:
@@ -60,6 +95,8 @@ public:
     std::string        m_version;
     std::string        m_checksum;
     std::vector<Group> m_data;
+    // set when the payload has been written to a local file (m_data is then empty)
+    BulkDescriptor m_bulk;
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrSaveResponse& resp);
@@ -72,9 +109,95 @@ public:
     std::string                m_status;
     std::string                m_error;
     std::vector<RestoreStatus> m_status_list;
+    MemoryUsage                m_memory; // optional
 };
 
 void operator<<=(cxxtools::SerializationInfo& si, const SrrRestoreResponse& resp);
 void operator>>=(const cxxtools::SerializationInfo& si, SrrRestoreResponse& resp);
 
+// snapshot kept in the local store
+class SnapshotInfo
+{
+public:
+    SnapshotInfo(){};
+
+    std::string              m_id;
+    uint64_t                 m_timestamp = 0; // seconds since epoch
+    std::string              m_version;
+    std::string              m_status; // status of the save which produced the snapshot
+    std::vector<std::string> m_groups;
+    uint64_t                 m_size = 0; // size of the feature payloads, before deduplication
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SnapshotInfo& info);
+void operator>>=(const cxxtools::SerializationInfo& si, SnapshotInfo& info);
+
+class SrrSnapshotResponse
+{
+public:
+    SrrSnapshotResponse(){};
+    std::string  m_status;
+    std::string  m_error;
+    SnapshotInfo m_snapshot;
+    MemoryUsage  m_memory; // optional
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrSnapshotResponse& resp);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrSnapshotResponse& resp);
+
+class SrrSnapshotListResponse
+{
+public:
+    SrrSnapshotListResponse(){};
+    std::vector<SnapshotInfo> m_snapshots;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrSnapshotListResponse& resp);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrSnapshotListResponse& resp);
+
+// estimated duration and payload size, from the duration history
+class FeatureEstimate
+{
+public:
+    FeatureEstimate(){};
+
+    std::string m_name;
+    uint64_t    m_durationMs = 0;
+    uint64_t    m_size       = 0;
+    uint64_t    m_samples    = 0; // 0: never measured, duration and size are unknown
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const FeatureEstimate& estimate);
+void operator>>=(const cxxtools::SerializationInfo& si, FeatureEstimate& estimate);
+
+class GroupEstimate
+{
+public:
+    GroupEstimate(){};
+
+    std::string                  m_group_id;
+    uint64_t                     m_durationMs = 0;
+    uint64_t                     m_size       = 0;
+    std::vector<FeatureEstimate> m_features;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const GroupEstimate& estimate);
+void operator>>=(const cxxtools::SerializationInfo& si, GroupEstimate& estimate);
+
+class SrrEstimateResponse
+{
+public:
+    SrrEstimateResponse(){};
+    std::string m_status;
+    std::string m_error;
+
+    std::string                m_operation;
+    uint64_t                   m_durationMs = 0;
+    uint64_t                   m_size       = 0;
+    std::vector<GroupEstimate> m_groups;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrEstimateResponse& resp);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrEstimateResponse& resp);
+
 } // namespace srr
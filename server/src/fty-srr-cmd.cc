@@ -21,8 +21,17 @@
 
 #include "dto/request.h"
 #include "dto/response.h"
+#include "fty-srr.h"
+#include "fty_srr_recorder.h"
+#include "helpers/backup_diff.h"
+#include "helpers/backup_inspector.h"
+#include "helpers/bulk_transfer.h"
+#include "helpers/parallel.h"
 #include "helpers/utilsReauth.h"
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <cxxtools/serializationinfo.h>
 #include <fstream>
 #include <fty/command-line.h>
@@ -34,6 +43,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unistd.h>
 #include <vector>
 
 #define END_POINT                      "ipc://@/malamute"
@@ -56,15 +66,49 @@ std::ostream& operator<<(std::ostream& os, const std::vector<T>& vec)
     os << *it;
     return os;
 }
+
+// Bus session: connected on first request and reused by all the requests of the invocation
+class SrrClient
+{
+public:
+    dto::UserData sendRequest(const std::string& action, const dto::UserData& userData);
+
+    // idempotency key of the save/restore requests: a retry with the same key is not run twice by the daemon
+    void               setIdempotencyKey(const std::string& key) { m_idempotencyKey = key; }
+    const std::string& idempotencyKey() const { return m_idempotencyKey; }
+
+private:
+    std::string                             m_clientId;
+    std::string                             m_idempotencyKey;
+    std::unique_ptr<messagebus::MessageBus> m_requester;
+};
+
 // Utils
-dto::UserData sendRequest(const std::string& action, const dto::UserData& userData);
+std::string bulkFileName(const std::string& operation);
+void moveFile(const std::string& from, const std::string& to);
 
 // operations
-std::vector<std::string> opList(void);
-void opSave(const std::string& passphrase, const std::string& sessionToken, const std::vector<std::string>& groupList,
-    std::ostream& os);
-void opRestore(const std::string& passphrase, const std::string& sessionToken, std::istream& is, bool force);
+std::vector<std::string> opList(SrrClient& client);
+void opSave(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental, std::ostream& os);
+void opRestore(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::string& fileName, bool force);
+void opSaveBulk(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental, const std::string& spool, const std::string& fileName);
+void opRestoreBulk(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const srr::BulkDescriptor& bulk, bool force);
 void opReset(void);
+bool opVerify(const std::vector<std::string>& files, const std::string& passphrase, bool details);
+int opDiff(const std::string& fromFile, const std::string& toFile, const std::string& patchFile);
+bool opFlight(const std::string& file);
+void opSnapshot(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental);
+void opListSnapshots(SrrClient& client);
+bool opCancel(SrrClient& client);
+bool opEstimate(SrrClient& client, const std::string& operation, const std::vector<std::string>& groupList);
+bool opStats(SrrClient& client);
+void opRestoreSnapshot(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::string& snapshotId, bool force);
 
 int main(int argc, char** argv)
 {
@@ -77,28 +121,42 @@ int main(int argc, char** argv)
     // remove log from fty-log
     ftylog_setLogLevelError(ftylog_getInstance());
 
-    bool help  = false;
-    bool force = false;
+    bool help        = false;
+    bool force       = false;
+    bool bulk        = false;
+    bool incremental = false;
 
     std::string fileName;
     std::string groups;
     std::string passphrase;
     std::string passwd{};
     std::string sessionToken{};
+    std::string patchFile;
+    std::string snapshotId;
+    std::string idempotencyKey;
+    std::string estimated = "save";
+    std::string bulkSpool = BULK_SPOOL_DEFAULT;
 
     if (std::getenv(SESSION_TOKEN_ENV_VAR)) {
         sessionToken = std::getenv(SESSION_TOKEN_ENV_VAR);
     }
 
     // clang-format off
-    fty::CommandLine cmd("### - SRR command line\n      Usage: fty-srr-cmd <list|save|restore|reset> [options]", {
+    fty::CommandLine cmd("### - SRR command line\n      Usage: fty-srr-cmd <list|save|restore|reset|verify|inspect|diff|snapshot|list-snapshots|restore-snapshot|cancel|estimate|stats|flight> [options]", {
         {"--help|-h", help, "Show this help"},
         {"--passphrase|-p", passphrase, "Passhphrase to save/restore groups"},
         {"--password|-pwd", passwd, "Password to restore groups (reauthentication)"},
         {"--token|-t", sessionToken, "Session token to save/restore groups if needed"},
         {"--groups|-g", groups, "Select groups to save (default to all groups)"},
-        {"--file|-f", fileName, "Path to the JSON file to save/restore. If not specified, standard input/output is used"},
-        {"--force|-F", force, "Force restore (discards data integrity check)"}
+        {"--operation|-o", estimated, "Estimate: operation to estimate, save (default) or restore"},
+        {"--snapshot|-s", snapshotId, "Id of the snapshot to restore from the local store"},
+        {"--key|-k", idempotencyKey, "Save/restore: idempotency key, a retried request with the same key gets the result of the first one. Cancel: key of the request to cancel"},
+        {"--file|-f", fileName, "Path to the JSON file to save/restore (comma separated list for verify/inspect/diff). If not specified, standard input/output is used. Flight: flight recorder of the daemon (default /var/lib/fty/fty-srr/flight-recorder)"},
+        {"--force|-F", force, "Force restore (discards data integrity check)"},
+        {"--incremental|-i", incremental, "Save/snapshot: only fetch the features changed since the latest snapshot of the daemon local store"},
+        {"--bulk|-b", bulk, "Local bulk transfer: the daemon reads/writes the payload in its spool directory, fty-srr-cmd must run as root or as a member of the group of the daemon"},
+        {"--spool|-S", bulkSpool, "Bulk transfer: spool directory of the daemon (default /var/lib/fty/fty-srr/bulk)"},
+        {"--patch|-P", patchFile, "Diff: write the JSON Patch (RFC 6902) turning the first file into the second one (- for standard output)"}
     });
 
     if(argc < 2) {
@@ -121,16 +179,24 @@ int main(int argc, char** argv)
         return EXIT_SUCCESS;
     }
 
+    SrrClient client;
+    client.setIdempotencyKey(idempotencyKey);
+
     if(operation == "list") {
-        opList();
+        opList(client);
     } else if(operation == "save") {
         if(passphrase.empty()) {
             std::cerr << "### - Passphrase is required with save operation" << std::endl;
             std::cout << cmd.help() << std::endl;
             return EXIT_FAILURE;
         }
+        if(bulk && fileName.empty()) {
+            std::cerr << "### - File is required with bulk save operation" << std::endl;
+            std::cout << cmd.help() << std::endl;
+            return EXIT_FAILURE;
+        }
         std::ofstream outputFile;
-        if(!fileName.empty()) {
+        if(!fileName.empty() && !bulk) {
             try{
                 outputFile.open(fileName);
             } catch(const std::exception& e) {
@@ -144,13 +210,55 @@ int main(int argc, char** argv)
             std::cout << "### - Saving groups: " << groupList << std::endl;
         } else {
             std::cout << "### - No group option specified\nSaving all groups" << std::endl;
-            groupList = opList();
+            groupList = opList(client);
+        }
+        if(bulk) {
+            opSaveBulk(client, passphrase, sessionToken, groupList, incremental, bulkSpool, fileName);
+        } else {
+            opSave(client, passphrase, sessionToken, groupList, incremental, outputFile.is_open() ? outputFile : std::cout);
         }
-        opSave(passphrase, sessionToken, groupList, outputFile.is_open() ? outputFile : std::cout);
         if(outputFile.is_open()) {
             outputFile.close();
         }
-    } else if(operation == "restore") {
+    } else if(operation == "snapshot") {
+        if(passphrase.empty()) {
+            std::cerr << "### - Passphrase is required with snapshot operation" << std::endl;
+            std::cout << cmd.help() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<std::string> groupList;
+        if(!groups.empty()) {
+            groupList = fty::split(groups, ",", fty::SplitOption::Trim);
+        } else {
+            groupList = opList(client);
+        }
+        opSnapshot(client, passphrase, sessionToken, groupList, incremental);
+    } else if(operation == "list-snapshots") {
+        opListSnapshots(client);
+    } else if(operation == "cancel") {
+        if(idempotencyKey.empty()) {
+            std::cerr << "### - Key of the request to cancel is required with cancel operation" << std::endl;
+            std::cout << cmd.help() << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(!opCancel(client)) {
+            return EXIT_FAILURE;
+        }
+    } else if(operation == "estimate") {
+        std::vector<std::string> groupList;
+        if(!groups.empty()) {
+            groupList = fty::split(groups, ",", fty::SplitOption::Trim);
+        } else {
+            groupList = opList(client);
+        }
+        if(!opEstimate(client, estimated, groupList)) {
+            return EXIT_FAILURE;
+        }
+    } else if(operation == "stats") {
+        if(!opStats(client)) {
+            return EXIT_FAILURE;
+        }
+    } else if(operation == "restore" || operation == "restore-snapshot") {
         if(passphrase.empty()) {
             std::cerr << "### - Passphrase is required with restore operation" << std::endl;
             std::cout << cmd.help() << std::endl;
@@ -164,24 +272,82 @@ int main(int argc, char** argv)
             std::cerr << "### - Wrong password, please retry" << std::endl;
             return EXIT_FAILURE;
         }
-        std::ifstream inputFile;
-        if(!fileName.empty()) {
-            try{
-                inputFile.open(fileName);
+        std::string reauthToken = srr::utils::buildReauthToken(sessionToken, passwd);
+        if(operation == "restore-snapshot") {
+            if(snapshotId.empty()) {
+                std::cerr << "### - Snapshot id is required with restore-snapshot operation" << std::endl;
+                std::cout << cmd.help() << std::endl;
+                return EXIT_FAILURE;
+            }
+            opRestoreSnapshot(client, passphrase, reauthToken, snapshotId, force);
+            return EXIT_SUCCESS;
+        }
+        if(bulk) {
+            // the daemon only reads the files of its spool directory: the backup is copied there first
+            const std::string name      = bulkFileName("restore");
+            std::string       spoolFile;
+            try {
+                spoolFile = srr::bulkSpoolPath(bulkSpool, name);
+                srr::BulkDescriptor bulkFile;
+                if(!fileName.empty()) {
+                    std::ifstream inputFile(fileName, std::ios::binary);
+                    if(!inputFile) {
+                        throw std::runtime_error("Can't open input file " + fileName);
+                    }
+                    bulkFile = srr::writeBulkFile(spoolFile, [&inputFile](std::ostream& os) {
+                        os << inputFile.rdbuf();
+                    });
+                } else {
+                    std::cout << "### - No input file specified, waiting for input from stdin" << std::endl;
+                    bulkFile = srr::copyToBulkFile(STDIN_FILENO, spoolFile);
+                }
+                bulkFile.m_path = name;
+                opRestoreBulk(client, passphrase, reauthToken, bulkFile, force);
             } catch(const std::exception& e) {
-                std::cerr << "### - Can't open input file: " << e.what() << std::endl;
+                std::cerr << "### - Error: " << e.what() << std::endl;
+                std::remove(spoolFile.c_str());
                 return EXIT_FAILURE;
             }
-        } else {
-            std::cout << "### - No input file specified, waiting for input from stdin" << std::endl;
+            std::remove(spoolFile.c_str());
+            return EXIT_SUCCESS;
         }
-        std::string reauthToken = srr::utils::buildReauthToken(sessionToken, passwd);
-        opRestore(passphrase, reauthToken, inputFile.is_open() ? inputFile : std::cin, force);
-        if(inputFile.is_open()) {
-            inputFile.close();
+        if(fileName.empty()) {
+            std::cout << "### - No input file specified, waiting for input from stdin" << std::endl;
         }
+        opRestore(client, passphrase, reauthToken, fileName, force);
     } else if(operation == "reset") {
         opReset();
+    } else if(operation == "verify" || operation == "inspect") {
+        // offline operations: no daemon nor message bus involved
+        std::vector<std::string> files;
+        if(!fileName.empty()) {
+            files = fty::split(fileName, ",", fty::SplitOption::Trim);
+        } else {
+            std::cout << "### - No input file specified, waiting for input from stdin" << std::endl;
+            files.push_back("");
+        }
+        if(!opVerify(files, passphrase, operation == "inspect")) {
+            return EXIT_FAILURE;
+        }
+    } else if(operation == "diff") {
+        // offline operation: fty-srr-cmd diff <from> <to>, or --file <from>,<to>
+        std::vector<std::string> files;
+        if(!fileName.empty()) {
+            files = fty::split(fileName, ",", fty::SplitOption::Trim);
+        }
+        for(int i = 2; i < argc && argv[i][0] != '-'; i++) {
+            files.push_back(argv[i]);
+        }
+        if(files.size() != 2) {
+            std::cerr << "### - Diff needs exactly two files" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return opDiff(files[0], files[1], patchFile);
+    } else if(operation == "flight") {
+        // offline operation: the recorder file is read as the daemon left it, even after a crash
+        if(!opFlight(fileName.empty() ? FLIGHT_RECORDER_DEFAULT : fileName)) {
+            return EXIT_FAILURE;
+        }
     } else {
         std::cout << "### - Unknown operation" << std::endl;
         std::cout << std::endl;
@@ -192,40 +358,69 @@ int main(int argc, char** argv)
     return EXIT_SUCCESS;
 }
 
-dto::UserData sendRequest (const std::string &action,
-                           const dto::UserData &userData)
+dto::UserData SrrClient::sendRequest(const std::string& action, const dto::UserData& userData)
 {
     log_debug ("sendRequest <%s> action", action.c_str());
-    // Client id
-    std::string clientId = messagebus::getClientId (AGENT_NAME);
-    std::unique_ptr<messagebus::MessageBus> requester (
-      messagebus::MlmMessageBus (END_POINT, clientId));
-    requester->connect ();
+    if (!m_requester) {
+        // Client id
+        m_clientId = messagebus::getClientId (AGENT_NAME);
+        m_requester.reset (messagebus::MlmMessageBus (END_POINT, m_clientId));
+        m_requester->connect ();
+    }
 
     // Build message
     messagebus::Message msg;
     msg.userData () = userData;
     msg.metaData ().emplace (messagebus::Message::SUBJECT, action);
-    msg.metaData ().emplace (messagebus::Message::FROM, clientId);
+    msg.metaData ().emplace (messagebus::Message::FROM, m_clientId);
     msg.metaData ().emplace (messagebus::Message::TO,
                              AGENT_NAME_REQUEST_DESTINATION);
     msg.metaData ().emplace (messagebus::Message::CORRELATION_ID,
                              messagebus::generateUuid ());
+    // the daemon gives up at the same time as us
+    msg.metaData ().emplace (messagebus::Message::TIME_OUT,
+                             std::to_string (DEFAULT_TIME_OUT));
     // Send request
     messagebus::Message resp =
-      requester->request (MSG_QUEUE_NAME, msg, DEFAULT_TIME_OUT);
+      m_requester->request (MSG_QUEUE_NAME, msg, DEFAULT_TIME_OUT);
     // Return the data response
     return resp.userData ();
 }
 
-std::vector<std::string> opList() {
+std::string bulkFileName(const std::string& operation)
+{
+    return operation + "-" + std::to_string(getpid()) + "-" + std::to_string(std::time(nullptr)) + ".json";
+}
+
+void moveFile(const std::string& from, const std::string& to)
+{
+    if(std::rename(from.c_str(), to.c_str()) == 0) {
+        return;
+    }
+    if(errno != EXDEV) {
+        throw std::runtime_error("Can't move " + from + " to " + to + ": " + std::strerror(errno));
+    }
+    // spool and destination on different file systems
+    {
+        srr::MappedFile input(from);
+        std::ofstream   output(to, std::ios::binary | std::ios::trunc);
+        output.write(input.data(), static_cast<std::streamsize>(input.size()));
+        output.close();
+        if(!output) {
+            throw std::runtime_error("Can't write " + to);
+        }
+    }
+    std::remove(from.c_str());
+}
+
+std::vector<std::string> opList(SrrClient& client) {
     std::vector<std::string> groupList;
 
     try {
         dto::UserData reqData;
 
         // Send request
-        dto::UserData respData = sendRequest ("list", reqData);
+        dto::UserData respData = client.sendRequest ("list", reqData);
         if (respData.empty ()) {
             throw std::runtime_error (
               "Impossible to get the list of features");
@@ -251,11 +446,14 @@ std::vector<std::string> opList() {
     return groupList;
 }
 
-void opSave(const std::string& passphrase, const std::string& sessionToken, const std::vector<std::string>& groupList, std::ostream& os) {
+void opSave(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental, std::ostream& os) {
     srr::SrrSaveRequest req;
     req.m_group_list = groupList;
     req.m_passphrase = passphrase;
     req.m_sessionToken = sessionToken;
+    req.m_incremental = incremental;
+    req.m_idempotencyKey = client.idempotencyKey();
 
     cxxtools::SerializationInfo reqSi;
 
@@ -266,7 +464,7 @@ void opSave(const std::string& passphrase, const std::string& sessionToken, cons
         reqData.push_back(JSON::writeToString(reqSi, false));
 
         // Send request
-        dto::UserData respData = sendRequest ("save", reqData);
+        dto::UserData respData = client.sendRequest ("save", reqData);
         if (respData.empty ()) {
             throw std::runtime_error (
               "Impossible to save requested features");
@@ -292,15 +490,18 @@ void opSave(const std::string& passphrase, const std::string& sessionToken, cons
     }
 }
 
-void opRestore(const std::string& passphrase, const std::string& sessionToken, std::istream& is, bool force) {
-    std::string reqJson;
-    while(!is.eof()) {
-        reqJson += static_cast<char>(is.get());
-    }
-
+void opRestore(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::string& fileName, bool force) {
     cxxtools::SerializationInfo siJson;
     try{
-        JSON::readFromString(reqJson, siJson);
+        if(!fileName.empty()) {
+            // parse straight from the page cache
+            srr::MappedFile inputFile(fileName);
+            siJson = srr::parseJson(inputFile.data(), inputFile.size());
+        } else {
+            const std::string reqJson = srr::readAll(STDIN_FILENO);
+            siJson = srr::parseJson(reqJson.data(), reqJson.size());
+        }
     } catch(const std::exception& e) {
         std::cerr << "### - Error: " << e.what () << std::endl;
         return;
@@ -309,6 +510,7 @@ void opRestore(const std::string& passphrase, const std::string& sessionToken, s
     srr::SrrRestoreRequest req;
     req.m_passphrase = passphrase;
     req.m_sessionToken = sessionToken;
+    req.m_idempotencyKey = client.idempotencyKey();
     siJson.getMember("version") >>= req.m_version;
     siJson.getMember("checksum") >>= req.m_checksum;
 
@@ -316,7 +518,7 @@ void opRestore(const std::string& passphrase, const std::string& sessionToken, s
         srr::SrrRestoreRequestDataV1 reqData;
         siJson.getMember("data") >>= reqData.m_data;
         req.m_data_ptr = std::shared_ptr<srr::SrrRestoreRequestData>(new srr::SrrRestoreRequestDataV1(reqData));
-    } else if(req.m_version == "2.0" || req.m_version == "2.1") {
+    } else if(req.m_version == "2.0" || req.m_version == "2.1" || req.m_version == "2.2") {
         srr::SrrRestoreRequestDataV2 reqData;
         siJson.getMember("data") >>= reqData.m_data;
         req.m_data_ptr = std::shared_ptr<srr::SrrRestoreRequestData>(new srr::SrrRestoreRequestDataV2(reqData));
@@ -338,7 +540,109 @@ void opRestore(const std::string& passphrase, const std::string& sessionToken, s
         }
 
         // Send request
-        dto::UserData respData = sendRequest ("restore", reqData);
+        dto::UserData respData = client.sendRequest ("restore", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to restore requested features");
+        }
+
+        srr::SrrRestoreResponse resp;
+
+        cxxtools::SerializationInfo respSi;
+        JSON::readFromString(respData.back(), respSi);
+
+        respSi >>= resp;
+
+        std::cout << "Request status: " << resp.m_status << std::endl;
+
+        if(!resp.m_error.empty()) {
+            std::cerr << "### - Error: " << resp.m_error << std::endl;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+}
+
+void opSaveBulk(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental, const std::string& spool,
+    const std::string& fileName) {
+    srr::SrrSaveRequest req;
+    req.m_group_list = groupList;
+    req.m_passphrase = passphrase;
+    req.m_sessionToken = sessionToken;
+    req.m_incremental = incremental;
+    req.m_idempotencyKey = client.idempotencyKey();
+    // the daemon writes the payload in its spool directory, it is moved to the output file then
+    req.m_bulk.m_path = bulkFileName("save");
+
+    cxxtools::SerializationInfo reqSi;
+
+    reqSi <<= req;
+
+    try {
+        dto::UserData reqData;
+        reqData.push_back(JSON::writeToString(reqSi, false));
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("save", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to save requested features");
+        }
+
+        srr::SrrSaveResponse resp;
+
+        cxxtools::SerializationInfo respSi;
+        JSON::readFromString(respData.back(), respSi);
+
+        respSi >>= resp;
+
+        std::cout << "Request status: " << resp.m_status << std::endl;
+
+        if(!resp.m_error.empty()) {
+            std::cerr << "Error: " << resp.m_error << std::endl;
+        }
+
+        if(!resp.m_bulk.m_path.empty()) {
+            // check that what we see on disk is what the daemon wrote
+            const std::string   spoolFile = srr::bulkSpoolPath(spool, resp.m_bulk.m_path);
+            srr::BulkDescriptor written   = srr::describeBulkFile(spoolFile);
+            if(written.m_size != resp.m_bulk.m_size || written.m_digest != resp.m_bulk.m_digest) {
+                std::remove(spoolFile.c_str());
+                throw std::runtime_error("Saved file " + spoolFile + " does not match the daemon digest");
+            }
+            moveFile(spoolFile, fileName);
+            std::cout << "### - Saved " << written.m_size << " bytes to " << fileName << std::endl;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+}
+
+void opRestoreBulk(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const srr::BulkDescriptor& bulk, bool force) {
+    // version, checksum and data are read by the daemon from the bulk file
+    cxxtools::SerializationInfo reqSi;
+    reqSi.addMember(srr::SI_PASSPHRASE) <<= passphrase;
+    reqSi.addMember(SESSION_TOKEN) <<= sessionToken;
+    reqSi.addMember(srr::SI_BULK) <<= bulk;
+    if(!client.idempotencyKey().empty()) {
+        reqSi.addMember(srr::SI_IDEMPOTENCY_KEY) <<= client.idempotencyKey();
+    }
+
+    try {
+        dto::UserData reqData;
+        reqData.push_back(JSON::writeToString(reqSi, false));
+
+        if(force) {
+            std::cout << "### - Restoring with force option" << std::endl;
+            reqData.push_back("force");
+        }
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("restore", reqData);
         if (respData.empty ()) {
             throw std::runtime_error (
               "Impossible to restore requested features");
@@ -362,6 +666,408 @@ void opRestore(const std::string& passphrase, const std::string& sessionToken, s
     }
 }
 
+void opSnapshot(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::vector<std::string>& groupList, bool incremental) {
+    srr::SrrSaveRequest req;
+    req.m_group_list = groupList;
+    req.m_passphrase = passphrase;
+    req.m_sessionToken = sessionToken;
+    req.m_incremental = incremental;
+    req.m_idempotencyKey = client.idempotencyKey();
+
+    cxxtools::SerializationInfo reqSi;
+
+    reqSi <<= req;
+
+    try {
+        dto::UserData reqData;
+        reqData.push_back(JSON::writeToString(reqSi, false));
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("snapshot", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to snapshot requested features");
+        }
+
+        srr::SrrSnapshotResponse resp;
+
+        cxxtools::SerializationInfo respSi;
+        JSON::readFromString(respData.back(), respSi);
+
+        respSi >>= resp;
+
+        std::cout << "Request status: " << resp.m_status << std::endl;
+
+        if(!resp.m_error.empty()) {
+            std::cerr << "### - Error: " << resp.m_error << std::endl;
+        }
+        if(!resp.m_snapshot.m_id.empty()) {
+            std::cout << "Snapshot: " << resp.m_snapshot.m_id << std::endl;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+}
+
+void opListSnapshots(SrrClient& client) {
+    try {
+        dto::UserData reqData;
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("list-snapshots", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to get the list of snapshots");
+        }
+
+        srr::SrrSnapshotListResponse resp;
+
+        cxxtools::SerializationInfo si;
+        JSON::readFromString(respData.front(), si);
+
+        si >>= resp;
+
+        std::cout << "### Snapshots available:" << std::endl;
+        for(const auto& snapshot : resp.m_snapshots) {
+            std::cout << " - " << snapshot.m_id << ": version " << snapshot.m_version << ", " << snapshot.m_status
+                      << ", " << snapshot.m_size << " bytes, groups " << snapshot.m_groups << std::endl;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+}
+
+bool opCancel(SrrClient& client) {
+    try {
+        dto::UserData reqData;
+        reqData.push_back(client.idempotencyKey());
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("cancel", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to cancel the request");
+        }
+        if (respData.front() != statusToString(Status::SUCCESS)) {
+            throw std::runtime_error (respData.front());
+        }
+
+        std::cout << "### - Request " << client.idempotencyKey() << " cancelled" << std::endl;
+        return true;
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+    return false;
+}
+
+bool opEstimate(SrrClient& client, const std::string& operation, const std::vector<std::string>& groupList) {
+    srr::SrrEstimateRequest req;
+    req.m_operation = operation;
+    req.m_group_list = groupList;
+
+    cxxtools::SerializationInfo reqSi;
+
+    reqSi <<= req;
+
+    try {
+        dto::UserData reqData;
+        reqData.push_back(JSON::writeToString(reqSi, false));
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("estimate", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to estimate the " + operation);
+        }
+
+        srr::SrrEstimateResponse resp;
+
+        cxxtools::SerializationInfo respSi;
+        JSON::readFromString(respData.back(), respSi);
+
+        respSi >>= resp;
+
+        if(!resp.m_error.empty()) {
+            throw std::runtime_error (resp.m_error);
+        }
+
+        std::cout << "### - Estimated " << resp.m_operation << ": " << resp.m_durationMs << " ms, " << resp.m_size
+                  << " bytes" << std::endl;
+        for(const auto& group : resp.m_groups) {
+            std::cout << " - " << group.m_group_id << ": " << group.m_durationMs << " ms, " << group.m_size
+                      << " bytes" << std::endl;
+            for(const auto& feature : group.m_features) {
+                std::cout << "     - " << feature.m_name << ": ";
+                if(feature.m_samples == 0) {
+                    std::cout << "no history" << std::endl;
+                } else {
+                    std::cout << feature.m_durationMs << " ms, " << feature.m_size << " bytes ("
+                              << feature.m_samples << " samples)" << std::endl;
+                }
+            }
+        }
+        return true;
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+    return false;
+}
+
+bool opStats(SrrClient& client) {
+    try {
+        dto::UserData reqData;
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("stats", reqData);
+        if (respData.size () < 2) {
+            throw std::runtime_error (
+              "Impossible to get the metrics");
+        }
+
+        std::cout << respData.back() << std::endl;
+        return true;
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+    return false;
+}
+
+void opRestoreSnapshot(SrrClient& client, const std::string& passphrase, const std::string& sessionToken,
+    const std::string& snapshotId, bool force) {
+    srr::SrrRestoreSnapshotRequest req;
+    req.m_snapshotId = snapshotId;
+    req.m_passphrase = passphrase;
+    req.m_sessionToken = sessionToken;
+    req.m_idempotencyKey = client.idempotencyKey();
+
+    cxxtools::SerializationInfo reqSi;
+
+    reqSi <<= req;
+
+    try {
+        dto::UserData reqData;
+        reqData.push_back(JSON::writeToString(reqSi, false));
+
+        if(force) {
+            std::cout << "### - Restoring with force option" << std::endl;
+            reqData.push_back("force");
+        }
+
+        // Send request
+        dto::UserData respData = client.sendRequest ("restore-snapshot", reqData);
+        if (respData.empty ()) {
+            throw std::runtime_error (
+              "Impossible to restore requested snapshot");
+        }
+
+        srr::SrrRestoreResponse resp;
+
+        cxxtools::SerializationInfo respSi;
+        JSON::readFromString(respData.back(), respSi);
+
+        respSi >>= resp;
+
+        std::cout << "Request status: " << resp.m_status << std::endl;
+
+        if(!resp.m_error.empty()) {
+            std::cerr << "### - Error: " << resp.m_error << std::endl;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+    }
+}
+
 void opReset() {
     std::cerr << "Srr daemon does not handle reset operation" << std::endl;
 }
+
+static void printReport(const std::string& name, const srr::BackupReport& report, bool details)
+{
+    std::cout << "### - " << name << ": version " << report.m_version
+              << (report.m_versionSupported ? "" : " (not supported)");
+    if(report.m_checksumChecked) {
+        std::cout << ", passphrase " << (report.m_checksumOk ? "OK" : "INVALID");
+    }
+    std::cout << " -> " << (report.isValid() ? "VALID" : "INVALID") << std::endl;
+
+    for(const auto& group : report.m_groups) {
+        std::cout << " - " << (group.m_group_id.empty() ? "features" : group.m_group_id) << ": " << group.m_size
+                  << " bytes, integrity " << (group.m_integrityOk ? "OK" : "FAILED")
+                  << (group.m_known ? "" : " (unknown group)") << std::endl;
+        for(const auto& feature : group.m_features) {
+            // corrupted features are always listed
+            if(details || !feature.m_integrityOk) {
+                std::cout << "     - " << feature.m_name << " (version " << feature.m_version << "): "
+                          << feature.m_size << " bytes" << (feature.m_integrityOk ? "" : ", integrity FAILED")
+                          << std::endl;
+            }
+        }
+    }
+}
+
+bool opVerify(const std::vector<std::string>& files, const std::string& passphrase, bool details) {
+    bool allValid = true;
+
+    for(const auto& file : files) {
+        const std::string name = file.empty() ? "stdin" : file;
+        try {
+            cxxtools::SerializationInfo si;
+            if(!file.empty()) {
+                srr::MappedFile inputFile(file);
+                si = srr::parseJson(inputFile.data(), inputFile.size());
+            } else {
+                const std::string input = srr::readAll(STDIN_FILENO);
+                si = srr::parseJson(input.data(), input.size());
+            }
+
+            srr::BackupContent content;
+            si >>= content;
+
+            srr::BackupReport report = srr::inspectBackup(content, passphrase);
+            printReport(name, report, details);
+
+            allValid = allValid && report.isValid();
+        }
+        catch (std::exception &e) {
+            std::cerr << "### - " << name << ": Error: " << e.what () << std::endl;
+            allValid = false;
+        }
+    }
+
+    return allValid;
+}
+
+static void writePatch(const cxxtools::SerializationInfo& patch, const std::string& patchFile)
+{
+    const std::string json = dto::srr::serializeJson(patch, true);
+    if(patchFile == "-") {
+        std::cout << json << std::endl;
+        return;
+    }
+    std::ofstream output(patchFile);
+    output << json << std::endl;
+    if(!output) {
+        throw std::runtime_error("Failed to write " + patchFile);
+    }
+}
+
+// exit status follows diff(1): 0 when identical, 1 when different, 2 on error
+int opDiff(const std::string& fromFile, const std::string& toFile, const std::string& patchFile) {
+    try {
+        srr::MappedFile from(fromFile);
+        srr::MappedFile to(toFile);
+
+        // byte identical payloads do not need to be parsed
+        if(from.size() == to.size() && std::memcmp(from.data(), to.data(), from.size()) == 0) {
+            std::cout << "### - Backups are identical" << std::endl;
+            if(!patchFile.empty()) {
+                cxxtools::SerializationInfo emptyPatch;
+                emptyPatch.setCategory(cxxtools::SerializationInfo::Category::Array);
+                writePatch(emptyPatch, patchFile);
+            }
+            return 0;
+        }
+
+        cxxtools::SerializationInfo payloads[2];
+        const srr::MappedFile*      files[2] = {&from, &to};
+        srr::parallelFor(2, [&](size_t i) {
+            payloads[i] = srr::parseJson(files[i]->data(), files[i]->size());
+        });
+
+        srr::BackupDiff diff = srr::diffBackups(payloads[0], payloads[1], !patchFile.empty());
+
+        if(diff.m_identical) {
+            std::cout << "### - Backups are equivalent" << std::endl;
+        }
+        for(const auto& group : diff.m_groups) {
+            std::cout << " - " << (group.m_group_id.empty() ? "features" : group.m_group_id) << ": "
+                      << srr::changeTypeToString(group.m_change) << std::endl;
+            for(const auto& feature : group.m_features) {
+                std::cout << "     - " << feature.m_name << ": " << srr::changeTypeToString(feature.m_change);
+                if(feature.m_change == srr::ChangeType::MODIFIED) {
+                    std::cout << " (" << feature.m_patchOps << " changes)";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        if(!patchFile.empty()) {
+            writePatch(diff.m_patch, patchFile);
+        }
+
+        return diff.m_identical ? 0 : 1;
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+        return 2;
+    }
+}
+
+static std::string formatTimeMs(uint64_t timeMs)
+{
+    const time_t seconds = static_cast<time_t>(timeMs / 1000);
+    struct tm    local;
+    char         text[32];
+    localtime_r(&seconds, &local);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+
+    char milliseconds[8];
+    snprintf(milliseconds, sizeof(milliseconds), ".%03u", static_cast<unsigned>(timeMs % 1000));
+    return std::string(text) + milliseconds;
+}
+
+bool opFlight(const std::string& file) {
+    std::vector<srr::SrrFlightEvent> events;
+    try {
+        events = srr::SrrFlightRecorder::read(file);
+    }
+    catch (std::exception &e) {
+        std::cerr << "### - Error: " << e.what () << std::endl;
+        return false;
+    }
+
+    std::cout << "### - " << events.size() << " event(s) in " << file << std::endl;
+
+    bool stopped = true;
+    for(const auto& event : events) {
+        const srr::SrrFlightEventType type = event.type();
+        if(type == srr::SrrFlightEventType::Start && !stopped) {
+            std::cout << "### - The daemon did not stop before this start: crashed or killed" << std::endl;
+        }
+        stopped = type == srr::SrrFlightEventType::Stop;
+
+        std::cout << formatTimeMs(event.m_timeMs) << " [" << event.m_pid << "] " << srr::flightEventName(type) << " "
+                  << event.m_name;
+        if(event.m_agent[0] != '\0') {
+            std::cout << " " << event.m_agent;
+        }
+        if(event.m_detail[0] != '\0') {
+            std::cout << " " << event.m_detail;
+        }
+
+        if(type == srr::SrrFlightEventType::Feature) {
+            std::cout << " " << event.m_durationMs << " ms, " << event.m_bytesOut << " bytes out, " << event.m_bytesIn
+                      << " bytes in";
+        } else if(type == srr::SrrFlightEventType::JobEnd) {
+            std::cout << " " << event.m_durationMs << " ms";
+        } else if(type == srr::SrrFlightEventType::RollbackStart || type == srr::SrrFlightEventType::RollbackEnd) {
+            std::cout << " " << event.m_bytesOut << " feature(s)";
+        }
+        if(event.m_failed) {
+            std::cout << " FAILED";
+        }
+        if(event.m_job[0] != '\0') {
+            std::cout << " (job " << event.m_job << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    return true;
+}
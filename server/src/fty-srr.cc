@@ -104,24 +104,67 @@ int main(int argc, char* argv[])
     }
 
     // Default parameters
-    paramsConfig[AGENT_NAME_KEY]      = AGENT_NAME;
-    paramsConfig[ENDPOINT_KEY]        = DEFAULT_ENDPOINT;
-    paramsConfig[SRR_QUEUE_NAME_KEY]  = SRR_MSG_QUEUE_NAME;
-    paramsConfig[SRR_VERSION_KEY]     = ACTIVE_VERSION;
-    paramsConfig[REQUEST_TIMEOUT_KEY] = DefaultTimeOut;
-    paramsConfig[ENABLE_REBOOT_KEY]   = ENABLE_REBOOT_DEFAULT;
+    paramsConfig[AGENT_NAME_KEY]               = AGENT_NAME;
+    paramsConfig[ENDPOINT_KEY]                 = DEFAULT_ENDPOINT;
+    paramsConfig[SRR_QUEUE_NAME_KEY]           = SRR_MSG_QUEUE_NAME;
+    paramsConfig[SRR_VERSION_KEY]              = ACTIVE_VERSION;
+    paramsConfig[REQUEST_TIMEOUT_KEY]          = DefaultTimeOut;
+    paramsConfig[ENABLE_REBOOT_KEY]            = ENABLE_REBOOT_DEFAULT;
+    paramsConfig[INTEGRITY_SCHEME_KEY]         = INTEGRITY_SCHEME_DEFAULT;
+    paramsConfig[STORE_PATH_KEY]               = STORE_PATH_DEFAULT;
+    paramsConfig[STORE_MAX_SNAPSHOTS_KEY]      = STORE_MAX_SNAPSHOTS_DEFAULT;
+    paramsConfig[CONTINUOUS_BACKUP_KEY]        = CONTINUOUS_BACKUP_DEFAULT;
+    paramsConfig[CONTINUOUS_BACKUP_PERIOD_KEY] = CONTINUOUS_BACKUP_PERIOD_DEFAULT;
+    paramsConfig[TWO_PHASE_RESTORE_KEY]        = TWO_PHASE_RESTORE_DEFAULT;
+    paramsConfig[TWO_PHASE_FEATURES_KEY]       = TWO_PHASE_FEATURES_DEFAULT;
+    paramsConfig[BUS_POOL_SIZE_KEY]            = BUS_POOL_SIZE_DEFAULT;
+    paramsConfig[BUS_POOL_IDLE_TIMEOUT_KEY]    = BUS_POOL_IDLE_TIMEOUT_DEFAULT;
+    paramsConfig[STATS_FILE_KEY]               = STATS_FILE_DEFAULT;
+    paramsConfig[STATS_PERIOD_KEY]             = STATS_PERIOD_DEFAULT;
+    paramsConfig[TRACE_DIRECTORY_KEY]          = TRACE_DIRECTORY_DEFAULT;
+    paramsConfig[RESTORE_DELAY_KEY]            = RESTORE_DELAY_DEFAULT;
+    paramsConfig[CAPTURE_FILE_KEY]             = CAPTURE_FILE_DEFAULT;
+    paramsConfig[CAPTURE_SCRUB_KEY]            = CAPTURE_SCRUB_DEFAULT;
+    paramsConfig[FLIGHT_RECORDER_KEY]          = FLIGHT_RECORDER_DEFAULT;
+    paramsConfig[FLIGHT_RECORDER_EVENTS_KEY]   = FLIGHT_RECORDER_EVENTS_DEFAULT;
+    paramsConfig[MEMORY_BUDGET_KEY]            = MEMORY_BUDGET_DEFAULT;
+    paramsConfig[BULK_SPOOL_KEY]               = BULK_SPOOL_DEFAULT;
 
     if (config_file) {
         log_debug((AGENT_NAME + std::string(": loading configuration file from ") + config_file).c_str());
         mlm::ZConfig config(config_file);
         // verbose mode
         std::istringstream(config.getEntry("server/verbose", "0")) >> verbose;
-        paramsConfig[REQUEST_TIMEOUT_KEY] = config.getEntry("server/timeout", DefaultTimeOut);
-        paramsConfig[ENDPOINT_KEY]        = config.getEntry("srr-msg-bus/endpoint", DEFAULT_ENDPOINT);
-        paramsConfig[AGENT_NAME_KEY]      = config.getEntry("srr-msg-bus/address", AGENT_NAME);
-        paramsConfig[SRR_QUEUE_NAME_KEY]  = config.getEntry("srr-msg-bus/srrQueueName", SRR_MSG_QUEUE_NAME);
-        paramsConfig[SRR_VERSION_KEY]     = config.getEntry("srr/version", ACTIVE_VERSION);
-        paramsConfig[ENABLE_REBOOT_KEY]   = config.getEntry("srr/enableReboot", ENABLE_REBOOT_DEFAULT);
+        paramsConfig[REQUEST_TIMEOUT_KEY]          = config.getEntry("server/timeout", DefaultTimeOut);
+        paramsConfig[ENDPOINT_KEY]                 = config.getEntry("srr-msg-bus/endpoint", DEFAULT_ENDPOINT);
+        paramsConfig[AGENT_NAME_KEY]               = config.getEntry("srr-msg-bus/address", AGENT_NAME);
+        paramsConfig[SRR_QUEUE_NAME_KEY]           = config.getEntry("srr-msg-bus/srrQueueName", SRR_MSG_QUEUE_NAME);
+        paramsConfig[SRR_VERSION_KEY]              = config.getEntry("srr/version", ACTIVE_VERSION);
+        paramsConfig[ENABLE_REBOOT_KEY]            = config.getEntry("srr/enableReboot", ENABLE_REBOOT_DEFAULT);
+        paramsConfig[INTEGRITY_SCHEME_KEY]         = config.getEntry("srr/integrityScheme", INTEGRITY_SCHEME_DEFAULT);
+        paramsConfig[STORE_PATH_KEY]               = config.getEntry("srr/storePath", STORE_PATH_DEFAULT);
+        paramsConfig[STORE_MAX_SNAPSHOTS_KEY] =
+            config.getEntry("srr/storeMaxSnapshots", STORE_MAX_SNAPSHOTS_DEFAULT);
+        paramsConfig[CONTINUOUS_BACKUP_KEY] = config.getEntry("srr/continuousBackup", CONTINUOUS_BACKUP_DEFAULT);
+        paramsConfig[CONTINUOUS_BACKUP_PERIOD_KEY] =
+            config.getEntry("srr/continuousBackupPeriod", CONTINUOUS_BACKUP_PERIOD_DEFAULT);
+        paramsConfig[TWO_PHASE_RESTORE_KEY] = config.getEntry("srr/twoPhaseRestore", TWO_PHASE_RESTORE_DEFAULT);
+        paramsConfig[TWO_PHASE_FEATURES_KEY] =
+            config.getEntry("srr/twoPhaseFeatures", TWO_PHASE_FEATURES_DEFAULT);
+        paramsConfig[BUS_POOL_SIZE_KEY]     = config.getEntry("srr/busPoolSize", BUS_POOL_SIZE_DEFAULT);
+        paramsConfig[BUS_POOL_IDLE_TIMEOUT_KEY] =
+            config.getEntry("srr/busPoolIdleTimeout", BUS_POOL_IDLE_TIMEOUT_DEFAULT);
+        paramsConfig[STATS_FILE_KEY]      = config.getEntry("srr/statsFile", STATS_FILE_DEFAULT);
+        paramsConfig[STATS_PERIOD_KEY]    = config.getEntry("srr/statsPeriod", STATS_PERIOD_DEFAULT);
+        paramsConfig[TRACE_DIRECTORY_KEY] = config.getEntry("srr/traceDirectory", TRACE_DIRECTORY_DEFAULT);
+        paramsConfig[RESTORE_DELAY_KEY]   = config.getEntry("srr/restoreDelay", RESTORE_DELAY_DEFAULT);
+        paramsConfig[CAPTURE_FILE_KEY]    = config.getEntry("srr/captureFile", CAPTURE_FILE_DEFAULT);
+        paramsConfig[CAPTURE_SCRUB_KEY]   = config.getEntry("srr/captureScrub", CAPTURE_SCRUB_DEFAULT);
+        paramsConfig[FLIGHT_RECORDER_KEY] = config.getEntry("srr/flightRecorder", FLIGHT_RECORDER_DEFAULT);
+        paramsConfig[FLIGHT_RECORDER_EVENTS_KEY] =
+            config.getEntry("srr/flightRecorderEvents", FLIGHT_RECORDER_EVENTS_DEFAULT);
+        paramsConfig[MEMORY_BUDGET_KEY] = config.getEntry("srr/memoryBudget", MEMORY_BUDGET_DEFAULT);
+        paramsConfig[BULK_SPOOL_KEY]    = config.getEntry("srr/bulkSpool", BULK_SPOOL_DEFAULT);
     }
 
     if (verbose) {
@@ -32,6 +32,44 @@ constexpr auto SRR_QUEUE_NAME_KEY                      = "queueName";
 constexpr auto SRR_MSG_QUEUE_NAME                      = "ETN.Q.IPMCORE.SRR";
 constexpr auto ENABLE_REBOOT_KEY                       = "enableReboot";
 constexpr auto ENABLE_REBOOT_DEFAULT                   = "true";
+constexpr auto INTEGRITY_SCHEME_KEY                    = "integrityScheme";
+constexpr auto INTEGRITY_SCHEME_DEFAULT                = "legacy";
+constexpr auto STORE_PATH_KEY                          = "storePath";
+constexpr auto STORE_PATH_DEFAULT                      = "/var/lib/fty/fty-srr/store";
+constexpr auto STORE_MAX_SNAPSHOTS_KEY                 = "storeMaxSnapshots";
+constexpr auto STORE_MAX_SNAPSHOTS_DEFAULT             = "10";
+constexpr auto CONTINUOUS_BACKUP_KEY                   = "continuousBackup";
+constexpr auto CONTINUOUS_BACKUP_DEFAULT               = "false";
+constexpr auto CONTINUOUS_BACKUP_PERIOD_KEY            = "continuousBackupPeriod";
+constexpr auto CONTINUOUS_BACKUP_PERIOD_DEFAULT        = "300";
+constexpr auto TWO_PHASE_RESTORE_KEY                   = "twoPhaseRestore";
+constexpr auto TWO_PHASE_RESTORE_DEFAULT               = "false";
+constexpr auto TWO_PHASE_FEATURES_KEY                  = "twoPhaseFeatures";
+constexpr auto TWO_PHASE_FEATURES_DEFAULT              = "";
+constexpr auto BUS_POOL_SIZE_KEY                       = "busPoolSize";
+constexpr auto BUS_POOL_SIZE_DEFAULT                   = "4";
+constexpr auto BUS_POOL_IDLE_TIMEOUT_KEY               = "busPoolIdleTimeout";
+constexpr auto BUS_POOL_IDLE_TIMEOUT_DEFAULT           = "60";
+constexpr auto STATS_FILE_KEY                          = "statsFile";
+constexpr auto STATS_FILE_DEFAULT                      = "";
+constexpr auto STATS_PERIOD_KEY                        = "statsPeriod";
+constexpr auto STATS_PERIOD_DEFAULT                    = "60";
+constexpr auto TRACE_DIRECTORY_KEY                     = "traceDirectory";
+constexpr auto TRACE_DIRECTORY_DEFAULT                 = "";
+constexpr auto RESTORE_DELAY_KEY                       = "restoreDelay";
+constexpr auto RESTORE_DELAY_DEFAULT                   = "6";
+constexpr auto CAPTURE_FILE_KEY                        = "captureFile";
+constexpr auto CAPTURE_FILE_DEFAULT                    = "";
+constexpr auto CAPTURE_SCRUB_KEY                       = "captureScrub";
+constexpr auto CAPTURE_SCRUB_DEFAULT                   = "pass,secret,token,private,credential,community,apikey";
+constexpr auto FLIGHT_RECORDER_KEY                     = "flightRecorder";
+constexpr auto FLIGHT_RECORDER_DEFAULT                 = "/var/lib/fty/fty-srr/flight-recorder";
+constexpr auto FLIGHT_RECORDER_EVENTS_KEY              = "flightRecorderEvents";
+constexpr auto FLIGHT_RECORDER_EVENTS_DEFAULT          = "4096";
+constexpr auto MEMORY_BUDGET_KEY                       = "memoryBudget";
+constexpr auto MEMORY_BUDGET_DEFAULT                   = "0";
+constexpr auto BULK_SPOOL_KEY                          = "bulkSpool";
+constexpr auto BULK_SPOOL_DEFAULT                      = "/var/lib/fty/fty-srr/bulk";
 
 // AGENTS AND QUEUES
 // Config agent definition
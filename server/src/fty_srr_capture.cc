@@ -0,0 +1,314 @@
+/*  =========================================================================
+    fty_srr_capture - Capture of the requests to the agents and their replies
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_capture.h"
+#include "fty_srr_exception.h"
+#include "helpers/base64.h"
+#include <algorithm>
+#include <fty/string-utils.h>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+
+using namespace dto::srr;
+
+namespace srr {
+
+static constexpr const char* SI_SENT_MS    = "sent_ms";
+static constexpr const char* SI_LATENCY_MS = "latency_ms";
+static constexpr const char* SI_AGENT      = "agent";
+static constexpr const char* SI_QUEUE      = "queue";
+static constexpr const char* SI_ACTION     = "action";
+static constexpr const char* SI_ERROR      = "error";
+static constexpr const char* SI_REQUEST    = "request";
+static constexpr const char* SI_REPLY      = "reply";
+
+// queries are sent with these actions, the revision probe sends feature names only
+static bool sendsQuery(const std::string& action)
+{
+    return action == "save" || action == "restore" || action == "prepare" || action == "commit" || action == "abort" ||
+           action == "reset";
+}
+
+static std::string hidden(const std::string& value)
+{
+    return std::string(value.size(), '*');
+}
+
+// frames which could not be decoded
+static dto::UserData hidden(const dto::UserData& frames)
+{
+    dto::UserData scrubbed;
+    for (const auto& frame : frames) {
+        scrubbed.push_back(hidden(frame));
+    }
+    return scrubbed;
+}
+
+SrrScrubber::SrrScrubber(const std::string& rules)
+{
+    for (const auto& rule : fty::split(rules, ",", fty::SplitOption::Trim)) {
+        if (rule.empty()) {
+            continue;
+        }
+        try {
+            m_rules.emplace_back(rule, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+        } catch (const std::regex_error& ex) {
+            throw SrrException("Invalid scrub rule " + rule + ": " + ex.what());
+        }
+    }
+}
+
+dto::UserData SrrScrubber::request(const std::string& action, const dto::UserData& frames) const
+{
+    if (!sendsQuery(action)) {
+        return frames;
+    }
+
+    try {
+        dto::UserData data = frames;
+        Query         query;
+        data >> query;
+
+        if (query.has_save()) {
+            SaveQuery* save = query.mutable_save();
+            save->set_passpharse(hidden(save->passpharse()));
+            save->set_session_token(hidden(save->session_token()));
+        }
+        if (query.has_restore()) {
+            RestoreQuery* restore = query.mutable_restore();
+            restore->set_passpharse(hidden(restore->passpharse()));
+            restore->set_session_token(hidden(restore->session_token()));
+            for (auto& feature : *restore->mutable_map_features_data()) {
+                feature.second.set_data(this->data(feature.second.data()));
+            }
+        }
+
+        dto::UserData scrubbed;
+        scrubbed << query;
+        return scrubbed;
+    } catch (const std::exception& ex) {
+        log_warning("Request %s not decoded, its frames are hidden: %s", action.c_str(), ex.what());
+        return hidden(frames);
+    }
+}
+
+dto::UserData SrrScrubber::reply(const std::string& action, const dto::UserData& frames) const
+{
+    // only the replies of the saves hold data
+    if (action != "save") {
+        return frames;
+    }
+
+    try {
+        dto::UserData data = frames;
+        Response      response;
+        data >> response;
+
+        for (auto& feature : *response.mutable_save()->mutable_map_features_data()) {
+            Feature* dtoFeature = feature.second.mutable_feature();
+            dtoFeature->set_data(this->data(dtoFeature->data()));
+        }
+
+        dto::UserData scrubbed;
+        scrubbed << response;
+        return scrubbed;
+    } catch (const std::exception& ex) {
+        log_warning("Reply to %s not decoded, its frames are hidden: %s", action.c_str(), ex.what());
+        return hidden(frames);
+    }
+}
+
+std::string SrrScrubber::data(const std::string& data) const
+{
+    if (data.empty()) {
+        return data;
+    }
+
+    try {
+        cxxtools::SerializationInfo si = deserializeJson(data);
+        if (si.category() == cxxtools::SerializationInfo::Object ||
+            si.category() == cxxtools::SerializationInfo::Array) {
+            scrub(si, false);
+            return serializeJson(si, false);
+        }
+    } catch (const std::exception&) {
+        // not JSON
+    }
+    return hidden(data);
+}
+
+bool SrrScrubber::matches(const std::string& name) const
+{
+    return std::any_of(m_rules.begin(), m_rules.end(), [&name](const std::regex& rule) {
+        return std::regex_search(name, rule);
+    });
+}
+
+void SrrScrubber::scrub(cxxtools::SerializationInfo& si, bool matched) const
+{
+    if (si.category() == cxxtools::SerializationInfo::Value) {
+        if (matched) {
+            std::string value;
+            si.getValue(value);
+            si.setValue(hidden(value));
+        }
+        return;
+    }
+
+    // everything under a matching member is scrubbed
+    for (auto& member : si) {
+        scrub(member, matched || (!member.name().empty() && matches(member.name())));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void framesToSi(cxxtools::SerializationInfo& si, const dto::UserData& frames)
+{
+    si.setCategory(cxxtools::SerializationInfo::Array);
+    for (const auto& frame : frames) {
+        si.addMember("") <<= base64Encode(frame);
+    }
+}
+
+static void framesFromSi(const cxxtools::SerializationInfo& si, dto::UserData& frames)
+{
+    for (const auto& member : si) {
+        std::string encoded;
+        member >>= encoded;
+        frames.push_back(base64Decode(encoded));
+    }
+}
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrExchange& exchange)
+{
+    si.addMember(SI_SENT_MS) <<= exchange.m_sentMs;
+    si.addMember(SI_LATENCY_MS) <<= exchange.m_latencyMs;
+    si.addMember(SI_AGENT) <<= exchange.m_agent;
+    si.addMember(SI_QUEUE) <<= exchange.m_queue;
+    si.addMember(SI_ACTION) <<= exchange.m_action;
+    si.addMember(SI_ERROR) <<= exchange.m_error;
+    framesToSi(si.addMember(SI_REQUEST), exchange.m_request);
+    framesToSi(si.addMember(SI_REPLY), exchange.m_reply);
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, SrrExchange& exchange)
+{
+    si.getMember(SI_SENT_MS) >>= exchange.m_sentMs;
+    si.getMember(SI_LATENCY_MS) >>= exchange.m_latencyMs;
+    si.getMember(SI_AGENT) >>= exchange.m_agent;
+    si.getMember(SI_QUEUE) >>= exchange.m_queue;
+    si.getMember(SI_ACTION) >>= exchange.m_action;
+    si.getMember(SI_ERROR) >>= exchange.m_error;
+    framesFromSi(si.getMember(SI_REQUEST), exchange.m_request);
+    framesFromSi(si.getMember(SI_REPLY), exchange.m_reply);
+}
+
+std::vector<std::string> requestFeatures(const std::string& action, const dto::UserData& frames)
+{
+    std::vector<std::string> features;
+
+    if (!sendsQuery(action)) {
+        features.assign(frames.begin(), frames.end());
+    } else {
+        dto::UserData data = frames;
+        Query         query;
+        data >> query;
+
+        if (query.has_save()) {
+            for (int i = 0; i < query.save().features_size(); i++) {
+                features.push_back(query.save().features(i));
+            }
+        } else if (query.has_restore()) {
+            for (const auto& feature : query.restore().map_features_data()) {
+                features.push_back(feature.first);
+            }
+        } else if (query.has_reset()) {
+            for (int i = 0; i < query.reset().features_size(); i++) {
+                features.push_back(query.reset().features(i));
+            }
+        }
+    }
+
+    std::sort(features.begin(), features.end());
+    return features;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrCapture::SrrCapture(const std::string& path, const std::string& scrubRules, std::shared_ptr<Clock> clock)
+    : m_path(path)
+    , m_scrubber(scrubRules)
+    , m_clock(clock)
+    , m_start(clock->now())
+    , m_file(path, std::ios::app)
+{
+    if (!m_file) {
+        throw SrrException("Failed to open " + path);
+    }
+    log_info("Requests to the agents captured in %s", path.c_str());
+}
+
+void SrrCapture::record(SrrExchange exchange, Clock::time_point sent)
+{
+    const auto sinceStart = std::chrono::duration_cast<std::chrono::milliseconds>(sent - m_start).count();
+    exchange.m_sentMs     = static_cast<uint64_t>(std::max<decltype(sinceStart)>(0, sinceStart));
+    exchange.m_latencyMs  = elapsedMs(*m_clock, sent);
+    exchange.m_request    = m_scrubber.request(exchange.m_action, exchange.m_request);
+    exchange.m_reply      = m_scrubber.reply(exchange.m_action, exchange.m_reply);
+
+    cxxtools::SerializationInfo si;
+    si <<= exchange;
+    const std::string line = serializeJson(si, false);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file << line << '\n';
+    if (!m_file.flush()) {
+        throw SrrException("Failed to write " + m_path);
+    }
+}
+
+std::vector<SrrExchange> SrrCapture::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw SrrException("Failed to open " + path);
+    }
+
+    std::vector<SrrExchange> exchanges;
+    std::string              line;
+    for (size_t number = 1; std::getline(file, line); number++) {
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            SrrExchange exchange;
+            deserializeJson(line) >>= exchange;
+            exchanges.push_back(exchange);
+        } catch (const std::exception& ex) {
+            // last line of a capture cut by a crash
+            log_warning("%s:%zu dropped: %s", path.c_str(), number, ex.what());
+        }
+    }
+    return exchanges;
+}
+
+} // namespace srr
@@ -0,0 +1,106 @@
+/*  =========================================================================
+    fty_srr_capture - Capture of the requests to the agents and their replies
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "helpers/clock.h"
+#include <cstdint>
+#include <cxxtools/serializationinfo.h>
+#include <fstream>
+#include <fty_userdata_dto.h>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+/**
+ * Sensitive values removed from the frames of the requests and replies: the passphrases and session tokens of the
+ * queries, and in the data of the features, the values of the JSON members whose name matches a rule. A value is
+ * replaced by as many '*' as it has characters so that the sizes are kept. Data which is not JSON is replaced as a
+ * whole, as its fields cannot be told apart.
+ */
+class SrrScrubber
+{
+public:
+    // rules: regular expressions separated by commas, searched in the member names, case insensitive
+    explicit SrrScrubber(const std::string& rules);
+
+    dto::UserData request(const std::string& action, const dto::UserData& frames) const;
+    dto::UserData reply(const std::string& action, const dto::UserData& frames) const;
+
+    // data of a feature
+    std::string data(const std::string& data) const;
+
+private:
+    std::vector<std::regex> m_rules;
+
+    bool matches(const std::string& name) const;
+    void scrub(cxxtools::SerializationInfo& si, bool matched) const;
+};
+
+// request to an agent and its reply
+struct SrrExchange
+{
+    uint64_t      m_sentMs    = 0; // since the start of the capture
+    uint64_t      m_latencyMs = 0;
+    std::string   m_agent;
+    std::string   m_queue;
+    std::string   m_action;
+    std::string   m_error; // empty if the reply was received
+    dto::UserData m_request;
+    dto::UserData m_reply;
+};
+
+void operator<<=(cxxtools::SerializationInfo& si, const SrrExchange& exchange);
+void operator>>=(const cxxtools::SerializationInfo& si, SrrExchange& exchange);
+
+// features a request with action is about, to match it with a recorded one
+std::vector<std::string> requestFeatures(const std::string& action, const dto::UserData& frames);
+
+/**
+ * Exchanges with the agents appended to a file, one JSON document per line, the frames in base64. Written as they
+ * complete: a capture cut by a crash keeps its complete lines.
+ */
+class SrrCapture
+{
+public:
+    SrrCapture(const std::string& path, const std::string& scrubRules, std::shared_ptr<Clock> clock);
+
+    // exchange sent at sent and completed now, scrubbed before it is written
+    void record(SrrExchange exchange, Clock::time_point sent);
+
+    // exchanges of a capture file, in their order of completion
+    static std::vector<SrrExchange> load(const std::string& path);
+
+private:
+    std::string            m_path;
+    SrrScrubber            m_scrubber;
+    std::shared_ptr<Clock> m_clock;
+    Clock::time_point      m_start;
+
+    std::mutex    m_mutex;
+    std::ofstream m_file;
+};
+
+} // namespace srr
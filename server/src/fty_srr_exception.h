@@ -103,6 +103,32 @@ namespace srr {
             return m_err.c_str();
         }
     };
+
+    struct SrrCancelled : public std::exception
+    {
+        SrrCancelled() {};
+        SrrCancelled(const std::string& err) : m_err(err) {};
+
+        std::string m_err = "Cancelled";
+
+        const char * what () const throw ()
+        {
+            return m_err.c_str();
+        }
+    };
+
+    struct SrrMemoryExceeded : public std::exception
+    {
+        SrrMemoryExceeded() {};
+        SrrMemoryExceeded(const std::string& err) : m_err(err) {};
+
+        std::string m_err = "Memory budget exceeded";
+
+        const char * what () const throw ()
+        {
+            return m_err.c_str();
+        }
+    };
 }
 
 #endif
@@ -68,7 +68,7 @@ auto initSrrFeatures = []() {
     tmp[F_ALERT_AGENT].m_name        = F_ALERT_AGENT;
     tmp[F_ALERT_AGENT].m_description = TRANSLATE_ME("srr_alert-agent");
     tmp[F_ALERT_AGENT].m_agent       = ALERT_AGENT_NAME;
-    tmp[F_ALERT_AGENT].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_ALERT_AGENT].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_ALERT_AGENT].m_restart     = true;
     tmp[F_ALERT_AGENT].m_reset       = true;
 
@@ -77,7 +77,7 @@ auto initSrrFeatures = []() {
     tmp[F_ASSET_AGENT].m_name        = F_ASSET_AGENT;
     tmp[F_ASSET_AGENT].m_description = TRANSLATE_ME("srr_asset-agent");
     tmp[F_ASSET_AGENT].m_agent       = ASSET_AGENT_NAME;
-    tmp[F_ASSET_AGENT].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_ASSET_AGENT].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_ASSET_AGENT].m_restart     = true;
     tmp[F_ASSET_AGENT].m_reset       = true;
 
@@ -86,7 +86,7 @@ auto initSrrFeatures = []() {
     tmp[F_AUTOMATIC_GROUPS].m_name        = F_AUTOMATIC_GROUPS;
     tmp[F_AUTOMATIC_GROUPS].m_description = TRANSLATE_ME("srr_automatic-groups");
     tmp[F_AUTOMATIC_GROUPS].m_agent       = AUTOMATIC_GROUPS_NAME;
-    tmp[F_AUTOMATIC_GROUPS].m_requiredIn  = {"2.1"};
+    tmp[F_AUTOMATIC_GROUPS].m_requiredIn  = {"2.1", "2.2"};
     tmp[F_AUTOMATIC_GROUPS].m_restart     = true;
     tmp[F_AUTOMATIC_GROUPS].m_reset       = true;
 
@@ -95,7 +95,7 @@ auto initSrrFeatures = []() {
     tmp[F_AUTOMATION_SETTINGS].m_name        = F_AUTOMATION_SETTINGS;
     tmp[F_AUTOMATION_SETTINGS].m_description = TRANSLATE_ME("srr_automation-settings");
     tmp[F_AUTOMATION_SETTINGS].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_AUTOMATION_SETTINGS].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_AUTOMATION_SETTINGS].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_AUTOMATION_SETTINGS].m_restart     = true;
     tmp[F_AUTOMATION_SETTINGS].m_reset       = false;
 
@@ -104,7 +104,7 @@ auto initSrrFeatures = []() {
     tmp[F_AUTOMATIONS].m_name        = F_AUTOMATIONS;
     tmp[F_AUTOMATIONS].m_description = TRANSLATE_ME("srr_automations");
     tmp[F_AUTOMATIONS].m_agent       = EMC4J_AGENT_NAME;
-    tmp[F_AUTOMATIONS].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_AUTOMATIONS].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_AUTOMATIONS].m_restart     = true;
     tmp[F_AUTOMATIONS].m_reset       = true;
 
@@ -113,7 +113,7 @@ auto initSrrFeatures = []() {
     tmp[F_DISCOVERY].m_name        = F_DISCOVERY;
     tmp[F_DISCOVERY].m_description = TRANSLATE_ME("srr_discovery");
     tmp[F_DISCOVERY].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_DISCOVERY].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_DISCOVERY].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_DISCOVERY].m_restart     = true;
     tmp[F_DISCOVERY].m_reset       = false;
 
@@ -122,7 +122,7 @@ auto initSrrFeatures = []() {
     tmp[F_MASS_MANAGEMENT].m_name        = F_MASS_MANAGEMENT;
     tmp[F_MASS_MANAGEMENT].m_description = TRANSLATE_ME("srr_etn-mass-management");
     tmp[F_MASS_MANAGEMENT].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_MASS_MANAGEMENT].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_MASS_MANAGEMENT].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_MASS_MANAGEMENT].m_restart     = true;
     tmp[F_MASS_MANAGEMENT].m_reset       = false;
 
@@ -131,7 +131,7 @@ auto initSrrFeatures = []() {
     tmp[F_MONITORING_FEATURE_NAME].m_name        = F_MONITORING_FEATURE_NAME;
     tmp[F_MONITORING_FEATURE_NAME].m_description = TRANSLATE_ME("srr_monitoring");
     tmp[F_MONITORING_FEATURE_NAME].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_MONITORING_FEATURE_NAME].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_MONITORING_FEATURE_NAME].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_MONITORING_FEATURE_NAME].m_restart     = true;
     tmp[F_MONITORING_FEATURE_NAME].m_reset       = false;
 
@@ -140,7 +140,7 @@ auto initSrrFeatures = []() {
     tmp[F_NETWORK].m_name        = F_NETWORK;
     tmp[F_NETWORK].m_description = TRANSLATE_ME("srr_network");
     tmp[F_NETWORK].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_NETWORK].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_NETWORK].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_NETWORK].m_restart     = true;
     tmp[F_NETWORK].m_reset       = false;
 
@@ -149,7 +149,7 @@ auto initSrrFeatures = []() {
     tmp[F_NOTIFICATION_FEATURE_NAME].m_name        = F_NOTIFICATION_FEATURE_NAME;
     tmp[F_NOTIFICATION_FEATURE_NAME].m_description = TRANSLATE_ME("srr_notification");
     tmp[F_NOTIFICATION_FEATURE_NAME].m_agent       = CONFIG_AGENT_NAME;
-    tmp[F_NOTIFICATION_FEATURE_NAME].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_NOTIFICATION_FEATURE_NAME].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_NOTIFICATION_FEATURE_NAME].m_restart     = true;
     tmp[F_NOTIFICATION_FEATURE_NAME].m_reset       = false;
 
@@ -159,7 +159,7 @@ auto initSrrFeatures = []() {
     tmp[F_SECURITY_WALLET].m_name        = F_SECURITY_WALLET;
     tmp[F_SECURITY_WALLET].m_description = TRANSLATE_ME("srr_security-wallet");
     tmp[F_SECURITY_WALLET].m_agent       = SECU_WALLET_AGENT_NAME;
-    tmp[F_SECURITY_WALLET].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_SECURITY_WALLET].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_SECURITY_WALLET].m_restart     = true;
     tmp[F_SECURITY_WALLET].m_reset       = false;
 
@@ -168,7 +168,7 @@ auto initSrrFeatures = []() {
     tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_name        = F_USER_SESSION_MANAGEMENT_FEATURE_NAME;
     tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_description = TRANSLATE_ME("srr_user-session-management");
     tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_agent       = USM_AGENT_NAME;
-    tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_requiredIn  = {"2.1"};
+    tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_requiredIn  = {"2.1", "2.2"};
     tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_restart     = true;
     tmp[F_USER_SESSION_MANAGEMENT_FEATURE_NAME].m_reset       = false;
 
@@ -177,7 +177,7 @@ auto initSrrFeatures = []() {
     tmp[F_VIRTUAL_ASSETS].m_name        = F_VIRTUAL_ASSETS;
     tmp[F_VIRTUAL_ASSETS].m_description = TRANSLATE_ME("srr_virtual-assets");
     tmp[F_VIRTUAL_ASSETS].m_agent       = EMC4J_AGENT_NAME;
-    tmp[F_VIRTUAL_ASSETS].m_requiredIn  = {"1.0", "2.0", "2.1"};
+    tmp[F_VIRTUAL_ASSETS].m_requiredIn  = {"1.0", "2.0", "2.1", "2.2"};
     tmp[F_VIRTUAL_ASSETS].m_restart     = true;
     tmp[F_VIRTUAL_ASSETS].m_reset       = true;
 
@@ -44,6 +44,8 @@ typedef struct SrrFeatureStruct
 
     bool m_restart;
     bool m_reset;
+    bool m_revision; // agent answers the revision probe used by incremental saves
+    bool m_twoPhase; // agent supports the prepare/commit/abort restore
 } SrrFeatureStruct;
 
 typedef struct SrrFeaturePriorityStruct
@@ -0,0 +1,197 @@
+/*  =========================================================================
+    fty_srr_history - Duration and size history of the features
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_history.h"
+#include "dto/common.h"
+#include "fty_srr_store.h"
+#include <algorithm>
+#include <cxxtools/serializationinfo.h>
+#include <fty_log.h>
+#include <functional>
+#include <queue>
+
+// weight of the latest sample in the moving average
+#define HISTORY_WEIGHT 0.3
+
+namespace srr {
+
+static constexpr const char* HISTORY_DOCUMENT = "history";
+
+static constexpr const char* SI_OPERATIONS = "operations";
+
+static uint64_t average(uint64_t previous, uint64_t sample, uint64_t samples)
+{
+    if (samples == 0) {
+        return sample;
+    }
+    return static_cast<uint64_t>(HISTORY_WEIGHT * static_cast<double>(sample) +
+                                 (1 - HISTORY_WEIGHT) * static_cast<double>(previous));
+}
+
+SrrHistory::SrrHistory(SrrStore* store)
+    : m_store(store)
+{
+    load();
+}
+
+void SrrHistory::record(
+    const std::string& featureName, const std::string& operation, std::chrono::milliseconds duration, uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Estimate& estimate    = m_history[featureName][operation];
+    estimate.m_durationMs = average(estimate.m_durationMs, static_cast<uint64_t>(duration.count()), estimate.m_samples);
+    estimate.m_size       = average(estimate.m_size, size, estimate.m_samples);
+    estimate.m_samples++;
+
+    m_changed = true;
+}
+
+SrrHistory::Estimate SrrHistory::estimate(const std::string& featureName, const std::string& operation) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto feature = m_history.find(featureName);
+    if (feature == m_history.end()) {
+        return Estimate();
+    }
+    auto found = feature->second.find(operation);
+    return found != feature->second.end() ? found->second : Estimate();
+}
+
+std::vector<size_t> SrrHistory::longestFirst(
+    const std::vector<std::string>& features, const std::string& operation) const
+{
+    std::vector<Estimate> estimates;
+    for (const auto& featureName : features) {
+        estimates.push_back(estimate(featureName, operation));
+    }
+
+    std::vector<size_t> order(features.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    // stable: equal estimates keep the order of the group
+    std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+        const bool unknownL = estimates[l].m_samples == 0;
+        const bool unknownR = estimates[r].m_samples == 0;
+        if (unknownL != unknownR) {
+            return unknownL;
+        }
+        return estimates[l].m_durationMs > estimates[r].m_durationMs;
+    });
+
+    return order;
+}
+
+uint64_t SrrHistory::makespan(
+    const std::vector<std::string>& features, const std::string& operation, size_t channels) const
+{
+    // end time of each channel, the next feature goes to the one which is free first
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> ends;
+    for (size_t i = 0; i < std::max<size_t>(1, channels); i++) {
+        ends.push(0);
+    }
+
+    uint64_t makespan = 0;
+    for (size_t index : longestFirst(features, operation)) {
+        const uint64_t end = ends.top() + estimate(features[index], operation).m_durationMs;
+        ends.pop();
+        ends.push(end);
+        makespan = std::max(makespan, end);
+    }
+
+    return makespan;
+}
+
+void SrrHistory::flush()
+{
+    cxxtools::SerializationInfo si;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_store || !m_changed) {
+            return;
+        }
+
+        cxxtools::SerializationInfo& featuresSi = si.addMember(SI_FEATURES);
+        featuresSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+
+        for (const auto& feature : m_history) {
+            cxxtools::SerializationInfo& featureSi = featuresSi.addMember("");
+            featureSi.addMember(SI_NAME) <<= feature.first;
+
+            cxxtools::SerializationInfo& operationsSi = featureSi.addMember(SI_OPERATIONS);
+            operationsSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+
+            for (const auto& operation : feature.second) {
+                cxxtools::SerializationInfo& operationSi = operationsSi.addMember("");
+                operationSi.addMember(SI_OPERATION) <<= operation.first;
+                operationSi.addMember(SI_DURATION_MS) <<= operation.second.m_durationMs;
+                operationSi.addMember(SI_SIZE) <<= operation.second.m_size;
+                operationSi.addMember(SI_SAMPLES) <<= operation.second.m_samples;
+            }
+        }
+        m_changed = false;
+    }
+
+    try {
+        m_store->writeDocument(HISTORY_DOCUMENT, si);
+    } catch (const std::exception& e) {
+        log_warning("Failed to write the duration history: %s", e.what());
+    }
+}
+
+void SrrHistory::load()
+{
+    if (!m_store) {
+        return;
+    }
+
+    try {
+        cxxtools::SerializationInfo si;
+        if (!m_store->readDocument(HISTORY_DOCUMENT, si)) {
+            return;
+        }
+
+        for (const auto& featureSi : si.getMember(SI_FEATURES)) {
+            std::string featureName;
+            featureSi.getMember(SI_NAME) >>= featureName;
+
+            for (const auto& operationSi : featureSi.getMember(SI_OPERATIONS)) {
+                std::string operation;
+                Estimate    estimate;
+                operationSi.getMember(SI_OPERATION) >>= operation;
+                operationSi.getMember(SI_DURATION_MS) >>= estimate.m_durationMs;
+                operationSi.getMember(SI_SIZE) >>= estimate.m_size;
+                operationSi.getMember(SI_SAMPLES) >>= estimate.m_samples;
+
+                m_history[featureName][operation] = estimate;
+            }
+        }
+    } catch (const std::exception& e) {
+        // estimates start again from scratch
+        log_warning("Failed to read the duration history: %s", e.what());
+        m_history.clear();
+    }
+}
+
+} // namespace srr
@@ -0,0 +1,80 @@
+/*  =========================================================================
+    fty_srr_history - Duration and size history of the features
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+class SrrStore;
+
+// operations of the history
+static constexpr const char* HISTORY_SAVE    = "save";
+static constexpr const char* HISTORY_RESTORE = "restore";
+
+/**
+ * Duration and payload size of the latest saves and restores of each feature (moving average).
+ * Used to start the longest features first and to estimate a save or a restore before it runs.
+ * The history is kept in the local store, if enabled.
+ */
+class SrrHistory
+{
+public:
+    struct Estimate
+    {
+        uint64_t m_durationMs = 0;
+        uint64_t m_size       = 0;
+        uint64_t m_samples    = 0; // 0: never measured
+    };
+
+    // store: where the history is kept, nullptr to keep it in memory only
+    explicit SrrHistory(SrrStore* store);
+
+    void record(const std::string& featureName, const std::string& operation, std::chrono::milliseconds duration,
+        uint64_t size);
+    // moving average of the feature, m_samples is 0 if it was never measured
+    Estimate estimate(const std::string& featureName, const std::string& operation) const;
+
+    // indexes of features, longest first. Features never measured come first: they may be the longest.
+    std::vector<size_t> longestFirst(const std::vector<std::string>& features, const std::string& operation) const;
+    // duration of the features run longest first on channels in parallel
+    uint64_t makespan(const std::vector<std::string>& features, const std::string& operation, size_t channels) const;
+
+    // write the history to the store if it changed
+    void flush();
+
+private:
+    SrrStore* m_store;
+
+    mutable std::mutex                                     m_mutex;
+    std::map<std::string, std::map<std::string, Estimate>> m_history; // by feature, then operation
+    bool                                                   m_changed = false;
+
+    void load();
+};
+
+} // namespace srr
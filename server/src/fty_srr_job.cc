@@ -0,0 +1,189 @@
+/*  =========================================================================
+    fty_srr_job - Registry of save and restore jobs
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_job.h"
+#include <algorithm>
+
+namespace srr {
+
+static thread_local std::shared_ptr<SrrJobContext> t_currentJob;
+
+SrrJobContext::SrrJobContext(const std::string& id, Clock::time_point deadline, std::shared_ptr<srr::Clock> clock)
+    : m_id(id)
+    , m_deadline(deadline)
+    , m_clock(clock)
+{
+}
+
+const std::string& SrrJobContext::id() const
+{
+    return m_id;
+}
+
+SrrJobContext::Clock::time_point SrrJobContext::deadline() const
+{
+    return m_deadline;
+}
+
+void SrrJobContext::cancel()
+{
+    log_info("Cancelling job %s", m_id.c_str());
+    m_cancelled = true;
+}
+
+bool SrrJobContext::isCancelled() const
+{
+    return m_cancelled;
+}
+
+void SrrJobContext::checkpoint() const
+{
+    if (m_recovery > 0) {
+        return;
+    }
+    if (m_cancelled) {
+        throw SrrCancelled("Job " + m_id + " cancelled");
+    }
+    if (m_clock->now() >= m_deadline) {
+        throw SrrCancelled("Job " + m_id + " deadline exceeded");
+    }
+}
+
+int SrrJobContext::timeout(int timeout) const
+{
+    if (m_recovery > 0 || m_deadline == Clock::time_point::max()) {
+        return timeout;
+    }
+
+    checkpoint();
+
+    // round up: a request needs at least one second
+    const auto left = std::chrono::ceil<std::chrono::seconds>(m_deadline - m_clock->now()).count();
+    return static_cast<int>(std::max<decltype(left)>(1, std::min<decltype(left)>(timeout, left)));
+}
+
+void SrrJobContext::enterRecovery()
+{
+    m_recovery++;
+}
+
+void SrrJobContext::leaveRecovery()
+{
+    m_recovery--;
+}
+
+bool SrrJobContext::isRecovering() const
+{
+    return m_recovery > 0;
+}
+
+std::shared_ptr<SrrTrace> SrrJobContext::trace() const
+{
+    return std::atomic_load(&m_trace);
+}
+
+void SrrJobContext::setTrace(const std::shared_ptr<SrrTrace>& trace)
+{
+    std::atomic_store(&m_trace, trace);
+}
+
+std::shared_ptr<SrrMemoryAccount> SrrJobContext::memory() const
+{
+    return std::atomic_load(&m_memory);
+}
+
+void SrrJobContext::setMemory(const std::shared_ptr<SrrMemoryAccount>& memory)
+{
+    std::atomic_store(&m_memory, memory);
+}
+
+std::shared_ptr<SrrJobContext> currentJob()
+{
+    return t_currentJob;
+}
+
+void jobCheckpoint()
+{
+    if (t_currentJob) {
+        t_currentJob->checkpoint();
+    }
+}
+
+int jobTimeout(int timeout)
+{
+    return t_currentJob ? t_currentJob->timeout(timeout) : timeout;
+}
+
+SrrJobScope::SrrJobScope(const std::shared_ptr<SrrJobContext>& job)
+    : m_previous(t_currentJob)
+{
+    t_currentJob = job;
+}
+
+SrrJobScope::~SrrJobScope()
+{
+    t_currentJob = m_previous;
+}
+
+SrrRecoveryScope::SrrRecoveryScope()
+    : m_job(t_currentJob)
+{
+    if (m_job) {
+        m_job->enterRecovery();
+    }
+}
+
+SrrRecoveryScope::~SrrRecoveryScope()
+{
+    if (m_job) {
+        m_job->leaveRecovery();
+    }
+}
+
+std::shared_ptr<void> SrrActiveJobs::attach(const std::string& key)
+{
+    auto job = t_currentJob;
+    if (key.empty() || !job) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        it = m_jobs.emplace(key, job);
+
+    return std::shared_ptr<void>(nullptr, [this, it](void*) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.erase(it);
+    });
+}
+
+size_t SrrActiveJobs::cancel(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto range = m_jobs.equal_range(key);
+    for (auto it = range.first; it != range.second; it++) {
+        it->second->cancel();
+    }
+
+    return static_cast<size_t>(std::distance(range.first, range.second));
+}
+
+} // namespace srr
@@ -0,0 +1,249 @@
+/*  =========================================================================
+    fty_srr_job - Registry of save and restore jobs
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_srr_exception.h"
+#include "helpers/clock.h"
+#include <atomic>
+#include <chrono>
+#include <fty_log.h>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace srr {
+
+class SrrMemoryAccount;
+class SrrTrace;
+
+/**
+ * Deadline and cancellation state of a request.
+ * Long operations check it at safe points (between features), requests to the agents get the time left as timeout.
+ */
+class SrrJobContext
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // deadline is a time of clock
+    explicit SrrJobContext(const std::string& id, Clock::time_point deadline = Clock::time_point::max(),
+        std::shared_ptr<srr::Clock> clock = steadyClock());
+
+    const std::string& id() const;
+    Clock::time_point  deadline() const;
+
+    void cancel();
+    bool isCancelled() const;
+
+    // throw SrrCancelled if the job is cancelled or past its deadline, except during a recovery
+    void checkpoint() const;
+    // timeout in seconds of a request to an agent: capped to the time left, except during a recovery
+    int timeout(int timeout) const;
+
+    // commit, rollback and abort must complete once started: cancellation and deadline are ignored in between
+    void enterRecovery();
+    void leaveRecovery();
+    bool isRecovering() const;
+
+    // spans of the job, nullptr if it is not traced
+    std::shared_ptr<SrrTrace> trace() const;
+    void                      setTrace(const std::shared_ptr<SrrTrace>& trace);
+
+    // memory held by the job, nullptr if it is not accounted
+    std::shared_ptr<SrrMemoryAccount> memory() const;
+    void                              setMemory(const std::shared_ptr<SrrMemoryAccount>& memory);
+
+private:
+    std::string                 m_id;
+    Clock::time_point           m_deadline;
+    std::shared_ptr<srr::Clock> m_clock;
+    std::atomic<bool>           m_cancelled{false};
+    std::atomic<unsigned>       m_recovery{0};
+    std::shared_ptr<SrrTrace>   m_trace; // read by the event loop: accessed atomically
+
+    std::shared_ptr<SrrMemoryAccount> m_memory; // accessed atomically too
+};
+
+// job of the calling thread, nullptr if none
+std::shared_ptr<SrrJobContext> currentJob();
+
+// checkpoint of the current job, if any
+void jobCheckpoint();
+// timeout of the current job, if any
+int jobTimeout(int timeout);
+
+// set the job of the calling thread for its lifetime
+class SrrJobScope
+{
+public:
+    explicit SrrJobScope(const std::shared_ptr<SrrJobContext>& job);
+    ~SrrJobScope();
+
+private:
+    std::shared_ptr<SrrJobContext> m_previous;
+};
+
+// recovery section of the current job
+class SrrRecoveryScope
+{
+public:
+    SrrRecoveryScope();
+    ~SrrRecoveryScope();
+
+private:
+    std::shared_ptr<SrrJobContext> m_job;
+};
+
+// jobs which can be cancelled by their key (idempotency key of the request)
+class SrrActiveJobs
+{
+public:
+    // the current job can be cancelled with key until the returned handle is released
+    std::shared_ptr<void> attach(const std::string& key);
+    // cancel the jobs attached to key, returns their number
+    size_t cancel(const std::string& key);
+
+private:
+    std::mutex                                                 m_mutex;
+    std::multimap<std::string, std::shared_ptr<SrrJobContext>> m_jobs;
+};
+
+/**
+ * Jobs in progress, by key.
+ * A request with the key of a running job waits for its result instead of running again. With keepResult, the
+ * result is also kept for the retention time after the end of the job, to answer the retries of the same request.
+ * The digest of the request (credentials included) is kept with the key: a request with the key of a job run for
+ * another request fails, it never gets the result of someone else.
+ */
+template <typename Result>
+class SrrJobRegistry
+{
+public:
+    explicit SrrJobRegistry(std::chrono::seconds retention)
+        : m_retention(retention)
+    {
+    }
+
+    // an empty key runs the job without registration
+    Result run(
+        const std::string& key, const std::string& request, bool keepResult, const std::function<Result()>& job);
+
+private:
+    struct Job
+    {
+        std::promise<Result>                  m_promise;
+        std::shared_future<Result>            m_result;
+        std::string                           m_request; // digest of the request
+        std::chrono::steady_clock::time_point m_finished;
+        bool                                  m_done = false;
+    };
+
+    std::chrono::seconds                        m_retention;
+    std::mutex                                  m_mutex;
+    std::map<std::string, std::shared_ptr<Job>> m_jobs;
+
+    // remove the results kept for longer than the retention time, m_mutex must be locked
+    void purge();
+};
+
+template <typename Result>
+Result SrrJobRegistry<Result>::run(
+    const std::string& key, const std::string& request, bool keepResult, const std::function<Result()>& job)
+{
+    if (key.empty()) {
+        return job();
+    }
+
+    std::shared_ptr<Job> entry;
+    bool                 owner = false;
+    bool                 done  = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        purge();
+
+        auto found = m_jobs.find(key);
+        if (found != m_jobs.end()) {
+            if (found->second->m_request != request) {
+                throw SrrException("Idempotency key reused with a different request");
+            }
+            entry = found->second;
+            done  = entry->m_done;
+        } else {
+            entry            = std::make_shared<Job>();
+            entry->m_result  = entry->m_promise.get_future().share();
+            entry->m_request = request;
+            m_jobs[key]      = entry;
+            owner            = true;
+        }
+    }
+
+    if (!owner) {
+        log_info("Job %s already %s, using its result", key.c_str(), done ? "done" : "in progress");
+
+        // do not wait past the deadline of this request
+        auto job = currentJob();
+        if (job && job->deadline() != SrrJobContext::Clock::time_point::max() &&
+            entry->m_result.wait_until(job->deadline()) != std::future_status::ready) {
+            throw SrrCancelled("Deadline exceeded while waiting for job " + key);
+        }
+        return entry->m_result.get();
+    }
+
+    try {
+        Result result = job();
+        entry->m_promise.set_value(result);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (keepResult) {
+            entry->m_finished = std::chrono::steady_clock::now();
+            entry->m_done     = true;
+        } else {
+            m_jobs.erase(key);
+        }
+        return result;
+    } catch (...) {
+        // waiting requests get the error, a retry runs the job again
+        entry->m_promise.set_exception(std::current_exception());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.erase(key);
+        throw;
+    }
+}
+
+template <typename Result>
+void SrrJobRegistry<Result>::purge()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (it->second->m_done && now - it->second->m_finished > m_retention) {
+            it = m_jobs.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+} // namespace srr
@@ -22,10 +22,21 @@
 #include "fty_srr_manager.h"
 #include "fty-srr.h"
 #include "fty_srr_exception.h"
+#include "fty_srr_job.h"
+#include "fty_srr_metrics.h"
+#include "fty_srr_recorder.h"
 #include "fty_srr_worker.h"
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <functional>
+#include <set>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <thread>
+#include <unistd.h>
+
+#define DEADLINE_MARGIN_SEC 2
 
 using namespace std::placeholders;
 using namespace dto::srr;
@@ -35,11 +46,19 @@ using namespace dto::srr;
 namespace srr
 {
     
+    const std::set<std::string> SrrManager::m_flightOperations = {"save", "restore", "reset", "snapshot", "restore-snapshot"};
+
     const std::map<const std::string, RequestType> SrrRequestProcessor::m_requestType = {
-        {"list"    , RequestType::REQ_LIST},
-        {"save"    , RequestType::REQ_SAVE},
-        {"restore" , RequestType::REQ_RESTORE},
-        {"reset"   , RequestType::REQ_RESET}
+        {"list"            , RequestType::REQ_LIST},
+        {"save"            , RequestType::REQ_SAVE},
+        {"restore"         , RequestType::REQ_RESTORE},
+        {"reset"           , RequestType::REQ_RESET},
+        {"snapshot"        , RequestType::REQ_SNAPSHOT},
+        {"list-snapshots"  , RequestType::REQ_LIST_SNAPSHOTS},
+        {"restore-snapshot", RequestType::REQ_RESTORE_SNAPSHOT},
+        {"cancel"          , RequestType::REQ_CANCEL},
+        {"estimate"        , RequestType::REQ_ESTIMATE},
+        {"stats"           , RequestType::REQ_STATS}
     };
 
     dto::UserData SrrRequestProcessor::processRequest(const std::string& operation, const dto::UserData& data)
@@ -48,6 +67,13 @@ namespace srr
 
         RequestType op = m_requestType.find(operation) != m_requestType.end() ? m_requestType.at(operation) : RequestType::REQ_UNKNOWN;
 
+        // unknown subjects are not measured: each one would add an entry
+        std::unique_ptr<SrrTimer> timer;
+        if (op != RequestType::REQ_UNKNOWN)
+        {
+            timer = std::unique_ptr<SrrTimer>(new SrrTimer(metrics().operation(operation)));
+        }
+
         switch(op)
         {
             case RequestType::REQ_LIST :
@@ -69,6 +95,36 @@ namespace srr
                 if(!resetHandler) throw std::runtime_error("No reset handler!");
                 response = resetHandler(data.front());
                 break;
+
+            case RequestType::REQ_SNAPSHOT :
+                if(!snapshotHandler) throw std::runtime_error("No snapshot handler!");
+                response = snapshotHandler(data.front());
+                break;
+
+            case RequestType::REQ_LIST_SNAPSHOTS :
+                if(!listSnapshotsHandler) throw std::runtime_error("No list snapshots handler!");
+                response = listSnapshotsHandler();
+                break;
+
+            case RequestType::REQ_RESTORE_SNAPSHOT :
+                if(!restoreSnapshotHandler) throw std::runtime_error("No restore snapshot handler!");
+                response = restoreSnapshotHandler(data.front(), data.size() > 1);
+                break;
+
+            case RequestType::REQ_CANCEL :
+                if(!cancelHandler) throw std::runtime_error("No cancel handler!");
+                response = cancelHandler(data.front());
+                break;
+
+            case RequestType::REQ_ESTIMATE :
+                if(!estimateHandler) throw std::runtime_error("No estimate handler!");
+                response = estimateHandler(data.front());
+                break;
+
+            case RequestType::REQ_STATS :
+                if(!statsHandler) throw std::runtime_error("No stats handler!");
+                response = statsHandler();
+                break;
             
             case RequestType::REQ_UNKNOWN:
             default:
@@ -89,12 +145,44 @@ namespace srr
     {
         init();
     }
+
+    SrrManager::~SrrManager()
+    {
+        if (m_continuousThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_continuousMutex);
+                m_stopContinuous = true;
+            }
+            m_continuousCv.notify_one();
+            m_continuousThread.join();
+        }
+
+        flightRecorder().record(SrrFlightEvent(SrrFlightEventType::Stop, "", m_parameters.at(AGENT_NAME_KEY)));
+        flightRecorder().sync();
+    }
     
     /**
      * Class initialization 
      */
     void SrrManager::init()
     {
+        // always on: the daemon runs without it if the file cannot be mapped
+        auto recorder = m_parameters.find(FLIGHT_RECORDER_KEY);
+        if (recorder != m_parameters.end() && !recorder->second.empty() && !flightRecorder().isOpen())
+        {
+            try
+            {
+                auto events = m_parameters.find(FLIGHT_RECORDER_EVENTS_KEY);
+                flightRecorder().open(recorder->second, std::stoull(events != m_parameters.end() ? events->second : FLIGHT_RECORDER_EVENTS_DEFAULT));
+                flightRecorder().record(SrrFlightEvent(SrrFlightEventType::Start, "", m_parameters.at(AGENT_NAME_KEY)));
+            }
+            catch (std::exception& ex)
+            {
+                log_warning("Flight recorder disabled: %s", ex.what());
+            }
+        }
+
         try
         {
             // Back end bus init
@@ -106,22 +194,40 @@ namespace srr
             m_uiBus->connect();
             
             // Worker creation.
-            m_srrworker = std::unique_ptr<srr::SrrWorker>(new srr::SrrWorker(*m_backEndBus, m_parameters, {"1.0", "2.0", "2.1"}));
+            m_srrworker = std::unique_ptr<srr::SrrWorker>(new srr::SrrWorker(*m_backEndBus, m_parameters, {"1.0", "2.0", "2.1", "2.2"}));
             
             // Bind all processor handler.
             m_processor.listHandler = std::bind(&SrrWorker::getGroupList, m_srrworker.get());
             m_processor.saveHandler = std::bind(&SrrWorker::requestSave, m_srrworker.get(), _1);
             m_processor.restoreHandler = std::bind(&SrrWorker::requestRestore, m_srrworker.get(), _1, _2);
             m_processor.resetHandler = std::bind(&SrrWorker::requestReset, m_srrworker.get(), _1);
+            m_processor.snapshotHandler = std::bind(&SrrWorker::requestSnapshot, m_srrworker.get(), _1);
+            m_processor.listSnapshotsHandler = std::bind(&SrrWorker::requestListSnapshots, m_srrworker.get());
+            m_processor.restoreSnapshotHandler = std::bind(&SrrWorker::requestRestoreSnapshot, m_srrworker.get(), _1, _2);
+            m_processor.cancelHandler = std::bind(&SrrWorker::requestCancel, m_srrworker.get(), _1);
+            m_processor.estimateHandler = std::bind(&SrrWorker::requestEstimate, m_srrworker.get(), _1);
+            m_processor.statsHandler = std::bind(&SrrWorker::requestStats, m_srrworker.get());
             
             // Listen all incoming UI requests           
             auto uiFct = std::bind(&SrrManager::handleRequest, this, _1);
             m_uiBus->receive(m_parameters.at(SRR_QUEUE_NAME_KEY) + ".UI", uiFct);
+
+            // Background refresh of the continuous backup
+            if (m_srrworker->isContinuousBackupEnabled())
+            {
+                auto period = m_parameters.find(CONTINUOUS_BACKUP_PERIOD_KEY);
+                m_continuousPeriod = std::chrono::seconds(std::stoul(period != m_parameters.end() ? period->second : CONTINUOUS_BACKUP_PERIOD_DEFAULT));
+                m_continuousThread = std::thread(&SrrManager::continuousBackupLoop, this);
+            }
         }        
         catch (messagebus::MessageBusException& ex)
         {
             log_error("Message bus error: %s", ex.what());
             throw SrrException("Failed to open connection with message bus!");
+        } catch (std::exception& ex)
+        {
+            log_error("Initialization error: %s", ex.what());
+            throw SrrException(ex.what());
         } catch (...)
         {
             log_error("Unexpected error: unknown");
@@ -129,17 +235,118 @@ namespace srr
         }
     }
 
+    /**
+     * Refresh the continuous backup every period, with the lowest priority: the cycle is skipped while a request is processed
+     */
+    void SrrManager::continuousBackupLoop()
+    {
+        // the niceness of a thread is set through its thread id on Linux
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19) != 0)
+        {
+            log_warning("Cannot lower the priority of the continuous backup thread");
+        }
+
+        std::unique_lock<std::mutex> lock(m_continuousMutex);
+        while (!m_continuousCv.wait_for(lock, m_continuousPeriod, [this] { return m_stopContinuous; }))
+        {
+            if (m_activeRequests > 0)
+            {
+                log_debug("Request in progress, continuous backup refresh postponed");
+                continue;
+            }
+
+            lock.unlock();
+            try
+            {
+                m_srrworker->refreshContinuousBackup();
+            }
+            catch (std::exception& ex)
+            {
+                log_error("Continuous backup refresh error: %s", ex.what());
+            }
+            lock.lock();
+        }
+    }
+
     void SrrManager::uiMsgHandler(const messagebus::Message& msg)
     {
         log_debug("uiMsgHandler");
 
+        // only the jobs are active: a poll of the statistics must not postpone the continuous backup refresh
+        auto subject = msg.metaData().find(messagebus::Message::SUBJECT);
+        const bool isJob = subject != msg.metaData().end() && m_flightOperations.count(subject->second) > 0;
+
+        if (isJob)
+        {
+            ++m_activeRequests;
+            metrics().m_activeJobs++;
+        }
+
         dto::UserData response;
 
         try
         {
             const std::string& op = msg.metaData().at(messagebus::Message::SUBJECT);
 
-            response = m_processor.processRequest(op, msg.userData());
+            // the request ends when the requester stops waiting for it: the deadline applies to every agent request
+            auto deadline = SrrJobContext::Clock::time_point::max();
+            auto timeout = msg.metaData().find(messagebus::Message::TIME_OUT);
+            if (timeout != msg.metaData().end() && !timeout->second.empty())
+            {
+                char* end = nullptr;
+                errno = 0;
+                const long seconds = std::strtol(timeout->second.c_str(), &end, 10);
+                if (errno != 0 || *end != '\0' || seconds <= 0)
+                {
+                    log_warning("Invalid timeout %s, the request has no deadline", timeout->second.c_str());
+                }
+                else
+                {
+                    // a short timeout keeps half of its time instead of a deadline already passed
+                    const long ms = std::max((seconds - DEADLINE_MARGIN_SEC) * 1000, seconds * 500);
+                    deadline = SrrJobContext::Clock::now() + std::chrono::milliseconds(ms);
+                }
+            }
+
+            auto correlationId = msg.metaData().find(messagebus::Message::CORRELATION_ID);
+            const std::string jobId = correlationId != msg.metaData().end() ? correlationId->second : op;
+            SrrJobScope job(std::make_shared<SrrJobContext>(jobId, deadline));
+
+            // the requests answering at once are not recorded: they would push the jobs out of the ring
+            const bool recorded = isJob;
+            const auto start = std::chrono::steady_clock::now();
+            auto recordEnd = [&](const std::string& status, bool failed)
+            {
+                SrrFlightEvent end(SrrFlightEventType::JobEnd, jobId, op, "", status);
+                end.m_durationMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+                end.m_failed = failed ? 1 : 0;
+                flightRecorder().record(end);
+            };
+
+            if (recorded)
+            {
+                flightRecorder().record(SrrFlightEvent(SrrFlightEventType::JobStart, jobId, op));
+            }
+
+            try
+            {
+                response = m_processor.processRequest(op, msg.userData());
+            }
+            catch (std::exception& ex)
+            {
+                if (recorded)
+                {
+                    recordEnd(ex.what(), true);
+                }
+                throw;
+            }
+
+            if (recorded)
+            {
+                // the status comes first in the responses of the jobs
+                const std::string status = response.empty() ? "" : response.front();
+                recordEnd(status, status != statusToString(Status::SUCCESS));
+            }
             // Send response
         }        
         catch (std::exception& ex)
@@ -148,6 +355,12 @@ namespace srr
             log_error(ex.what());
         }
 
+        if (isJob)
+        {
+            --m_activeRequests;
+            metrics().m_activeJobs--;
+        }
+
         sendUiResponse(msg, response);
     }
 
@@ -21,12 +21,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fty_common_dto.h>
 #include <fty_common_messagebus.h>
 #include <fty_userdata_dto.h>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 
 /// Agent srr server
 namespace srr {
@@ -38,7 +44,13 @@ enum class RequestType
     REQ_LIST,
     REQ_SAVE,
     REQ_RESTORE,
-    REQ_RESET
+    REQ_RESET,
+    REQ_SNAPSHOT,
+    REQ_LIST_SNAPSHOTS,
+    REQ_RESTORE_SNAPSHOT,
+    REQ_CANCEL,
+    REQ_ESTIMATE,
+    REQ_STATS
 };
 
 class SrrRequestProcessor
@@ -50,6 +62,12 @@ public:
     std::function<dto::UserData(const std::string&)>       saveHandler;
     std::function<dto::UserData(const std::string&, bool)> restoreHandler;
     std::function<dto::UserData(const std::string&)>       resetHandler;
+    std::function<dto::UserData(const std::string&)>       snapshotHandler;
+    std::function<dto::UserData()>                         listSnapshotsHandler;
+    std::function<dto::UserData(const std::string&, bool)> restoreSnapshotHandler;
+    std::function<dto::UserData(const std::string&)>       cancelHandler;
+    std::function<dto::UserData(const std::string&)>       estimateHandler;
+    std::function<dto::UserData()>                         statsHandler;
 
     dto::UserData processRequest(const std::string& operation, const dto::UserData& data);
 };
@@ -58,7 +76,7 @@ class SrrManager
 {
 public:
     explicit SrrManager(const std::map<std::string, std::string>& parameters);
-    ~SrrManager() = default;
+    ~SrrManager();
 
 private:
     std::map<std::string, std::string> m_parameters;
@@ -70,8 +88,20 @@ private:
 
     SrrRequestProcessor m_processor;
 
+    // operations whose start and end are kept by the flight recorder
+    static const std::set<std::string> m_flightOperations;
+
+    // continuous backup, refreshed in background while no request is processed
+    std::atomic<unsigned>   m_activeRequests{0};
+    std::chrono::seconds    m_continuousPeriod{0};
+    std::thread             m_continuousThread;
+    std::mutex              m_continuousMutex;
+    std::condition_variable m_continuousCv;
+    bool                    m_stopContinuous = false;
+
     void init();
     void handleRequest(messagebus::Message msg);
+    void continuousBackupLoop();
 
     void sendResponse(const messagebus::Message& msg, const dto::UserData& userData);
     void sendUiResponse(const messagebus::Message& msg, const dto::UserData& userData);
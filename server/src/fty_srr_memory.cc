@@ -0,0 +1,240 @@
+/*  =========================================================================
+    fty_srr_memory - Memory held by the jobs, peak tracking and budget
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_memory.h"
+#include "fty_srr_exception.h"
+#include "fty_srr_job.h"
+#include "fty_srr_metrics.h"
+#include <algorithm>
+#include <fty_log.h>
+
+namespace srr {
+
+const char* memoryKindName(SrrMemoryKind kind)
+{
+    switch (kind) {
+        case SrrMemoryKind::Dto:
+            return "dto";
+        case SrrMemoryKind::Serialization:
+            return "serialization";
+        case SrrMemoryKind::Protobuf:
+            return "protobuf";
+        case SrrMemoryKind::Rollback:
+            return "rollback";
+    }
+    return "unknown";
+}
+
+SrrMemoryAccount::SrrMemoryAccount(uint64_t budget)
+    : m_budget(budget)
+{
+}
+
+SrrMemoryAccount::~SrrMemoryAccount()
+{
+    // the charges keep the account alive: nothing should be left, but the gauge must not drift
+    metrics().m_jobMemoryBytes -= static_cast<int64_t>(m_current);
+}
+
+void SrrMemoryAccount::charge(SrrMemoryKind kind, uint64_t bytes, bool enforce)
+{
+    const size_t index = static_cast<size_t>(kind);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (enforce && m_budget > 0 && m_current + bytes > m_budget) {
+            metrics().m_memoryBudgetExceeded++;
+            throw SrrMemoryExceeded("Memory budget of " + std::to_string(m_budget) + " bytes exceeded: " +
+                                    std::to_string(bytes) + " bytes of " + memoryKindName(kind) + " needed, " +
+                                    std::to_string(m_current) + " bytes held");
+        }
+
+        m_current += bytes;
+        m_peak = std::max(m_peak, m_current);
+
+        m_kindCurrent[index] += bytes;
+        m_kindPeak[index] = std::max(m_kindPeak[index], m_kindCurrent[index]);
+
+        for (auto& phase : m_phases) {
+            if (phase.second.m_active > 0) {
+                phase.second.m_peak = std::max(phase.second.m_peak, m_current);
+            }
+        }
+    }
+    metrics().m_jobMemoryBytes += static_cast<int64_t>(bytes);
+}
+
+void SrrMemoryAccount::release(SrrMemoryKind kind, uint64_t bytes)
+{
+    const size_t index = static_cast<size_t>(kind);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bytes = std::min(bytes, m_kindCurrent[index]);
+
+        m_kindCurrent[index] -= bytes;
+        m_current -= bytes;
+    }
+    metrics().m_jobMemoryBytes -= static_cast<int64_t>(bytes);
+}
+
+void SrrMemoryAccount::enterPhase(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_phases.find(name);
+    if (found == m_phases.end()) {
+        found = m_phases.emplace(name, Phase()).first;
+        m_phaseOrder.push_back(name);
+    }
+    found->second.m_active++;
+    found->second.m_peak = std::max(found->second.m_peak, m_current);
+}
+
+void SrrMemoryAccount::leavePhase(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_phases.find(name);
+    if (found != m_phases.end() && found->second.m_active > 0) {
+        found->second.m_active--;
+    }
+}
+
+uint64_t SrrMemoryAccount::budget() const
+{
+    return m_budget;
+}
+
+uint64_t SrrMemoryAccount::current() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current;
+}
+
+uint64_t SrrMemoryAccount::peak() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+MemoryUsage SrrMemoryAccount::usage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryUsage usage;
+    usage.m_budget = m_budget;
+    usage.m_peak   = m_peak;
+    for (size_t index = 0; index < KINDS; index++) {
+        MemoryPeak kind;
+        kind.m_name = memoryKindName(static_cast<SrrMemoryKind>(index));
+        kind.m_peak = m_kindPeak[index];
+        usage.m_kinds.push_back(kind);
+    }
+    for (const auto& name : m_phaseOrder) {
+        MemoryPeak phase;
+        phase.m_name = name;
+        phase.m_peak = m_phases.at(name).m_peak;
+        usage.m_phases.push_back(phase);
+    }
+    return usage;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrMemoryCharge::SrrMemoryCharge(const std::shared_ptr<SrrJobContext>& job, SrrMemoryKind kind, uint64_t bytes)
+{
+    auto account = job ? job->memory() : nullptr;
+    if (!account) {
+        return;
+    }
+
+    account->charge(kind, bytes, !job->isRecovering());
+    m_account = account;
+    m_kind    = kind;
+    m_bytes   = bytes;
+}
+
+SrrMemoryCharge::~SrrMemoryCharge()
+{
+    release();
+}
+
+SrrMemoryCharge::SrrMemoryCharge(SrrMemoryCharge&& other) noexcept
+    : m_account(std::move(other.m_account))
+    , m_kind(other.m_kind)
+    , m_bytes(other.m_bytes)
+{
+    other.m_account = nullptr;
+}
+
+SrrMemoryCharge& SrrMemoryCharge::operator=(SrrMemoryCharge&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_account       = std::move(other.m_account);
+        m_kind          = other.m_kind;
+        m_bytes         = other.m_bytes;
+        other.m_account = nullptr;
+    }
+    return *this;
+}
+
+void SrrMemoryCharge::release()
+{
+    if (m_account) {
+        m_account->release(m_kind, m_bytes);
+        m_account = nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrMemoryScope::SrrMemoryScope(const std::shared_ptr<SrrJobContext>& job, uint64_t budget, const std::string& operation)
+{
+    if (!job) {
+        return;
+    }
+
+    m_job       = job;
+    m_account   = std::make_shared<SrrMemoryAccount>(budget);
+    m_operation = operation;
+    m_job->setMemory(m_account);
+}
+
+SrrMemoryScope::~SrrMemoryScope()
+{
+    if (!m_job) {
+        return;
+    }
+
+    m_job->setMemory(nullptr);
+
+    const uint64_t peak = m_account->peak();
+    metrics().m_jobPeakMemoryKb.record(peak / 1024);
+    log_debug("Memory held by the %s job %s: %llu bytes at the peak", m_operation.c_str(), m_job->id().c_str(),
+        static_cast<unsigned long long>(peak));
+}
+
+MemoryUsage SrrMemoryScope::usage() const
+{
+    return m_account ? m_account->usage() : MemoryUsage();
+}
+
+} // namespace srr
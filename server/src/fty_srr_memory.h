@@ -0,0 +1,141 @@
+/*  =========================================================================
+    fty_srr_memory - Memory held by the jobs, peak tracking and budget
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "dto/response.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+class SrrJobContext;
+
+// data held by a job
+enum class SrrMemoryKind
+{
+    Dto,           // backup payload: request and response DTOs
+    Serialization, // SerializationInfo trees and JSON documents
+    Protobuf,      // queries to and responses from the agents
+    Rollback,      // current configuration saved before a restore
+};
+
+const char* memoryKindName(SrrMemoryKind kind);
+
+/**
+ * Memory held by a job, by kind of data, with its peak overall and during each phase.
+ * Sizes are estimates from the payloads, not allocator counts: they miss the overhead of the containers, but follow
+ * what grows with the backup. Charged from the request thread and the event loop.
+ */
+class SrrMemoryAccount
+{
+public:
+    // budget in bytes, 0: no budget
+    explicit SrrMemoryAccount(uint64_t budget = 0);
+    ~SrrMemoryAccount();
+
+    SrrMemoryAccount(const SrrMemoryAccount&) = delete;
+    SrrMemoryAccount& operator=(const SrrMemoryAccount&) = delete;
+
+    // throw SrrMemoryExceeded if enforce is set and the budget would be exceeded, nothing is charged then
+    void charge(SrrMemoryKind kind, uint64_t bytes, bool enforce = true);
+    void release(SrrMemoryKind kind, uint64_t bytes);
+
+    // phases may nest or overlap: a phase entered several times is active until left as many times
+    void enterPhase(const std::string& name);
+    void leavePhase(const std::string& name);
+
+    uint64_t budget() const;
+    uint64_t current() const;
+    uint64_t peak() const;
+
+    MemoryUsage usage() const;
+
+private:
+    static constexpr size_t KINDS = 4;
+
+    struct Phase
+    {
+        unsigned m_active = 0;
+        uint64_t m_peak   = 0;
+    };
+
+    uint64_t m_budget;
+
+    mutable std::mutex           m_mutex;
+    uint64_t                     m_current = 0;
+    uint64_t                     m_peak    = 0;
+    std::array<uint64_t, KINDS>  m_kindCurrent{};
+    std::array<uint64_t, KINDS>  m_kindPeak{};
+    std::map<std::string, Phase> m_phases;
+    std::vector<std::string>     m_phaseOrder; // names of the phases, in the order they were first entered
+};
+
+/**
+ * Bytes charged to the account of a job, released at the destruction. No-op if the job is not accounted.
+ * The budget is not enforced during a recovery: a rollback must complete.
+ */
+class SrrMemoryCharge
+{
+public:
+    SrrMemoryCharge() = default;
+    SrrMemoryCharge(const std::shared_ptr<SrrJobContext>& job, SrrMemoryKind kind, uint64_t bytes);
+    ~SrrMemoryCharge();
+
+    SrrMemoryCharge(SrrMemoryCharge&& other) noexcept;
+    SrrMemoryCharge& operator=(SrrMemoryCharge&& other) noexcept;
+
+    SrrMemoryCharge(const SrrMemoryCharge&) = delete;
+    SrrMemoryCharge& operator=(const SrrMemoryCharge&) = delete;
+
+    void release();
+
+private:
+    std::shared_ptr<SrrMemoryAccount> m_account;
+    SrrMemoryKind                     m_kind  = SrrMemoryKind::Dto;
+    uint64_t                          m_bytes = 0;
+};
+
+// account the memory of the job for the lifetime of the scope, its peak goes to the metrics at the end
+class SrrMemoryScope
+{
+public:
+    SrrMemoryScope(const std::shared_ptr<SrrJobContext>& job, uint64_t budget, const std::string& operation);
+    ~SrrMemoryScope();
+
+    SrrMemoryScope(const SrrMemoryScope&) = delete;
+    SrrMemoryScope& operator=(const SrrMemoryScope&) = delete;
+
+    // usage so far, empty if the job is not accounted
+    MemoryUsage usage() const;
+
+private:
+    std::shared_ptr<SrrJobContext>    m_job;
+    std::shared_ptr<SrrMemoryAccount> m_account;
+    std::string                       m_operation;
+};
+
+} // namespace srr
@@ -0,0 +1,250 @@
+/*  =========================================================================
+    fty_srr_metrics - Runtime counters and histograms of the agent
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_metrics.h"
+#include "dto/common.h"
+#include "fty_srr_exception.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace srr {
+
+static constexpr const char* SI_COUNT              = "count";
+static constexpr const char* SI_SUM                = "sum";
+static constexpr const char* SI_MAX                = "max";
+static constexpr const char* SI_P50                = "p50";
+static constexpr const char* SI_P90                = "p90";
+static constexpr const char* SI_P99                = "p99";
+static constexpr const char* SI_ACTIVE_JOBS        = "active_jobs";
+static constexpr const char* SI_PENDING_REQUESTS   = "pending_requests";
+static constexpr const char* SI_QUEUE_DEPTH        = "queue_depth";
+static constexpr const char* SI_ROLLBACKS          = "rollbacks";
+static constexpr const char* SI_TIMEOUTS           = "timeouts";
+static constexpr const char* SI_JOB_MEMORY_BYTES   = "job_memory_bytes";
+static constexpr const char* SI_MEMORY_EXCEEDED    = "memory_budget_exceeded";
+static constexpr const char* SI_JOB_PEAK_MEMORY_KB = "job_peak_memory_kb";
+static constexpr const char* SI_INTEGRITY_CHECK_MS = "integrity_check_ms";
+static constexpr const char* SI_RESTORE_DELAY_MS   = "restore_delay_ms";
+static constexpr const char* SI_OPERATIONS         = "operations";
+static constexpr const char* SI_AGENTS             = "agents";
+static constexpr const char* SI_AGENT              = "agent";
+static constexpr const char* SI_ACTION             = "action";
+static constexpr const char* SI_LATENCY_MS         = "latency_ms";
+static constexpr const char* SI_BYTES_OUT          = "bytes_out";
+static constexpr const char* SI_BYTES_IN           = "bytes_in";
+static constexpr const char* SI_ERRORS             = "errors";
+
+static void dumpHistogram(std::ostream& os, const std::string& name, const SrrHistogram& histogram)
+{
+    os << name << " count=" << histogram.count() << " sum=" << histogram.sum() << " max=" << histogram.max()
+       << " p50=" << histogram.percentile(0.5) << " p90=" << histogram.percentile(0.9)
+       << " p99=" << histogram.percentile(0.99) << "\n";
+}
+
+void SrrHistogram::record(uint64_t value)
+{
+    size_t bucket = 0;
+    while (bucket < BUCKETS - 1 && value > (uint64_t(1) << bucket)) {
+        bucket++;
+    }
+
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t SrrHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t SrrHistogram::sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t SrrHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t SrrHistogram::percentile(double ratio) const
+{
+    const uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint64_t rank  = static_cast<uint64_t>(ratio * static_cast<double>(total));
+    uint64_t       below = 0;
+    for (size_t i = 0; i < BUCKETS - 1; i++) {
+        below += m_buckets[i].load(std::memory_order_relaxed);
+        if (below > rank) {
+            return std::min(uint64_t(1) << i, max());
+        }
+    }
+    // overflow bucket
+    return max();
+}
+
+void SrrHistogram::serialize(cxxtools::SerializationInfo& si) const
+{
+    si.addMember(SI_COUNT) <<= count();
+    si.addMember(SI_SUM) <<= sum();
+    si.addMember(SI_MAX) <<= max();
+    si.addMember(SI_P50) <<= percentile(0.5);
+    si.addMember(SI_P90) <<= percentile(0.9);
+    si.addMember(SI_P99) <<= percentile(0.99);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrHistogram& SrrMetrics::operation(const std::string& subject)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_operations[subject];
+}
+
+SrrAgentMetrics& SrrMetrics::agent(const std::string& agentName, const std::string& action)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_agents[agentName + "/" + action];
+}
+
+void SrrMetrics::serialize(cxxtools::SerializationInfo& si) const
+{
+    si.addMember(SI_ACTIVE_JOBS) <<= m_activeJobs.load();
+    si.addMember(SI_PENDING_REQUESTS) <<= m_pendingRequests.load();
+    si.addMember(SI_QUEUE_DEPTH) <<= m_queueDepth.load();
+    si.addMember(SI_JOB_MEMORY_BYTES) <<= m_jobMemoryBytes.load();
+    si.addMember(SI_BYTES_OUT) <<= m_bytesOut.load();
+    si.addMember(SI_BYTES_IN) <<= m_bytesIn.load();
+    si.addMember(SI_ROLLBACKS) <<= m_rollbacks.load();
+    si.addMember(SI_TIMEOUTS) <<= m_timeouts.load();
+    si.addMember(SI_MEMORY_EXCEEDED) <<= m_memoryBudgetExceeded.load();
+    m_integrityCheckMs.serialize(si.addMember(SI_INTEGRITY_CHECK_MS));
+    m_restoreDelayMs.serialize(si.addMember(SI_RESTORE_DELAY_MS));
+    m_jobPeakMemoryKb.serialize(si.addMember(SI_JOB_PEAK_MEMORY_KB));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    cxxtools::SerializationInfo& operationsSi = si.addMember(SI_OPERATIONS);
+    operationsSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+    for (const auto& operation : m_operations) {
+        cxxtools::SerializationInfo& operationSi = operationsSi.addMember("");
+        operationSi.addMember(SI_OPERATION) <<= operation.first;
+        operation.second.serialize(operationSi.addMember(SI_LATENCY_MS));
+    }
+
+    cxxtools::SerializationInfo& agentsSi = si.addMember(SI_AGENTS);
+    agentsSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+    for (const auto& agent : m_agents) {
+        const size_t separator = agent.first.rfind('/');
+
+        cxxtools::SerializationInfo& agentSi = agentsSi.addMember("");
+        agentSi.addMember(SI_AGENT) <<= agent.first.substr(0, separator);
+        agentSi.addMember(SI_ACTION) <<= agent.first.substr(separator + 1);
+        agent.second.m_latencyMs.serialize(agentSi.addMember(SI_LATENCY_MS));
+        agentSi.addMember(SI_BYTES_OUT) <<= agent.second.m_bytesOut.load();
+        agentSi.addMember(SI_BYTES_IN) <<= agent.second.m_bytesIn.load();
+        agentSi.addMember(SI_ERRORS) <<= agent.second.m_errors.load();
+    }
+}
+
+void SrrMetrics::dump(std::ostream& os) const
+{
+    os << SI_ACTIVE_JOBS << " " << m_activeJobs << "\n";
+    os << SI_PENDING_REQUESTS << " " << m_pendingRequests << "\n";
+    os << SI_QUEUE_DEPTH << " " << m_queueDepth << "\n";
+    os << SI_JOB_MEMORY_BYTES << " " << m_jobMemoryBytes << "\n";
+    os << SI_BYTES_OUT << " " << m_bytesOut << "\n";
+    os << SI_BYTES_IN << " " << m_bytesIn << "\n";
+    os << SI_ROLLBACKS << " " << m_rollbacks << "\n";
+    os << SI_TIMEOUTS << " " << m_timeouts << "\n";
+    os << SI_MEMORY_EXCEEDED << " " << m_memoryBudgetExceeded << "\n";
+    dumpHistogram(os, SI_INTEGRITY_CHECK_MS, m_integrityCheckMs);
+    dumpHistogram(os, SI_RESTORE_DELAY_MS, m_restoreDelayMs);
+    dumpHistogram(os, SI_JOB_PEAK_MEMORY_KB, m_jobPeakMemoryKb);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& operation : m_operations) {
+        dumpHistogram(os, "operation_ms{" + operation.first + "}", operation.second);
+    }
+    for (const auto& agent : m_agents) {
+        dumpHistogram(os, "agent_ms{" + agent.first + "}", agent.second.m_latencyMs);
+        os << "agent_bytes{" << agent.first << "} out=" << agent.second.m_bytesOut << " in=" << agent.second.m_bytesIn
+           << " errors=" << agent.second.m_errors << "\n";
+    }
+}
+
+void SrrMetrics::dumpToFile(const std::string& path) const
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file) {
+            throw SrrException("Failed to create " + tmpPath);
+        }
+        dump(file);
+        if (!file.flush()) {
+            throw SrrException("Failed to write " + tmpPath);
+        }
+    }
+
+    // readers never see a partial dump
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw SrrException("Failed to rename " + tmpPath);
+    }
+}
+
+SrrMetrics& metrics()
+{
+    static SrrMetrics instance;
+    return instance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrTimer::SrrTimer(SrrHistogram& histogram)
+    : m_histogram(histogram)
+    , m_start(std::chrono::steady_clock::now())
+{
+}
+
+SrrTimer::~SrrTimer()
+{
+    m_histogram.record(elapsedMs(m_start));
+}
+
+uint64_t elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace srr
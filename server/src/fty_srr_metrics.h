@@ -0,0 +1,132 @@
+/*  =========================================================================
+    fty_srr_metrics - Runtime counters and histograms of the agent
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cxxtools/serializationinfo.h>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace srr {
+
+/**
+ * Histogram of values with power of two buckets: bucket i counts the values up to 2^i, the last one the rest.
+ * Updated with relaxed atomics only, a snapshot read during updates may be slightly off.
+ */
+class SrrHistogram
+{
+public:
+    static constexpr size_t BUCKETS = 21;
+
+    void record(uint64_t value);
+
+    uint64_t count() const;
+    uint64_t sum() const;
+    uint64_t max() const;
+    // upper bound of the bucket holding the given ratio of the values (0.5: median)
+    uint64_t percentile(double ratio) const;
+
+    void serialize(cxxtools::SerializationInfo& si) const;
+
+private:
+    std::atomic<uint64_t>                      m_count{0};
+    std::atomic<uint64_t>                      m_sum{0};
+    std::atomic<uint64_t>                      m_max{0};
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+};
+
+// requests sent to an agent for an action
+struct SrrAgentMetrics
+{
+    SrrHistogram          m_latencyMs;
+    std::atomic<uint64_t> m_bytesOut{0};
+    std::atomic<uint64_t> m_bytesIn{0};
+    std::atomic<uint64_t> m_errors{0};
+};
+
+/**
+ * Counters of the agent, shared by all the requests.
+ * Entries of the agents and the operations are created on first use and never removed: references stay valid.
+ */
+class SrrMetrics
+{
+public:
+    // time of the UI requests, by subject
+    SrrHistogram& operation(const std::string& subject);
+    // requests to the agents, by agent and action
+    SrrAgentMetrics& agent(const std::string& agentName, const std::string& action);
+
+    SrrHistogram m_integrityCheckMs;
+    SrrHistogram m_restoreDelayMs;
+    SrrHistogram m_jobPeakMemoryKb; // memory accounted to a job at its peak
+
+    std::atomic<uint64_t> m_bytesOut{0};
+    std::atomic<uint64_t> m_bytesIn{0};
+    std::atomic<uint64_t> m_rollbacks{0};
+    std::atomic<uint64_t> m_timeouts{0};
+    std::atomic<uint64_t> m_memoryBudgetExceeded{0};
+
+    // gauges
+    std::atomic<int64_t> m_activeJobs{0};
+    std::atomic<int64_t> m_pendingRequests{0}; // requests to the agents waiting for their reply
+    std::atomic<int64_t> m_queueDepth{0};      // requests to the agents waiting for a bus client
+    std::atomic<int64_t> m_jobMemoryBytes{0};  // memory accounted to the running jobs
+
+    void serialize(cxxtools::SerializationInfo& si) const;
+    // one line per value, for the periodic dump
+    void dump(std::ostream& os) const;
+    // dump to a temporary file renamed to path
+    void dumpToFile(const std::string& path) const;
+
+private:
+    mutable std::mutex                     m_mutex;
+    std::map<std::string, SrrHistogram>    m_operations;
+    std::map<std::string, SrrAgentMetrics> m_agents; // by "agent/action"
+};
+
+// metrics of the process
+SrrMetrics& metrics();
+
+// record in histogram the milliseconds elapsed during its lifetime
+class SrrTimer
+{
+public:
+    explicit SrrTimer(SrrHistogram& histogram);
+    ~SrrTimer();
+
+    SrrTimer(const SrrTimer&) = delete;
+    SrrTimer& operator=(const SrrTimer&) = delete;
+
+private:
+    SrrHistogram&                         m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// milliseconds elapsed since start
+uint64_t elapsedMs(std::chrono::steady_clock::time_point start);
+
+} // namespace srr
@@ -0,0 +1,337 @@
+/*  =========================================================================
+    fty_srr_recorder - Flight recorder of the recent operations in a memory-mapped ring
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_recorder.h"
+#include "fty_srr_exception.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace srr {
+
+namespace {
+
+constexpr char     FLIGHT_MAGIC[8] = {'S', 'R', 'R', 'F', 'L', 'I', 'G', 'H'};
+constexpr uint32_t FLIGHT_VERSION  = 1;
+
+struct FlightHeader
+{
+    char                  m_magic[8];
+    uint32_t              m_version;
+    uint32_t              m_slotSize;
+    uint64_t              m_capacity;
+    std::atomic<uint64_t> m_sequence; // of the last event reserved, the first one is 1
+    char                  m_padding[32];
+};
+
+constexpr size_t EVENT_WORDS = sizeof(SrrFlightEvent) / sizeof(uint64_t);
+
+// the event is stored in atomic words: a reader copying a slot while it is written gets a torn event, never a data
+// race, and the sequence of the slot tells it to drop the event (seqlock)
+struct FlightSlot
+{
+    std::atomic<uint64_t> m_sequence; // of the event, 0 while it is written
+    std::atomic<uint64_t> m_event[EVENT_WORDS];
+};
+
+// the atomics are shared with the other processes mapping the file: they must not need a lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64 bits atomics must be lock-free");
+static_assert(std::is_trivially_copyable<SrrFlightEvent>::value, "events are copied as is");
+static_assert(sizeof(SrrFlightEvent) == 184, "events of the same size in every build reading the file");
+static_assert(sizeof(SrrFlightEvent) % sizeof(uint64_t) == 0, "events copied by words");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomic words of the size of the file layout");
+static_assert(sizeof(FlightHeader) == 64, "header of one cache line");
+static_assert(sizeof(FlightSlot) % 64 == 0, "slots aligned on the cache lines");
+
+size_t fileSize(uint64_t capacity)
+{
+    return sizeof(FlightHeader) + capacity * sizeof(FlightSlot);
+}
+
+FlightSlot* slots(char* base)
+{
+    return reinterpret_cast<FlightSlot*>(base + sizeof(FlightHeader));
+}
+
+bool hasLayout(const FlightHeader& header, uint64_t capacity)
+{
+    return std::memcmp(header.m_magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC)) == 0 &&
+           header.m_version == FLIGHT_VERSION && header.m_slotSize == sizeof(FlightSlot) &&
+           (capacity == 0 || header.m_capacity == capacity);
+}
+
+template <size_t Size>
+void copyText(char (&field)[Size], const std::string& text)
+{
+    const size_t length = std::min(text.size(), Size - 1);
+    std::memcpy(field, text.data(), length);
+    field[length] = '\0';
+}
+
+std::string systemError(const std::string& what, const std::string& path)
+{
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+// the directory of the file, if missing: its own parent is the state directory of the service
+void makeParent(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    if (slash == std::string::npos || slash == 0) {
+        return;
+    }
+
+    const std::string parent = path.substr(0, slash);
+    if (mkdir(parent.c_str(), 0750) != 0 && errno != EEXIST) {
+        throw SrrException(systemError("Failed to create", parent));
+    }
+}
+
+void storeEvent(FlightSlot& slot, const SrrFlightEvent& event)
+{
+    uint64_t words[EVENT_WORDS];
+    std::memcpy(words, &event, sizeof(event));
+    for (size_t i = 0; i < EVENT_WORDS; i++) {
+        slot.m_event[i].store(words[i], std::memory_order_relaxed);
+    }
+}
+
+SrrFlightEvent loadEvent(const FlightSlot& slot)
+{
+    uint64_t words[EVENT_WORDS];
+    for (size_t i = 0; i < EVENT_WORDS; i++) {
+        words[i] = slot.m_event[i].load(std::memory_order_relaxed);
+    }
+
+    SrrFlightEvent event;
+    std::memcpy(&event, words, sizeof(event));
+    return event;
+}
+
+} // namespace
+
+const char* flightEventName(SrrFlightEventType type)
+{
+    switch (type) {
+        case SrrFlightEventType::Start:
+            return "start";
+        case SrrFlightEventType::Stop:
+            return "stop";
+        case SrrFlightEventType::JobStart:
+            return "job-start";
+        case SrrFlightEventType::JobEnd:
+            return "job-end";
+        case SrrFlightEventType::Feature:
+            return "feature";
+        case SrrFlightEventType::RollbackStart:
+            return "rollback-start";
+        case SrrFlightEventType::RollbackEnd:
+            return "rollback-end";
+        case SrrFlightEventType::Restart:
+            return "restart";
+    }
+    return "unknown";
+}
+
+SrrFlightEvent::SrrFlightEvent(SrrFlightEventType type, const std::string& job, const std::string& name,
+    const std::string& agent, const std::string& detail)
+    : m_type(static_cast<uint16_t>(type))
+{
+    copyText(m_job, job);
+    copyText(m_name, name);
+    copyText(m_agent, agent);
+    copyText(m_detail, detail);
+}
+
+SrrFlightEventType SrrFlightEvent::type() const
+{
+    return static_cast<SrrFlightEventType>(m_type);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrFlightRecorder::~SrrFlightRecorder()
+{
+    char* base = m_base.exchange(nullptr);
+    if (base) {
+        munmap(base, m_size);
+    }
+}
+
+void SrrFlightRecorder::open(const std::string& path, uint64_t capacity)
+{
+    if (isOpen()) {
+        throw SrrException("Flight recorder already open");
+    }
+    if (capacity == 0) {
+        throw SrrException("Flight recorder without capacity");
+    }
+
+    makeParent(path);
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        throw SrrException(systemError("Failed to open", path));
+    }
+
+    const size_t size = fileSize(capacity);
+
+    // a file of another layout or capacity is started again
+    struct stat  status;
+    FlightHeader header;
+    const bool   keep = fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) == size &&
+                      pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                      hasLayout(header, capacity);
+    if (!keep && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        const std::string error = systemError("Failed to size", path);
+        ::close(fd);
+        throw SrrException(error);
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const std::string error = mapped == MAP_FAILED ? systemError("Failed to map", path) : "";
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw SrrException(error);
+    }
+
+    char* base = static_cast<char*>(mapped);
+    if (!keep) {
+        // the file is zeroed: every slot is empty
+        FlightHeader* fresh = new (base) FlightHeader();
+        std::memcpy(fresh->m_magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC));
+        fresh->m_version  = FLIGHT_VERSION;
+        fresh->m_slotSize = sizeof(FlightSlot);
+        fresh->m_capacity = capacity;
+        fresh->m_sequence.store(0);
+    }
+
+    m_size     = size;
+    m_capacity = capacity;
+    m_pid      = static_cast<uint32_t>(getpid());
+    m_base.store(base, std::memory_order_release);
+}
+
+bool SrrFlightRecorder::isOpen() const
+{
+    return m_base.load(std::memory_order_acquire) != nullptr;
+}
+
+void SrrFlightRecorder::record(SrrFlightEvent event)
+{
+    char* base = m_base.load(std::memory_order_acquire);
+    if (!base) {
+        return;
+    }
+
+    event.m_timeMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    event.m_pid    = m_pid;
+
+    FlightHeader*  header   = reinterpret_cast<FlightHeader*>(base);
+    const uint64_t sequence = header->m_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    FlightSlot&    slot     = slots(base)[(sequence - 1) % m_capacity];
+
+    slot.m_sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    storeEvent(slot, event);
+    slot.m_sequence.store(sequence, std::memory_order_release);
+}
+
+void SrrFlightRecorder::sync()
+{
+    char* base = m_base.load(std::memory_order_acquire);
+    if (base) {
+        msync(base, m_size, MS_SYNC);
+    }
+}
+
+std::vector<SrrFlightEvent> SrrFlightRecorder::read(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw SrrException(systemError("Failed to open", path));
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FlightHeader)) {
+        ::close(fd);
+        throw SrrException("Not a flight recorder file: " + path);
+    }
+
+    const size_t size   = static_cast<size_t>(status.st_size);
+    void*        mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    const std::string error = mapped == MAP_FAILED ? systemError("Failed to map", path) : "";
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw SrrException(error);
+    }
+
+    char*               base   = static_cast<char*>(mapped);
+    const FlightHeader& header = *reinterpret_cast<const FlightHeader*>(base);
+    if (!hasLayout(header, 0) || size != fileSize(header.m_capacity)) {
+        munmap(mapped, size);
+        throw SrrException("Not a flight recorder file: " + path);
+    }
+
+    // the daemon may be writing: an event is kept if its slot held the same sequence before and after the copy
+    std::vector<std::pair<uint64_t, SrrFlightEvent>> events;
+    for (uint64_t i = 0; i < header.m_capacity; i++) {
+        const FlightSlot& slot   = slots(base)[i];
+        const uint64_t    before = slot.m_sequence.load(std::memory_order_acquire);
+        if (before == 0 || (before - 1) % header.m_capacity != i) {
+            continue;
+        }
+
+        const SrrFlightEvent event = loadEvent(slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.m_sequence.load(std::memory_order_relaxed) == before) {
+            events.emplace_back(before, event);
+        }
+    }
+    munmap(mapped, size);
+
+    std::sort(events.begin(), events.end(), [](const auto& l, const auto& r) {
+        return l.first < r.first;
+    });
+
+    std::vector<SrrFlightEvent> ordered;
+    ordered.reserve(events.size());
+    for (const auto& event : events) {
+        ordered.push_back(event.second);
+    }
+    return ordered;
+}
+
+SrrFlightRecorder& flightRecorder()
+{
+    static SrrFlightRecorder instance;
+    return instance;
+}
+
+} // namespace srr
@@ -0,0 +1,111 @@
+/*  =========================================================================
+    fty_srr_recorder - Flight recorder of the recent operations in a memory-mapped ring
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+enum class SrrFlightEventType : uint16_t
+{
+    Start = 1,     // daemon started: a start not preceded by a stop follows a crash
+    Stop,          // daemon stopped
+    JobStart,      // name: operation
+    JobEnd,        // name: operation, detail: status
+    Feature,       // request about a feature to agent, detail: action
+    RollbackStart, // count: features rolled back
+    RollbackEnd,   // count: features rolled back
+    Restart,       // reboot of the appliance scheduled after a restore
+};
+
+const char* flightEventName(SrrFlightEventType type);
+
+/**
+ * Event of the flight recorder, fixed size and trivially copyable: it is copied as is in the ring. Texts are
+ * truncated to their field and always terminated.
+ */
+struct SrrFlightEvent
+{
+    uint64_t m_timeMs     = 0; // since the epoch, set when recorded
+    uint64_t m_durationMs = 0;
+    uint64_t m_bytesOut   = 0; // or the count of the event
+    uint64_t m_bytesIn    = 0;
+    uint32_t m_pid        = 0; // set when recorded
+    uint16_t m_type       = 0;
+    uint16_t m_failed     = 0;
+    char     m_job[40]    = {};
+    char     m_name[48]   = {};
+    char     m_agent[32]  = {};
+    char     m_detail[24] = {};
+
+    SrrFlightEvent() = default;
+    SrrFlightEvent(SrrFlightEventType type, const std::string& job, const std::string& name,
+        const std::string& agent = "", const std::string& detail = "");
+
+    SrrFlightEventType type() const;
+};
+
+/**
+ * Ring of the last events, in a file mapped in memory: the events written before a crash of the daemon are in the
+ * page cache and end up in the file, they are read at the next start or by fty-srr-cmd.
+ * An event is written without lock from any thread: its slot is reserved by an atomic increment of the sequence,
+ * the sequence stored in the slot is cleared while the event is copied and set once it is complete, so that a
+ * reader skips the slots being written or torn by a crash. The events are copied in and out of the slots by atomic
+ * words, the sequence detects a torn copy (seqlock).
+ */
+class SrrFlightRecorder
+{
+public:
+    SrrFlightRecorder() = default;
+    ~SrrFlightRecorder();
+
+    SrrFlightRecorder(const SrrFlightRecorder&) = delete;
+    SrrFlightRecorder& operator=(const SrrFlightRecorder&) = delete;
+
+    // map path, created for capacity events if missing or of another layout, else its events are kept.
+    // Called once, before recording: the file stays mapped until the recorder is destroyed.
+    void open(const std::string& path, uint64_t capacity);
+    bool isOpen() const;
+
+    // no-op if not open
+    void record(SrrFlightEvent event);
+
+    // write the events to the file now, for the ones which must survive a reboot
+    void sync();
+
+    // events of a recorder file, oldest first
+    static std::vector<SrrFlightEvent> read(const std::string& path);
+
+private:
+    std::atomic<char*> m_base{nullptr};
+    size_t             m_size     = 0;
+    uint64_t           m_capacity = 0;
+    uint32_t           m_pid      = 0;
+};
+
+// recorder of the daemon
+SrrFlightRecorder& flightRecorder();
+
+} // namespace srr
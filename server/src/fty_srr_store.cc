@@ -0,0 +1,453 @@
+/*  =========================================================================
+    fty_srr_store - Local content addressed store of saved configurations
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_store.h"
+#include "fty_srr_exception.h"
+#include "helpers/bulk_transfer.h"
+#include "helpers/data_integrity.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fty_log.h>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace srr {
+
+// si manifest fields
+static constexpr const char* SI_OBJECTS  = "objects";
+static constexpr const char* SI_REVISION = "revision";
+
+static constexpr const char* OBJECTS_DIR   = "/objects";
+static constexpr const char* SNAPSHOTS_DIR = "/snapshots";
+static constexpr const char* MANIFEST_EXT  = ".json";
+static constexpr const char* TMP_EXT       = ".tmp";
+
+static std::string errnoString(const std::string& what, const std::string& path)
+{
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+static bool endsWith(const std::string& str, const std::string& suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void makeDirectory(const std::string& path)
+{
+    if (mkdir(path.c_str(), 0750) != 0 && errno != EEXIST) {
+        throw SrrException(errnoString("Failed to create", path));
+    }
+}
+
+// the missing parents are created too
+static void makeDirectories(const std::string& path)
+{
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        makeDirectory(path.substr(0, pos));
+    }
+    makeDirectory(path);
+}
+
+static bool fileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// an object is reused only if its content still matches its name
+static bool objectIntact(const std::string& path, const std::string& digest)
+{
+    if (!fileExists(path)) {
+        return false;
+    }
+    try {
+        MappedFile object(path);
+        return evalSha256(object.data(), object.size()) == digest;
+    } catch (const std::exception& e) {
+        log_warning("Cannot read object %s: %s", path.c_str(), e.what());
+        return false;
+    }
+}
+
+static std::vector<std::string> listDirectory(const std::string& path)
+{
+    std::vector<std::string> entries;
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        if (errno == ENOENT) {
+            return entries;
+        }
+        throw SrrException(errnoString("Failed to open", path));
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            entries.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    return entries;
+}
+
+// write a temporary file and rename it: readers never see a partial file
+static void writeFileAtomic(const std::string& path, const std::string& content)
+{
+    const std::string tmpPath = path + TMP_EXT;
+
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        throw SrrException(errnoString("Failed to create", tmpPath));
+    }
+
+    const char* data = content.data();
+    size_t      size = content.size();
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            ::close(fd);
+            ::unlink(tmpPath.c_str());
+            throw SrrException(errnoString("Failed to write", tmpPath));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    if (fsync(fd) != 0 || ::close(fd) != 0) {
+        ::unlink(tmpPath.c_str());
+        throw SrrException(errnoString("Failed to sync", tmpPath));
+    }
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        throw SrrException(errnoString("Failed to rename", tmpPath));
+    }
+}
+
+static cxxtools::SerializationInfo readJsonFile(const std::string& path)
+{
+    MappedFile file(path);
+    return parseJson(file.data(), file.size());
+}
+
+// snapshot ids are used as file names
+static void checkSnapshotId(const std::string& snapshotId)
+{
+    if (snapshotId.empty() || !std::all_of(snapshotId.begin(), snapshotId.end(), [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '-';
+        })) {
+        throw SrrException("Invalid snapshot id " + snapshotId);
+    }
+}
+
+SrrStore::SrrStore(const std::string& rootPath, unsigned maxSnapshots)
+    : m_rootPath(rootPath)
+    , m_maxSnapshots(maxSnapshots)
+{
+}
+
+std::string SrrStore::objectPath(const std::string& digest) const
+{
+    return m_rootPath + OBJECTS_DIR + "/" + digest;
+}
+
+std::string SrrStore::snapshotPath(const std::string& snapshotId) const
+{
+    return m_rootPath + SNAPSHOTS_DIR + "/" + snapshotId + MANIFEST_EXT;
+}
+
+SnapshotInfo SrrStore::store(const SrrSaveResponse& payload, const std::map<std::string, std::string>& revisions)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    makeDirectories(m_rootPath);
+    makeDirectory(m_rootPath + OBJECTS_DIR);
+    makeDirectory(m_rootPath + SNAPSHOTS_DIR);
+
+    SnapshotInfo info;
+    info.m_timestamp = static_cast<uint64_t>(std::time(nullptr));
+    info.m_version   = payload.m_version;
+    info.m_status    = payload.m_status;
+
+    cxxtools::SerializationInfo manifest;
+    manifest.addMember(SI_CHECKSUM) <<= payload.m_checksum;
+
+    cxxtools::SerializationInfo& groupsSi = manifest.addMember(SI_GROUPS);
+    groupsSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+
+    std::string contentDigests;
+
+    for (const auto& group : payload.m_data) {
+        info.m_groups.push_back(group.m_group_id);
+
+        // group description without its features, which are replaced by references to the objects
+        Group description;
+        description.m_group_id           = group.m_group_id;
+        description.m_group_name         = group.m_group_name;
+        description.m_data_integrity     = group.m_data_integrity;
+        description.m_integrity_scheme   = group.m_integrity_scheme;
+        description.m_features_integrity = group.m_features_integrity;
+
+        cxxtools::SerializationInfo& groupSi = groupsSi.addMember("");
+        groupSi <<= description;
+
+        cxxtools::SerializationInfo& objectsSi = groupSi.addMember(SI_OBJECTS);
+        objectsSi.setCategory(cxxtools::SerializationInfo::Category::Array);
+
+        for (const auto& feature : group.m_features) {
+            cxxtools::SerializationInfo featureSi;
+            featureSi <<= feature;
+            const std::string content = dto::srr::serializeJson(featureSi, false);
+            const std::string digest  = evalSha256(content);
+
+            // deduplication: an unchanged feature is already stored, a corrupted object is written again
+            if (!objectIntact(objectPath(digest), digest)) {
+                writeFileAtomic(objectPath(digest), content);
+            }
+
+            cxxtools::SerializationInfo& objectSi = objectsSi.addMember("");
+            objectSi.addMember(SI_NAME) <<= feature.m_feature_name;
+            objectSi.addMember(SI_DIGEST) <<= digest;
+            objectSi.addMember(SI_SIZE) <<= static_cast<uint64_t>(content.size());
+
+            auto revision = revisions.find(feature.m_feature_name);
+            if (revision != revisions.end()) {
+                objectSi.addMember(SI_REVISION) <<= revision->second;
+            }
+
+            info.m_size += content.size();
+            contentDigests += digest;
+        }
+    }
+
+    char      date[32];
+    struct tm tm;
+    time_t    now = static_cast<time_t>(info.m_timestamp);
+    gmtime_r(&now, &tm);
+    strftime(date, sizeof(date), "%Y%m%dT%H%M%SZ", &tm);
+
+    const std::string baseId = std::string(date) + "-" + evalSha256(contentDigests + payload.m_checksum).substr(0, 8);
+    info.m_id                = baseId;
+    for (unsigned i = 1; fileExists(snapshotPath(info.m_id)); i++) {
+        info.m_id = baseId + "-" + std::to_string(i);
+    }
+
+    manifest.addMember(SI_SNAPSHOT) <<= info;
+    writeFileAtomic(snapshotPath(info.m_id), dto::srr::serializeJson(manifest, false));
+
+    log_info("Snapshot %s stored (%zu groups)", info.m_id.c_str(), info.m_groups.size());
+
+    applyRetention();
+
+    return info;
+}
+
+std::vector<SnapshotInfo> SrrStore::list() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return listSnapshots();
+}
+
+std::vector<SnapshotInfo> SrrStore::listSnapshots() const
+{
+    std::vector<SnapshotInfo> snapshots;
+
+    for (const auto& entry : listDirectory(m_rootPath + SNAPSHOTS_DIR)) {
+        if (!endsWith(entry, MANIFEST_EXT)) {
+            continue;
+        }
+        try {
+            SnapshotInfo info;
+            readJsonFile(m_rootPath + SNAPSHOTS_DIR + "/" + entry).getMember(SI_SNAPSHOT) >>= info;
+            snapshots.push_back(info);
+        } catch (const std::exception& e) {
+            log_error("Invalid snapshot manifest %s: %s", entry.c_str(), e.what());
+        }
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(), [](const SnapshotInfo& l, const SnapshotInfo& r) {
+        return l.m_timestamp != r.m_timestamp ? l.m_timestamp > r.m_timestamp : l.m_id > r.m_id;
+    });
+
+    return snapshots;
+}
+
+SrrSaveResponse SrrStore::load(const std::string& snapshotId, std::map<std::string, std::string>* revisions) const
+{
+    checkSnapshotId(snapshotId);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const std::string path = snapshotPath(snapshotId);
+    if (!fileExists(path)) {
+        throw SrrException("Snapshot " + snapshotId + " not found");
+    }
+
+    cxxtools::SerializationInfo manifest = readJsonFile(path);
+
+    SnapshotInfo info;
+    manifest.getMember(SI_SNAPSHOT) >>= info;
+
+    SrrSaveResponse payload;
+    payload.m_version = info.m_version;
+    payload.m_status  = info.m_status;
+    manifest.getMember(SI_CHECKSUM) >>= payload.m_checksum;
+
+    for (const auto& groupSi : manifest.getMember(SI_GROUPS)) {
+        Group group;
+        groupSi >>= group;
+
+        for (const auto& objectSi : groupSi.getMember(SI_OBJECTS)) {
+            std::string digest;
+            objectSi.getMember(SI_DIGEST) >>= digest;
+
+            MappedFile object(objectPath(digest));
+            if (evalSha256(object.data(), object.size()) != digest) {
+                throw SrrException("Corrupted object " + digest + " in snapshot " + snapshotId);
+            }
+
+            SrrFeature feature;
+            parseJson(object.data(), object.size()) >>= feature;
+
+            const cxxtools::SerializationInfo* revisionSi = objectSi.findMember(SI_REVISION);
+            if (revisions != nullptr && revisionSi != nullptr) {
+                *revisionSi >>= (*revisions)[feature.m_feature_name];
+            }
+
+            group.m_features.push_back(feature);
+        }
+
+        payload.m_data.push_back(group);
+    }
+
+    return payload;
+}
+
+void SrrStore::remove(const std::string& snapshotId)
+{
+    checkSnapshotId(snapshotId);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (::unlink(snapshotPath(snapshotId).c_str()) != 0) {
+        throw SrrException(errnoString("Failed to remove", snapshotPath(snapshotId)));
+    }
+    removeUnreferencedObjects();
+}
+
+size_t SrrStore::collectGarbage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return removeUnreferencedObjects();
+}
+
+void SrrStore::writeDocument(const std::string& name, const cxxtools::SerializationInfo& si)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    makeDirectories(m_rootPath);
+    writeFileAtomic(m_rootPath + "/" + name + MANIFEST_EXT, dto::srr::serializeJson(si, false));
+}
+
+bool SrrStore::readDocument(const std::string& name, cxxtools::SerializationInfo& si) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const std::string path = m_rootPath + "/" + name + MANIFEST_EXT;
+    if (!fileExists(path)) {
+        return false;
+    }
+    si = readJsonFile(path);
+    return true;
+}
+
+void SrrStore::applyRetention()
+{
+    if (m_maxSnapshots == 0) {
+        return;
+    }
+
+    const std::vector<SnapshotInfo> snapshots = listSnapshots();
+    for (size_t i = m_maxSnapshots; i < snapshots.size(); i++) {
+        log_info("Removing snapshot %s (retention)", snapshots[i].m_id.c_str());
+        ::unlink(snapshotPath(snapshots[i].m_id).c_str());
+    }
+
+    removeUnreferencedObjects();
+}
+
+size_t SrrStore::removeUnreferencedObjects()
+{
+    std::set<std::string> referenced;
+    bool                  complete = true;
+
+    for (const auto& entry : listDirectory(m_rootPath + SNAPSHOTS_DIR)) {
+        if (!endsWith(entry, MANIFEST_EXT)) {
+            continue;
+        }
+        try {
+            cxxtools::SerializationInfo manifest = readJsonFile(m_rootPath + SNAPSHOTS_DIR + "/" + entry);
+            for (const auto& groupSi : manifest.getMember(SI_GROUPS)) {
+                for (const auto& objectSi : groupSi.getMember(SI_OBJECTS)) {
+                    std::string digest;
+                    objectSi.getMember(SI_DIGEST) >>= digest;
+                    referenced.insert(digest);
+                }
+            }
+        } catch (const std::exception& e) {
+            log_error("Invalid snapshot manifest %s: %s", entry.c_str(), e.what());
+            complete = false;
+        }
+    }
+
+    // an unreadable manifest may still reference any object
+    if (!complete) {
+        log_warning("Garbage collection skipped");
+        return 0;
+    }
+
+    size_t removed = 0;
+    for (const auto& entry : listDirectory(m_rootPath + OBJECTS_DIR)) {
+        if (referenced.count(entry) == 0) {
+            if (::unlink(objectPath(entry).c_str()) == 0) {
+                removed++;
+            } else {
+                log_warning("%s", errnoString("Failed to remove", objectPath(entry)).c_str());
+            }
+        }
+    }
+
+    if (removed > 0) {
+        log_debug("%zu unreferenced objects removed", removed);
+    }
+
+    return removed;
+}
+
+} // namespace srr
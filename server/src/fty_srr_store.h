@@ -0,0 +1,74 @@
+/*  =========================================================================
+    fty_srr_store - Local content addressed store of saved configurations
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "dto/response.h"
+#include <cxxtools/serializationinfo.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+/**
+ * On device store of save payloads.
+ * Every feature is stored once under objects/<sha256 of its content>, a snapshot is a manifest under
+ * snapshots/<id>.json referencing the features of each group: unchanged features are shared between snapshots.
+ */
+class SrrStore
+{
+public:
+    SrrStore(const std::string& rootPath, unsigned maxSnapshots);
+    ~SrrStore() = default;
+
+    // store a save payload as a new snapshot, then apply the retention policy
+    // revisions: feature revisions reported by the agents at save time, if any
+    SnapshotInfo store(const SrrSaveResponse& payload, const std::map<std::string, std::string>& revisions = {});
+    // snapshots, most recent first
+    std::vector<SnapshotInfo> list() const;
+    // rebuild the save payload of a snapshot, every feature is checked against its digest
+    SrrSaveResponse load(
+        const std::string& snapshotId, std::map<std::string, std::string>* revisions = nullptr) const;
+    void            remove(const std::string& snapshotId);
+    // remove the features not referenced by any snapshot anymore, returns the number of removed objects
+    size_t collectGarbage();
+
+    // JSON document kept next to the snapshots (name.json), false if there is none yet
+    void writeDocument(const std::string& name, const cxxtools::SerializationInfo& si);
+    bool readDocument(const std::string& name, cxxtools::SerializationInfo& si) const;
+
+private:
+    std::string m_rootPath;
+    unsigned    m_maxSnapshots;
+
+    mutable std::mutex m_mutex;
+
+    std::string objectPath(const std::string& digest) const;
+    std::string snapshotPath(const std::string& snapshotId) const;
+
+    std::vector<SnapshotInfo> listSnapshots() const;
+    void                      applyRetention();
+    size_t                    removeUnreferencedObjects();
+};
+
+} // namespace srr
@@ -0,0 +1,260 @@
+/*  =========================================================================
+    fty_srr_trace - Timeline of the phases of a job, in Chrome trace format
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "fty_srr_trace.h"
+#include "fty_srr_exception.h"
+#include "fty_srr_job.h"
+#include "fty_srr_memory.h"
+#include <cctype>
+#include <cxxtools/serializationinfo.h>
+#include <fstream>
+#include <fty_common_dto.h>
+#include <fty_log.h>
+
+namespace srr {
+
+// Chrome trace event fields
+static constexpr const char* TRACE_EVENTS   = "traceEvents";
+static constexpr const char* TRACE_NAME     = "name";
+static constexpr const char* TRACE_CATEGORY = "cat";
+static constexpr const char* TRACE_PHASE_ID = "ph";
+static constexpr const char* TRACE_TS       = "ts";
+static constexpr const char* TRACE_DURATION = "dur";
+static constexpr const char* TRACE_PID      = "pid";
+static constexpr const char* TRACE_TID      = "tid";
+static constexpr const char* TRACE_ARGS     = "args";
+
+// job id used in a file name
+static std::string fileSafe(const std::string& name)
+{
+    std::string safe = name;
+    for (auto& c : safe) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    return safe;
+}
+
+static void addEvent(cxxtools::SerializationInfo& events, const std::string& name, const std::string& category,
+    const std::string& phase, size_t lane, uint64_t startUs, uint64_t durationUs,
+    const std::map<std::string, std::string>& args)
+{
+    cxxtools::SerializationInfo& event = events.addMember("");
+    event.addMember(TRACE_NAME) <<= name;
+    if (!category.empty()) {
+        event.addMember(TRACE_CATEGORY) <<= category;
+    }
+    event.addMember(TRACE_PHASE_ID) <<= phase;
+    event.addMember(TRACE_TS) <<= startUs;
+    if (phase == "X") {
+        event.addMember(TRACE_DURATION) <<= durationUs;
+    }
+    event.addMember(TRACE_PID) <<= uint64_t(1);
+    event.addMember(TRACE_TID) <<= static_cast<uint64_t>(lane);
+
+    cxxtools::SerializationInfo& argsSi = event.addMember(TRACE_ARGS);
+    argsSi.setCategory(cxxtools::SerializationInfo::Category::Object);
+    for (const auto& arg : args) {
+        argsSi.addMember(arg.first) <<= arg.second;
+    }
+}
+
+SrrTrace::SrrTrace(const std::string& operation, const std::string& jobId)
+    : m_operation(operation)
+    , m_jobId(jobId)
+    , m_origin(Clock::now())
+    , m_started(std::time(nullptr))
+    , m_lanes(1, true)
+{
+}
+
+size_t SrrTrace::acquireLane()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t lane = 1; lane < m_lanes.size(); lane++) {
+        if (!m_lanes[lane]) {
+            m_lanes[lane] = true;
+            return lane;
+        }
+    }
+    m_lanes.push_back(true);
+    return m_lanes.size() - 1;
+}
+
+void SrrTrace::releaseLane(size_t lane)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (lane > 0 && lane < m_lanes.size()) {
+        m_lanes[lane] = false;
+    }
+}
+
+void SrrTrace::add(const std::string& name, const std::string& category, size_t lane, Clock::time_point start,
+    Clock::time_point end, const Args& args)
+{
+    const uint64_t startUs = sinceOrigin(start);
+    const uint64_t endUs   = sinceOrigin(end);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spans.push_back(Span{name, category, lane, startUs, endUs > startUs ? endUs - startUs : 0, args});
+}
+
+void SrrTrace::write(const std::string& directory) const
+{
+    char    date[32];
+    std::tm tm;
+    localtime_r(&m_started, &tm);
+    std::strftime(date, sizeof(date), "%Y%m%dT%H%M%S", &tm);
+
+    const std::string path = directory + "/" + m_operation + "-" + date + "-" + fileSafe(m_jobId) + ".json";
+
+    cxxtools::SerializationInfo si;
+    cxxtools::SerializationInfo& events = si.addMember(TRACE_EVENTS);
+    events.setCategory(cxxtools::SerializationInfo::Category::Array);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // names of the lanes
+        for (size_t lane = 0; lane < m_lanes.size(); lane++) {
+            addEvent(events, "thread_name", "", "M", lane, 0, 0,
+                {{"name", lane == 0 ? m_operation + " " + m_jobId : "event loop " + std::to_string(lane)}});
+        }
+        for (const auto& span : m_spans) {
+            addEvent(events, span.m_name, span.m_category, "X", span.m_lane, span.m_startUs, span.m_durationUs,
+                span.m_args);
+        }
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        throw SrrException("Failed to create " + path);
+    }
+    file << dto::srr::serializeJson(si, false);
+    if (!file.flush()) {
+        throw SrrException("Failed to write " + path);
+    }
+
+    log_debug("Trace of job %s written to %s", m_jobId.c_str(), path.c_str());
+}
+
+uint64_t SrrTrace::sinceOrigin(Clock::time_point time) const
+{
+    if (time <= m_origin) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time - m_origin).count());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SrrSpan::SrrSpan(const std::shared_ptr<SrrJobContext>& job, const std::string& name, const std::string& category,
+    const SrrTrace::Args& args)
+    : m_trace(job ? job->trace() : nullptr)
+    , m_memory(job && category == TRACE_PHASE ? job->memory() : nullptr)
+    , m_name(name)
+{
+    if (m_trace) {
+        m_category = category;
+        m_args     = args;
+        m_start    = SrrTrace::Clock::now();
+    }
+    if (m_memory) {
+        m_memory->enterPhase(m_name);
+    }
+}
+
+SrrSpan::~SrrSpan()
+{
+    if (m_memory) {
+        m_memory->leavePhase(m_name);
+    }
+    if (m_trace) {
+        m_trace->add(m_name, m_category, 0, m_start, SrrTrace::Clock::now(), m_args);
+    }
+}
+
+SrrTraceScope::SrrTraceScope(
+    const std::shared_ptr<SrrJobContext>& job, const std::string& directory, const std::string& operation)
+{
+    if (!job || directory.empty()) {
+        return;
+    }
+
+    m_job       = job;
+    m_directory = directory;
+    m_start     = SrrTrace::Clock::now();
+    m_job->setTrace(std::make_shared<SrrTrace>(operation, job->id()));
+}
+
+SrrTraceScope::~SrrTraceScope()
+{
+    if (!m_job) {
+        return;
+    }
+
+    auto trace = m_job->trace();
+    m_job->setTrace(nullptr);
+
+    trace->add("job", TRACE_JOB, 0, m_start, SrrTrace::Clock::now());
+    try {
+        trace->write(m_directory);
+    } catch (const std::exception& ex) {
+        log_warning("Failed to write the trace of job %s: %s", m_job->id().c_str(), ex.what());
+    }
+}
+
+Step traced(const std::shared_ptr<SrrJobContext>& job, const std::string& name, const std::string& category,
+    Step step, const SrrTrace::Args& args)
+{
+    auto trace  = job ? job->trace() : nullptr;
+    auto memory = job && category == TRACE_PHASE ? job->memory() : nullptr;
+    if (!trace && !memory) {
+        return step;
+    }
+
+    return [trace, memory, name, category, step, args](StepDone done) {
+        const size_t lane  = trace ? trace->acquireLane() : 0;
+        const auto   start = SrrTrace::Clock::now();
+        if (memory) {
+            memory->enterPhase(name);
+        }
+
+        invokeStep(step, [trace, memory, name, category, args, done, lane, start](std::exception_ptr error) {
+            if (memory) {
+                memory->leavePhase(name);
+            }
+            if (trace) {
+                SrrTrace::Args spanArgs = args;
+                if (error) {
+                    spanArgs["error"] = errorMessage(error);
+                }
+                trace->add(name, category, lane, start, SrrTrace::Clock::now(), spanArgs);
+                trace->releaseLane(lane);
+            }
+
+            done(error);
+        });
+    };
+}
+
+} // namespace srr
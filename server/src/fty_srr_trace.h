@@ -0,0 +1,134 @@
+/*  =========================================================================
+    fty_srr_trace - Timeline of the phases of a job, in Chrome trace format
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "helpers/step.h"
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+class SrrJobContext;
+class SrrMemoryAccount;
+
+// categories of the spans
+static constexpr const char* TRACE_JOB     = "job";
+static constexpr const char* TRACE_PHASE   = "phase";
+static constexpr const char* TRACE_FEATURE = "feature";
+static constexpr const char* TRACE_REQUEST = "request";
+
+/**
+ * Spans of a job, written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+ * Lane 0 holds the spans of the request thread, which nest. The spans run by the event loop may overlap: each one
+ * gets the first lane free when it starts, so that a lane never holds two overlapping spans.
+ */
+class SrrTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Args  = std::map<std::string, std::string>;
+
+    SrrTrace(const std::string& operation, const std::string& jobId);
+
+    // lane of an overlapping span, to release once the span is added
+    size_t acquireLane();
+    void   releaseLane(size_t lane);
+
+    void add(const std::string& name, const std::string& category, size_t lane, Clock::time_point start,
+        Clock::time_point end, const Args& args = {});
+
+    // write <operation>-<date>-<job id>.json in directory
+    void write(const std::string& directory) const;
+
+private:
+    struct Span
+    {
+        std::string m_name;
+        std::string m_category;
+        size_t      m_lane;
+        uint64_t    m_startUs;
+        uint64_t    m_durationUs;
+        Args        m_args;
+    };
+
+    std::string       m_operation;
+    std::string       m_jobId;
+    Clock::time_point m_origin;
+    std::time_t       m_started;
+
+    mutable std::mutex m_mutex;
+    std::vector<Span>  m_spans;
+    std::vector<bool>  m_lanes; // busy lanes, lane 0 is the request thread
+
+    uint64_t sinceOrigin(Clock::time_point time) const;
+};
+
+// span of the request thread, from its creation to its destruction. No-op if the job is not traced.
+// A span of the phase category is also a phase of the memory accounting of the job.
+class SrrSpan
+{
+public:
+    SrrSpan(const std::shared_ptr<SrrJobContext>& job, const std::string& name, const std::string& category,
+        const SrrTrace::Args& args = {});
+    ~SrrSpan();
+
+    SrrSpan(const SrrSpan&) = delete;
+    SrrSpan& operator=(const SrrSpan&) = delete;
+
+private:
+    std::shared_ptr<SrrTrace>         m_trace;
+    std::shared_ptr<SrrMemoryAccount> m_memory;
+    std::string                       m_name;
+    std::string                       m_category;
+    SrrTrace::Args                    m_args;
+    SrrTrace::Clock::time_point       m_start;
+};
+
+// trace the job for the lifetime of the scope, written to directory at the end. No-op if directory is empty.
+class SrrTraceScope
+{
+public:
+    SrrTraceScope(
+        const std::shared_ptr<SrrJobContext>& job, const std::string& directory, const std::string& operation);
+    ~SrrTraceScope();
+
+    SrrTraceScope(const SrrTraceScope&) = delete;
+    SrrTraceScope& operator=(const SrrTraceScope&) = delete;
+
+private:
+    std::shared_ptr<SrrJobContext> m_job;
+    std::string                    m_directory;
+    SrrTrace::Clock::time_point    m_start;
+};
+
+// step run as a span of the event loop, whatever its result, and as a phase of the memory accounting for the phase
+// category. step itself if the job is neither traced nor accounted.
+Step traced(const std::shared_ptr<SrrJobContext>& job, const std::string& name, const std::string& category,
+    Step step, const SrrTrace::Args& args = {});
+
+} // namespace srr
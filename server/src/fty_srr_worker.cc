@@ -23,20 +23,35 @@
 #include "dto/request.h"
 #include "dto/response.h"
 #include "fty-srr.h"
+#include "fty_srr_capture.h"
 #include "fty_srr_exception.h"
 #include "fty_srr_groups.h"
+#include "fty_srr_history.h"
+#include "fty_srr_memory.h"
+#include "fty_srr_metrics.h"
+#include "fty_srr_recorder.h"
+#include "fty_srr_store.h"
+#include "fty_srr_trace.h"
+#include "helpers/bulk_transfer.h"
 #include "helpers/data_integrity.h"
+#include "helpers/event_loop.h"
+#include "helpers/probes.h"
+#include "helpers/step.h"
 #include "helpers/utils.h"
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
+#include <cxxtools/jsonserializer.h>
 #include <fty_common.h>
 #include <fty-lib-certificate.h>
+#include <fty/string-utils.h>
 #include <numeric>
-#include <thread>
 #include <vector>
 
-#define SRR_RESTART_DELAY_SEC     5
-#define FEATURE_RESTORE_DELAY_SEC 6
+#define SRR_RESTART_DELAY_SEC      5
+#define REVISION_PROBE_TIMEOUT_SEC 5
+#define JOB_RESULT_RETENTION_SEC   600
+#define FEATURE_SAVE_TIMEOUT_SEC   60
 
 using namespace dto::srr;
 
@@ -45,190 +60,610 @@ namespace srr {
  * Constructor
  * @param msgBus
  * @param parameters
+ * @param busFactory
  */
 SrrWorker::SrrWorker(messagebus::MessageBus& msgBus, const std::map<std::string, std::string>& parameters,
-    const std::set<std::string>& supportedVersions)
+    const std::set<std::string>& supportedVersions, BusFactory busFactory, std::shared_ptr<Clock> clock)
     : m_msgBus(msgBus)
+    , m_busFactory(busFactory)
+    , m_clock(clock ? clock : steadyClock())
     , m_parameters(parameters)
     , m_supportedVersions(supportedVersions)
+    , m_saveJobs(std::chrono::seconds(JOB_RESULT_RETENTION_SEC))
+    , m_snapshotJobs(std::chrono::seconds(JOB_RESULT_RETENTION_SEC))
+    , m_restoreJobs(std::chrono::seconds(JOB_RESULT_RETENTION_SEC))
 {
     init();
 }
 
+SrrWorker::~SrrWorker() = default;
+
 /**
  * Init srr worker
  */
 void SrrWorker::init()
 {
+    size_t      poolSize        = 0;
+    unsigned    poolIdleTimeout = 0;
+    std::string statsFile;
+    unsigned    statsPeriod = 0;
+
     try {
         m_srrVersion  = m_parameters.at(SRR_VERSION_KEY);
         m_sendTimeout = std::stoi(m_parameters.at(REQUEST_TIMEOUT_KEY)) / 1000;
+
+        auto size       = m_parameters.find(BUS_POOL_SIZE_KEY);
+        auto idle       = m_parameters.find(BUS_POOL_IDLE_TIMEOUT_KEY);
+        poolSize        = std::stoul(size != m_parameters.end() ? size->second : BUS_POOL_SIZE_DEFAULT);
+        poolIdleTimeout = static_cast<unsigned>(
+            std::stoul(idle != m_parameters.end() ? idle->second : BUS_POOL_IDLE_TIMEOUT_DEFAULT));
+
+        auto featureDelay = m_parameters.find(RESTORE_DELAY_KEY);
+        m_restoreDelay    = std::chrono::seconds(
+            std::stoul(featureDelay != m_parameters.end() ? featureDelay->second : RESTORE_DELAY_DEFAULT));
+
+        auto traceDirectory = m_parameters.find(TRACE_DIRECTORY_KEY);
+        m_traceDirectory    = traceDirectory != m_parameters.end() ? traceDirectory->second : TRACE_DIRECTORY_DEFAULT;
+
+        auto              memoryBudget = m_parameters.find(MEMORY_BUDGET_KEY);
+        const std::string budgetMb =
+            memoryBudget != m_parameters.end() ? memoryBudget->second : MEMORY_BUDGET_DEFAULT;
+        m_memoryBudget = std::stoull(budgetMb) * 1024 * 1024;
+
+        auto bulkSpool = m_parameters.find(BULK_SPOOL_KEY);
+        m_bulkSpool    = bulkSpool != m_parameters.end() ? bulkSpool->second : BULK_SPOOL_DEFAULT;
+        try {
+            makeBulkSpool(m_bulkSpool);
+        } catch (const std::exception& e) {
+            // only the bulk transfers fail
+            log_warning("Bulk transfers unavailable: %s", e.what());
+        }
+
+        auto captureFile = m_parameters.find(CAPTURE_FILE_KEY);
+        if (captureFile != m_parameters.end() && !captureFile->second.empty()) {
+            auto scrub = m_parameters.find(CAPTURE_SCRUB_KEY);
+            m_capture  = std::unique_ptr<SrrCapture>(new SrrCapture(captureFile->second,
+                scrub != m_parameters.end() ? scrub->second : CAPTURE_SCRUB_DEFAULT, m_clock));
+        }
+
+        auto file   = m_parameters.find(STATS_FILE_KEY);
+        auto period = m_parameters.find(STATS_PERIOD_KEY);
+        statsFile   = file != m_parameters.end() ? file->second : STATS_FILE_DEFAULT;
+        statsPeriod =
+            static_cast<unsigned>(std::stoul(period != m_parameters.end() ? period->second : STATS_PERIOD_DEFAULT));
+
+        // local snapshot store
+        auto storePath = m_parameters.find(STORE_PATH_KEY);
+        if (storePath != m_parameters.end() && !storePath->second.empty()) {
+            auto              maxSnapshots = m_parameters.find(STORE_MAX_SNAPSHOTS_KEY);
+            const std::string max =
+                maxSnapshots != m_parameters.end() ? maxSnapshots->second : STORE_MAX_SNAPSHOTS_DEFAULT;
+
+            m_store = std::unique_ptr<SrrStore>(
+                new SrrStore(storePath->second, static_cast<unsigned>(std::stoul(max))));
+        }
+
+        // kept in the local store, if enabled
+        m_history = std::unique_ptr<SrrHistory>(new SrrHistory(m_store.get()));
     } catch (const std::exception& ex) {
         throw SrrException(ex.what());
     }
-}
 
-dto::srr::SaveResponse SrrWorker::saveFeature(
-    const dto::srr::FeatureName& featureName, const std::string& passphrase, const std::string& sessionToken)
-{
-    dto::srr::SaveResponse response;
+    auto scheme = m_parameters.find(INTEGRITY_SCHEME_KEY);
+    if (scheme != m_parameters.end() && scheme->second == INTEGRITY_SCHEME_MERKLE) {
+        m_integrityScheme = INTEGRITY_SCHEME_MERKLE;
+    } else if (scheme != m_parameters.end() && scheme->second != INTEGRITY_SCHEME_DEFAULT) {
+        log_warning("Unknown integrity scheme %s, using %s", scheme->second.c_str(), INTEGRITY_SCHEME_DEFAULT);
+    }
 
-    std::string agentNameDest;
-    std::string queueNameDest;
+    auto continuous    = m_parameters.find(CONTINUOUS_BACKUP_KEY);
+    m_continuousBackup = continuous != m_parameters.end() && continuous->second == "true";
 
-    try {
-        agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
-        queueNameDest = g_agentToQueue.at(agentNameDest);
-    } catch (std::exception& ex) {
-        log_error("Feature %s not found", featureName.c_str());
-        throw SrrSaveFailed("Feature " + featureName + " not found");
+    auto twoPhase     = m_parameters.find(TWO_PHASE_RESTORE_KEY);
+    m_twoPhaseRestore = twoPhase != m_parameters.end() && twoPhase->second == "true";
+
+    for (const auto& feature : g_srrFeatureMap) {
+        if (feature.second.m_twoPhase) {
+            m_twoPhaseFeatures.insert(feature.first);
+        }
+    }
+    auto twoPhaseFeatures = m_parameters.find(TWO_PHASE_FEATURES_KEY);
+    if (twoPhaseFeatures != m_parameters.end()) {
+        for (const auto& featureName : fty::split(twoPhaseFeatures->second, ",", fty::SplitOption::Trim)) {
+            if (g_srrFeatureMap.find(featureName) == g_srrFeatureMap.end()) {
+                log_warning("Unknown two-phase feature %s ignored", featureName.c_str());
+                continue;
+            }
+            m_twoPhaseFeatures.insert(featureName);
+        }
     }
 
-    log_debug("Request save of feature %s to agent %s", featureName.c_str(), agentNameDest.c_str());
+    // replies of the agents come back on a queue of the loop
+    const std::string replyQueue = m_parameters.at(AGENT_NAME_KEY) + ".reply";
+
+    // features fetched at once: one per client of the pool
+    m_concurrency = std::max<size_t>(1, poolSize);
+
+    m_loop = std::unique_ptr<EventLoop>(new EventLoop(m_clock));
+    m_loop->attach(m_msgBus, replyQueue);
+
+    // each request in flight leases its own client: requests to different agents do not wait for each other
+    if (poolSize > 0) {
+        BusFactory busFactory = m_busFactory;
+        if (!busFactory) {
+            const std::string endpoint = m_parameters.at(ENDPOINT_KEY);
+            busFactory                 = [endpoint](const std::string& clientId) {
+                std::unique_ptr<messagebus::MessageBus> bus(messagebus::MlmMessageBus(endpoint, clientId));
+                bus->connect();
+                return bus;
+            };
+        }
+        auto listener = m_loop->replyListener();
+
+        m_loop->setPool(std::unique_ptr<BusPool>(new BusPool(m_parameters.at(AGENT_NAME_KEY), poolSize,
+            std::chrono::seconds(poolIdleTimeout), [busFactory, replyQueue, listener](const std::string& clientId) {
+                std::unique_ptr<messagebus::MessageBus> bus = busFactory(clientId);
+                bus->receive(replyQueue, listener);
+                return bus;
+            })));
+    }
 
-    dto::srr::Query saveQuery = dto::srr::createSaveQuery({featureName}, passphrase, sessionToken);
+    // the metrics are also readable without the message bus
+    if (!statsFile.empty() && statsPeriod > 0) {
+        m_loop->post([this, statsFile, statsPeriod]() {
+            dumpStats(statsFile, std::chrono::seconds(statsPeriod));
+        });
+    }
+}
 
-    dto::UserData data;
-    data << saveQuery;
-    // Send message to agent
-    messagebus::Message message;
-    try {
-        message = sendRequest(m_msgBus, data, "save", m_parameters.at(AGENT_NAME_KEY), queueNameDest, agentNameDest);
-    } catch (SrrException& ex) {
-        throw(SrrSaveFailed("Request to agent " + agentNameDest + ":" + queueNameDest + " failed: " + ex.what()));
+void SrrWorker::dumpStats(const std::string& path, std::chrono::seconds period)
+{
+    m_loop->schedule(period, [this, path, period]() {
+        try {
+            metrics().dumpToFile(path);
+        } catch (const std::exception& ex) {
+            log_warning("Failed to dump the metrics: %s", ex.what());
+        }
+        dumpStats(path, period);
+    });
+}
+
+namespace {
+    // timeout of a request of job, capped to the time it has left
+    int timeoutOf(const std::shared_ptr<SrrJobContext>& job, int timeout)
+    {
+        return job ? job->timeout(timeout) : timeout;
+    }
+
+    Step checkpointStep(const std::shared_ptr<SrrJobContext>& job)
+    {
+        return call([job]() {
+            if (job) {
+                job->checkpoint();
+            }
+        });
     }
-    log_debug("Save done by agent %s", agentNameDest.c_str());
 
-    dto::srr::Response featureResponse;
-    message.userData() >> featureResponse;
+    Step noop()
+    {
+        return call([]() {});
+    }
 
-    // check all features in the map of the response. If one failed, the save operation fails
-    for (const auto& f : featureResponse.save().map_features_data()) {
-        if (f.second.status().status() != Status::SUCCESS) {
-            throw(SrrSaveFailed("Save failed for feature " + featureName));
+    uint64_t payloadSize(const dto::UserData& data)
+    {
+        uint64_t size = 0;
+        for (const auto& frame : data) {
+            size += frame.size();
         }
+        return size;
     }
 
-    response = featureResponse.save();
+    // bytes of the features held by a payload
+    uint64_t payloadBytes(const std::vector<SrrFeature>& features)
+    {
+        uint64_t size = 0;
+        for (const auto& feature : features) {
+            size += feature.m_feature_and_status.ByteSizeLong();
+        }
+        return size;
+    }
 
-    return response;
-}
+    uint64_t payloadBytes(const std::vector<Group>& groups)
+    {
+        uint64_t size = 0;
+        for (const auto& group : groups) {
+            size += payloadBytes(group.m_features);
+        }
+        return size;
+    }
 
-dto::srr::RestoreResponse SrrWorker::restoreFeature(
-    const dto::srr::FeatureName& featureName, const dto::srr::RestoreQuery& query)
-{
-    const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
-    const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
+    uint64_t payloadBytes(const SrrRestoreRequest& request)
+    {
+        if (auto data = std::dynamic_pointer_cast<SrrRestoreRequestDataV2>(request.m_data_ptr)) {
+            return payloadBytes(data->m_data);
+        }
+        if (auto data = std::dynamic_pointer_cast<SrrRestoreRequestDataV1>(request.m_data_ptr)) {
+            return payloadBytes(data->m_data);
+        }
+        return 0;
+    }
 
-    Query restoreQuery;
-    *(restoreQuery.mutable_restore()) = query;
-    log_debug("Request restore of feature %s to agent %s ", featureName.c_str(), agentNameDest.c_str());
+    bool isMemoryExceeded(std::exception_ptr error)
+    {
+        try {
+            std::rethrow_exception(error);
+        } catch (const SrrMemoryExceeded&) {
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
 
-    // Send message
-    dto::UserData data;
-    data << restoreQuery;
-    messagebus::Message message;
-    try {
-        message = sendRequest(
-            m_msgBus, data, "restore", m_parameters.at(AGENT_NAME_KEY), queueNameDest, agentNameDest, m_sendTimeout);
-    } catch (SrrException& ex) {
-        throw(SrrRestoreFailed("Request to agent " + agentNameDest + ":" + queueNameDest + " failed: " + ex.what()));
+    // wait for the agent to apply a restored feature
+    Step restoreDelay(EventLoop& loop, std::chrono::seconds duration, const std::shared_ptr<SrrJobContext>& job)
+    {
+        return traced(job, "delay", TRACE_PHASE, defer([&loop, duration]() {
+            const auto start = loop.clock().now();
+            return finally(delay(loop, duration), [&loop, start]() {
+                metrics().m_restoreDelayMs.record(elapsedMs(loop.clock(), start));
+            });
+        }));
     }
 
-    Response response;
-    message.userData() >> response;
+    // step completed even if job is cancelled or late (commit, rollback, abort)
+    Step recoveryStep(const std::shared_ptr<SrrJobContext>& job, Step step)
+    {
+        return [job, step](StepDone done) {
+            if (job) {
+                job->enterRecovery();
+            }
+            invokeStep(finally(step,
+                           [job]() {
+                               if (job) {
+                                   job->leaveRecovery();
+                               }
+                           }),
+                done);
+        };
+    }
 
-    // restore procedure failed -> rollback
-    // check all features in the map of the response. If one failed, the save operation fails
-    bool restoreOk = true;
-    for (const auto& f : response.restore().map_features_status()) {
-        if (f.second.status() != Status::SUCCESS) {
-            restoreOk = false;
-        }
+    // a failed request is reported as a Failed error of the operation, other errors (cancellation) go through
+    template <typename Failed>
+    std::function<std::exception_ptr(std::exception_ptr)> requestFailed(
+        const std::string& agentNameDest, const std::string& queueNameDest)
+    {
+        return [agentNameDest, queueNameDest](std::exception_ptr error) {
+            try {
+                std::rethrow_exception(error);
+            } catch (const SrrException& ex) {
+                return std::make_exception_ptr(
+                    Failed("Request to agent " + agentNameDest + ":" + queueNameDest + " failed: " + ex.what()));
+            } catch (...) {
+                return std::current_exception();
+            }
+        };
     }
 
-    if (!restoreOk) {
-        throw SrrRestoreFailed("Restore procedure failed for feature " + featureName);
+    std::exception_ptr logWarning(std::exception_ptr error)
+    {
+        log_warning(errorMessage(error).c_str());
+        return nullptr;
     }
+} // namespace
+
+Step SrrWorker::agentRequest(const dto::srr::FeatureName& featureName, const std::string& agentNameDest,
+    const std::string& action, const dto::UserData& data, const std::shared_ptr<SrrJobContext>& job, int timeout,
+    std::shared_ptr<messagebus::Message> reply)
+{
+    const std::string from = m_parameters.at(AGENT_NAME_KEY);
+
+    return traced(job, agentNameDest + " " + action, TRACE_REQUEST,
+        [this, featureName, agentNameDest, action, data, job, timeout, reply, from](StepDone done) {
+            const std::string& queueNameDest = g_agentToQueue.at(agentNameDest);
+
+            log_debug("Send message from %s to %s:%s with action %s", from.c_str(), agentNameDest.c_str(),
+                queueNameDest.c_str(), action.c_str());
+
+            messagebus::Message request;
+            request.userData() = data;
+            request.metaData().emplace(messagebus::Message::SUBJECT, action);
+            request.metaData().emplace(messagebus::Message::FROM, from);
+            request.metaData().emplace(messagebus::Message::TO, agentNameDest);
+
+            SrrAgentMetrics& agentMetrics = metrics().agent(agentNameDest, action);
+            const uint64_t   bytesOut     = payloadSize(data);
+            agentMetrics.m_bytesOut += bytesOut;
+            metrics().m_bytesOut += bytesOut;
+
+            // the requests in flight overlap, the id pairs the exit probe with its entry
+            static std::atomic<uint64_t> requestIds{0};
+            const uint64_t               requestId = ++requestIds;
+            SRR_PROBE4(send_request_entry, agentNameDest.c_str(), action.c_str(), bytesOut, requestId);
+
+            const auto start = m_clock->now();
+
+            // frames of the request, kept until its reply to be captured with it
+            std::shared_ptr<SrrExchange> exchange;
+            if (m_capture) {
+                exchange            = std::make_shared<SrrExchange>();
+                exchange->m_agent   = agentNameDest;
+                exchange->m_queue   = queueNameDest;
+                exchange->m_action  = action;
+                exchange->m_request = data;
+            }
 
-    return response.restore();
+            SrrFlightEvent flight(
+                SrrFlightEventType::Feature, job ? job->id() : "", featureName, agentNameDest, action);
+            flight.m_bytesOut = bytesOut;
+
+            // the reply is matched by correlation id, no thread waits for it
+            m_loop->request(queueNameDest, request, timeoutOf(job, timeout),
+                [this, agentNameDest, action, reply, done, &agentMetrics, start, requestId, exchange, flight](
+                    std::exception_ptr error, messagebus::Message message) mutable {
+                    const uint64_t latencyMs = elapsedMs(*m_clock, start);
+                    agentMetrics.m_latencyMs.record(latencyMs);
+                    if (exchange) {
+                        exchange->m_error = error ? errorMessage(error) : "";
+                        exchange->m_reply = message.userData();
+                        try {
+                            m_capture->record(*exchange, start);
+                        } catch (const std::exception& ex) {
+                            log_warning("Exchange with %s not captured: %s", agentNameDest.c_str(), ex.what());
+                        }
+                    }
+                    uint64_t bytesIn = 0;
+                    if (!error) {
+                        log_debug("Message received from %s with action %s", agentNameDest.c_str(), action.c_str());
+
+                        bytesIn = payloadSize(message.userData());
+                        agentMetrics.m_bytesIn += bytesIn;
+                        metrics().m_bytesIn += bytesIn;
+
+                        *reply = std::move(message);
+                    } else {
+                        agentMetrics.m_errors++;
+                    }
+                    SRR_PROBE5(send_request_exit, agentNameDest.c_str(), action.c_str(), bytesIn, error ? 1 : 0,
+                        requestId);
+
+                    flight.m_durationMs = latencyMs;
+                    flight.m_bytesIn    = bytesIn;
+                    flight.m_failed     = error ? 1 : 0;
+                    flightRecorder().record(flight);
+                    done(error);
+                });
+        },
+        {{"agent", agentNameDest}, {"action", action}});
 }
 
-dto::srr::ResetResponse SrrWorker::resetFeature(const dto::srr::FeatureName& featureName)
+Step SrrWorker::saveFeatureStep(const dto::srr::FeatureName& featureName, const std::string& passphrase,
+    const std::string& sessionToken, const std::shared_ptr<SrrJobContext>& job,
+    std::function<void(const dto::srr::SaveResponse&)> onSaved)
 {
-    const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
-    const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
+    return traced(job, "save " + featureName, TRACE_FEATURE,
+        defer([this, featureName, passphrase, sessionToken, job, onSaved]() {
+            std::string agentNameDest;
+            std::string queueNameDest;
+
+            try {
+                agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
+                queueNameDest = g_agentToQueue.at(agentNameDest);
+            } catch (std::exception& ex) {
+                log_error("Feature %s not found", featureName.c_str());
+                throw SrrSaveFailed("Feature " + featureName + " not found");
+            }
 
-    log_debug("Request reset of feature %s to agent %s ", featureName.c_str(), agentNameDest.c_str());
+            log_debug("Request save of feature %s to agent %s", featureName.c_str(), agentNameDest.c_str());
 
-    Query       query;
-    ResetQuery& resetQuery          = *(query.mutable_reset());
-    *(resetQuery.mutable_version()) = m_srrVersion;
-    resetQuery.add_features(featureName);
+            dto::srr::Query saveQuery = dto::srr::createSaveQuery({featureName}, passphrase, sessionToken);
 
-    dto::UserData data;
-    data << query;
-    messagebus::Message message;
-    try {
-        message = sendRequest(
-            m_msgBus, data, "reset", m_parameters.at(AGENT_NAME_KEY), queueNameDest, agentNameDest, m_sendTimeout);
-    } catch (SrrException& ex) {
-        throw(SrrResetFailed("Request to agent " + agentNameDest + ":" + queueNameDest + " failed: " + ex.what()));
-    }
+            dto::UserData data;
+            data << saveQuery;
 
-    Response response;
-    message.userData() >> response;
+            SRR_PROBE2(save_feature_entry, featureName.c_str(), agentNameDest.c_str());
 
-    bool resetOk = true;
-    for (const auto& f : response.reset().map_features_status()) {
-        if (f.second.status() != Status::SUCCESS) {
-            resetOk = false;
-        }
-    }
-    if (!resetOk) {
-        throw SrrResetFailed("Reset procedure failed for feature " + featureName);
-    }
+            auto reply = std::make_shared<messagebus::Message>();
+            return observe(sequence({
+                attempt(agentRequest(featureName, agentNameDest, "save", data, job, FEATURE_SAVE_TIMEOUT_SEC, reply),
+                    requestFailed<SrrSaveFailed>(agentNameDest, queueNameDest)),
+                call([featureName, agentNameDest, reply, job, onSaved]() {
+                    log_debug("Save done by agent %s", agentNameDest.c_str());
+
+                    dto::srr::Response featureResponse;
+                    reply->userData() >> featureResponse;
 
-    return response.reset();
+                    // reply and decoded response, until the features are converted
+                    SrrMemoryCharge decodedMemory(job, SrrMemoryKind::Protobuf,
+                        payloadSize(reply->userData()) + featureResponse.ByteSizeLong());
+
+                    // check all features in the map of the response. If one failed, the save operation fails
+                    for (const auto& f : featureResponse.save().map_features_data()) {
+                        if (f.second.status().status() != Status::SUCCESS) {
+                            throw(SrrSaveFailed("Save failed for feature " + featureName));
+                        }
+                    }
+
+                    onSaved(featureResponse.save());
+                }),
+            }),
+                [featureName, agentNameDest, reply](std::exception_ptr error) {
+                    SRR_PROBE4(save_feature_exit, featureName.c_str(), agentNameDest.c_str(),
+                        payloadSize(reply->userData()), error ? 1 : 0);
+                });
+        }));
 }
 
-bool SrrWorker::rollback(const dto::srr::SaveResponse& rollbackSaveResponse, const std::string& passphrase)
+Step SrrWorker::restoreFeatureStep(const dto::srr::FeatureName& featureName, const dto::srr::RestoreQuery& query,
+    const std::string& action, const std::shared_ptr<SrrJobContext>& job,
+    std::function<void(const dto::srr::RestoreResponse&)> onRestored)
 {
-    bool restart = false;
+    return traced(job, action + " " + featureName, TRACE_FEATURE,
+        defer([this, featureName, query, action, job, onRestored]() {
+            const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
+            const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
+
+            Query restoreQuery;
+            *(restoreQuery.mutable_restore()) = query;
+            log_debug(
+                "Request %s of feature %s to agent %s ", action.c_str(), featureName.c_str(), agentNameDest.c_str());
+
+            dto::UserData data;
+            data << restoreQuery;
+
+            const uint64_t bytes = payloadSize(data);
+            SRR_PROBE3(restore_feature_entry, featureName.c_str(), agentNameDest.c_str(), bytes);
+
+            // query and its encoding, until the agent replied
+            auto queryMemory = std::make_shared<SrrMemoryCharge>(
+                job, SrrMemoryKind::Protobuf, restoreQuery.ByteSizeLong() + bytes);
+
+            auto reply = std::make_shared<messagebus::Message>();
+            return observe(sequence({
+                attempt(agentRequest(featureName, agentNameDest, action, data, job, m_sendTimeout, reply),
+                    requestFailed<SrrRestoreFailed>(agentNameDest, queueNameDest)),
+                call([featureName, reply, onRestored]() {
+                    Response response;
+                    reply->userData() >> response;
+
+                    // check all features in the map of the response. If one failed, the restore operation fails
+                    for (const auto& f : response.restore().map_features_status()) {
+                        if (f.second.status() != Status::SUCCESS) {
+                            throw SrrRestoreFailed("Restore procedure failed for feature " + featureName);
+                        }
+                    }
 
-    log_debug("Starting features roll back...");
+                    if (onRestored) {
+                        onRestored(response.restore());
+                    }
+                }),
+            }),
+                [featureName, agentNameDest, bytes, queryMemory](std::exception_ptr error) {
+                    queryMemory->release();
+                    SRR_PROBE4(
+                        restore_feature_exit, featureName.c_str(), agentNameDest.c_str(), bytes, error ? 1 : 0);
+                });
+        }));
+}
 
-    std::map<std::string, FeatureAndStatus> rollbackMap(
-        rollbackSaveResponse.map_features_data().begin(), rollbackSaveResponse.map_features_data().end());
+Step SrrWorker::phaseStep(const dto::srr::FeatureName& featureName, const std::string& action,
+    const std::string& sessionToken, const std::shared_ptr<SrrJobContext>& job)
+{
+    return traced(job, action + " " + featureName, TRACE_FEATURE,
+        defer([this, featureName, action, sessionToken, job]() {
+            const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
+            const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
+
+            log_debug(
+                "Request %s of feature %s to agent %s ", action.c_str(), featureName.c_str(), agentNameDest.c_str());
+
+            // the agent knows the prepared payload: the restore query names the feature, without data, along with the
+            // session which authorizes the change
+            Query         query;
+            RestoreQuery& phaseQuery        = *(query.mutable_restore());
+            *(phaseQuery.mutable_version()) = m_srrVersion;
+            phaseQuery.set_session_token(sessionToken);
+            phaseQuery.mutable_map_features_data()->insert({featureName, Feature()});
+
+            dto::UserData data;
+            data << query;
+
+            auto reply = std::make_shared<messagebus::Message>();
+            return sequence({
+                attempt(agentRequest(featureName, agentNameDest, action, data, job, m_sendTimeout, reply),
+                    requestFailed<SrrRestoreFailed>(agentNameDest, queueNameDest)),
+                call([featureName, action, reply]() {
+                    Response response;
+                    reply->userData() >> response;
+
+                    for (const auto& f : response.restore().map_features_status()) {
+                        if (f.second.status() != Status::SUCCESS) {
+                            throw SrrRestoreFailed("Restore " + action + " failed for feature " + featureName);
+                        }
+                    }
+                }),
+            });
+        }));
+}
+
+Step SrrWorker::abortStep(const std::vector<dto::srr::FeatureName>& featureNames, const std::string& sessionToken,
+    const std::shared_ptr<SrrJobContext>& job)
+{
+    // the current configuration was never left: nothing to roll back
+    return recoveryStep(job, forEach(featureNames.size(), [this, featureNames, sessionToken, job](size_t i) {
+        return attempt(phaseStep(featureNames[i], "abort", sessionToken, job), logWarning);
+    }));
+}
+
+Step SrrWorker::resetFeatureStep(const dto::srr::FeatureName& featureName, const std::shared_ptr<SrrJobContext>& job)
+{
+    return traced(job, "reset " + featureName, TRACE_FEATURE, defer([this, featureName, job]() {
+        const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
+        const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
+
+        log_debug("Request reset of feature %s to agent %s ", featureName.c_str(), agentNameDest.c_str());
+
+        Query       query;
+        ResetQuery& resetQuery          = *(query.mutable_reset());
+        *(resetQuery.mutable_version()) = m_srrVersion;
+        resetQuery.add_features(featureName);
+
+        dto::UserData data;
+        data << query;
+
+        SRR_PROBE2(reset_feature_entry, featureName.c_str(), agentNameDest.c_str());
+
+        auto reply = std::make_shared<messagebus::Message>();
+        return observe(sequence({
+            attempt(agentRequest(featureName, agentNameDest, "reset", data, job, m_sendTimeout, reply),
+                requestFailed<SrrResetFailed>(agentNameDest, queueNameDest)),
+            call([featureName, reply]() {
+                Response response;
+                reply->userData() >> response;
+
+                for (const auto& f : response.reset().map_features_status()) {
+                    if (f.second.status() != Status::SUCCESS) {
+                        throw SrrResetFailed("Reset procedure failed for feature " + featureName);
+                    }
+                }
+            }),
+        }),
+            [featureName, agentNameDest](std::exception_ptr error) {
+                SRR_PROBE3(reset_feature_exit, featureName.c_str(), agentNameDest.c_str(), error ? 1 : 0);
+            });
+    }));
+}
 
-    std::vector<FeatureName> featuresToRestore;
+Step SrrWorker::rollbackStep(const dto::srr::SaveResponse& rollbackSaveResponse, const std::string& passphrase,
+    const std::shared_ptr<SrrJobContext>& job, bool& restart)
+{
+    auto rollbackMap = std::make_shared<std::map<std::string, FeatureAndStatus>>(
+        rollbackSaveResponse.map_features_data().begin(), rollbackSaveResponse.map_features_data().end());
 
-    for (const auto& entry : rollbackMap) {
-        featuresToRestore.push_back(entry.first);
+    auto featuresToRestore = std::make_shared<std::vector<FeatureName>>();
+    for (const auto& entry : *rollbackMap) {
+        featuresToRestore->push_back(entry.first);
     }
 
     // in version 1.0 sorting has no practical effect, as there is no concept of groups
     // in version 2.0, a rollbackSaveResponse will contain only features from the same group -> ordering is meaningful
-    std::sort(featuresToRestore.begin(), featuresToRestore.end(), [&](FeatureName l, FeatureName r) {
+    std::sort(featuresToRestore->begin(), featuresToRestore->end(), [&](FeatureName l, FeatureName r) {
         return getPriority(l) < getPriority(r);
     });
 
     // reset features in reverse order
-    for (auto revIt = featuresToRestore.rbegin(); revIt != featuresToRestore.rend(); revIt++) {
-        if (g_srrFeatureMap.at(*revIt).m_reset) {
-            try {
-                resetFeature(*revIt);
-            } catch (SrrResetFailed& ex) {
-                log_warning(ex.what());
-            }
+    Step resets = forEach(featuresToRestore->size(), [this, featuresToRestore, job](size_t i) {
+        const FeatureName& featureName = (*featuresToRestore)[featuresToRestore->size() - 1 - i];
+        if (!g_srrFeatureMap.at(featureName).m_reset) {
+            return noop();
         }
-    }
+        return attempt(resetFeatureStep(featureName, job), logWarning);
+    });
 
-    for (const auto& featureName : featuresToRestore) {
-        const dto::srr::Feature& featureData = rollbackMap.at(featureName).feature();
+    Step restores = forEach(featuresToRestore->size(), [=, &restart](size_t i) {
+        const FeatureName&       featureName = (*featuresToRestore)[i];
+        const dto::srr::Feature& featureData = rollbackMap->at(featureName).feature();
 
         const std::string agentNameDest = g_srrFeatureMap.at(featureName).m_agent;
-        const std::string queueNameDest = g_agentToQueue.at(agentNameDest);
 
         // Build restore query
         RestoreQuery restoreQuery;
@@ -240,20 +675,74 @@ bool SrrWorker::rollback(const dto::srr::SaveResponse& rollbackSaveResponse, con
 
         // restore backup data
         log_debug("Rollback configuration of %s by agent %s ", featureName.c_str(), agentNameDest.c_str());
-        try {
-            restoreFeature(featureName, restoreQuery);
-        } catch (SrrRestoreFailed& ex) {
-            log_error("Feature %s is unrecoverable. May be in undefined state", featureName.c_str());
-        }
-        log_debug("%s rolled back by: %s ", featureName.c_str(), agentNameDest.c_str());
-        restart = restart | g_srrFeatureMap.at(featureName).m_restart;
-        // wait to sync feature restore
-        std::this_thread::sleep_for(std::chrono::seconds(FEATURE_RESTORE_DELAY_SEC));
-    }
+        return sequence({
+            attempt(restoreFeatureStep(featureName, restoreQuery, "restore", job, nullptr),
+                [featureName](std::exception_ptr) {
+                    log_error("Feature %s is unrecoverable. May be in undefined state", featureName.c_str());
+                    return std::exception_ptr();
+                }),
+            call([featureName, agentNameDest, &restart]() {
+                log_debug("%s rolled back by: %s ", featureName.c_str(), agentNameDest.c_str());
+                restart = restart | g_srrFeatureMap.at(featureName).m_restart;
+            }),
+            // wait to sync feature restore
+            restoreDelay(*m_loop, m_restoreDelay, job),
+        });
+    });
+
+    // the previous configuration is put back even if the job is cancelled or late
+    const uint64_t    features = featuresToRestore->size();
+    const std::string jobId    = job ? job->id() : "";
+    return traced(job, "rollback", TRACE_PHASE, observe(recoveryStep(job, sequence({
+        call([features, jobId]() {
+            log_debug("Starting features roll back...");
+            metrics().m_rollbacks++;
+            SRR_PROBE1(rollback_entry, features);
+
+            SrrFlightEvent flight(SrrFlightEventType::RollbackStart, jobId, "rollback");
+            flight.m_bytesOut = features;
+            flightRecorder().record(flight);
+        }),
+        resets,
+        restores,
+        call([]() {
+            log_debug("Roll back completed");
+        }),
+    })),
+        [features, jobId](std::exception_ptr error) {
+            SRR_PROBE2(rollback_exit, features, error ? 1 : 0);
+
+            SrrFlightEvent flight(SrrFlightEventType::RollbackEnd, jobId, "rollback");
+            flight.m_bytesOut = features;
+            flight.m_failed   = error ? 1 : 0;
+            flightRecorder().record(flight);
+        }));
+}
+
+dto::srr::SaveResponse SrrWorker::saveFeature(
+    const dto::srr::FeatureName& featureName, const std::string& passphrase, const std::string& sessionToken)
+{
+    dto::srr::SaveResponse response;
+
+    auto onSaved = [&](const SaveResponse& saved) {
+        response = saved;
+    };
+    runSync(*m_loop, saveFeatureStep(featureName, passphrase, sessionToken, currentJob(), onSaved));
+
+    return response;
+}
 
-    log_debug("Roll back completed");
+void SrrWorker::restartCountdown(unsigned seconds)
+{
+    if (seconds == 0) {
+        restartBiosService(0);
+        return;
+    }
 
-    return restart;
+    log_info("Rebooting in %d seconds...", seconds);
+    m_loop->schedule(std::chrono::seconds(1), [this, seconds]() {
+        restartCountdown(seconds - 1);
+    });
 }
 
 // UI interface
@@ -306,17 +795,120 @@ dto::UserData SrrWorker::requestSave(const std::string& json)
 
     log_debug("SRR save request");
 
+    auto           job = currentJob();
+    SrrTraceScope  trace(job, m_traceDirectory, "save");
+    SrrMemoryScope memory(job, m_memoryBudget, "save");
+
+    BulkDescriptor bulk;
+    std::string    cachedJson;
+
+    try {
+        SrrSaveRequest srrSaveReq;
+        {
+            SrrSpan span(job, "parse", TRACE_PHASE);
+
+            SrrMemoryCharge             requestMemory(job, SrrMemoryKind::Serialization, json.size());
+            cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
+            requestSi >>= srrSaveReq;
+        }
+        bulk = srrSaveReq.m_bulk;
+
+        auto cancellable = m_activeJobs.attach(srrSaveReq.m_idempotencyKey);
+
+        if (cachedSave(srrSaveReq, cachedJson)) {
+            srrSaveResp.m_version = m_srrVersion;
+            srrSaveResp.m_status  = statusToString(Status::SUCCESS);
+        } else {
+            // a retry or an identical save in progress gets the result of the running one
+            const std::string key     = saveJobKey(srrSaveReq);
+            const std::string request = saveRequestDigest(srrSaveReq);
+
+            srrSaveResp = m_saveJobs.run(key, request, !srrSaveReq.m_idempotencyKey.empty(), [&]() {
+                std::map<std::string, std::string> revisions;
+
+                SrrSaveResponse resp = save(srrSaveReq, m_continuousBackup ? &revisions : nullptr);
+                armContinuousBackup(srrSaveReq, resp, revisions);
+                return resp;
+            });
+        }
+    } catch (const std::exception& e) {
+        srrSaveResp.m_version = m_srrVersion;
+        srrSaveResp.m_status  = statusToString(Status::FAILED);
+        srrSaveResp.m_error   = TRANSLATE_ME("Exception on save Ipm2 configuration: (%s)", e.what());
+        log_error(srrSaveResp.m_error.c_str());
+    }
+
+    SrrSpan span(job, "serialization", TRACE_PHASE);
+
+    // payload returned by the save, held until it is serialized. Sent on the bus, it is also held as a tree, then as a
+    // JSON document: over the budget, the save fails instead
+    SrrMemoryCharge payloadMemory;
+    SrrMemoryCharge responseMemory;
+    try {
+        const uint64_t bytes = payloadBytes(srrSaveResp.m_data);
+        payloadMemory        = SrrMemoryCharge(job, SrrMemoryKind::Dto, bytes);
+        if (bulk.m_path.empty()) {
+            responseMemory = SrrMemoryCharge(job, SrrMemoryKind::Serialization, 2 * bytes);
+        }
+    } catch (const SrrMemoryExceeded& e) {
+        srrSaveResp.m_status = statusToString(Status::FAILED);
+        srrSaveResp.m_error  = TRANSLATE_ME("Exception on save Ipm2 configuration: (%s)", e.what());
+        srrSaveResp.m_data.clear();
+        log_error(srrSaveResp.m_error.c_str());
+    }
+
+    // local bulk transfer: the payload is written to a file of the spool, only its descriptor goes on the bus
+    if (!bulk.m_path.empty()) {
+        try {
+            srrSaveResp.m_bulk = writeBulkFile(bulkSpoolPath(m_bulkSpool, bulk.m_path), [&](std::ostream& os) {
+                if (!cachedJson.empty()) {
+                    os << cachedJson;
+                    return;
+                }
+                cxxtools::JsonSerializer serializer(os);
+                serializer.serialize(srrSaveResp).finish();
+            });
+            srrSaveResp.m_bulk.m_path = bulk.m_path;
+            srrSaveResp.m_data.clear();
+        } catch (const std::exception& e) {
+            srrSaveResp.m_status = statusToString(Status::FAILED);
+            srrSaveResp.m_error  = TRANSLATE_ME("Exception on save Ipm2 configuration: (%s)", e.what());
+            srrSaveResp.m_data.clear();
+            log_error(srrSaveResp.m_error.c_str());
+        }
+        cachedJson.clear();
+    }
+
+    dto::UserData response;
+
+    // answered from the continuous backup: the payload is already serialized
+    if (!cachedJson.empty()) {
+        response.push_back(srrSaveResp.m_status);
+        response.push_back(cachedJson);
+        return response;
+    }
+
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrSaveResp;
+
+    std::string jsonResp = serializeJson(responseSi);
+
+    response.push_back(srrSaveResp.m_status);
+    response.push_back(jsonResp);
+
+    return response;
+}
+
+SrrSaveResponse SrrWorker::save(const SrrSaveRequest& srrSaveReq, std::map<std::string, std::string>* revisions)
+{
+    SrrSaveResponse srrSaveResp;
+
     srrSaveResp.m_version = m_srrVersion;
     srrSaveResp.m_status  = statusToString(Status::FAILED);
 
     bool allGroupsSaved = true;
 
     try {
-        cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
-        SrrSaveRequest              srrSaveReq;
-
-        requestSi >>= srrSaveReq;
-
         // check that passphrase is compliant with requested format
         if (fty::checkPassphraseFormat(srrSaveReq.m_passphrase)) {
             // evalutate checksum
@@ -326,8 +918,27 @@ dto::UserData SrrWorker::requestSave(const std::string& json)
 
             std::map<std::string, Group> savedGroups;
 
+            // job of the request, the features are fetched in the event loop thread
+            auto job = currentJob();
+
+            // features held until the payload is returned
+            std::vector<SrrMemoryCharge> savedMemory;
+
+            // incremental save: features with an unchanged revision are taken from the latest snapshot
+            std::map<std::string, SrrFeature>  baseFeatures;
+            std::map<std::string, std::string> baseRevisions;
+            if (srrSaveReq.m_incremental) {
+                loadIncrementalBase(srrSaveReq.m_passphrase, baseFeatures, baseRevisions);
+                for (const auto& feature : baseFeatures) {
+                    savedMemory.emplace_back(
+                        job, SrrMemoryKind::Dto, feature.second.m_feature_and_status.ByteSizeLong());
+                }
+            }
+
             // save all the features for each required group
             for (const auto& groupId : srrSaveReq.m_group_list) {
+                jobCheckpoint();
+
                 log_debug("Saving features from group %s ", groupId.c_str());
                 srr::SrrGroupStruct group;
                 try {
@@ -341,23 +952,78 @@ dto::UserData SrrWorker::requestSave(const std::string& json)
                 }
 
                 try {
-                    for (const auto& entry : group.m_fp) {
-                        const auto& featureName = entry.m_feature;
+                    // features of the group, in its order
+                    std::vector<std::vector<SrrFeature>> saved(group.m_fp.size());
+                    // features to fetch from the agents, with their index in the group
+                    std::vector<std::string> toFetch;
+                    std::vector<size_t>      toFetchIndex;
+
+                    for (size_t i = 0; i < group.m_fp.size(); i++) {
+                        const auto& featureName = group.m_fp[i].m_feature;
+
+                        jobCheckpoint();
+
+                        // revision before the fetch: a change during the fetch is caught by the next save
+                        std::string revision;
+                        if (revisions != nullptr || !baseRevisions.empty()) {
+                            revision = featureRevision(featureName);
+                        }
+                        if (revisions != nullptr && !revision.empty()) {
+                            (*revisions)[featureName] = revision;
+                        }
+
+                        auto baseRevision = baseRevisions.find(featureName);
+                        auto baseFeature  = baseFeatures.find(featureName);
+                        if (!revision.empty() && baseRevision != baseRevisions.end() &&
+                            baseRevision->second == revision && baseFeature != baseFeatures.end()) {
+                            log_debug("Feature %s unchanged since the latest snapshot", featureName.c_str());
+                            saved[i].push_back(baseFeature->second);
+                            continue;
+                        }
+
+                        toFetch.push_back(featureName);
+                        toFetchIndex.push_back(i);
+                    }
+
+                    // longest first: the slowest agent must not start last while the others are already done
+                    const std::vector<size_t> order = m_history->longestFirst(toFetch, HISTORY_SAVE);
+
+                    runSync(*m_loop, parallel(order.size(), m_concurrency, [&](size_t i) {
+                        const size_t       index       = toFetchIndex[order[i]];
+                        const std::string& featureName = toFetch[order[i]];
+                        const auto         start       = m_clock->now();
 
-                        SaveResponse saveResp =
-                            saveFeature(featureName, srrSaveReq.m_passphrase, srrSaveReq.m_sessionToken);
-                        // convert ProtoBuf save response to UI DTO
-                        const auto& mapFeaturesData = saveResp.map_features_data();
+                        auto onSaved = [&, index, featureName, start](const SaveResponse& saveResp) {
+                            uint64_t size = 0;
 
-                        for (const auto& fs : mapFeaturesData) {
-                            SrrFeature f;
-                            f.m_feature_name       = fs.first;
-                            f.m_feature_and_status = fs.second;
+                            // convert ProtoBuf save response to UI DTO
+                            for (const auto& fs : saveResp.map_features_data()) {
+                                savedMemory.emplace_back(job, SrrMemoryKind::Dto, fs.second.ByteSizeLong());
 
-                            // save each feature into its group
-                            savedGroups[groupId].m_features.push_back(f);
+                                SrrFeature f;
+                                f.m_feature_name       = fs.first;
+                                f.m_feature_and_status = fs.second;
+
+                                saved[index].push_back(f);
+                                size += fs.second.feature().data().size();
+                            }
+
+                            m_history->record(featureName, HISTORY_SAVE,
+                                std::chrono::milliseconds(elapsedMs(*m_clock, start)), size);
+                        };
+                        return saveFeatureStep(
+                            featureName, srrSaveReq.m_passphrase, srrSaveReq.m_sessionToken, job, onSaved);
+                    }));
+
+                    // save each feature into its group
+                    for (auto& features : saved) {
+                        for (auto& f : features) {
+                            savedGroups[groupId].m_features.push_back(std::move(f));
                         }
                     }
+                } catch (const SrrMemoryExceeded&) {
+                    // the whole save fails: a partial payload would be mistaken for a complete backup
+                    throw;
                 } catch (std::exception& e) {
                     allGroupsSaved = false;
                     log_error("Error while saving group %s: %s. Will not be included in the payload", groupId.c_str(),
@@ -369,17 +1035,27 @@ dto::UserData SrrWorker::requestSave(const std::string& json)
             }
 
             // update group info and evaluate data integrity
-            for (auto groupElement : savedGroups) {
+            for (auto& groupElement : savedGroups) {
                 const auto& groupId = groupElement.first;
                 auto&       group   = groupElement.second;
 
-                group.m_group_id   = groupId;
-                group.m_group_name = groupId;
+                group.m_group_id         = groupId;
+                group.m_group_name       = groupId;
+                group.m_integrity_scheme = m_integrityScheme;
+
+                // the data encoding is part of the digests: it follows the version of the payload
+                for (auto& feature : group.m_features) {
+                    feature.m_base64Data = hasBase64Data(m_srrVersion);
+                }
 
                 // evaluate data integrity
-                evalDataIntegrity(group);
+                {
+                    SrrSpan  span(job, "integrity check " + groupId, TRACE_PHASE);
+                    SrrTimer timer(metrics().m_integrityCheckMs);
+                    evalDataIntegrity(group);
+                }
 
-                srrSaveResp.m_data.push_back(group);
+                srrSaveResp.m_data.push_back(std::move(group));
             }
 
             if (allGroupsSaved) {
@@ -398,114 +1074,210 @@ dto::UserData SrrWorker::requestSave(const std::string& json)
         log_error(srrSaveResp.m_error.c_str());
     }
 
-    dto::UserData response;
-
-    cxxtools::SerializationInfo responseSi;
-    responseSi <<= srrSaveResp;
-
-    std::string jsonResp = serializeJson(responseSi);
-
-    response.push_back(srrSaveResp.m_status);
-    response.push_back(jsonResp);
+    m_history->flush();
 
-    return response;
+    return srrSaveResp;
 }
 
 dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
 {
-    bool restart = false;
-
     log_debug("SRR restore request");
 
-    SrrRestoreResponse srrRestoreResp;
+    auto           job = currentJob();
+    SrrTraceScope  trace(job, m_traceDirectory, "restore");
+    SrrMemoryScope memory(job, m_memoryBudget, "restore");
 
-    srrRestoreResp.m_status = statusToString(Status::FAILED);
+    SrrRestoreResponse srrRestoreResp;
 
     try {
-        cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
-        SrrRestoreRequest           srrRestoreReq;
-
-        requestSi >>= srrRestoreReq;
-
+        SrrRestoreRequest srrRestoreReq;
+        SrrMemoryCharge   payloadMemory; // payload of the request, held until the end of the restore
+        {
+            SrrSpan span(job, "parse", TRACE_PHASE);
+
+            SrrMemoryCharge             requestMemory(job, SrrMemoryKind::Serialization, json.size());
+            cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
+
+            // local bulk transfer: the backup is read from a file of the spool, only credentials come with the request
+            if (requestSi.findMember(SI_BULK) != nullptr) {
+                BulkDescriptor bulk;
+                requestSi.getMember(SI_BULK) >>= bulk;
+                log_debug("Reading restore payload from %s", bulk.m_path.c_str());
+
+                std::string passphrase;
+                std::string sessionToken;
+                requestSi.getMember(SI_PASSPHRASE) >>= passphrase;
+                requestSi.getMember(SESSION_TOKEN) >>= sessionToken;
+
+                const cxxtools::SerializationInfo* idempotencyKey = requestSi.findMember(SI_IDEMPOTENCY_KEY);
+                std::string                        key;
+                if (idempotencyKey != nullptr) {
+                    *idempotencyKey >>= key;
+                }
 
-        std::string passphrase = fty::decrypt(srrRestoreReq.m_checksum, srrRestoreReq.m_passphrase);
+                requestMemory = SrrMemoryCharge(job, SrrMemoryKind::Serialization, bulk.m_size);
+                requestSi     = readBulkJson(m_bulkSpool, bulk);
+                requestSi.addMember(SI_PASSPHRASE) <<= passphrase;
+                requestSi.addMember(SESSION_TOKEN) <<= sessionToken;
+                if (!key.empty()) {
+                    requestSi.addMember(SI_IDEMPOTENCY_KEY) <<= key;
+                }
+            }
 
-        if (passphrase.compare(srrRestoreReq.m_passphrase) != 0) {
-            throw std::runtime_error("Invalid passphrase");
+            requestSi >>= srrRestoreReq;
+            payloadMemory = SrrMemoryCharge(job, SrrMemoryKind::Dto, payloadBytes(srrRestoreReq));
         }
 
-        if (srrRestoreReq.m_version == "1.0") {
-            const auto& features = srrRestoreReq.m_data_ptr->getSrrFeatures();
+        auto cancellable = m_activeJobs.attach(srrRestoreReq.m_idempotencyKey);
 
-            bool allFeaturesRestored = true;
+        // a retried restore must not run twice: it gets the result of the first one
+        const std::string request = requestDigest(srrRestoreReq.m_idempotencyKey, json, force);
 
-            std::string featureName;
+        srrRestoreResp = m_restoreJobs.run(srrRestoreReq.m_idempotencyKey, request, true, [&]() {
+            return restore(srrRestoreReq, force);
+        });
+    } catch (const std::exception& e) {
+        srrRestoreResp.m_status = statusToString(Status::FAILED);
+        srrRestoreResp.m_error  = TRANSLATE_ME(e.what());
 
-            for (const auto& feature : features) {
-                featureName            = feature.m_feature_name;
-                const auto& dtoFeature = feature.m_feature_and_status.feature();
-                // prepare restore query
-                RestoreQuery query;
-                query.set_passpharse(srrRestoreReq.m_passphrase);
-                query.set_session_token(srrRestoreReq.m_sessionToken);
-                query.mutable_map_features_data()->insert({featureName, dtoFeature});
+        log_error(srrRestoreResp.m_error.c_str());
+    }
+    srrRestoreResp.m_memory = memory.usage();
 
-                RestoreStatus restoreStatus;
-                restoreStatus.m_name = featureName;
+    SrrSpan span(job, "serialization", TRACE_PHASE);
 
-                // save feature to perform a rollback in case of error
-                SaveResponse rollbackSaveResponse;
-                log_debug("Saving feature %s current status", feature.m_feature_name.c_str());
-                try {
-                    rollbackSaveResponse +=
-                        saveFeature(feature.m_feature_name, srrRestoreReq.m_passphrase, srrRestoreReq.m_sessionToken);
-                } catch (std::exception& ex) {
-                    allFeaturesRestored = false;
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrRestoreResp;
 
-                    restoreStatus.m_status = statusToString(Status::FAILED);
-                    restoreStatus.m_error =
-                        TRANSLATE_ME("Could not backup feature %s. Restore will be skipped", featureName.c_str());
+    dto::UserData response;
+    std::string   jsonResp = serializeJson(responseSi);
+    response.push_back(srrRestoreResp.m_status);
+    response.push_back(jsonResp);
 
-                    log_error(restoreStatus.m_error.c_str());
+    return response;
+}
 
-                    srrRestoreResp.m_status_list.push_back(restoreStatus);
+SrrRestoreResponse SrrWorker::restore(const SrrRestoreRequest& srrRestoreReq, bool force)
+{
+    bool restart = false;
 
-                    continue;
-                }
+    SrrRestoreResponse srrRestoreResp;
 
-                // reset feature before restore (do not stop on fail -> reset is not supported by every feature yet)
-                if (g_srrFeatureMap.at(featureName).m_reset) {
-                    try {
-                        resetFeature(featureName);
-                    } catch (SrrResetFailed& ex) {
-                        log_warning(ex.what());
-                    }
-                }
+    srrRestoreResp.m_status = statusToString(Status::FAILED);
 
-                // perform restore
-                try {
-                    RestoreResponse resp   = restoreFeature(featureName, query);
-                    restoreStatus.m_status = statusToString(resp.status().status());
-                    restoreStatus.m_error  = TRANSLATE_ME(resp.status().error().c_str());
-                } catch (SrrRestoreFailed& ex) {
-                    allFeaturesRestored = false;
+    // job of the request, the steps run in the event loop thread
+    auto job = currentJob();
 
-                    restoreStatus.m_status = statusToString(Status::FAILED);
-                    restoreStatus.m_error  = TRANSLATE_ME(ex.what());
+    // the configuration is about to change: the continuous backup must not be served anymore
+    invalidateContinuousBackup();
 
-                    log_error(restoreStatus.m_error.c_str());
+    try {
+        std::string passphrase = fty::decrypt(srrRestoreReq.m_checksum, srrRestoreReq.m_passphrase);
 
-                    srrRestoreResp.m_status_list.push_back(restoreStatus);
+        if (passphrase.compare(srrRestoreReq.m_passphrase) != 0) {
+            throw std::runtime_error("Invalid passphrase");
+        }
 
-                    // start rollback
-                    restart = restart | rollback(rollbackSaveResponse, srrRestoreReq.m_passphrase);
+        if (srrRestoreReq.m_version == "1.0") {
+            const auto&     features = srrRestoreReq.m_data_ptr->getSrrFeatures();
+            SrrMemoryCharge featuresMemory(job, SrrMemoryKind::Dto, payloadBytes(features));
 
-                    continue;
-                }
+            bool allFeaturesRestored = true;
 
-                srrRestoreResp.m_status_list.push_back(restoreStatus);
-                // wait to sync feature restore
-                std::this_thread::sleep_for(std::chrono::seconds(FEATURE_RESTORE_DELAY_SEC));
+            std::string featureName;
+
+            for (const auto& feature : features) {
+                // stop before the next feature: the restored ones are kept
+                jobCheckpoint();
+
+                featureName            = feature.m_feature_name;
+                const auto& dtoFeature = feature.m_feature_and_status.feature();
+                // prepare restore query
+                RestoreQuery query;
+                query.set_passpharse(srrRestoreReq.m_passphrase);
+                query.set_session_token(srrRestoreReq.m_sessionToken);
+                query.mutable_map_features_data()->insert({featureName, dtoFeature});
+                SrrMemoryCharge queryMemory(job, SrrMemoryKind::Protobuf, query.ByteSizeLong());
+
+                RestoreStatus restoreStatus;
+                restoreStatus.m_name = featureName;
+
+                // save feature to perform a rollback in case of error
+                SaveResponse                 rollbackSaveResponse;
+                std::vector<SrrMemoryCharge> rollbackMemory;
+                bool                         backupFailed  = false;
+                bool                         restoreFailed = false;
+
+                // run by the event loop, the locals outlive it as runSync waits for its end
+                Step featureRestore = sequence({
+                    call([&]() {
+                        log_debug("Saving feature %s current status", featureName.c_str());
+                    }),
+                    attempt(traced(job, "rollback snapshot", TRACE_PHASE,
+                                saveFeatureStep(featureName, srrRestoreReq.m_passphrase, srrRestoreReq.m_sessionToken,
+                                    job,
+                                    [&](const SaveResponse& saved) {
+                                        rollbackMemory.emplace_back(job, SrrMemoryKind::Rollback, saved.ByteSizeLong());
+                                        rollbackSaveResponse += saved;
+                                    })),
+                        [&](std::exception_ptr) {
+                            backupFailed        = true;
+                            allFeaturesRestored = false;
+
+                            restoreStatus.m_status = statusToString(Status::FAILED);
+                            restoreStatus.m_error  = TRANSLATE_ME(
+                                "Could not backup feature %s. Restore will be skipped", featureName.c_str());
+
+                            log_error(restoreStatus.m_error.c_str());
+
+                            srrRestoreResp.m_status_list.push_back(restoreStatus);
+                            return std::exception_ptr();
+                        }),
+                    when(
+                        [&]() {
+                            return !backupFailed;
+                        },
+                        sequence({
+                            // reset feature before restore (do not stop on fail -> reset is not supported by every
+                            // feature yet)
+                            when(
+                                [&]() {
+                                    return g_srrFeatureMap.at(featureName).m_reset;
+                                },
+                                attempt(resetFeatureStep(featureName, job), logWarning)),
+                            // perform restore (a cancellation from here rolls the feature back)
+                            attempt(restoreFeatureStep(featureName, query, "restore", job,
+                                        [&](const RestoreResponse& resp) {
+                                            restoreStatus.m_status = statusToString(resp.status().status());
+                                            restoreStatus.m_error  = TRANSLATE_ME(resp.status().error().c_str());
+                                        }),
+                                [&](std::exception_ptr error) {
+                                    restoreFailed       = true;
+                                    allFeaturesRestored = false;
+
+                                    restoreStatus.m_status = statusToString(Status::FAILED);
+                                    restoreStatus.m_error  = TRANSLATE_ME(errorMessage(error).c_str());
+
+                                    log_error(restoreStatus.m_error.c_str());
+
+                                    srrRestoreResp.m_status_list.push_back(restoreStatus);
+                                    return std::exception_ptr();
+                                }),
+                            defer([&]() {
+                                if (restoreFailed) {
+                                    // start rollback
+                                    return rollbackStep(rollbackSaveResponse, srrRestoreReq.m_passphrase, job, restart);
+                                }
+
+                                srrRestoreResp.m_status_list.push_back(restoreStatus);
+                                // wait to sync feature restore
+                                return restoreDelay(*m_loop, m_restoreDelay, job);
+                            }),
+                        })),
+                });
+
+                SrrSpan span(job, "feature " + featureName, TRACE_PHASE);
+                runSync(*m_loop, featureRestore);
             }
 
             if (allFeaturesRestored) {
@@ -513,7 +1285,8 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
             } else {
                 srrRestoreResp.m_status = statusToString(Status::PARTIAL_SUCCESS);
             }
-        } else if (srrRestoreReq.m_version == "2.0" || srrRestoreReq.m_version == "2.1") {
+        } else if (srrRestoreReq.m_version == "2.0" || srrRestoreReq.m_version == "2.1" ||
+                   srrRestoreReq.m_version == "2.2") {
             std::list<std::string> groupsIntegrityCheckFailed; // stores groups for which integrity check failed
 
             std::shared_ptr<SrrRestoreRequestDataV2> dataPtr =
@@ -541,14 +1314,33 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
                 });
             }
 
+            // features which failed the integrity check (merkle scheme only), by group
+            std::map<std::string, std::vector<std::string>> corruptedFeatures;
+
             // data integrity check
             if (force) {
                 log_warning("Restoring with force option: data integrity check will be skipped");
             } else {
                 // features in each group must be sorted by priority to evaluate correctly the data integrity
+                SrrSpan  span(job, "integrity check", TRACE_PHASE);
+                SrrTimer timer(metrics().m_integrityCheckMs);
                 for (auto& group : groups) {
-                    // check data integrity
-                    if (!checkDataIntegrity(group)) {
+                    if (group.m_integrity_scheme == INTEGRITY_SCHEME_MERKLE) {
+                        // corrupted features are left out, the intact ones can still be restored
+                        std::vector<std::string> corrupted = checkFeaturesIntegrity(group);
+                        if (!corrupted.empty()) {
+                            log_error("Integrity check failed in group %s for features:%s", group.m_group_id.c_str(),
+                                std::accumulate(corrupted.begin(), corrupted.end(), std::string(" ")).c_str());
+
+                            group.m_features.erase(std::remove_if(group.m_features.begin(), group.m_features.end(),
+                                                       [&](const SrrFeature& f) {
+                                                           return std::find(corrupted.begin(), corrupted.end(),
+                                                                      f.m_feature_name) != corrupted.end();
+                                                       }),
+                                group.m_features.end());
+                            corruptedFeatures[group.m_group_id] = corrupted;
+                        }
+                    } else if (!checkDataIntegrity(group)) {
                         log_error("Integrity check failed for group %s", group.m_group_id.c_str());
                         groupsIntegrityCheckFailed.push_back(group.m_group_id);
                     }
@@ -564,12 +1356,14 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
 
 
             // start restore procedure
-            RestoreResponse response;
-            bool            allGroupsRestored = true;
+            bool allGroupsRestored = true;
 
             for (const auto& group : groups) {
                 const auto& groupId = group.m_group_id;
 
+                // stop before the next group: the restored ones are kept
+                jobCheckpoint();
+
                 if (g_srrGroupMap.find(group.m_group_id) == g_srrGroupMap.end()) {
                     RestoreStatus restoreStatus;
                     restoreStatus.m_name   = groupId;
@@ -585,27 +1379,48 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
                     continue;
                 }
 
-                std::map<std::string, dto::srr::FeatureAndStatus> ftMap;
+                // report every feature left out by the integrity check
+                std::set<std::string> corrupted;
+                if (auto found = corruptedFeatures.find(groupId); found != corruptedFeatures.end()) {
+                    corrupted.insert(found->second.begin(), found->second.end());
+                    for (const auto& featureName : found->second) {
+                        RestoreStatus restoreStatus;
+                        restoreStatus.m_name   = featureName;
+                        restoreStatus.m_status = statusToString(Status::FAILED);
+                        restoreStatus.m_error  = TRANSLATE_ME(
+                            "Integrity check failed for feature %s. Will not be restored", featureName.c_str());
+
+                        srrRestoreResp.m_status_list.push_back(restoreStatus);
+
+                        log_error(restoreStatus.m_error.c_str());
+                    }
+                    allGroupsRestored = false;
+                }
+
+                // features of the payload by name, not copied
+                std::map<std::string, const dto::srr::FeatureAndStatus*> ftMap;
                 for (const auto& feature : group.m_features) {
-                    ftMap[feature.m_feature_name] = feature.m_feature_and_status;
+                    ftMap[feature.m_feature_name] = &feature.m_feature_and_status;
                 }
 
                 // create all restore queries related to the current group
                 // it helps to detect at an early stage if there are features missing in the restore payload
                 std::map<FeatureName, RestoreQuery> restoreQueriesMap;
+                std::vector<SrrMemoryCharge>        queriesMemory;
 
                 try {
                     // loop through all required features to create the restore queries
                     for (const auto& feature : g_srrGroupMap.at(groupId).m_fp) {
                         const auto& featureName = feature.m_feature;
                         try {
-                            const auto& dtoFeature = ftMap.at(featureName).feature();
+                            const auto& dtoFeature = ftMap.at(featureName)->feature();
 
                             // prepare restore queries
                             RestoreQuery& request = restoreQueriesMap[featureName];
                             request.set_passpharse(srrRestoreReq.m_passphrase);
                             request.set_session_token(srrRestoreReq.m_sessionToken);
                             request.mutable_map_features_data()->insert({featureName, dtoFeature});
+                            queriesMemory.emplace_back(job, SrrMemoryKind::Protobuf, request.ByteSizeLong());
                         } catch (const std::out_of_range& e) {
                             // missing feature, check if it required in restore payload version
                             const auto requiredIn = g_srrFeatureMap.at(featureName).m_requiredIn;
@@ -613,7 +1428,8 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
                                 found != requiredIn.end()) {
                                 log_error("Feature %s is required in version %s", featureName.c_str(),
                                     srrRestoreReq.m_version.c_str());
-                                throw std::runtime_error(
+                                // thrown from the handler: caught below, for the whole group
+                                throw std::out_of_range(
                                     "Feature " + featureName + " is required in version " + srrRestoreReq.m_version);
                             }
                         } catch (const std::exception& e) {
@@ -639,69 +1455,264 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
                 // get list of features in the group (based on current version)
                 const auto featureList = g_srrGroupMap.at(group.m_group_id).m_fp;
 
-                // save group status to perform a rollback in case of error
-                SaveResponse rollbackSaveResponse;
-                try {
-                    for (const auto& feature : featureList) {
-                        log_debug("Saving feature %s current status", feature.m_feature.c_str());
-                        rollbackSaveResponse +=
-                            saveFeature(feature.m_feature, srrRestoreReq.m_passphrase, srrRestoreReq.m_sessionToken);
-                    }
-                } catch (std::exception& ex) {
-                    log_error("Could not backup feature %s", groupId.c_str());
-                }
-
-                // reset features in reverse order before restore
-                // WARNING: currently reset is not implemented by all features, hence it will not be mandatory
-                for (auto revIt = featureList.rbegin(); revIt != featureList.rend(); revIt++) {
-                    if (g_srrFeatureMap.at(revIt->m_feature).m_reset) {
-                        try {
-                            resetFeature(revIt->m_feature);
-                        } catch (SrrResetFailed& ex) {
-                            log_warning(ex.what());
-                        }
-                    }
-                }
-
-                bool restoreFailed = false;
-
                 RestoreStatus restoreStatus;
                 restoreStatus.m_name   = groupId;
                 restoreStatus.m_status = statusToString(Status::SUCCESS);
 
-                // restore features in order
-                for (const auto& feature : group.m_features) {
-                    const auto& featureName = feature.m_feature_name;
+                std::vector<FeatureName>     preparedFeatures;
+                SaveResponse                 rollbackSaveResponse;
+                std::vector<SrrMemoryCharge> rollbackMemory;
+                FeatureName                  currentFeature;
+                size_t                       committed     = 0;
+                bool                         prepareFailed = false;
+                bool                         restoreFailed = false;
+                bool                         commitFailed  = false;
+                std::exception_ptr           cancelled;
+                std::exception_ptr           memoryExceeded;
+
+                auto isPrepared = [&](const FeatureName& featureName) {
+                    return std::find(preparedFeatures.begin(), preparedFeatures.end(), featureName) !=
+                           preparedFeatures.end();
+                };
+
+                // feature which failed the restore of the group
+                auto setFailed = [&](std::exception_ptr error) {
+                    restoreStatus.m_status = statusToString(Status::FAILED);
+                    restoreStatus.m_error  = TRANSLATE_ME(
+                        "Restore failed for feature %s: %s", currentFeature.c_str(), errorMessage(error).c_str());
 
-                    try {
-                        // Restore feature
-                        response += restoreFeature(featureName, restoreQueriesMap[featureName]);
+                    log_error(restoreStatus.m_error.c_str());
+                };
+
+                // two-phase restore: agents supporting it validate and stage their payload first, while still
+                // serving the current configuration. Nothing is changed on the appliance if one of them refuses.
+                Step prepare = traced(job, "prepare", TRACE_PHASE,
+                    forEach(group.m_features.size(), [&](size_t i) {
+                        const auto& featureName = group.m_features[i].m_feature_name;
+                        if (!m_twoPhaseRestore || m_twoPhaseFeatures.count(featureName) == 0) {
+                            return noop();
+                        }
 
-                        // update restart flag
-                        restart = restart | g_srrFeatureMap.at(featureName).m_restart;
-                    } catch (const std::exception& ex) {
-                        // restore failed -> rolling back the whole group
-                        restoreFailed = true;
+                        currentFeature = featureName;
+                        return sequence({
+                            checkpointStep(job),
+                            restoreFeatureStep(featureName, restoreQueriesMap[featureName], "prepare", job,
+                                [&, featureName](const RestoreResponse&) {
+                                    preparedFeatures.push_back(featureName);
+                                }),
+                        });
+                    }));
+
+                // save group status to perform a rollback in case of error (prepared features are rolled back by abort)
+                // corrupted features are not restored: their current status is kept as is
+                std::vector<std::string> backupFeatures;
+                for (const auto& feature : featureList) {
+                    if (corrupted.count(feature.m_feature) == 0) {
+                        backupFeatures.push_back(feature.m_feature);
+                    }
+                }
+                const std::vector<size_t> backupOrder = m_history->longestFirst(backupFeatures, HISTORY_SAVE);
 
-                        restoreStatus.m_status = statusToString(Status::FAILED);
-                        restoreStatus.m_error =
-                            TRANSLATE_ME("Restore failed for feature %s: ", featureName.c_str(), ex.what());
+                Step backup = traced(job, "rollback snapshot", TRACE_PHASE,
+                    parallel(backupOrder.size(), m_concurrency, [&](size_t i) {
+                        const auto& featureName = backupFeatures[backupOrder[i]];
+                        if (isPrepared(featureName)) {
+                            return noop();
+                        }
 
-                        allGroupsRestored = false;
-                        log_error(restoreStatus.m_error.c_str());
+                        log_debug("Saving feature %s current status", featureName.c_str());
+                        return saveFeatureStep(featureName, srrRestoreReq.m_passphrase, srrRestoreReq.m_sessionToken,
+                            job, [&](const SaveResponse& saved) {
+                                rollbackMemory.emplace_back(job, SrrMemoryKind::Rollback, saved.ByteSizeLong());
+                                rollbackSaveResponse += saved;
+                            });
+                    }));
 
-                        // stop group restore
-                        break;
+                // reset features in reverse order before restore
+                // WARNING: currently reset is not implemented by all features, hence it will not be mandatory
+                // a cancellation during the reset is caught by the restore below, which rolls the group back
+                Step reset = traced(job, "reset", TRACE_PHASE, forEach(featureList.size(), [&](size_t i) {
+                    const auto& featureName = featureList[featureList.size() - 1 - i].m_feature;
+                    if (!g_srrFeatureMap.at(featureName).m_reset || isPrepared(featureName) ||
+                        corrupted.count(featureName) != 0) {
+                        return noop();
                     }
+                    return attempt(resetFeatureStep(featureName, job), logWarning);
+                }));
 
-                    // wait to sync feature restore
-                    std::this_thread::sleep_for(std::chrono::seconds(FEATURE_RESTORE_DELAY_SEC));
-                }
+                // restore features in order
+                Step restoreFeatures = traced(job, "restore", TRACE_PHASE,
+                    forEach(group.m_features.size(), [&](size_t i) {
+                        const auto& featureName = group.m_features[i].m_feature_name;
+                        if (isPrepared(featureName)) {
+                            return noop();
+                        }
 
-                // if restore failed -> rollback
-                if (restoreFailed) {
-                    restart = restart | rollback(rollbackSaveResponse, srrRestoreReq.m_passphrase);
-                }
+                        currentFeature   = featureName;
+                        const auto start = m_clock->now();
+                        const size_t size =
+                            group.m_features[i].m_feature_and_status.feature().data().size();
+
+                        return sequence({
+                            checkpointStep(job),
+                            restoreFeatureStep(featureName, restoreQueriesMap[featureName], "restore", job,
+                                [&, featureName, start, size](const RestoreResponse&) {
+                                    m_history->record(featureName, HISTORY_RESTORE,
+                                        std::chrono::milliseconds(elapsedMs(*m_clock, start)), size);
+
+                                    // update restart flag
+                                    restart = restart | g_srrFeatureMap.at(featureName).m_restart;
+                                }),
+                            // wait to sync feature restore
+                            restoreDelay(*m_loop, m_restoreDelay, job),
+                        });
+                    }));
+
+                // switch all the prepared features at once, in priority order. Once started, the switch is not
+                // cancelled.
+                auto commit = [&]() {
+                    return forEach(preparedFeatures.size(), [&](size_t i) {
+                        currentFeature = preparedFeatures[i];
+                        committed      = i;
+                        return sequence({
+                            phaseStep(currentFeature, "commit", srrRestoreReq.m_sessionToken, job),
+                            call([&]() {
+                                restart = restart | g_srrFeatureMap.at(currentFeature).m_restart;
+                            }),
+                        });
+                    });
+                };
+
+                auto onCommitFailed = [&](std::exception_ptr error) {
+                    // already committed features keep their validated payload
+                    commitFailed      = true;
+                    allGroupsRestored = false;
+                    setFailed(error);
+                    return std::exception_ptr();
+                };
+                auto abortUncommitted = [&]() {
+                    // the feature whose commit failed is still prepared
+                    const std::vector<FeatureName> uncommitted(
+                        preparedFeatures.begin() + committed, preparedFeatures.end());
+                    return abortStep(uncommitted, srrRestoreReq.m_sessionToken, job);
+                };
+
+                // run by the event loop: requests and delays of the group do not hold a thread. The locals outlive
+                // the steps as runSync waits for their end.
+                Step groupRestore = sequence({
+                    attempt(prepare,
+                        [&](std::exception_ptr error) {
+                            prepareFailed = true;
+                            setFailed(error);
+                            return std::exception_ptr();
+                        }),
+                    when(
+                        [&]() {
+                            return prepareFailed;
+                        },
+                        sequence({
+                            defer([&]() {
+                                return abortStep(preparedFeatures, srrRestoreReq.m_sessionToken, job);
+                            }),
+                            call([&]() {
+                                allGroupsRestored = false;
+                            }),
+                        })),
+                    when(
+                        [&]() {
+                            return !prepareFailed;
+                        },
+                        sequence({
+                            attempt(backup,
+                                [&](std::exception_ptr error) {
+                                    // without its complete rollback snapshot, the group is left untouched
+                                    if (isMemoryExceeded(error)) {
+                                        memoryExceeded = error;
+                                        return std::exception_ptr();
+                                    }
+                                    log_error("Could not backup feature %s", groupId.c_str());
+                                    return std::exception_ptr();
+                                }),
+                            // last point where the group can be left untouched
+                            attempt(checkpointStep(job),
+                                [&](std::exception_ptr error) {
+                                    cancelled = error;
+                                    return std::exception_ptr();
+                                }),
+                            when(
+                                [&]() {
+                                    return cancelled != nullptr;
+                                },
+                                sequence({
+                                    defer([&]() {
+                                        return abortStep(preparedFeatures, srrRestoreReq.m_sessionToken, job);
+                                    }),
+                                    call([&]() {
+                                        std::rethrow_exception(cancelled);
+                                    }),
+                                })),
+                            // the rest of the groups can still be restored
+                            when(
+                                [&]() {
+                                    return cancelled == nullptr && memoryExceeded != nullptr;
+                                },
+                                sequence({
+                                    defer([&]() {
+                                        return abortStep(preparedFeatures, srrRestoreReq.m_sessionToken, job);
+                                    }),
+                                    call([&]() {
+                                        allGroupsRestored      = false;
+                                        restoreStatus.m_status = statusToString(Status::FAILED);
+                                        restoreStatus.m_error  = TRANSLATE_ME("Group %s left untouched: %s",
+                                            groupId.c_str(),
+                                            errorMessage(memoryExceeded).c_str());
+
+                                        log_error(restoreStatus.m_error.c_str());
+                                    }),
+                                })),
+                            when(
+                                [&]() {
+                                    return memoryExceeded == nullptr;
+                                },
+                                sequence({
+                                    reset,
+                                    attempt(restoreFeatures,
+                                        [&](std::exception_ptr error) {
+                                            // restore failed -> rolling back the whole group
+                                            restoreFailed     = true;
+                                            allGroupsRestored = false;
+                                            setFailed(error);
+                                            return std::exception_ptr();
+                                        }),
+                                    defer([&]() {
+                                        // if restore failed -> rollback
+                                        if (restoreFailed) {
+                                            return sequence({
+                                                abortStep(preparedFeatures, srrRestoreReq.m_sessionToken, job),
+                                                rollbackStep(
+                                                    rollbackSaveResponse, srrRestoreReq.m_passphrase, job, restart),
+                                            });
+                                        }
+                                        if (preparedFeatures.empty()) {
+                                            return noop();
+                                        }
+                                        return sequence({
+                                            recoveryStep(job, attempt(commit(), onCommitFailed)),
+                                            when(
+                                                [&]() {
+                                                    return commitFailed;
+                                                },
+                                                defer(abortUncommitted)),
+                                            // wait to sync feature restore
+                                            restoreDelay(*m_loop, m_restoreDelay, job),
+                                        });
+                                    }),
+                                })),
+                        })),
+                });
+
+                SrrSpan span(job, "group " + groupId, TRACE_PHASE);
+                runSync(*m_loop, groupRestore);
 
                 // push group status into restore response
                 srrRestoreResp.m_status_list.push_back(restoreStatus);
@@ -727,23 +1738,614 @@ dto::UserData SrrWorker::requestRestore(const std::string& json, bool force)
         log_error(srrRestoreResp.m_error.c_str());
     }
 
+    if (restart) {
+        if (m_parameters.at(ENABLE_REBOOT_KEY) == "true") {
+            // the events before the reboot must reach the disk
+            flightRecorder().record(SrrFlightEvent(SrrFlightEventType::Restart, job ? job->id() : "", "reboot"));
+            flightRecorder().sync();
+
+            m_loop->post([this]() {
+                restartCountdown(SRR_RESTART_DELAY_SEC);
+            });
+        } else {
+            log_warning("Reboot is disabled in current configuration");
+        }
+    }
+
+    m_history->flush();
+
+    return srrRestoreResp;
+}
+
+std::string SrrWorker::featureRevision(const dto::srr::FeatureName& featureName)
+{
+    const auto& feature = g_srrFeatureMap.at(featureName);
+    if (!feature.m_revision) {
+        return "";
+    }
+
+    const std::string& agentNameDest = feature.m_agent;
+
+    {
+        std::lock_guard<std::mutex> lock(m_revisionMutex);
+        if (m_revisionUnsupported.count(agentNameDest) != 0) {
+            return "";
+        }
+    }
+
+    // out of the try: a cancelled job must not mark the agent as unsupported
+    const int timeout = jobTimeout(REVISION_PROBE_TIMEOUT_SEC);
+
+    try {
+        dto::UserData data;
+        data.push_back(featureName);
+
+        auto message = std::make_shared<messagebus::Message>();
+        runSync(*m_loop, agentRequest(featureName, agentNameDest, "revision", data, nullptr, timeout, message));
+
+        if (!message->userData().empty() && !message->userData().front().empty()) {
+            return message->userData().front();
+        }
+        log_warning("Empty revision of feature %s", featureName.c_str());
+    } catch (const std::exception& ex) {
+        // do not probe this agent anymore: every save would wait for the probe timeout
+        log_warning(
+            "Revision probe failed for agent %s, full fetch will be used: %s", agentNameDest.c_str(), ex.what());
+
+        std::lock_guard<std::mutex> lock(m_revisionMutex);
+        m_revisionUnsupported.insert(agentNameDest);
+    }
+
+    return "";
+}
+
+void SrrWorker::loadIncrementalBase(const std::string& passphrase, std::map<std::string, SrrFeature>& features,
+    std::map<std::string, std::string>& revisions)
+{
+    if (!m_store) {
+        log_warning("Local store is disabled: incremental save falls back to a full save");
+        return;
+    }
+
+    try {
+        const std::vector<SnapshotInfo> snapshots = m_store->list();
+        if (snapshots.empty()) {
+            log_info("No snapshot available: incremental save falls back to a full save");
+            return;
+        }
+
+        std::map<std::string, std::string> snapshotRevisions;
+        SrrSaveResponse                    payload = m_store->load(snapshots.front().m_id, &snapshotRevisions);
+
+        // feature data are encrypted with the passphrase: they can only be reused with the same one
+        std::string snapshotPassphrase;
+        try {
+            snapshotPassphrase = fty::decrypt(payload.m_checksum, passphrase);
+        } catch (const std::exception&) {
+        }
+        if (snapshotPassphrase != passphrase) {
+            log_info("Snapshot %s has another passphrase: incremental save falls back to a full save",
+                snapshots.front().m_id.c_str());
+            return;
+        }
+
+        for (auto& group : payload.m_data) {
+            for (auto& feature : group.m_features) {
+                features[feature.m_feature_name] = feature;
+            }
+        }
+        revisions = std::move(snapshotRevisions);
+
+        log_debug("Incremental save based on snapshot %s", snapshots.front().m_id.c_str());
+    } catch (const std::exception& ex) {
+        features.clear();
+        revisions.clear();
+        log_warning("Cannot load the latest snapshot, incremental save falls back to a full save: %s", ex.what());
+    }
+}
+
+dto::UserData SrrWorker::requestSnapshot(const std::string& json)
+{
+    log_debug("SRR snapshot request");
+
+    SrrSnapshotResponse srrSnapshotResp;
+    srrSnapshotResp.m_status = statusToString(Status::FAILED);
+
+    SrrMemoryScope memory(currentJob(), m_memoryBudget, "snapshot");
+
+    try {
+        if (!m_store) {
+            throw SrrException("Local store is disabled");
+        }
+
+        cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
+        SrrSaveRequest              srrSaveReq;
+
+        requestSi >>= srrSaveReq;
+
+        auto cancellable = m_activeJobs.attach(srrSaveReq.m_idempotencyKey);
+
+        srrSnapshotResp = m_snapshotJobs.run(srrSaveReq.m_idempotencyKey, saveRequestDigest(srrSaveReq), true, [&]() {
+            std::map<std::string, std::string> revisions;
+
+            SrrSaveResponse srrSaveResp = save(srrSaveReq, &revisions);
+            if (srrSaveResp.m_status == statusToString(Status::FAILED)) {
+                throw SrrException(srrSaveResp.m_error);
+            }
+
+            SrrSnapshotResponse resp;
+            resp.m_snapshot = m_store->store(srrSaveResp, revisions);
+            resp.m_status   = srrSaveResp.m_status;
+            resp.m_error    = srrSaveResp.m_error;
+            return resp;
+        });
+    } catch (const std::exception& e) {
+        srrSnapshotResp.m_error = TRANSLATE_ME("Exception on snapshot: (%s)", e.what());
+        log_error(srrSnapshotResp.m_error.c_str());
+    }
+    srrSnapshotResp.m_memory = memory.usage();
+
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrSnapshotResp;
+
+    dto::UserData response;
+    response.push_back(srrSnapshotResp.m_status);
+    response.push_back(serializeJson(responseSi));
+
+    return response;
+}
+
+dto::UserData SrrWorker::requestListSnapshots()
+{
+    log_debug("SRR list snapshots request");
+
+    if (!m_store) {
+        throw SrrException("Local store is disabled");
+    }
+
+    SrrSnapshotListResponse srrListResp;
+    srrListResp.m_snapshots = m_store->list();
+
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrListResp;
+
+    dto::UserData response;
+    response.push_back(serializeJson(responseSi));
+
+    return response;
+}
+
+dto::UserData SrrWorker::requestRestoreSnapshot(const std::string& json, bool force)
+{
+    log_debug("SRR restore snapshot request");
+
+    SrrRestoreResponse srrRestoreResp;
+
+    auto           job = currentJob();
+    SrrMemoryScope memory(job, m_memoryBudget, "restore-snapshot");
+
+    try {
+        if (!m_store) {
+            throw SrrException("Local store is disabled");
+        }
+
+        cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
+        SrrRestoreSnapshotRequest   srrSnapshotReq;
+
+        requestSi >>= srrSnapshotReq;
+
+        auto cancellable = m_activeJobs.attach(srrSnapshotReq.m_idempotencyKey);
+
+        // the stored payload replaces the one a restore request would upload
+        SrrSaveResponse payload = m_store->load(srrSnapshotReq.m_snapshotId);
+
+        std::shared_ptr<SrrRestoreRequestDataV2> dataPtr(new SrrRestoreRequestDataV2);
+        dataPtr->m_data = std::move(payload.m_data);
+
+        SrrMemoryCharge payloadMemory(job, SrrMemoryKind::Dto, payloadBytes(dataPtr->m_data));
+
+        SrrRestoreRequest srrRestoreReq;
+        srrRestoreReq.m_version      = payload.m_version;
+        srrRestoreReq.m_checksum     = payload.m_checksum;
+        srrRestoreReq.m_passphrase   = srrSnapshotReq.m_passphrase;
+        srrRestoreReq.m_sessionToken = srrSnapshotReq.m_sessionToken;
+        srrRestoreReq.m_data_ptr     = dataPtr;
+
+        const std::string request = requestDigest(srrSnapshotReq.m_idempotencyKey, json, force);
+
+        srrRestoreResp = m_restoreJobs.run(srrSnapshotReq.m_idempotencyKey, request, true, [&]() {
+            return restore(srrRestoreReq, force);
+        });
+    } catch (const std::exception& e) {
+        srrRestoreResp.m_status = statusToString(Status::FAILED);
+        srrRestoreResp.m_error  = TRANSLATE_ME(e.what());
+
+        log_error(srrRestoreResp.m_error.c_str());
+    }
+    srrRestoreResp.m_memory = memory.usage();
+
     cxxtools::SerializationInfo responseSi;
     responseSi <<= srrRestoreResp;
 
     dto::UserData response;
-    std::string   jsonResp = serializeJson(responseSi);
     response.push_back(srrRestoreResp.m_status);
-    response.push_back(jsonResp);
+    response.push_back(serializeJson(responseSi));
 
-    if (restart) {
-        if (m_parameters.at(ENABLE_REBOOT_KEY) == "true") {
-            std::thread restartThread(restartBiosService, SRR_RESTART_DELAY_SEC);
-            restartThread.detach();
-        } else {
-            log_warning("Reboot is disabled in current configuration");
+    return response;
+}
+
+std::string SrrWorker::saveJobKey(const SrrSaveRequest& srrSaveReq)
+{
+    if (!srrSaveReq.m_idempotencyKey.empty()) {
+        return "key:" + srrSaveReq.m_idempotencyKey;
+    }
+    return "save:" + saveRequestDigest(srrSaveReq);
+}
+
+std::string SrrWorker::saveRequestDigest(const SrrSaveRequest& srrSaveReq)
+{
+    // identical requests: same credentials and same groups, the bulk file of each request is written separately
+    std::string request = srrSaveReq.m_passphrase + "\n" + srrSaveReq.m_sessionToken + "\n" +
+                          (srrSaveReq.m_incremental ? "incremental" : "full");
+    for (const auto& groupId : srrSaveReq.m_group_list) {
+        request += "\n" + groupId;
+    }
+
+    return evalSha256(request);
+}
+
+std::string SrrWorker::requestDigest(const std::string& key, const std::string& json, bool force)
+{
+    // without key, the request is not registered
+    if (key.empty()) {
+        return "";
+    }
+    return evalSha256(json) + (force ? ":force" : "");
+}
+
+bool SrrWorker::isContinuousBackupEnabled() const
+{
+    return m_continuousBackup;
+}
+
+bool SrrWorker::cachedSave(const SrrSaveRequest& srrSaveReq, std::string& json)
+{
+    if (!m_continuousBackup) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_continuousMutex);
+
+        const std::set<std::string> requested(srrSaveReq.m_group_list.begin(), srrSaveReq.m_group_list.end());
+        const std::set<std::string> cached(
+            m_continuous.m_request.m_group_list.begin(), m_continuous.m_request.m_group_list.end());
+
+        // feature data are encrypted with the passphrase: only a save with the same one can be answered
+        if (!m_continuous.m_valid || requested != cached ||
+            srrSaveReq.m_passphrase != m_continuous.m_request.m_passphrase) {
+            return false;
+        }
+    }
+
+    // a feature without revision is saved again on every update: the full save is not slower
+    for (const auto& groupId : srrSaveReq.m_group_list) {
+        for (const auto& entry : g_srrGroupMap.at(groupId).m_fp) {
+            if (!g_srrFeatureMap.at(entry.m_feature).m_revision) {
+                return false;
+            }
+        }
+    }
+
+    // the session of the caller is checked by the agents and the features changed since the last refresh are saved
+    // again: the answer is never older than this request
+    if (!updateContinuousBackup(&srrSaveReq, &json)) {
+        return false;
+    }
+
+    log_debug("Save answered from the continuous backup");
+
+    return true;
+}
+
+void SrrWorker::armContinuousBackup(const SrrSaveRequest& srrSaveReq, const SrrSaveResponse& srrSaveResp,
+    const std::map<std::string, std::string>& revisions)
+{
+    if (!m_continuousBackup || srrSaveResp.m_status != statusToString(Status::SUCCESS)) {
+        return;
+    }
+
+    // only a save of every group is kept
+    const std::set<std::string> requested(srrSaveReq.m_group_list.begin(), srrSaveReq.m_group_list.end());
+    if (requested.size() != g_srrGroupMap.size()) {
+        return;
+    }
+    for (const auto& group : g_srrGroupMap) {
+        if (requested.count(group.first) == 0) {
+            return;
+        }
+    }
+
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrSaveResp;
+    std::string json = serializeJson(responseSi);
+
+    SrrSaveRequest request = srrSaveReq;
+    request.m_bulk         = BulkDescriptor();
+
+    std::lock_guard<std::mutex> lock(m_continuousMutex);
+
+    m_continuous.m_request   = request;
+    m_continuous.m_response  = srrSaveResp;
+    m_continuous.m_json      = std::move(json);
+    m_continuous.m_revisions = revisions;
+    m_continuous.m_valid     = true;
+    ++m_continuous.m_generation;
+
+    log_debug("Continuous backup armed");
+}
+
+void SrrWorker::invalidateContinuousBackup()
+{
+    std::lock_guard<std::mutex> lock(m_continuousMutex);
+
+    if (m_continuous.m_valid) {
+        log_debug("Continuous backup invalidated");
+    }
+
+    // the passphrase is not kept in memory longer than needed
+    const uint64_t generation = m_continuous.m_generation;
+    m_continuous              = ContinuousBackup();
+    m_continuous.m_generation = generation + 1;
+}
+
+void SrrWorker::refreshContinuousBackup()
+{
+    updateContinuousBackup(nullptr, nullptr);
+}
+
+bool SrrWorker::updateContinuousBackup(const SrrSaveRequest* caller, std::string* json)
+{
+    SrrSaveRequest                     request;
+    std::map<std::string, std::string> revisions;
+    uint64_t                           generation;
+    std::string                        smallest; // feature saved to check the session if none changed
+    {
+        std::lock_guard<std::mutex> lock(m_continuousMutex);
+        if (!m_continuous.m_valid) {
+            return false;
+        }
+        request    = m_continuous.m_request;
+        revisions  = m_continuous.m_revisions;
+        generation = m_continuous.m_generation;
+
+        if (caller != nullptr) {
+            request.m_sessionToken = caller->m_sessionToken;
+
+            size_t smallestSize = 0;
+            for (const auto& group : m_continuous.m_response.m_data) {
+                for (const auto& feature : group.m_features) {
+                    const size_t size = feature.m_feature_and_status.feature().data().size();
+                    if (smallest.empty() || size < smallestSize) {
+                        smallest     = feature.m_feature_name;
+                        smallestSize = size;
+                    }
+                }
+            }
+        }
+    }
+
+    log_debug(caller != nullptr ? "Continuous backup update" : "Continuous backup refresh");
+
+    // features saved again, by name
+    std::map<std::string, SrrFeature> updated;
+
+    try {
+        // features to save again
+        std::vector<std::string> toSave;
+
+        for (const auto& groupId : request.m_group_list) {
+            for (const auto& entry : g_srrGroupMap.at(groupId).m_fp) {
+                const auto& featureName = entry.m_feature;
+
+                // without revision, a feature can't tell if it changed: it is saved again
+                std::string revision = featureRevision(featureName);
+                auto        known    = revisions.find(featureName);
+                if (!revision.empty() && known != revisions.end() && known->second == revision) {
+                    continue;
+                }
+
+                toSave.push_back(featureName);
+
+                if (revision.empty()) {
+                    revisions.erase(featureName);
+                } else {
+                    revisions[featureName] = revision;
+                }
+            }
+        }
+
+        // the agents check the session token of a save: at least one is needed before answering the caller
+        if (caller != nullptr && toSave.empty() && !smallest.empty()) {
+            toSave.push_back(smallest);
+        }
+
+        auto job = currentJob();
+
+        // same fan-out as a full save
+        runSync(*m_loop, parallel(toSave.size(), m_concurrency, [&](size_t i) {
+            auto onSaved = [&](const SaveResponse& saveResp) {
+                for (const auto& fs : saveResp.map_features_data()) {
+                    SrrFeature f;
+                    f.m_feature_name       = fs.first;
+                    f.m_feature_and_status = fs.second;
+                    f.m_base64Data         = hasBase64Data(m_srrVersion);
+
+                    updated[fs.first] = f;
+                }
+            };
+            return saveFeatureStep(toSave[i], request.m_passphrase, request.m_sessionToken, job, onSaved);
+        }));
+    } catch (const std::exception& e) {
+        if (caller != nullptr) {
+            // refused session or unavailable agent: the request runs a full save, the backup is kept for the others
+            log_warning("Continuous backup not used: %s", e.what());
+            return false;
+        }
+        // a stale payload must not be served, the next save will do a full one
+        log_warning("Continuous backup refresh failed: %s", e.what());
+        invalidateContinuousBackup();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_continuousMutex);
+
+    // armed again or invalidated during the refresh
+    if (!m_continuous.m_valid || m_continuous.m_generation != generation) {
+        return false;
+    }
+
+    if (updated.empty()) {
+        log_debug("Continuous backup is up to date");
+    } else {
+        for (auto& group : m_continuous.m_response.m_data) {
+            bool changed = false;
+            for (auto& feature : group.m_features) {
+                auto f = updated.find(feature.m_feature_name);
+                if (f != updated.end()) {
+                    feature = f->second;
+                    changed = true;
+                }
+            }
+            if (changed) {
+                evalDataIntegrity(group);
+            }
+        }
+
+        cxxtools::SerializationInfo responseSi;
+        responseSi <<= m_continuous.m_response;
+
+        m_continuous.m_json      = serializeJson(responseSi);
+        m_continuous.m_revisions = std::move(revisions);
+        ++m_continuous.m_generation;
+
+        log_debug("Continuous backup refreshed (%zu features)", updated.size());
+    }
+
+    if (caller != nullptr) {
+        // checked by the agents: the background refreshes go on with the most recent session
+        m_continuous.m_request.m_sessionToken = caller->m_sessionToken;
+    }
+    if (json != nullptr) {
+        *json = m_continuous.m_json;
+    }
+
+    return true;
+}
+
+dto::UserData SrrWorker::requestEstimate(const std::string& json)
+{
+    log_debug("SRR estimate request");
+
+    SrrEstimateResponse srrEstimateResp;
+
+    try {
+        cxxtools::SerializationInfo requestSi = dto::srr::deserializeJson(json);
+        SrrEstimateRequest          srrEstimateReq;
+
+        requestSi >>= srrEstimateReq;
+
+        const std::string& operation = srrEstimateReq.m_operation;
+        if (operation != HISTORY_SAVE && operation != HISTORY_RESTORE) {
+            throw SrrException("Unknown operation " + operation);
         }
+        srrEstimateResp.m_operation = operation;
+
+        for (const auto& groupId : srrEstimateReq.m_group_list) {
+            auto group = g_srrGroupMap.find(groupId);
+            if (group == g_srrGroupMap.end()) {
+                throw SrrException("Group " + groupId + " not found");
+            }
+
+            GroupEstimate groupEstimate;
+            groupEstimate.m_group_id = groupId;
+
+            std::vector<std::string> features;
+            for (const auto& entry : group->second.m_fp) {
+                SrrHistory::Estimate estimate = m_history->estimate(entry.m_feature, operation);
+
+                FeatureEstimate featureEstimate;
+                featureEstimate.m_name       = entry.m_feature;
+                featureEstimate.m_durationMs = estimate.m_durationMs;
+                featureEstimate.m_size       = estimate.m_size;
+                featureEstimate.m_samples    = estimate.m_samples;
+
+                groupEstimate.m_size += estimate.m_size;
+                groupEstimate.m_features.push_back(featureEstimate);
+                features.push_back(entry.m_feature);
+            }
+
+            if (operation == HISTORY_SAVE) {
+                // features fetched in parallel, longest first
+                groupEstimate.m_durationMs = m_history->makespan(features, HISTORY_SAVE, m_concurrency);
+            } else {
+                // backup of the group for the rollback, then the features one after the other with their delay
+                groupEstimate.m_durationMs = m_history->makespan(features, HISTORY_SAVE, m_concurrency);
+                for (const auto& featureEstimate : groupEstimate.m_features) {
+                    groupEstimate.m_durationMs +=
+                        featureEstimate.m_durationMs + static_cast<uint64_t>(m_restoreDelay.count()) * 1000;
+                }
+            }
+
+            srrEstimateResp.m_durationMs += groupEstimate.m_durationMs;
+            srrEstimateResp.m_size += groupEstimate.m_size;
+            srrEstimateResp.m_groups.push_back(groupEstimate);
+        }
+
+        srrEstimateResp.m_status = statusToString(Status::SUCCESS);
+    } catch (const std::exception& e) {
+        srrEstimateResp.m_status = statusToString(Status::FAILED);
+        srrEstimateResp.m_error  = TRANSLATE_ME(e.what());
+
+        log_error(srrEstimateResp.m_error.c_str());
     }
 
+    cxxtools::SerializationInfo responseSi;
+    responseSi <<= srrEstimateResp;
+
+    dto::UserData response;
+    response.push_back(srrEstimateResp.m_status);
+    response.push_back(serializeJson(responseSi));
+
+    return response;
+}
+
+dto::UserData SrrWorker::requestStats()
+{
+    log_debug("SRR stats request");
+
+    cxxtools::SerializationInfo responseSi;
+    metrics().serialize(responseSi);
+
+    dto::UserData response;
+    response.push_back(statusToString(Status::SUCCESS));
+    response.push_back(serializeJson(responseSi));
+
+    return response;
+}
+
+dto::UserData SrrWorker::requestCancel(const std::string& key)
+{
+    log_debug("SRR cancel request");
+
+    // the jobs stop at their next checkpoint, a restore in progress rolls back its current group
+    if (key.empty() || m_activeJobs.cancel(key) == 0) {
+        throw SrrException("No job in progress with key " + key);
+    }
+
+    dto::UserData response;
+    response.push_back(statusToString(Status::SUCCESS));
+
     return response;
 }
 
@@ -21,30 +21,67 @@
 
 #pragma once
 
+#include "dto/request.h"
+#include "dto/response.h"
+#include "fty_srr_job.h"
+#include "helpers/clock.h"
+#include "helpers/step.h"
+#include <chrono>
+#include <cstdint>
 #include <fty_common_dto.h>
 #include <fty_common_messagebus.h>
 #include <fty_userdata_dto.h>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace srr {
 
+class EventLoop;
+class SrrCapture;
+class SrrHistory;
+class SrrStore;
+
 class SrrWorker
 {
 public:
+    // connected back-end bus client with clientId, for the clients of the pool
+    using BusFactory = std::function<std::unique_ptr<messagebus::MessageBus>(const std::string& clientId)>;
+
+    // busFactory: clients of the pool, malamute clients on the endpoint of the parameters if not set
+    // clock: time of the delays, timeouts and durations, the steady clock if not set
     SrrWorker(messagebus::MessageBus& msgBus, const std::map<std::string, std::string>& parameters,
-        const std::set<std::string>& supportedVersions);
-    ~SrrWorker() = default;
+        const std::set<std::string>& supportedVersions, BusFactory busFactory = nullptr,
+        std::shared_ptr<Clock> clock = nullptr);
+    ~SrrWorker();
 
     // UI interface
     dto::UserData getGroupList();
     dto::UserData requestSave(const std::string& json);
     dto::UserData requestRestore(const std::string& json, bool force = false);
     dto::UserData requestReset(const std::string& json);
+    dto::UserData requestSnapshot(const std::string& json);
+    dto::UserData requestListSnapshots();
+    dto::UserData requestRestoreSnapshot(const std::string& json, bool force = false);
+    // cancel the jobs of the requests with this idempotency key
+    dto::UserData requestCancel(const std::string& key);
+    // expected duration and payload size of a save or a restore, from the duration history
+    dto::UserData requestEstimate(const std::string& json);
+    // counters and histograms of the agent
+    dto::UserData requestStats();
+
+    // continuous backup: re-save the features changed since the cached all groups save
+    bool isContinuousBackupEnabled() const;
+    void refreshContinuousBackup();
 
 private:
     messagebus::MessageBus&            m_msgBus;
+    BusFactory                         m_busFactory;
+    std::shared_ptr<Clock>             m_clock;
     std::map<std::string, std::string> m_parameters;
     std::string                        m_srrVersion;
 
@@ -52,17 +89,116 @@ private:
 
     int m_sendTimeout;
 
+    std::chrono::seconds m_restoreDelay; // given to an agent to apply a restored feature
+
+    std::string m_integrityScheme; // scheme of the saved groups, empty for the legacy one
+
+    bool m_twoPhaseRestore = false; // prepare/commit/abort with the agents supporting it
+
+    std::set<std::string> m_twoPhaseFeatures; // features whose agent supports prepare/commit/abort
+
+    std::unique_ptr<SrrStore>   m_store;
+    std::unique_ptr<SrrHistory> m_history;
+
+    size_t m_concurrency = 1; // features saved at once
+
+    std::string m_traceDirectory; // where the traces of the saves and restores are written, empty: not traced
+
+    uint64_t m_memoryBudget = 0; // bytes a job may hold, 0: no budget
+
+    std::string m_bulkSpool; // the only directory of the bulk files
+
+    std::unique_ptr<SrrCapture> m_capture; // exchanges with the agents, if captured
+
+    // agents which failed the revision probe
+    std::mutex            m_revisionMutex;
+    std::set<std::string> m_revisionUnsupported;
+
+    // latest all groups save, kept up to date in background and used to answer the next save
+    struct ContinuousBackup
+    {
+        // groups and credentials of the save, the background refreshes run with them. The session token is only
+        // replaced by the one of a save the agents accepted. Both stay in memory until the backup is invalidated:
+        // failed refresh (e.g. expired session), restore or stop of the worker
+        SrrSaveRequest                     m_request;
+        SrrSaveResponse                    m_response;
+        std::string                        m_json;      // serialized m_response
+        std::map<std::string, std::string> m_revisions; // revisions of the saved features, if supported
+        uint64_t                           m_generation = 0;
+        bool                               m_valid      = false;
+    };
+
+    bool             m_continuousBackup = false;
+    std::mutex       m_continuousMutex;
+    ContinuousBackup m_continuous;
+
+    // jobs by idempotency key, identical saves in progress are also coalesced
+    SrrJobRegistry<SrrSaveResponse>     m_saveJobs;
+    SrrJobRegistry<SrrSnapshotResponse> m_snapshotJobs;
+    SrrJobRegistry<SrrRestoreResponse>  m_restoreJobs;
+    SrrActiveJobs                       m_activeJobs;
+
     void init();
     // void buildMapAssociation();
+
+    // revisions: if set, filled with the revisions of the features which support it
+    SrrSaveResponse save(const SrrSaveRequest& srrSaveReq, std::map<std::string, std::string>* revisions = nullptr);
+    SrrRestoreResponse restore(const SrrRestoreRequest& srrRestoreReq, bool force);
+
+    // incremental save
+    std::string featureRevision(const dto::srr::FeatureName& featureName);
+    void        loadIncrementalBase(const std::string& passphrase, std::map<std::string, SrrFeature>& features,
+        std::map<std::string, std::string>& revisions);
     bool isVerstionCompatible(const std::string& version);
 
-    // SRR methods
+    // continuous backup
+    bool cachedSave(const SrrSaveRequest& srrSaveReq, std::string& json);
+    void armContinuousBackup(const SrrSaveRequest& srrSaveReq, const SrrSaveResponse& srrSaveResp,
+        const std::map<std::string, std::string>& revisions);
+    void invalidateContinuousBackup();
+    // save again the features changed since the backup, with the credentials of the caller if any (its session is
+    // checked by the agents) or with the ones of the backup. json: the backup once up to date
+    bool updateContinuousBackup(const SrrSaveRequest* caller, std::string* json);
+
+    static std::string saveJobKey(const SrrSaveRequest& srrSaveReq);
+    // digests of the requests kept with their idempotency key: credentials and content of the request
+    static std::string saveRequestDigest(const SrrSaveRequest& srrSaveReq);
+    static std::string requestDigest(const std::string& key, const std::string& json, bool force);
+
+    // drives the requests to the agents and the delays, declared last to stop before the rest is destroyed
+    std::unique_ptr<EventLoop> m_loop;
+
+    // SRR methods, as steps run by the event loop. job is the job of the request, if any.
+    // featureName: feature the request is about, for the flight recorder
+    Step agentRequest(const dto::srr::FeatureName& featureName, const std::string& agentNameDest,
+        const std::string& action, const dto::UserData& data, const std::shared_ptr<SrrJobContext>& job, int timeout,
+        std::shared_ptr<messagebus::Message> reply);
+    Step saveFeatureStep(const dto::srr::FeatureName& featureName, const std::string& passphrase,
+        const std::string& sessionToken, const std::shared_ptr<SrrJobContext>& job,
+        std::function<void(const dto::srr::SaveResponse&)> onSaved);
+    // action: "restore", or "prepare" to stage the payload of a two-phase restore
+    Step restoreFeatureStep(const dto::srr::FeatureName& featureName, const dto::srr::RestoreQuery& query,
+        const std::string& action, const std::shared_ptr<SrrJobContext>& job,
+        std::function<void(const dto::srr::RestoreResponse&)> onRestored);
+    Step resetFeatureStep(const dto::srr::FeatureName& featureName, const std::shared_ptr<SrrJobContext>& job);
+    // restart is set if a rolled back feature needs it, it must outlive the step
+    Step rollbackStep(const dto::srr::SaveResponse& rollbackSaveResponse, const std::string& passphrase,
+        const std::shared_ptr<SrrJobContext>& job, bool& restart);
+
+    // two-phase restore: "commit" switches to the prepared payload, "abort" drops it
+    Step phaseStep(const dto::srr::FeatureName& featureName, const std::string& action,
+        const std::string& sessionToken, const std::shared_ptr<SrrJobContext>& job);
+    Step abortStep(const std::vector<dto::srr::FeatureName>& featureNames, const std::string& sessionToken,
+        const std::shared_ptr<SrrJobContext>& job);
+
+    // save of one feature for the calling thread
     dto::srr::SaveResponse saveFeature(
         const dto::srr::FeatureName& featureName, const std::string& passphrase, const std::string& sessionToken);
-    dto::srr::RestoreResponse restoreFeature(
-        const dto::srr::FeatureName& featureName, const dto::srr::RestoreQuery& query);
-    dto::srr::ResetResponse resetFeature(const dto::srr::FeatureName& featureName);
-    bool                    rollback(const dto::srr::SaveResponse& rollbackSaveResponse, const std::string& passphrase);
+
+    // log the countdown then reboot, in the event loop
+    void restartCountdown(unsigned seconds);
+    // write the metrics to path every period, in the event loop
+    void dumpStats(const std::string& path, std::chrono::seconds period);
 };
 
 } // namespace srr
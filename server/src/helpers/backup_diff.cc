@@ -0,0 +1,444 @@
+/*  =========================================================================
+    backup_diff - Structural comparison of saved SRR payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "helpers/backup_diff.h"
+#include "dto/common.h"
+#include "helpers/data_integrity.h"
+#include "helpers/parallel.h"
+#include <algorithm>
+#include <fty_common_dto.h>
+#include <map>
+
+namespace srr {
+
+static constexpr const char* PATCH_OP      = "op";
+static constexpr const char* PATCH_PATH    = "path";
+static constexpr const char* PATCH_VALUE   = "value";
+static constexpr const char* PATCH_ADD     = "add";
+static constexpr const char* PATCH_REMOVE  = "remove";
+static constexpr const char* PATCH_REPLACE = "replace";
+
+std::string changeTypeToString(ChangeType change)
+{
+    switch (change) {
+        case ChangeType::ADDED:
+            return "added";
+        case ChangeType::REMOVED:
+            return "removed";
+        case ChangeType::MODIFIED:
+            return "modified";
+        default:
+            return "unchanged";
+    }
+}
+
+// JSON pointer reference token (RFC 6901)
+static std::string escapePointer(const std::string& token)
+{
+    std::string escaped;
+    escaped.reserve(token.size());
+    for (char c : token) {
+        if (c == '~') {
+            escaped += "~0";
+        } else if (c == '/') {
+            escaped += "~1";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static void addPatchOp(cxxtools::SerializationInfo& patch, const char* op, const std::string& path,
+    const cxxtools::SerializationInfo* value = nullptr)
+{
+    cxxtools::SerializationInfo& entry = patch.addMember("");
+    entry.setCategory(cxxtools::SerializationInfo::Category::Object);
+    entry.addMember(PATCH_OP) <<= op;
+    entry.addMember(PATCH_PATH) <<= path;
+    if (value != nullptr) {
+        cxxtools::SerializationInfo& valueSi = entry.addMember(PATCH_VALUE);
+        valueSi                              = *value;
+        valueSi.setName(PATCH_VALUE);
+    }
+}
+
+static bool isContainer(const cxxtools::SerializationInfo& si)
+{
+    return si.category() == cxxtools::SerializationInfo::Category::Object ||
+           si.category() == cxxtools::SerializationInfo::Category::Array;
+}
+
+static bool sameValue(const cxxtools::SerializationInfo& l, const cxxtools::SerializationInfo& r)
+{
+    if (l.isNull() || r.isNull()) {
+        return l.isNull() == r.isNull();
+    }
+    std::string lValue, rValue;
+    l.getValue(lValue);
+    r.getValue(rValue);
+    return lValue == rValue;
+}
+
+size_t diffJson(const cxxtools::SerializationInfo& from, const cxxtools::SerializationInfo& to, const std::string& path,
+    cxxtools::SerializationInfo& patch)
+{
+    if (from.category() != to.category()) {
+        addPatchOp(patch, PATCH_REPLACE, path, &to);
+        return 1;
+    }
+
+    if (!isContainer(from)) {
+        if (sameValue(from, to)) {
+            return 0;
+        }
+        addPatchOp(patch, PATCH_REPLACE, path, &to);
+        return 1;
+    }
+
+    size_t ops = 0;
+
+    if (from.category() == cxxtools::SerializationInfo::Category::Array) {
+        const size_t common = std::min(from.memberCount(), to.memberCount());
+        for (size_t i = 0; i < common; i++) {
+            ops += diffJson(from.getMember(unsigned(i)), to.getMember(unsigned(i)), path + "/" + std::to_string(i), patch);
+        }
+        // remove from the end so that indexes stay valid while the patch is applied
+        for (size_t i = from.memberCount(); i > common; i--) {
+            addPatchOp(patch, PATCH_REMOVE, path + "/" + std::to_string(i - 1));
+            ops++;
+        }
+        for (size_t i = common; i < to.memberCount(); i++) {
+            addPatchOp(patch, PATCH_ADD, path + "/" + std::to_string(i), &to.getMember(unsigned(i)));
+            ops++;
+        }
+        return ops;
+    }
+
+    for (const auto& member : from) {
+        const std::string                  memberPath = path + "/" + escapePointer(member.name());
+        const cxxtools::SerializationInfo* other      = to.findMember(member.name());
+        if (other == nullptr) {
+            addPatchOp(patch, PATCH_REMOVE, memberPath);
+            ops++;
+        } else {
+            ops += diffJson(member, *other, memberPath, patch);
+        }
+    }
+    for (const auto& member : to) {
+        if (from.findMember(member.name()) == nullptr) {
+            addPatchOp(patch, PATCH_ADD, path + "/" + escapePointer(member.name()), &member);
+            ops++;
+        }
+    }
+
+    return ops;
+}
+
+namespace {
+    // features array of a group, with its JSON pointer in the payload
+    struct GroupView
+    {
+        std::string                        m_group_id;
+        std::string                        m_data_integrity;
+        std::string                        m_path;
+        const cxxtools::SerializationInfo* m_group             = nullptr; // null for version 1.0
+        const cxxtools::SerializationInfo* m_features          = nullptr;
+        const cxxtools::SerializationInfo* m_featuresIntegrity = nullptr; // merkle integrity scheme only
+    };
+
+    struct FeaturePair
+    {
+        const cxxtools::SerializationInfo* m_from = nullptr;
+        const cxxtools::SerializationInfo* m_to       = nullptr;
+        bool                               m_digested = false;
+        bool                               m_same     = false;
+    };
+} // namespace
+
+static std::string memberString(const cxxtools::SerializationInfo& si, const char* name)
+{
+    std::string                        value;
+    const cxxtools::SerializationInfo* member = si.findMember(name);
+    if (member != nullptr) {
+        *member >>= value;
+    }
+    return value;
+}
+
+static std::vector<GroupView> groupViews(const cxxtools::SerializationInfo& payload)
+{
+    std::vector<GroupView>             views;
+    const cxxtools::SerializationInfo& data = payload.getMember(SI_DATA);
+
+    // version 1.0 has no groups: handle its features as a single anonymous group
+    if (memberString(payload, SI_VERSION) == "1.0") {
+        GroupView view;
+        view.m_path     = std::string("/") + SI_DATA;
+        view.m_features = &data;
+        views.push_back(view);
+        return views;
+    }
+
+    for (size_t i = 0; i < data.memberCount(); i++) {
+        const cxxtools::SerializationInfo& groupSi = data.getMember(unsigned(i));
+
+        GroupView view;
+        view.m_group_id       = memberString(groupSi, SI_GROUP_ID);
+        view.m_data_integrity = memberString(groupSi, SI_DATA_INTEGRITY);
+        view.m_path           = std::string("/") + SI_DATA + "/" + std::to_string(i) + "/" + SI_FEATURES;
+        view.m_group          = &groupSi;
+        view.m_features       = &groupSi.getMember(SI_FEATURES);
+        if (memberString(groupSi, SI_INTEGRITY_SCHEME) == INTEGRITY_SCHEME_MERKLE) {
+            view.m_featuresIntegrity = groupSi.findMember(SI_FEATURES_INTEGRITY);
+        }
+        views.push_back(view);
+    }
+    return views;
+}
+
+// each feature entry is an object with a single member named after the feature
+static std::map<std::string, size_t> featureIndexes(const cxxtools::SerializationInfo& features)
+{
+    std::map<std::string, size_t> indexes;
+    for (size_t i = 0; i < features.memberCount(); i++) {
+        const cxxtools::SerializationInfo& entry = features.getMember(unsigned(i));
+        if (entry.memberCount() > 0) {
+            indexes[entry.getMember(0u).name()] = i;
+        }
+    }
+    return indexes;
+}
+
+static std::string featureDigest(const cxxtools::SerializationInfo& entry)
+{
+    return evalSha256(dto::srr::serializeJson(entry, false));
+}
+
+BackupDiff diffBackups(const cxxtools::SerializationInfo& from, const cxxtools::SerializationInfo& to, bool withPatch)
+{
+    BackupDiff diff;
+    diff.m_patch.setCategory(cxxtools::SerializationInfo::Category::Array);
+
+    for (const char* member : {SI_VERSION, SI_CHECKSUM}) {
+        const cxxtools::SerializationInfo* fromSi = from.findMember(member);
+        const cxxtools::SerializationInfo* toSi   = to.findMember(member);
+        if (fromSi != nullptr && toSi != nullptr) {
+            diffJson(*fromSi, *toSi, std::string("/") + member, diff.m_patch);
+        }
+    }
+
+    const bool fromV1 = memberString(from, SI_VERSION) == "1.0";
+    const bool toV1   = memberString(to, SI_VERSION) == "1.0";
+    if (fromV1 != toV1) {
+        // layouts are not comparable group by group
+        GroupDiff group;
+        group.m_change = ChangeType::MODIFIED;
+        diff.m_groups.push_back(group);
+        diffJson(from.getMember(SI_DATA), to.getMember(SI_DATA), std::string("/") + SI_DATA, diff.m_patch);
+        diff.m_identical = false;
+        return diff;
+    }
+
+    const std::vector<GroupView> fromGroups = groupViews(from);
+    const std::vector<GroupView> toGroups   = groupViews(to);
+
+    std::map<std::string, size_t> toGroupIndexes;
+    for (size_t i = 0; i < toGroups.size(); i++) {
+        toGroupIndexes[toGroups[i].m_group_id] = i;
+    }
+
+    // first pass: group digests, then collect the features to hash
+    std::vector<std::pair<size_t, size_t>> changedGroups;
+    std::vector<FeaturePair>               pairs;
+
+    for (size_t i = 0; i < fromGroups.size(); i++) {
+        const GroupView& fromGroup = fromGroups[i];
+        auto             found     = toGroupIndexes.find(fromGroup.m_group_id);
+        if (found == toGroupIndexes.end()) {
+            continue;
+        }
+        const GroupView& toGroup = toGroups[found->second];
+        if (!fromGroup.m_data_integrity.empty() && fromGroup.m_data_integrity == toGroup.m_data_integrity) {
+            continue;
+        }
+        changedGroups.emplace_back(i, found->second);
+
+        std::map<std::string, size_t> toFeatures = featureIndexes(*toGroup.m_features);
+        for (const auto& feature : featureIndexes(*fromGroup.m_features)) {
+            auto other = toFeatures.find(feature.first);
+            if (other != toFeatures.end()) {
+                FeaturePair pair;
+                pair.m_from = &fromGroup.m_features->getMember(unsigned(feature.second));
+                pair.m_to   = &toGroup.m_features->getMember(unsigned(other->second));
+
+                // feature digests saved with the merkle integrity scheme spare the hashing
+                if (fromGroup.m_featuresIntegrity != nullptr && toGroup.m_featuresIntegrity != nullptr) {
+                    const std::string fromDigest = memberString(*fromGroup.m_featuresIntegrity, feature.first.c_str());
+                    const std::string toDigest   = memberString(*toGroup.m_featuresIntegrity, feature.first.c_str());
+                    if (!fromDigest.empty() && !toDigest.empty()) {
+                        pair.m_digested = true;
+                        pair.m_same     = fromDigest == toDigest;
+                    }
+                }
+                pairs.push_back(pair);
+            }
+        }
+    }
+
+    parallelFor(pairs.size(), [&](size_t i) {
+        if (!pairs[i].m_digested) {
+            pairs[i].m_same = featureDigest(*pairs[i].m_from) == featureDigest(*pairs[i].m_to);
+        }
+    });
+
+    std::map<const cxxtools::SerializationInfo*, bool> sameFeatures;
+    for (const auto& pair : pairs) {
+        sameFeatures[pair.m_from] = pair.m_same;
+    }
+
+    // second pass: describe changed features and only descend into the ones that differ
+    cxxtools::SerializationInfo scratch;
+    for (const auto& changed : changedGroups) {
+        const GroupView& fromGroup = fromGroups[changed.first];
+        const GroupView& toGroup   = toGroups[changed.second];
+
+        GroupDiff group;
+        group.m_group_id = fromGroup.m_group_id;
+
+        cxxtools::SerializationInfo& patch = withPatch ? diff.m_patch : scratch;
+
+        std::map<std::string, size_t> fromFeatures = featureIndexes(*fromGroup.m_features);
+        std::map<std::string, size_t> toFeatures   = featureIndexes(*toGroup.m_features);
+
+        // group members other than the features (data integrity...)
+        if (fromGroup.m_group != nullptr) {
+            const std::string groupPath = fromGroup.m_path.substr(0, fromGroup.m_path.rfind('/'));
+            for (const auto& member : *fromGroup.m_group) {
+                if (member.name() == SI_FEATURES) {
+                    continue;
+                }
+                const std::string                  memberPath = groupPath + "/" + escapePointer(member.name());
+                const cxxtools::SerializationInfo* other      = toGroup.m_group->findMember(member.name());
+                if (other == nullptr) {
+                    addPatchOp(diff.m_patch, PATCH_REMOVE, memberPath);
+                } else {
+                    diffJson(member, *other, memberPath, diff.m_patch);
+                }
+            }
+            for (const auto& member : *toGroup.m_group) {
+                if (fromGroup.m_group->findMember(member.name()) == nullptr) {
+                    addPatchOp(diff.m_patch, PATCH_ADD, groupPath + "/" + escapePointer(member.name()), &member);
+                }
+            }
+        }
+
+        std::vector<size_t> removed;
+        for (const auto& feature : fromFeatures) {
+            const cxxtools::SerializationInfo& fromEntry = fromGroup.m_features->getMember(unsigned(feature.second));
+
+            FeatureDiff featureDiff;
+            featureDiff.m_name = feature.first;
+
+            auto other = toFeatures.find(feature.first);
+            if (other == toFeatures.end()) {
+                featureDiff.m_change   = ChangeType::REMOVED;
+                featureDiff.m_patchOps = 1;
+                removed.push_back(feature.second);
+            } else if (!sameFeatures[&fromEntry]) {
+                const cxxtools::SerializationInfo& toEntry = toGroup.m_features->getMember(unsigned(other->second));
+
+                scratch.clear();
+                scratch.setCategory(cxxtools::SerializationInfo::Category::Array);
+                featureDiff.m_change   = ChangeType::MODIFIED;
+                featureDiff.m_patchOps = diffJson(fromEntry, toEntry,
+                    fromGroup.m_path + "/" + std::to_string(feature.second), patch);
+            } else {
+                continue;
+            }
+            group.m_features.push_back(featureDiff);
+        }
+
+        // remove from the end so that indexes stay valid while the patch is applied
+        std::sort(removed.rbegin(), removed.rend());
+        for (size_t index : removed) {
+            addPatchOp(diff.m_patch, PATCH_REMOVE, fromGroup.m_path + "/" + std::to_string(index));
+        }
+
+        for (const auto& feature : toFeatures) {
+            if (fromFeatures.count(feature.first) == 0) {
+                FeatureDiff featureDiff;
+                featureDiff.m_name     = feature.first;
+                featureDiff.m_change   = ChangeType::ADDED;
+                featureDiff.m_patchOps = 1;
+                group.m_features.push_back(featureDiff);
+
+                addPatchOp(diff.m_patch, PATCH_ADD, fromGroup.m_path + "/-",
+                    &toGroup.m_features->getMember(unsigned(feature.second)));
+            }
+        }
+
+        if (!group.m_features.empty()) {
+            group.m_change = ChangeType::MODIFIED;
+            diff.m_groups.push_back(group);
+        }
+    }
+
+    // whole groups, after every change made inside the groups of the original payload
+    std::map<std::string, size_t> fromGroupIndexes;
+    for (size_t i = 0; i < fromGroups.size(); i++) {
+        fromGroupIndexes[fromGroups[i].m_group_id] = i;
+    }
+
+    for (size_t i = fromGroups.size(); i > 0; i--) {
+        if (toGroupIndexes.count(fromGroups[i - 1].m_group_id) == 0) {
+            GroupDiff group;
+            group.m_group_id = fromGroups[i - 1].m_group_id;
+            group.m_change   = ChangeType::REMOVED;
+            diff.m_groups.push_back(group);
+
+            addPatchOp(diff.m_patch, PATCH_REMOVE, std::string("/") + SI_DATA + "/" + std::to_string(i - 1));
+        }
+    }
+
+    const cxxtools::SerializationInfo& toData = to.getMember(SI_DATA);
+    for (size_t i = 0; i < toGroups.size(); i++) {
+        if (fromGroupIndexes.count(toGroups[i].m_group_id) == 0) {
+            GroupDiff group;
+            group.m_group_id = toGroups[i].m_group_id;
+            group.m_change   = ChangeType::ADDED;
+            diff.m_groups.push_back(group);
+
+            addPatchOp(diff.m_patch, PATCH_ADD, std::string("/") + SI_DATA + "/-", &toData.getMember(unsigned(i)));
+        }
+    }
+
+    diff.m_identical = diff.m_groups.empty() && diff.m_patch.memberCount() == 0;
+
+    if (!withPatch) {
+        diff.m_patch.clear();
+        diff.m_patch.setCategory(cxxtools::SerializationInfo::Category::Array);
+    }
+
+    return diff;
+}
+
+} // namespace srr
@@ -0,0 +1,81 @@
+/*  =========================================================================
+    backup_diff - Structural comparison of saved SRR payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cxxtools/serializationinfo.h>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+enum class ChangeType
+{
+    UNCHANGED,
+    ADDED,
+    REMOVED,
+    MODIFIED
+};
+
+std::string changeTypeToString(ChangeType change);
+
+class FeatureDiff
+{
+public:
+    FeatureDiff(){};
+
+    std::string m_name;
+    ChangeType  m_change   = ChangeType::UNCHANGED;
+    size_t      m_patchOps = 0;
+};
+
+class GroupDiff
+{
+public:
+    GroupDiff(){};
+
+    std::string              m_group_id;
+    ChangeType               m_change = ChangeType::UNCHANGED;
+    std::vector<FeatureDiff> m_features; // changed features only
+};
+
+class BackupDiff
+{
+public:
+    BackupDiff(){};
+
+    bool                        m_identical = true;
+    std::vector<GroupDiff>      m_groups;
+    cxxtools::SerializationInfo m_patch; // RFC 6902 JSON Patch turning "from" into "to"
+};
+
+/**
+ * Compare two saved payloads (save response format).
+ * Groups with the same data integrity are skipped, then only features with a different digest are compared
+ * member by member, to produce the JSON Patch if requested.
+ */
+BackupDiff diffBackups(const cxxtools::SerializationInfo& from, const cxxtools::SerializationInfo& to, bool withPatch);
+
+// RFC 6902 operations between two JSON documents, appended to patch (an array), path is the JSON pointer of from
+size_t diffJson(const cxxtools::SerializationInfo& from, const cxxtools::SerializationInfo& to, const std::string& path,
+    cxxtools::SerializationInfo& patch);
+
+} // namespace srr
@@ -0,0 +1,156 @@
+/*  =========================================================================
+    backup_inspector - Offline checks of saved SRR payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "helpers/backup_inspector.h"
+#include "fty_srr_groups.h"
+#include "helpers/data_integrity.h"
+#include "helpers/parallel.h"
+#include <algorithm>
+#include <fty-lib-certificate.h>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace srr {
+
+static const std::set<std::string> SUPPORTED_VERSIONS = {"1.0", "2.0", "2.1", "2.2"};
+
+bool BackupReport::isValid() const
+{
+    if (!m_versionSupported || (m_checksumChecked && !m_checksumOk)) {
+        return false;
+    }
+    return std::all_of(m_groups.begin(), m_groups.end(), [](const GroupReport& g) {
+        return g.m_known && g.m_integrityOk;
+    });
+}
+
+void operator>>=(const cxxtools::SerializationInfo& si, BackupContent& content)
+{
+    si.getMember(SI_VERSION) >>= content.m_version;
+    if (si.findMember(SI_CHECKSUM) != nullptr) {
+        si.getMember(SI_CHECKSUM) >>= content.m_checksum;
+    }
+
+    if (content.m_version == "1.0") {
+        si.getMember(SI_DATA) >>= content.m_features;
+    } else {
+        si.getMember(SI_DATA) >>= content.m_groups;
+    }
+}
+
+static FeatureReport featureReport(const SrrFeature& feature)
+{
+    FeatureReport report;
+    report.m_name    = feature.m_feature_name;
+    report.m_version = feature.m_feature_and_status.feature().version();
+    report.m_size    = feature.m_feature_and_status.feature().data().size();
+
+    return report;
+}
+
+BackupReport inspectBackup(BackupContent& content, const std::string& passphrase)
+{
+    BackupReport report;
+
+    report.m_version          = content.m_version;
+    report.m_versionSupported = SUPPORTED_VERSIONS.count(content.m_version) != 0;
+
+    if (!passphrase.empty()) {
+        report.m_checksumChecked = true;
+        try {
+            report.m_checksumOk = fty::decrypt(content.m_checksum, passphrase) == passphrase;
+        } catch (const std::exception&) {
+            report.m_checksumOk = false;
+        }
+    }
+
+    // version 1.0 has neither groups nor data integrity
+    if (content.m_version == "1.0") {
+        GroupReport group;
+        for (const auto& feature : content.m_features) {
+            group.m_features.push_back(featureReport(feature));
+            group.m_size += group.m_features.back().m_size;
+        }
+        report.m_groups.push_back(group);
+        return report;
+    }
+
+    report.m_groups.resize(content.m_groups.size());
+
+    // one flat list of work items, a feature of a merkle group or a whole legacy group: threads are not nested
+    static constexpr size_t WHOLE_GROUP = static_cast<size_t>(-1);
+
+    std::vector<std::pair<size_t, size_t>> items;
+    std::vector<std::vector<std::string>>  digests(content.m_groups.size());
+
+    for (size_t i = 0; i < content.m_groups.size(); i++) {
+        Group& group = content.m_groups[i];
+
+        report.m_groups[i].m_group_id = group.m_group_id;
+        report.m_groups[i].m_known    = g_srrGroupMap.find(group.m_group_id) != g_srrGroupMap.end();
+
+        // features must be sorted by priority to evaluate correctly the data integrity
+        std::sort(group.m_features.begin(), group.m_features.end(), [&](const SrrFeature& l, const SrrFeature& r) {
+            return getPriority(l.m_feature_name) < getPriority(r.m_feature_name);
+        });
+
+        if (group.m_integrity_scheme == INTEGRITY_SCHEME_MERKLE) {
+            digests[i].resize(group.m_features.size());
+            for (size_t j = 0; j < group.m_features.size(); j++) {
+                items.emplace_back(i, j);
+            }
+        } else {
+            items.emplace_back(i, WHOLE_GROUP);
+        }
+    }
+
+    parallelFor(items.size(), [&](size_t k) {
+        const Group& group = content.m_groups[items[k].first];
+        if (items[k].second == WHOLE_GROUP) {
+            report.m_groups[items[k].first].m_integrityOk = checkDataIntegrity(group);
+        } else {
+            digests[items[k].first][items[k].second] = evalFeatureIntegrity(group.m_features[items[k].second]);
+        }
+    });
+
+    for (size_t i = 0; i < content.m_groups.size(); i++) {
+        const Group& group       = content.m_groups[i];
+        GroupReport& groupReport = report.m_groups[i];
+
+        std::vector<std::string> corrupted;
+        if (group.m_integrity_scheme == INTEGRITY_SCHEME_MERKLE) {
+            corrupted                 = checkFeaturesIntegrity(group, digests[i]);
+            groupReport.m_integrityOk = corrupted.empty();
+        }
+
+        for (const auto& feature : group.m_features) {
+            groupReport.m_features.push_back(featureReport(feature));
+            groupReport.m_features.back().m_integrityOk =
+                std::find(corrupted.begin(), corrupted.end(), feature.m_feature_name) == corrupted.end();
+            groupReport.m_size += groupReport.m_features.back().m_size;
+        }
+    }
+
+    return report;
+}
+
+} // namespace srr
@@ -0,0 +1,86 @@
+/*  =========================================================================
+    backup_inspector - Offline checks of saved SRR payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "dto/common.h"
+#include <cxxtools/serializationinfo.h>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+class FeatureReport
+{
+public:
+    FeatureReport(){};
+
+    std::string m_name;
+    std::string m_version;
+    size_t      m_size        = 0;
+    bool        m_integrityOk = true; // checked on its own with the merkle integrity scheme only
+};
+
+class GroupReport
+{
+public:
+    GroupReport(){};
+
+    std::string                m_group_id;
+    size_t                     m_size        = 0;
+    bool                       m_known       = true;
+    bool                       m_integrityOk = true;
+    std::vector<FeatureReport> m_features;
+};
+
+class BackupReport
+{
+public:
+    BackupReport(){};
+
+    std::string m_version;
+    bool        m_versionSupported = false;
+    bool        m_checksumChecked  = false;
+    bool        m_checksumOk       = false;
+
+    std::vector<GroupReport> m_groups;
+
+    bool isValid() const;
+};
+
+// Saved payload (save response format), as read from a backup file
+class BackupContent
+{
+public:
+    BackupContent(){};
+
+    std::string             m_version;
+    std::string             m_checksum;
+    std::vector<Group>      m_groups;   // version 2.x
+    std::vector<SrrFeature> m_features; // version 1.0
+};
+
+void operator>>=(const cxxtools::SerializationInfo& si, BackupContent& content);
+
+// check passphrase (if not empty), version and data integrity of every group, groups are hashed in parallel
+BackupReport inspectBackup(BackupContent& content, const std::string& passphrase);
+
+} // namespace srr
@@ -0,0 +1,224 @@
+/*  =========================================================================
+    base64 - Binary safe encoding of opaque feature payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "helpers/base64.h"
+#include "fty_srr_exception.h"
+#include <array>
+#include <cstdint>
+
+namespace srr {
+
+static constexpr const char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr uint8_t    INVALID_CHAR   = 0xff;
+
+static const std::array<uint8_t, 256> DECODE_TABLE = []() {
+    std::array<uint8_t, 256> table;
+    table.fill(INVALID_CHAR);
+    for (uint8_t i = 0; i < 64; i++) {
+        table[static_cast<uint8_t>(ENCODE_TABLE[i])] = i;
+    }
+    return table;
+}();
+
+static inline void encodeBlock(const uint8_t* in, char* out)
+{
+    const uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | uint32_t(in[2]);
+    out[0]           = ENCODE_TABLE[(v >> 18) & 0x3f];
+    out[1]           = ENCODE_TABLE[(v >> 12) & 0x3f];
+    out[2]           = ENCODE_TABLE[(v >> 6) & 0x3f];
+    out[3]           = ENCODE_TABLE[v & 0x3f];
+}
+
+static inline uint32_t decodeBlock(const uint8_t* in)
+{
+    const uint32_t a = DECODE_TABLE[in[0]];
+    const uint32_t b = DECODE_TABLE[in[1]];
+    const uint32_t c = DECODE_TABLE[in[2]];
+    const uint32_t d = DECODE_TABLE[in[3]];
+    // an invalid char sets bits above the 24 bits of payload
+    return (a << 18) | (b << 12) | (c << 6) | d | (((a | b | c | d) & 0x80) << 24);
+}
+
+std::string base64Encode(const std::string& data)
+{
+    const size_t   size = data.size();
+    const uint8_t* in   = reinterpret_cast<const uint8_t*>(data.data());
+
+    std::string encoded(((size + 2) / 3) * 4, '=');
+    char*       out = &encoded[0];
+
+    size_t i = 0;
+    // 12 bytes in, 16 chars out per iteration: independent blocks let the compiler interleave them
+    for (; i + 12 <= size; i += 12, out += 16) {
+        encodeBlock(in + i, out);
+        encodeBlock(in + i + 3, out + 4);
+        encodeBlock(in + i + 6, out + 8);
+        encodeBlock(in + i + 9, out + 12);
+    }
+    for (; i + 3 <= size; i += 3, out += 4) {
+        encodeBlock(in + i, out);
+    }
+
+    // tail, padding is already in place
+    if (size - i == 1) {
+        out[0] = ENCODE_TABLE[in[i] >> 2];
+        out[1] = ENCODE_TABLE[(in[i] & 0x03) << 4];
+    } else if (size - i == 2) {
+        out[0] = ENCODE_TABLE[in[i] >> 2];
+        out[1] = ENCODE_TABLE[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        out[2] = ENCODE_TABLE[(in[i + 1] & 0x0f) << 2];
+    }
+
+    return encoded;
+}
+
+std::string base64Decode(const std::string& encoded)
+{
+    const size_t size = encoded.size();
+    if (size % 4 != 0) {
+        throw SrrException("Invalid base64 payload length");
+    }
+    if (size == 0) {
+        return {};
+    }
+
+    const uint8_t* in      = reinterpret_cast<const uint8_t*>(encoded.data());
+    const size_t   padding = (in[size - 1] == '=') + (in[size - 2] == '=');
+
+    std::string data((size / 4) * 3 - padding, '\0');
+    uint8_t*    out = reinterpret_cast<uint8_t*>(&data[0]);
+
+    // all blocks but the last one, which may hold padding
+    const size_t fullSize = size - 4;
+    size_t       i        = 0;
+    uint32_t     errors   = 0;
+    for (; i < fullSize; i += 4, out += 3) {
+        const uint32_t v = decodeBlock(in + i);
+        errors |= v;
+        out[0] = uint8_t(v >> 16);
+        out[1] = uint8_t(v >> 8);
+        out[2] = uint8_t(v);
+    }
+
+    // last block: replace padding by a valid char so that it decodes to zero bits
+    uint8_t last[4] = {in[i], in[i + 1], in[i + 2], in[i + 3]};
+    if (padding >= 1) {
+        last[3] = 'A';
+    }
+    if (padding == 2) {
+        last[2] = 'A';
+    }
+    const uint32_t v = decodeBlock(last);
+    errors |= v;
+    out[0] = uint8_t(v >> 16);
+    if (padding < 2) {
+        out[1] = uint8_t(v >> 8);
+    }
+    if (padding < 1) {
+        out[2] = uint8_t(v);
+    }
+
+    if (errors & 0x80000000) {
+        throw SrrException("Invalid character in base64 payload");
+    }
+
+    return data;
+}
+
+// returns the escaped size, or 0 with validUtf8 set to false on invalid UTF-8
+static size_t escapedSize(const std::string& data, bool& validUtf8)
+{
+    const uint8_t* in   = reinterpret_cast<const uint8_t*>(data.data());
+    const size_t   size = data.size();
+
+    size_t escaped = 0;
+    size_t i       = 0;
+    validUtf8      = true;
+
+    while (i < size) {
+        const uint8_t c = in[i];
+        if (c < 0x80) {
+            if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+                escaped += 2;
+            } else if (c < 0x20 || c == 0x7f) {
+                escaped += 6; // \u00XX
+            } else {
+                escaped += 1;
+            }
+            i++;
+            continue;
+        }
+
+        // multi-byte sequence, written by the JSON formatter as \uXXXX (or a surrogate pair)
+        size_t   len;
+        uint32_t codePoint;
+        if ((c & 0xe0) == 0xc0) {
+            len       = 2;
+            codePoint = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            len       = 3;
+            codePoint = c & 0x0f;
+        } else if ((c & 0xf8) == 0xf0) {
+            len       = 4;
+            codePoint = c & 0x07;
+        } else {
+            validUtf8 = false;
+            return 0;
+        }
+        if (i + len > size) {
+            validUtf8 = false;
+            return 0;
+        }
+        for (size_t j = 1; j < len; j++) {
+            if ((in[i + j] & 0xc0) != 0x80) {
+                validUtf8 = false;
+                return 0;
+            }
+            codePoint = (codePoint << 6) | (in[i + j] & 0x3f);
+        }
+        // reject overlong encodings, surrogates and out of range code points
+        if ((len == 2 && codePoint < 0x80) || (len == 3 && codePoint < 0x800) || (len == 4 && codePoint < 0x10000) ||
+            (codePoint >= 0xd800 && codePoint <= 0xdfff) || codePoint > 0x10ffff) {
+            validUtf8 = false;
+            return 0;
+        }
+        escaped += (codePoint >= 0x10000) ? 12 : 6;
+        i += len;
+    }
+
+    return escaped;
+}
+
+size_t jsonEscapedSize(const std::string& data)
+{
+    bool validUtf8;
+    return escapedSize(data, validUtf8);
+}
+
+bool isBinaryPayload(const std::string& data)
+{
+    bool         validUtf8;
+    const size_t escaped = escapedSize(data, validUtf8);
+
+    return !validUtf8 || escaped > ((data.size() + 2) / 3) * 4;
+}
+
+} // namespace srr
@@ -0,0 +1,38 @@
+/*  =========================================================================
+    base64 - Binary safe encoding of opaque feature payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <string>
+
+namespace srr {
+
+// RFC 4648 base64 (standard alphabet, padded)
+std::string base64Encode(const std::string& data);
+// throws SrrException on malformed input
+std::string base64Decode(const std::string& encoded);
+
+// size of data once written as a JSON string (quotes excluded)
+size_t jsonEscapedSize(const std::string& data);
+// true if data is not valid UTF-8 or if base64 is smaller than its JSON escaped form
+bool isBinaryPayload(const std::string& data);
+
+} // namespace srr
@@ -0,0 +1,338 @@
+/*  =========================================================================
+    bulk_transfer - Local out of band transfer of save/restore payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "helpers/bulk_transfer.h"
+#include "fty_srr_exception.h"
+#include "helpers/data_integrity.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cxxtools/jsondeserializer.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <istream>
+#include <memory>
+#include <openssl/evp.h>
+#include <sstream>
+#include <streambuf>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define BULK_IO_BLOCK_SIZE (1024 * 1024)
+
+namespace srr {
+
+static std::string errnoString(const std::string& what, const std::string& path)
+{
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+static void writeAll(int fd, const char* data, size_t size, const std::string& path)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw SrrException(errnoString("Failed to write", path));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+/**
+ * Input stream buffer reading directly from memory, without copy
+ */
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char* data, size_t size)
+    {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+/**
+ * Output stream buffer writing to a file descriptor and hashing the content on the fly
+ */
+class HashingFileBuf : public std::streambuf
+{
+public:
+    HashingFileBuf(int fd, const std::string& path)
+        : m_fd(fd)
+        , m_path(path)
+        , m_buffer(BULK_IO_BLOCK_SIZE)
+        , m_ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free)
+    {
+        if (!m_ctx || EVP_DigestInit_ex(m_ctx.get(), EVP_sha256(), nullptr) != 1) {
+            throw SrrException("Failed to init digest");
+        }
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    std::string digest()
+    {
+        unsigned char result[EVP_MAX_MD_SIZE];
+        unsigned int  length = 0;
+        EVP_DigestFinal_ex(m_ctx.get(), result, &length);
+
+        std::ostringstream sout;
+        sout << std::hex << std::setfill('0');
+        for (unsigned int i = 0; i < length; i++) {
+            sout << std::setw(2) << static_cast<unsigned>(result[i]);
+        }
+        return sout.str();
+    }
+
+    uint64_t size() const
+    {
+        return m_size;
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        flush();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        flush();
+        return 0;
+    }
+
+private:
+    int         m_fd;
+    std::string m_path;
+
+    std::vector<char>                                        m_buffer;
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> m_ctx;
+    uint64_t                                                 m_size = 0;
+
+    void flush()
+    {
+        const size_t pending = static_cast<size_t>(pptr() - pbase());
+        if (pending > 0) {
+            EVP_DigestUpdate(m_ctx.get(), pbase(), pending);
+            writeAll(m_fd, pbase(), pending, m_path);
+            m_size += pending;
+        }
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+};
+
+MappedFile::MappedFile(const std::string& path, bool followLinks)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | (followLinks ? 0 : O_NOFOLLOW));
+    if (m_fd < 0) {
+        throw SrrException(errnoString("Failed to open", path));
+    }
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(m_fd);
+        throw SrrException("Not a regular file: " + path);
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size == 0) {
+        m_data = "";
+        return;
+    }
+
+    void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(m_fd);
+        throw SrrException(errnoString("Failed to map", path));
+    }
+    // payloads are parsed and hashed front to back
+    madvise(addr, m_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(addr);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_size > 0) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    ::close(m_fd);
+}
+
+cxxtools::SerializationInfo parseJson(const char* data, size_t size)
+{
+    MemoryStreamBuf buffer(data, size);
+    std::istream    is(&buffer);
+
+    cxxtools::SerializationInfo si;
+    cxxtools::JsonDeserializer  deserializer(is);
+    deserializer.deserialize(si);
+
+    return si;
+}
+
+std::string readAll(int fd)
+{
+    std::string data;
+    size_t      size = 0;
+
+    for (;;) {
+        if (data.size() - size < BULK_IO_BLOCK_SIZE) {
+            data.resize(std::max(data.size() * 2, size + BULK_IO_BLOCK_SIZE));
+        }
+        ssize_t length = ::read(fd, &data[size], data.size() - size);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw SrrException(errnoString("Failed to read", "input"));
+        }
+        if (length == 0) {
+            break;
+        }
+        size += static_cast<size_t>(length);
+    }
+    data.resize(size);
+
+    return data;
+}
+
+BulkDescriptor describeBulkFile(const std::string& path)
+{
+    MappedFile file(path);
+
+    BulkDescriptor bulk;
+    bulk.m_path   = path;
+    bulk.m_size   = file.size();
+    bulk.m_digest = evalSha256(file.data(), file.size());
+
+    return bulk;
+}
+
+void makeBulkSpool(const std::string& spool)
+{
+    if (::mkdir(spool.c_str(), 0770) != 0 && errno != EEXIST) {
+        throw SrrException(errnoString("Failed to create", spool));
+    }
+
+    struct stat st;
+    if (lstat(spool.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        throw SrrException("Not a directory: " + spool);
+    }
+    // files created by the clients belong to the group of the daemon, whatever their primary group
+    if (st.st_uid == geteuid() && chmod(spool.c_str(), 02770) != 0) {
+        throw SrrException(errnoString("Failed to set the mode of", spool));
+    }
+}
+
+std::string bulkSpoolPath(const std::string& spool, const std::string& name)
+{
+    if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+        throw SrrException("Bulk file must be a file name of the spool directory: " + name);
+    }
+    return spool + "/" + name;
+}
+
+cxxtools::SerializationInfo readBulkJson(const std::string& spool, const BulkDescriptor& bulk)
+{
+    MappedFile file(bulkSpoolPath(spool, bulk.m_path), false);
+
+    if (file.size() != bulk.m_size) {
+        throw SrrException("Bulk file size mismatch: " + bulk.m_path);
+    }
+    if (evalSha256(file.data(), file.size()) != bulk.m_digest) {
+        throw SrrException("Bulk file digest mismatch: " + bulk.m_path);
+    }
+
+    return parseJson(file.data(), file.size());
+}
+
+BulkDescriptor writeBulkFile(const std::string& path, const std::function<void(std::ostream&)>& writer)
+{
+    if (path.empty() || path.front() != '/') {
+        throw SrrException("Bulk file path must be absolute: " + path);
+    }
+
+    // never overwrite or follow an existing file
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        throw SrrException(errnoString("Failed to create", path));
+    }
+
+    BulkDescriptor bulk;
+    bulk.m_path = path;
+
+    try {
+        HashingFileBuf buffer(fd, path);
+        std::ostream   os(&buffer);
+        os.exceptions(std::ostream::badbit);
+
+        writer(os);
+        os.flush();
+
+        bulk.m_size   = buffer.size();
+        bulk.m_digest = buffer.digest();
+
+        if (fsync(fd) != 0) {
+            throw SrrException(errnoString("Failed to sync", path));
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw;
+    }
+
+    ::close(fd);
+
+    return bulk;
+}
+
+BulkDescriptor copyToBulkFile(int inputFd, const std::string& path)
+{
+    return writeBulkFile(path, [inputFd](std::ostream& os) {
+        std::vector<char> buffer(BULK_IO_BLOCK_SIZE);
+        for (;;) {
+            ssize_t length = ::read(inputFd, buffer.data(), buffer.size());
+            if (length < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw SrrException(errnoString("Failed to read", "input"));
+            }
+            if (length == 0) {
+                break;
+            }
+            os.write(buffer.data(), length);
+        }
+    });
+}
+
+} // namespace srr
@@ -0,0 +1,90 @@
+/*  =========================================================================
+    bulk_transfer - Local out of band transfer of save/restore payloads
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "dto/common.h"
+#include <cxxtools/serializationinfo.h>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace srr {
+
+/**
+ * Read only memory mapping of a whole file
+ */
+class MappedFile
+{
+public:
+    // followLinks: false to refuse a symbolic link as the last component of the path
+    explicit MappedFile(const std::string& path, bool followLinks = true);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return m_data;
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    int         m_fd   = -1;
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+};
+
+// parse JSON directly from memory, without copying it into a string first
+cxxtools::SerializationInfo parseJson(const char* data, size_t size);
+
+// read everything available on a file descriptor using large block reads
+std::string readAll(int fd);
+
+// build the descriptor (size and digest) of an existing file
+BulkDescriptor describeBulkFile(const std::string& path);
+
+/**
+ * Bulk files are only exchanged through the spool directory of the daemon: a request names a file of it, never a path.
+ * The daemon runs as its own user and neither reads nor creates files elsewhere on behalf of a client. The directory
+ * is shared with the group of the daemon (setgid), fty-srr-cmd has to run as root or as a member of this group.
+ */
+
+// create the spool directory if it does not exist yet (its parent must exist)
+void makeBulkSpool(const std::string& spool);
+
+// path of a file of the spool, name must be a plain file name
+std::string bulkSpoolPath(const std::string& spool, const std::string& name);
+
+// map the file of the spool named by the descriptor, check size and digest and parse its JSON content
+cxxtools::SerializationInfo readBulkJson(const std::string& spool, const BulkDescriptor& bulk);
+
+// create a new file and let writer fill it, digest is evaluated on the fly
+BulkDescriptor writeBulkFile(const std::string& path, const std::function<void(std::ostream&)>& writer);
+
+// create a new file with everything available on a file descriptor (e.g. stdin)
+BulkDescriptor copyToBulkFile(int inputFd, const std::string& path);
+
+} // namespace srr
@@ -0,0 +1,108 @@
+/*  =========================================================================
+    bus_pool - Pool of message bus clients
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "bus_pool.h"
+#include <fty_log.h>
+
+namespace srr {
+
+BusPool::BusPool(const std::string& clientPrefix, size_t size, std::chrono::seconds idleTimeout, Factory factory)
+    : m_clientPrefix(clientPrefix)
+    , m_size(size)
+    , m_idleTimeout(idleTimeout)
+    , m_factory(std::move(factory))
+{
+}
+
+std::chrono::seconds BusPool::idleTimeout() const
+{
+    return m_idleTimeout;
+}
+
+BusPool::Client* BusPool::lease()
+{
+    // most recently released first: the oldest idle ones get reaped
+    for (auto it = m_clients.rbegin(); it != m_clients.rend(); it++) {
+        if (!it->m_leased) {
+            it->m_leased = true;
+            return &(*it);
+        }
+    }
+
+    if (m_clients.size() >= m_size) {
+        return nullptr;
+    }
+
+    Client client;
+    client.m_id  = m_clientPrefix + "-" + std::to_string(m_nextId++);
+    client.m_bus = m_factory(client.m_id);
+
+    log_debug("Bus client %s connected (%zu in pool)", client.m_id.c_str(), m_clients.size() + 1);
+
+    client.m_leased = true;
+    m_clients.push_back(std::move(client));
+    return &m_clients.back();
+}
+
+void BusPool::release(Client* client)
+{
+    client->m_leased    = false;
+    client->m_idleSince = std::chrono::steady_clock::now();
+
+    // keep the list ordered by release time
+    for (auto it = m_clients.begin(); it != m_clients.end(); it++) {
+        if (&(*it) == client) {
+            m_clients.splice(m_clients.end(), m_clients, it);
+            break;
+        }
+    }
+}
+
+size_t BusPool::reap()
+{
+    const auto now    = std::chrono::steady_clock::now();
+    size_t     reaped = 0;
+
+    for (auto it = m_clients.begin(); it != m_clients.end();) {
+        if (!it->m_leased && now - it->m_idleSince >= m_idleTimeout) {
+            log_debug("Bus client %s idle, disconnected", it->m_id.c_str());
+            it = m_clients.erase(it);
+            reaped++;
+        } else {
+            it++;
+        }
+    }
+
+    return reaped;
+}
+
+size_t BusPool::idle() const
+{
+    size_t count = 0;
+    for (const auto& client : m_clients) {
+        if (!client.m_leased) {
+            count++;
+        }
+    }
+    return count;
+}
+
+} // namespace srr
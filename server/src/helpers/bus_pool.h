@@ -0,0 +1,76 @@
+/*  =========================================================================
+    bus_pool - Pool of message bus clients
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <fty_common_messagebus.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+namespace srr {
+
+/**
+ * Back-end bus clients, each with its own client id, leased for the time of one request.
+ * Clients are connected on demand up to the size of the pool and disconnected after staying idle for the idle
+ * timeout. Not thread safe: the pool is used by the thread of the event loop only.
+ */
+class BusPool
+{
+public:
+    // connected client with clientId
+    using Factory = std::function<std::unique_ptr<messagebus::MessageBus>(const std::string& clientId)>;
+
+    struct Client
+    {
+        std::string                             m_id;
+        std::unique_ptr<messagebus::MessageBus> m_bus;
+        std::chrono::steady_clock::time_point   m_idleSince;
+        bool                                    m_leased = false;
+    };
+
+    // client ids are clientPrefix-1, clientPrefix-2...
+    BusPool(const std::string& clientPrefix, size_t size, std::chrono::seconds idleTimeout, Factory factory);
+
+    std::chrono::seconds idleTimeout() const;
+
+    // idle client, connected if needed. nullptr if all the clients are leased.
+    Client* lease();
+    void    release(Client* client);
+
+    // disconnect the clients idle for longer than the idle timeout, returns their number
+    size_t reap();
+    // clients not leased
+    size_t idle() const;
+
+private:
+    std::string          m_clientPrefix;
+    size_t               m_size;
+    std::chrono::seconds m_idleTimeout;
+    Factory              m_factory;
+    unsigned             m_nextId = 1;
+
+    std::list<Client> m_clients;
+};
+
+} // namespace srr
@@ -0,0 +1,66 @@
+/*  =========================================================================
+    clock - Steady or virtual time of the worker
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "helpers/clock.h"
+
+namespace srr {
+
+Clock::time_point SteadyClock::now() const
+{
+    return std::chrono::steady_clock::now();
+}
+
+VirtualClock::VirtualClock(time_point start)
+    : m_now(start.time_since_epoch().count())
+{
+}
+
+Clock::time_point VirtualClock::now() const
+{
+    return time_point(time_point::duration(m_now.load()));
+}
+
+void VirtualClock::advance(std::chrono::milliseconds duration)
+{
+    m_now += std::chrono::duration_cast<time_point::duration>(duration).count();
+}
+
+void VirtualClock::advanceTo(time_point time)
+{
+    const time_point::rep target = time.time_since_epoch().count();
+    time_point::rep       now    = m_now.load();
+    // now is reloaded when another thread moved the time meanwhile
+    while (now < target && !m_now.compare_exchange_weak(now, target)) {
+    }
+}
+
+std::shared_ptr<Clock> steadyClock()
+{
+    static std::shared_ptr<Clock> clock = std::make_shared<SteadyClock>();
+    return clock;
+}
+
+uint64_t elapsedMs(const Clock& clock, Clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(clock.now() - start).count());
+}
+
+} // namespace srr
@@ -0,0 +1,74 @@
+/*  =========================================================================
+    clock - Steady or virtual time of the worker
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace srr {
+
+/**
+ * Time of the worker: delays, timeouts, deadlines and measured durations.
+ * The steady clock in the agent. In the simulations, a virtual clock moved forward by the event loop when it has
+ * nothing else to run, so that waiting takes no wall time.
+ */
+class Clock
+{
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    virtual ~Clock() = default;
+
+    virtual time_point now() const = 0;
+};
+
+class SteadyClock : public Clock
+{
+public:
+    time_point now() const override;
+};
+
+// time moved by advance only, readable from any thread
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(time_point start = time_point());
+
+    time_point now() const override;
+
+    void advance(std::chrono::milliseconds duration);
+    // no effect if time is in the past
+    void advanceTo(time_point time);
+
+private:
+    std::atomic<time_point::rep> m_now;
+};
+
+// shared steady clock, default of the worker
+std::shared_ptr<Clock> steadyClock();
+
+// milliseconds elapsed on clock since start
+uint64_t elapsedMs(const Clock& clock, Clock::time_point start);
+
+} // namespace srr
@@ -22,6 +22,8 @@
 #include "helpers/data_integrity.h"
 #include "fty_srr_exception.h"
 #include "fty_srr_groups.h"
+#include "helpers/parallel.h"
+#include "helpers/probes.h"
 #include <cxxtools/serializationinfo.h>
 #include <dto/common.h>
 #include <fty_common.h>
@@ -31,9 +33,14 @@
 namespace srr {
 
 std::string evalSha256(const std::string& data)
+{
+    return evalSha256(data.c_str(), data.length());
+}
+
+std::string evalSha256(const char* data, size_t size)
 {
     unsigned char result[SHA256_DIGEST_LENGTH];
-    SHA256(const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(data.c_str())), data.length(), result);
+    SHA256(reinterpret_cast<const unsigned char*>(data), size, result);
 
     std::ostringstream sout;
     sout << std::hex << std::setfill('0');
@@ -44,13 +51,50 @@ std::string evalSha256(const std::string& data)
     return sout.str();
 }
 
-void evalDataIntegrity(Group& group)
+std::string evalFeatureIntegrity(const SrrFeature& feature)
+{
+    cxxtools::SerializationInfo tmpSi;
+    tmpSi <<= feature;
+    return evalSha256(dto::srr::serializeJson(tmpSi, false));
+}
+
+// root over the feature digests, in name order so that it does not depend on the features order
+static std::string evalMerkleRoot(const std::map<std::string, std::string>& featuresIntegrity)
+{
+    std::string data;
+    for (const auto& digest : featuresIntegrity) {
+        data += digest.first + ":" + digest.second + "\n";
+    }
+    return evalSha256(data);
+}
+
+static std::vector<std::string> evalFeaturesDigests(const Group& group)
+{
+    std::vector<std::string> digests(group.m_features.size());
+    parallelFor(group.m_features.size(), [&](size_t i) {
+        digests[i] = evalFeatureIntegrity(group.m_features[i]);
+    });
+    return digests;
+}
+
+static void evalGroupIntegrity(Group& group)
 {
     // sort features by priority
     std::sort(group.m_features.begin(), group.m_features.end(), [&](SrrFeature l, SrrFeature r) {
         return getPriority(l.m_feature_name) < getPriority(r.m_feature_name);
     });
 
+    if (group.m_integrity_scheme == INTEGRITY_SCHEME_MERKLE) {
+        const std::vector<std::string> digests = evalFeaturesDigests(group);
+
+        group.m_features_integrity.clear();
+        for (size_t i = 0; i < digests.size(); i++) {
+            group.m_features_integrity[group.m_features[i].m_feature_name] = digests[i];
+        }
+        group.m_data_integrity = evalMerkleRoot(group.m_features_integrity);
+        return;
+    }
+
     // evaluate data integrity
     cxxtools::SerializationInfo tmpSi;
     tmpSi <<= group.m_features;
@@ -59,8 +103,49 @@ void evalDataIntegrity(Group& group)
     group.m_data_integrity = evalSha256(data);
 }
 
-bool checkDataIntegrity(const Group& group)
+// digests: of the features in their order, evaluated here if not given
+static std::vector<std::string> findCorruptedFeatures(const Group& group, const std::vector<std::string>* digests)
+{
+    std::vector<std::string> corrupted;
+
+    // without a consistent root, none of the feature digests can be trusted
+    if (evalMerkleRoot(group.m_features_integrity) != group.m_data_integrity) {
+        for (const auto& feature : group.m_features) {
+            corrupted.push_back(feature.m_feature_name);
+        }
+        return corrupted;
+    }
+
+    const std::vector<std::string> evaluated = digests != nullptr ? *digests : evalFeaturesDigests(group);
+    for (size_t i = 0; i < evaluated.size(); i++) {
+        const auto found = group.m_features_integrity.find(group.m_features[i].m_feature_name);
+        if (found == group.m_features_integrity.end() || found->second != evaluated[i]) {
+            corrupted.push_back(group.m_features[i].m_feature_name);
+        }
+    }
+
+    // features removed from the payload
+    for (const auto& digest : group.m_features_integrity) {
+        if (std::none_of(group.m_features.begin(), group.m_features.end(), [&](const SrrFeature& f) {
+                return f.m_feature_name == digest.first;
+            })) {
+            corrupted.push_back(digest.first);
+        }
+    }
+
+    return corrupted;
+}
+
+static bool checkGroupIntegrity(const Group& group)
 {
+    if (group.m_integrity_scheme == INTEGRITY_SCHEME_MERKLE) {
+        return findCorruptedFeatures(group, nullptr).empty();
+    }
+
+    if (!group.m_integrity_scheme.empty()) {
+        throw SrrException("Unsupported integrity scheme " + group.m_integrity_scheme);
+    }
+
     cxxtools::SerializationInfo tmpSi;
     tmpSi <<= group.m_features;
     const std::string data = dto::srr::serializeJson(tmpSi, false);
@@ -70,4 +155,41 @@ bool checkDataIntegrity(const Group& group)
     return checksum == group.m_data_integrity;
 }
 
+void evalDataIntegrity(Group& group)
+{
+    SRR_PROBE2(eval_integrity_entry, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()));
+    evalGroupIntegrity(group);
+    SRR_PROBE2(eval_integrity_exit, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()));
+}
+
+bool checkDataIntegrity(const Group& group)
+{
+    SRR_PROBE2(check_integrity_entry, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()));
+    const bool valid = checkGroupIntegrity(group);
+    SRR_PROBE3(check_integrity_exit, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()),
+        valid ? 0 : 1);
+    return valid;
+}
+
+std::vector<std::string> checkFeaturesIntegrity(const Group& group)
+{
+    SRR_PROBE2(check_integrity_entry, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()));
+    std::vector<std::string> corrupted = findCorruptedFeatures(group, nullptr);
+    SRR_PROBE3(check_integrity_exit, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()),
+        corrupted.empty() ? 0 : 1);
+    return corrupted;
+}
+
+std::vector<std::string> checkFeaturesIntegrity(const Group& group, const std::vector<std::string>& digests)
+{
+    if (digests.size() != group.m_features.size()) {
+        throw SrrException("Feature digests do not match the features of group " + group.m_group_id);
+    }
+    SRR_PROBE2(check_integrity_entry, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()));
+    std::vector<std::string> corrupted = findCorruptedFeatures(group, &digests);
+    SRR_PROBE3(check_integrity_exit, group.m_group_id.c_str(), static_cast<uint64_t>(group.m_features.size()),
+        corrupted.empty() ? 0 : 1);
+    return corrupted;
+}
+
 } // namespace srr
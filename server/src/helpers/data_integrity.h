@@ -21,14 +21,24 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace srr {
 
 std::string evalSha256(const std::string& data);
+std::string evalSha256(const char* data, size_t size);
 
 class Group;
+class SrrFeature;
 void evalDataIntegrity(Group& group);
 bool checkDataIntegrity(const Group& group);
 
+std::string evalFeatureIntegrity(const SrrFeature& feature);
+// merkle scheme only: names of the features which do not match their digest (all of them if the root is wrong)
+std::vector<std::string> checkFeaturesIntegrity(const Group& group);
+// same, from the digests of the features (evalFeatureIntegrity) already evaluated, in the order of the features
+std::vector<std::string> checkFeaturesIntegrity(const Group& group, const std::vector<std::string>& digests);
+
 } // namespace srr
@@ -0,0 +1,394 @@
+/*  =========================================================================
+    event_loop - Single thread event loop with timers and asynchronous requests
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "event_loop.h"
+#include "fty_srr_exception.h"
+#include "fty_srr_metrics.h"
+#include <fty_log.h>
+
+#define LOOP_TICK_MS    100
+#define LOOP_WHEEL_SIZE 512
+
+namespace srr {
+
+static thread_local EventLoop* t_currentLoop = nullptr;
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slots)
+    : m_tick(tick)
+    , m_slots(slots)
+{
+}
+
+std::chrono::milliseconds TimerWheel::tick() const
+{
+    return m_tick;
+}
+
+TimerWheel::TimerId TimerWheel::add(std::chrono::milliseconds delay, Task task)
+{
+    // expires after ticks calls to advance, at least one
+    const uint64_t ticks =
+        std::max<uint64_t>(1, static_cast<uint64_t>((delay.count() + m_tick.count() - 1) / m_tick.count()));
+    const size_t slot = (m_cursor + ticks) % m_slots.size();
+
+    const TimerId id = m_nextId++;
+    m_slots[slot].push_back(Timer{id, (ticks - 1) / m_slots.size(), std::move(task)});
+    m_timers[id] = {slot, std::prev(m_slots[slot].end())};
+
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    auto found = m_timers.find(id);
+    if (found == m_timers.end()) {
+        return false;
+    }
+
+    m_slots[found->second.first].erase(found->second.second);
+    m_timers.erase(found);
+    return true;
+}
+
+std::vector<TimerWheel::Task> TimerWheel::advance()
+{
+    std::vector<Task> expired;
+
+    m_cursor   = (m_cursor + 1) % m_slots.size();
+    auto& slot = m_slots[m_cursor];
+    for (auto it = slot.begin(); it != slot.end();) {
+        if (it->m_rounds == 0) {
+            expired.push_back(std::move(it->m_task));
+            m_timers.erase(it->m_id);
+            it = slot.erase(it);
+        } else {
+            it->m_rounds--;
+            it++;
+        }
+    }
+
+    return expired;
+}
+
+bool TimerWheel::empty() const
+{
+    return m_timers.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+EventLoop::EventLoop(std::shared_ptr<Clock> clock)
+    : m_clock(clock)
+    , m_virtualClock(dynamic_cast<VirtualClock*>(clock.get()))
+    , m_wheel(std::chrono::milliseconds(LOOP_TICK_MS), LOOP_WHEEL_SIZE)
+{
+    m_thread = std::thread(&EventLoop::run, this);
+}
+
+EventLoop::~EventLoop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void EventLoop::post(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+EventLoop::TimerId EventLoop::schedule(std::chrono::milliseconds delay, Task task)
+{
+    if (!inLoop()) {
+        throw std::logic_error("Timers must be scheduled from the event loop");
+    }
+    return m_wheel.add(delay, std::move(task));
+}
+
+void EventLoop::cancel(TimerId id)
+{
+    m_wheel.cancel(id);
+}
+
+bool EventLoop::inLoop() const
+{
+    return std::this_thread::get_id() == m_thread.get_id();
+}
+
+EventLoop* EventLoop::current()
+{
+    return t_currentLoop;
+}
+
+const Clock& EventLoop::clock() const
+{
+    return *m_clock;
+}
+
+void EventLoop::beginWait()
+{
+    m_waiters++;
+}
+
+void EventLoop::endWait()
+{
+    m_waiters--;
+}
+
+void EventLoop::attach(messagebus::MessageBus& msgBus, const std::string& replyQueue)
+{
+    m_msgBus     = &msgBus;
+    m_replyQueue = replyQueue;
+
+    m_msgBus->receive(m_replyQueue, replyListener());
+}
+
+void EventLoop::setPool(std::unique_ptr<BusPool> pool)
+{
+    m_pool = std::move(pool);
+}
+
+std::function<void(messagebus::Message)> EventLoop::replyListener()
+{
+    // called by the message bus thread: the reply is handled by the loop
+    return [this](messagebus::Message message) {
+        post([this, message]() {
+            onReply(message);
+        });
+    };
+}
+
+void EventLoop::request(const std::string& queue, messagebus::Message message, int timeout, ReplyHandler handler)
+{
+    if (!m_msgBus) {
+        throw std::logic_error("Event loop is not attached to a message bus");
+    }
+
+    auto correlationId = message.metaData().find(messagebus::Message::CORRELATION_ID);
+    if (correlationId == message.metaData().end()) {
+        correlationId =
+            message.metaData().emplace(messagebus::Message::CORRELATION_ID, messagebus::generateUuid()).first;
+    }
+    const std::string id = correlationId->second;
+    message.metaData()[messagebus::Message::REPLY_TO] = m_replyQueue;
+
+    // the timeout includes the wait for a client of the pool
+    TimerId timer = schedule(std::chrono::seconds(timeout), [this, id]() {
+        metrics().m_timeouts++;
+        complete(id, std::make_exception_ptr(SrrException("Request timeout")), messagebus::Message());
+    });
+    PendingRequest& pending = m_pending[id];
+    pending.m_handler       = std::move(handler);
+    pending.m_timer         = timer;
+    metrics().m_pendingRequests++;
+
+    if (!m_pool) {
+        send(id, queue, message, *m_msgBus);
+        return;
+    }
+
+    pending.m_queue   = queue;
+    pending.m_message = std::move(message);
+    m_waiting.push_back(id);
+    metrics().m_queueDepth++;
+    sendWaiting();
+}
+
+void EventLoop::send(
+    const std::string& id, const std::string& queue, const messagebus::Message& message, messagebus::MessageBus& msgBus)
+{
+    try {
+        msgBus.sendRequest(queue, message);
+    } catch (const std::exception& ex) {
+        complete(id, std::make_exception_ptr(SrrException(ex.what())), messagebus::Message());
+    }
+}
+
+void EventLoop::sendWaiting()
+{
+    while (!m_waiting.empty()) {
+        const std::string id = m_waiting.front();
+
+        auto pending = m_pending.find(id);
+        if (pending == m_pending.end()) {
+            // timed out while waiting
+            m_waiting.pop_front();
+            metrics().m_queueDepth--;
+            continue;
+        }
+
+        BusPool::Client* client = nullptr;
+        try {
+            client = m_pool->lease();
+        } catch (const std::exception& ex) {
+            m_waiting.pop_front();
+            metrics().m_queueDepth--;
+            complete(id, std::make_exception_ptr(SrrException(ex.what())), messagebus::Message());
+            continue;
+        }
+        if (!client) {
+            // sent when a client is released
+            return;
+        }
+        m_waiting.pop_front();
+        metrics().m_queueDepth--;
+
+        pending->second.m_client    = client;
+        messagebus::Message message = std::move(pending->second.m_message);
+        const std::string   queue   = pending->second.m_queue;
+
+        // the reply is routed to the client which sent the request
+        message.metaData()[messagebus::Message::FROM] = client->m_id;
+        send(id, queue, message, *client->m_bus);
+    }
+}
+
+void EventLoop::complete(const std::string& id, std::exception_ptr error, messagebus::Message reply)
+{
+    auto pending = m_pending.find(id);
+    if (pending == m_pending.end()) {
+        return;
+    }
+
+    ReplyHandler     handler = std::move(pending->second.m_handler);
+    BusPool::Client* client  = pending->second.m_client;
+    cancel(pending->second.m_timer);
+    m_pending.erase(pending);
+    metrics().m_pendingRequests--;
+
+    if (client) {
+        m_pool->release(client);
+        armReap();
+        sendWaiting();
+    }
+
+    handler(error, reply);
+}
+
+void EventLoop::armReap()
+{
+    if (m_reapArmed || m_pool->idle() == 0) {
+        return;
+    }
+
+    m_reapArmed = true;
+    schedule(m_pool->idleTimeout(), [this]() {
+        m_reapArmed = false;
+        m_pool->reap();
+        armReap();
+    });
+}
+
+void EventLoop::onReply(messagebus::Message message)
+{
+    auto correlationId = message.metaData().find(messagebus::Message::CORRELATION_ID);
+    if (correlationId == message.metaData().end()) {
+        log_warning("Reply without correlation id dropped");
+        return;
+    }
+
+    if (m_pending.find(correlationId->second) == m_pending.end()) {
+        // late reply of a request which timed out
+        log_warning("Reply to unknown request %s dropped", correlationId->second.c_str());
+        return;
+    }
+
+    complete(correlationId->second, nullptr, message);
+}
+
+void EventLoop::run()
+{
+    t_currentLoop = this;
+
+    auto nextTick = m_clock->now() + m_wheel.tick();
+
+    while (true) {
+        std::deque<Task> tasks;
+        bool             idle = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // no timer: wait for a task only
+            if (m_wheel.empty()) {
+                m_cv.wait(lock, [this] {
+                    return m_stop || !m_tasks.empty();
+                });
+                nextTick = m_clock->now() + m_wheel.tick();
+            } else if (m_virtualClock) {
+                // the time moves only while a thread waits for the loop
+                m_cv.wait(lock, [this] {
+                    return m_stop || !m_tasks.empty() || m_waiters > 0;
+                });
+                idle = m_tasks.empty();
+            } else {
+                m_cv.wait_until(lock, nextTick, [this] {
+                    return m_stop || !m_tasks.empty();
+                });
+            }
+            if (m_stop) {
+                break;
+            }
+            tasks.swap(m_tasks);
+        }
+
+        for (auto& task : tasks) {
+            try {
+                task();
+            } catch (const std::exception& ex) {
+                log_error("Event loop task failed: %s", ex.what());
+            }
+        }
+
+        if (idle) {
+            m_virtualClock->advanceTo(nextTick);
+        }
+
+        // catch up with the ticks elapsed meanwhile
+        const auto now = m_clock->now();
+        while (nextTick <= now) {
+            for (auto& task : m_wheel.advance()) {
+                try {
+                    task();
+                } catch (const std::exception& ex) {
+                    log_error("Event loop timer failed: %s", ex.what());
+                }
+            }
+            nextTick += m_wheel.tick();
+        }
+    }
+
+    // the pending requests will never get their reply
+    metrics().m_queueDepth -= static_cast<int64_t>(m_waiting.size());
+    metrics().m_pendingRequests -= static_cast<int64_t>(m_pending.size());
+    m_waiting.clear();
+    for (auto& pending : m_pending) {
+        pending.second.m_handler(std::make_exception_ptr(SrrException("Event loop stopped")), messagebus::Message());
+    }
+    m_pending.clear();
+}
+
+} // namespace srr
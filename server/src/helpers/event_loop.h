@@ -0,0 +1,162 @@
+/*  =========================================================================
+    event_loop - Single thread event loop with timers and asynchronous requests
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "bus_pool.h"
+#include "clock.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fty_common_messagebus.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace srr {
+
+/**
+ * Hashed timer wheel: a timer is put in the slot of its expiry tick, with the number of turns left before it
+ * expires. Adding, cancelling and expiring a timer does not depend on the number of timers.
+ */
+class TimerWheel
+{
+public:
+    using TimerId = uint64_t;
+    using Task    = std::function<void()>;
+
+    TimerWheel(std::chrono::milliseconds tick, size_t slots);
+
+    std::chrono::milliseconds tick() const;
+
+    TimerId add(std::chrono::milliseconds delay, Task task);
+    bool    cancel(TimerId id);
+    // move one tick forward, returns the expired tasks
+    std::vector<Task> advance();
+    bool              empty() const;
+
+private:
+    struct Timer
+    {
+        TimerId  m_id;
+        uint64_t m_rounds;
+        Task     m_task;
+    };
+
+    std::chrono::milliseconds                                           m_tick;
+    std::vector<std::list<Timer>>                                       m_slots;
+    size_t                                                              m_cursor = 0;
+    TimerId                                                             m_nextId = 1;
+    std::unordered_map<TimerId, std::pair<size_t, std::list<Timer>::iterator>> m_timers;
+};
+
+/**
+ * Event loop run by one thread: posted tasks, timers and replies of asynchronous requests are all run by it,
+ * so the operations it drives never block a thread while waiting.
+ * Requests are sent with a reply queue of the loop, their replies are matched by correlation id.
+ * With a virtual clock, the time jumps to the next tick as soon as the loop has nothing to run while a thread waits
+ * for it (runSync): what the loop waits for must then come from its own timers, not from another thread.
+ */
+class EventLoop
+{
+public:
+    using Task         = std::function<void()>;
+    using TimerId      = TimerWheel::TimerId;
+    using ReplyHandler = std::function<void(std::exception_ptr, messagebus::Message)>;
+
+    explicit EventLoop(std::shared_ptr<Clock> clock = steadyClock());
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void post(Task task);
+    // timers and requests are handled by the loop thread only: call them from a posted task or a callback
+    TimerId schedule(std::chrono::milliseconds delay, Task task);
+    void    cancel(TimerId id);
+    // true in the thread of the loop
+    bool inLoop() const;
+    // loop of the calling thread, nullptr if it is not the thread of a loop
+    static EventLoop* current();
+
+    const Clock& clock() const;
+    // a thread waits for the end of an operation of the loop (runSync), called by the loop at its start and its end
+    void beginWait();
+    void endWait();
+
+    // receive the replies of the asynchronous requests from replyQueue of msgBus
+    void attach(messagebus::MessageBus& msgBus, const std::string& replyQueue);
+    // send the requests with clients leased from pool instead of the attached bus, each client must receive the
+    // replies from the reply queue with replyListener. To set before the first request.
+    void setPool(std::unique_ptr<BusPool> pool);
+    std::function<void(messagebus::Message)> replyListener();
+    // send a request, handler gets the reply (or the error: timeout, send failure) in the loop
+    void request(const std::string& queue, messagebus::Message message, int timeout, ReplyHandler handler);
+
+private:
+    struct PendingRequest
+    {
+        ReplyHandler        m_handler;
+        TimerId             m_timer  = 0;
+        BusPool::Client*    m_client = nullptr;
+        std::string         m_queue;   // until sent
+        messagebus::Message m_message; // until sent
+    };
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Task>        m_tasks;
+    bool                    m_stop = false;
+
+    std::shared_ptr<Clock> m_clock;
+    VirtualClock*          m_virtualClock = nullptr; // m_clock, if virtual
+
+    // used by the loop thread only
+    TimerWheel                                      m_wheel;
+    std::unordered_map<std::string, PendingRequest> m_pending;
+    std::deque<std::string>                         m_waiting; // requests waiting for a client of the pool
+    bool                                            m_reapArmed = false;
+    unsigned                                        m_waiters   = 0; // operations waited for by another thread
+
+    messagebus::MessageBus*  m_msgBus = nullptr;
+    std::string              m_replyQueue;
+    std::unique_ptr<BusPool> m_pool;
+
+    std::thread m_thread;
+
+    void run();
+    void onReply(messagebus::Message message);
+    void send(const std::string& id, const std::string& queue, const messagebus::Message& message,
+        messagebus::MessageBus& msgBus);
+    void sendWaiting();
+    // end of a request: its client goes back to the pool and its handler is called
+    void complete(const std::string& id, std::exception_ptr error, messagebus::Message reply);
+    void armReap();
+};
+
+} // namespace srr
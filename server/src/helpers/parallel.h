@@ -0,0 +1,33 @@
+/*  =========================================================================
+    parallel - Run independent tasks on all cores
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace srr {
+
+// call task(i) for i in [0, count) from up to maxThreads threads (0: one per core)
+// the first exception thrown by a task is rethrown once all threads are done
+void parallelFor(size_t count, const std::function<void(size_t)>& task, unsigned maxThreads = 0);
+
+} // namespace srr
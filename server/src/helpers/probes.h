@@ -0,0 +1,87 @@
+/*  =========================================================================
+    probes - USDT static probes of the agent
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+/**
+ * Probes of the provider fty_srr, for bpftrace/perf/systemtap (usdt:/usr/bin/fty-srr:fty_srr:<name>).
+ * A disabled probe is a nop instruction. Without sys/sdt.h (systemtap-sdt-dev), the probes are compiled out.
+ *
+ * Strings are passed as char*, sizes as uint64_t, statuses as int (0: success).
+ *   save_feature_entry(feature, agent)               save_feature_exit(feature, agent, bytes, status)
+ *   restore_feature_entry(feature, agent, bytes)     restore_feature_exit(feature, agent, bytes, status)
+ *   reset_feature_entry(feature, agent)              reset_feature_exit(feature, agent, status)
+ *   rollback_entry(features)                         rollback_exit(features, status)
+ *   eval_integrity_entry(group, features)            eval_integrity_exit(group, features)
+ *   check_integrity_entry(group, features)           check_integrity_exit(group, features, status)
+ *   send_request_entry(agent, action, bytes, id)     send_request_exit(agent, action, bytes, status, id)
+ * restore_feature_* also fire for the prepare of a two-phase restore. id matches the exit of a request to its entry.
+ */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SRR_PROBES_ENABLED
+#endif
+#endif
+
+#ifdef SRR_PROBES_ENABLED
+
+#define SRR_PROBE1(name, a1)                 DTRACE_PROBE1(fty_srr, name, a1)
+#define SRR_PROBE2(name, a1, a2)             DTRACE_PROBE2(fty_srr, name, a1, a2)
+#define SRR_PROBE3(name, a1, a2, a3)         DTRACE_PROBE3(fty_srr, name, a1, a2, a3)
+#define SRR_PROBE4(name, a1, a2, a3, a4)     DTRACE_PROBE4(fty_srr, name, a1, a2, a3, a4)
+#define SRR_PROBE5(name, a1, a2, a3, a4, a5) DTRACE_PROBE5(fty_srr, name, a1, a2, a3, a4, a5)
+
+#else
+
+#define SRR_PROBE1(name, a1)                                                                                          \
+    do {                                                                                                               \
+        (void)(a1);                                                                                                    \
+    } while (0)
+#define SRR_PROBE2(name, a1, a2)                                                                                      \
+    do {                                                                                                               \
+        (void)(a1);                                                                                                    \
+        (void)(a2);                                                                                                    \
+    } while (0)
+#define SRR_PROBE3(name, a1, a2, a3)                                                                                  \
+    do {                                                                                                               \
+        (void)(a1);                                                                                                    \
+        (void)(a2);                                                                                                    \
+        (void)(a3);                                                                                                    \
+    } while (0)
+#define SRR_PROBE4(name, a1, a2, a3, a4)                                                                              \
+    do {                                                                                                               \
+        (void)(a1);                                                                                                    \
+        (void)(a2);                                                                                                    \
+        (void)(a3);                                                                                                    \
+        (void)(a4);                                                                                                    \
+    } while (0)
+#define SRR_PROBE5(name, a1, a2, a3, a4, a5)                                                                          \
+    do {                                                                                                               \
+        (void)(a1);                                                                                                    \
+        (void)(a2);                                                                                                    \
+        (void)(a3);                                                                                                    \
+        (void)(a4);                                                                                                    \
+        (void)(a5);                                                                                                    \
+    } while (0)
+
+#endif
@@ -0,0 +1,305 @@
+/*  =========================================================================
+    step - Asynchronous steps run by the event loop
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "step.h"
+#include "event_loop.h"
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+namespace srr {
+
+namespace {
+
+    // runs the steps of forEach: a step ending at once continues in the same call instead of nesting one more
+    class StepRunner : public std::enable_shared_from_this<StepRunner>
+    {
+    public:
+        StepRunner(size_t count, std::function<Step(size_t)> make, StepDone done)
+            : m_count(count)
+            , m_make(std::move(make))
+            , m_done(std::move(done))
+        {
+        }
+
+        void run()
+        {
+            while (m_index < m_count) {
+                auto self = shared_from_this();
+
+                m_inStep      = true;
+                m_endedInStep = false;
+
+                Step step;
+                try {
+                    step = m_make(m_index);
+                } catch (...) {
+                    m_inStep = false;
+                    m_done(std::current_exception());
+                    return;
+                }
+                invokeStep(step, [self](std::exception_ptr error) {
+                    self->stepDone(error);
+                });
+
+                m_inStep = false;
+                if (!m_endedInStep) {
+                    // resumed by stepDone
+                    return;
+                }
+                if (m_error) {
+                    m_done(m_error);
+                    return;
+                }
+            }
+            m_done(nullptr);
+        }
+
+    private:
+        size_t                      m_count;
+        std::function<Step(size_t)> m_make;
+        StepDone                    m_done;
+
+        size_t             m_index       = 0;
+        bool               m_inStep      = false;
+        bool               m_endedInStep = false;
+        std::exception_ptr m_error;
+
+        void stepDone(std::exception_ptr error)
+        {
+            m_index++;
+            m_error = error;
+
+            if (m_inStep) {
+                m_endedInStep = true;
+                return;
+            }
+            if (m_error) {
+                m_done(m_error);
+                return;
+            }
+            run();
+        }
+    };
+
+    // state of parallel, used by the loop thread only
+    struct ParallelRun
+    {
+        size_t                      m_count;
+        size_t                      m_maxConcurrent;
+        std::function<Step(size_t)> m_make;
+        StepDone                    m_done;
+
+        size_t             m_next    = 0;
+        size_t             m_running = 0;
+        std::exception_ptr m_error;
+    };
+
+    void startNext(const std::shared_ptr<ParallelRun>& run)
+    {
+        while (!run->m_error && run->m_next < run->m_count && run->m_running < run->m_maxConcurrent) {
+            const size_t index = run->m_next++;
+            run->m_running++;
+
+            Step step;
+            try {
+                step = run->m_make(index);
+            } catch (...) {
+                run->m_error = std::current_exception();
+                run->m_running--;
+                break;
+            }
+            invokeStep(step, [run](std::exception_ptr error) {
+                run->m_running--;
+                if (error && !run->m_error) {
+                    run->m_error = error;
+                }
+                startNext(run);
+            });
+        }
+
+        if (run->m_running == 0 && (run->m_error || run->m_next == run->m_count) && run->m_done) {
+            // done only once: the last completion gets here
+            StepDone done = std::move(run->m_done);
+            run->m_done   = nullptr;
+            done(run->m_error);
+        }
+    }
+
+} // namespace
+
+void invokeStep(const Step& step, StepDone done)
+{
+    // done must not be called twice: an exception thrown by done itself is not the error of the step
+    auto called = std::make_shared<bool>(false);
+    try {
+        step([called, done](std::exception_ptr error) {
+            *called = true;
+            done(error);
+        });
+    } catch (...) {
+        if (*called) {
+            throw;
+        }
+        done(std::current_exception());
+    }
+}
+
+Step sequence(std::vector<Step> steps)
+{
+    auto shared = std::make_shared<std::vector<Step>>(std::move(steps));
+    return forEach(shared->size(), [shared](size_t i) {
+        return (*shared)[i];
+    });
+}
+
+Step forEach(size_t count, std::function<Step(size_t)> make)
+{
+    return [count, make](StepDone done) {
+        std::make_shared<StepRunner>(count, make, done)->run();
+    };
+}
+
+Step parallel(size_t count, size_t maxConcurrent, std::function<Step(size_t)> make)
+{
+    return [count, maxConcurrent, make](StepDone done) {
+        auto run             = std::make_shared<ParallelRun>();
+        run->m_count         = count;
+        run->m_maxConcurrent = std::max<size_t>(1, maxConcurrent);
+        run->m_make          = make;
+        run->m_done          = done;
+
+        startNext(run);
+    };
+}
+
+Step defer(std::function<Step()> make)
+{
+    return [make](StepDone done) {
+        invokeStep(make(), done);
+    };
+}
+
+Step when(std::function<bool()> cond, Step step)
+{
+    return [cond, step](StepDone done) {
+        if (!cond()) {
+            done(nullptr);
+            return;
+        }
+        invokeStep(step, done);
+    };
+}
+
+Step call(std::function<void()> fn)
+{
+    return [fn](StepDone done) {
+        fn();
+        done(nullptr);
+    };
+}
+
+Step delay(EventLoop& loop, std::chrono::milliseconds duration)
+{
+    return [&loop, duration](StepDone done) {
+        loop.schedule(duration, [done]() {
+            done(nullptr);
+        });
+    };
+}
+
+Step attempt(Step step, std::function<std::exception_ptr(std::exception_ptr)> onError)
+{
+    return [step, onError](StepDone done) {
+        invokeStep(step, [onError, done](std::exception_ptr error) {
+            if (!error) {
+                done(nullptr);
+                return;
+            }
+            std::exception_ptr result;
+            try {
+                result = onError(error);
+            } catch (...) {
+                result = std::current_exception();
+            }
+            done(result);
+        });
+    };
+}
+
+Step finally(Step step, std::function<void()> fn)
+{
+    return [step, fn](StepDone done) {
+        invokeStep(step, [fn, done](std::exception_ptr error) {
+            fn();
+            done(error);
+        });
+    };
+}
+
+Step observe(Step step, std::function<void(std::exception_ptr)> fn)
+{
+    return [step, fn](StepDone done) {
+        invokeStep(step, [fn, done](std::exception_ptr error) {
+            fn(error);
+            done(error);
+        });
+    };
+}
+
+std::string errorMessage(std::exception_ptr error)
+{
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& ex) {
+        return ex.what();
+    } catch (...) {
+        return "Unknown error";
+    }
+}
+
+void runSync(EventLoop& loop, Step step)
+{
+    if (loop.inLoop()) {
+        throw std::logic_error("runSync called from the event loop");
+    }
+
+    auto promise = std::make_shared<std::promise<void>>();
+    auto result  = promise->get_future();
+
+    loop.post([&loop, step, promise]() {
+        // with a virtual clock, the time of the loop moves only while the step is waited for
+        loop.beginWait();
+        invokeStep(step, [&loop, promise](std::exception_ptr error) {
+            loop.endWait();
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value();
+            }
+        });
+    });
+
+    result.get();
+}
+
+} // namespace srr
@@ -0,0 +1,72 @@
+/*  =========================================================================
+    step - Asynchronous steps run by the event loop
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace srr {
+
+class EventLoop;
+
+// end of a step: nullptr on success, the error otherwise
+using StepDone = std::function<void(std::exception_ptr)>;
+// asynchronous operation run by the event loop, calls done exactly once (an exception thrown before is its error)
+using Step = std::function<void(StepDone)>;
+
+// run step, done gets its error if it throws. Not named invoke: std::invoke, found by argument-dependent lookup on
+// Step, would be a better match for a lambda than StepDone and would let the exceptions through.
+void invokeStep(const Step& step, StepDone done);
+
+// run the steps one after the other, stop at the first error
+Step sequence(std::vector<Step> steps);
+// run make(i)() for each i in [0, count) one after the other, each step is made when its turn comes
+Step forEach(size_t count, std::function<Step(size_t)> make);
+// run make(i)() for each i in [0, count), up to maxConcurrent at once, started in index order. After the first error
+// no step is started anymore, the error is reported once the running ones are done.
+Step parallel(size_t count, size_t maxConcurrent, std::function<Step(size_t)> make);
+// step made when its turn comes, to use the results of the previous ones
+Step defer(std::function<Step()> make);
+// run step only if cond() is true when its turn comes
+Step when(std::function<bool()> cond, Step step);
+// synchronous step
+Step call(std::function<void()> fn);
+// wait without holding a thread
+Step delay(EventLoop& loop, std::chrono::milliseconds duration);
+// on error, onError returns the error to propagate, or nullptr to go on
+Step attempt(Step step, std::function<std::exception_ptr(std::exception_ptr)> onError);
+// run always after step, whatever its result
+Step finally(Step step, std::function<void()> fn);
+// run fn with the result of step, which is kept
+Step observe(Step step, std::function<void(std::exception_ptr)> fn);
+
+// message of an error, for the logs and the statuses
+std::string errorMessage(std::exception_ptr error);
+
+// run step in the loop and wait for its end, its error is rethrown (not from the loop thread)
+void runSync(EventLoop& loop, Step step);
+
+} // namespace srr
@@ -27,7 +27,617 @@
     =========================================================================
 */
 
-#include "fty_srr_classes.h"
+#include "dto/common.h"
+#include "dto/response.h"
+#include "fty_srr_exception.h"
+#include "fty_srr_job.h"
+#include "fty_srr_store.h"
+#include "helpers/backup_diff.h"
+#include "helpers/base64.h"
+#include "helpers/data_integrity.h"
+#include "helpers/event_loop.h"
+#include "helpers/step.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <fty_common_dto.h>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#ifndef streq
+#define streq(s1, s2) (!strcmp((s1), (s2)))
+#endif
+
+using namespace srr;
+
+//  -------------------------------------------------------------------------
+//  Helpers of the tests.
+//
+
+static std::string
+read_fixture (const std::string &name)
+{
+    //  the tests are run from the tests directory
+    std::ifstream file ("fixtures/" + name);
+    assert (file);
+    std::ostringstream content;
+    content << file.rdbuf ();
+    return content.str ();
+}
+
+static SrrFeature
+make_feature (const std::string &name, const std::string &data)
+{
+    SrrFeature feature;
+    feature.m_feature_name = name;
+    feature.m_feature_and_status.mutable_feature ()->set_version ("1.0");
+    feature.m_feature_and_status.mutable_feature ()->set_data (data);
+    feature.m_feature_and_status.mutable_status ()->set_status (dto::srr::Status::SUCCESS);
+    return feature;
+}
+
+static std::vector<std::string>
+list_directory (const std::string &path)
+{
+    std::vector<std::string> entries;
+    DIR *dir = opendir (path.c_str ());
+    assert (dir);
+    while (struct dirent *entry = readdir (dir)) {
+        if (entry->d_name [0] != '.')
+            entries.push_back (entry->d_name);
+    }
+    closedir (dir);
+    return entries;
+}
+
+template <typename Fn>
+static bool
+throws (Fn fn)
+{
+    try {
+        fn ();
+    }
+    catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+//  -------------------------------------------------------------------------
+//  Base64 encoding of the opaque feature data (payload version 2.2).
+//
+
+static void
+base64_test (bool verbose)
+{
+    printf (" * base64: ");
+
+    //  RFC 4648 test vectors
+    const char *vectors [][2] = {
+        {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}
+    };
+    for (const auto &vector : vectors) {
+        assert (base64Encode (vector [0]) == vector [1]);
+        assert (base64Decode (vector [1]) == vector [0]);
+    }
+
+    std::string bytes;
+    for (int c = 0; c < 256; c++)
+        bytes += static_cast<char> (c);
+    assert (base64Decode (base64Encode (bytes)) == bytes);
+
+    assert (throws ([] { base64Decode ("Zm9"); }));
+    assert (throws ([] { base64Decode ("Zm9v!A=="); }));
+
+    //  size written as a JSON string: quote, newline, control character, 2 bytes UTF-8 character
+    assert (jsonEscapedSize ("a\"b\n\x01") == 12);
+    assert (jsonEscapedSize ("caf\xc3\xa9") == 9);
+    assert (!isBinaryPayload ("plain text, written as is"));
+    assert (isBinaryPayload ("\xff\xfe not UTF-8"));
+    assert (isBinaryPayload (std::string ("\x01\x02\x03\x04\x05\x06", 6)));
+
+    assert (!hasBase64Data ("1.0"));
+    assert (!hasBase64Data ("2.1"));
+    assert (hasBase64Data ("2.2"));
+    assert (hasBase64Data ("3.0"));
+    assert (!hasBase64Data ("latest"));
+
+    //  opaque data base64 encoded only when asked for
+    SrrFeature feature = make_feature ("etn-licensing", bytes);
+    for (bool base64Data : {false, true}) {
+        feature.m_base64Data = base64Data;
+
+        cxxtools::SerializationInfo si;
+        si <<= feature;
+        const std::string json = dto::srr::serializeJson (si, false);
+        assert ((json.find (SI_DATA_ENCODING) != std::string::npos) == base64Data);
+
+        SrrFeature parsed;
+        dto::srr::deserializeJson (json) >>= parsed;
+        assert (parsed.m_base64Data == base64Data);
+        assert (parsed.m_feature_and_status.feature ().data () == bytes);
+    }
+
+    //  a payload written by a 2.1 daemon is read and written again as it was: its digests stay valid
+    SrrSaveResponse payload;
+    dto::srr::deserializeJson (read_fixture ("save-2.1.json")) >>= payload;
+    assert (payload.m_version == "2.1");
+    assert (payload.m_data.size () == 1);
+
+    Group &group = payload.m_data.front ();
+    for (const auto &f : group.m_features)
+        assert (!f.m_base64Data);
+    //  digest written by the 2.1 serializer, not evaluated again here
+    assert (group.m_data_integrity == "bf1443f9091d1cfa67e0749ad25cd3cf097708996a302a2bbf724d8529c206e8");
+    assert (checkDataIntegrity (group));
+
+    cxxtools::SerializationInfo si;
+    si <<= payload;
+    const std::string json = dto::srr::serializeJson (si, false);
+    assert (json.find (SI_DATA_ENCODING) == std::string::npos);
+
+    SrrSaveResponse written;
+    dto::srr::deserializeJson (json) >>= written;
+    assert (written.m_data.size () == 1);
+    assert (written.m_data.front ().m_data_integrity == group.m_data_integrity);
+    assert (checkDataIntegrity (written.m_data.front ()));
+    for (size_t i = 0; i < group.m_features.size (); i++) {
+        assert (written.m_data.front ().m_features [i].m_feature_and_status.feature ().data ()
+            == group.m_features [i].m_feature_and_status.feature ().data ());
+    }
+
+    //  the same features written in version 2.2 are encoded, which changes the digest of the group
+    Group encoded = group;
+    for (auto &f : encoded.m_features)
+        f.m_base64Data = true;
+    evalDataIntegrity (encoded);
+    assert (encoded.m_data_integrity != group.m_data_integrity);
+
+    printf ("OK\n");
+    if (verbose)
+        printf ("   group digest %s\n", group.m_data_integrity.c_str ());
+}
+
+//  -------------------------------------------------------------------------
+//  Differences between two saved payloads, against the expected JSON Patch.
+//
+
+static void
+diff_test (bool verbose)
+{
+    printf (" * diff: ");
+
+    const std::string from = R"({
+        "version": "2.1", "status": "success", "checksum": "c1",
+        "data": [{
+            "group_id": "config", "group_name": "Configuration", "data_integrity": "d1",
+            "features": [
+                {"alert": {"version": "1.0", "status": "success", "error": "",
+                    "data": {"threshold": "5", "mode": "on"}}},
+                {"network": {"version": "1.0", "status": "success", "error": "",
+                    "data": {"dhcp": "true"}}}
+            ]
+        }, {
+            "group_id": "users", "group_name": "Users", "data_integrity": "u1",
+            "features": [
+                {"usm": {"version": "1.0", "status": "success", "error": "", "data": {"admin": "x"}}}
+            ]
+        }]
+    })";
+    //  alert modified, network removed, ntp added; users unchanged
+    const std::string to = R"({
+        "version": "2.1", "status": "success", "checksum": "c1",
+        "data": [{
+            "group_id": "config", "group_name": "Configuration", "data_integrity": "d2",
+            "features": [
+                {"alert": {"version": "1.0", "status": "success", "error": "",
+                    "data": {"threshold": "10", "mode": "on"}}},
+                {"ntp": {"version": "1.0", "status": "success", "error": "",
+                    "data": {"server": "pool"}}}
+            ]
+        }, {
+            "group_id": "users", "group_name": "Users", "data_integrity": "u1",
+            "features": [
+                {"usm": {"version": "1.0", "status": "success", "error": "", "data": {"admin": "x"}}}
+            ]
+        }]
+    })";
+    const std::string golden = R"([
+        {"op": "replace", "path": "/data/0/data_integrity", "value": "d2"},
+        {"op": "replace", "path": "/data/0/features/0/alert/data/threshold", "value": "10"},
+        {"op": "remove", "path": "/data/0/features/1"},
+        {"op": "add", "path": "/data/0/features/-", "value":
+            {"ntp": {"version": "1.0", "status": "success", "error": "", "data": {"server": "pool"}}}}
+    ])";
+
+    const cxxtools::SerializationInfo fromSi = dto::srr::deserializeJson (from);
+    const cxxtools::SerializationInfo toSi = dto::srr::deserializeJson (to);
+
+    BackupDiff diff = diffBackups (fromSi, toSi, true);
+    assert (!diff.m_identical);
+    assert (diff.m_groups.size () == 1);
+    assert (diff.m_groups [0].m_group_id == "config");
+    assert (diff.m_groups [0].m_change == ChangeType::MODIFIED);
+
+    const auto &features = diff.m_groups [0].m_features;
+    assert (features.size () == 3);
+    assert (features [0].m_name == "alert" && features [0].m_change == ChangeType::MODIFIED);
+    assert (features [0].m_patchOps == 1);
+    assert (features [1].m_name == "network" && features [1].m_change == ChangeType::REMOVED);
+    assert (features [2].m_name == "ntp" && features [2].m_change == ChangeType::ADDED);
+
+    //  both documents written by the same formatter
+    const std::string patch = dto::srr::serializeJson (diff.m_patch, false);
+    const std::string expected = dto::srr::serializeJson (dto::srr::deserializeJson (golden), false);
+    if (verbose)
+        printf ("\n   %s\n   ", patch.c_str ());
+    assert (patch == expected);
+
+    //  without the patch, the same changes are reported
+    BackupDiff summary = diffBackups (fromSi, toSi, false);
+    assert (summary.m_groups.size () == 1 && summary.m_groups [0].m_features.size () == 3);
+
+    BackupDiff same = diffBackups (fromSi, fromSi, true);
+    assert (same.m_identical);
+    assert (same.m_groups.empty ());
+    assert (same.m_patch.memberCount () == 0);
+
+    printf ("OK\n");
+}
+
+//  -------------------------------------------------------------------------
+//  Merkle integrity scheme: one digest per feature, the group digest is the root over them.
+//
+
+static void
+merkle_test (bool verbose)
+{
+    printf (" * merkle: ");
+
+    //  FIPS 180-2 test vectors
+    assert (evalSha256 ("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    assert (evalSha256 ("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    //  known root: sha256 of "alert:1111\nnetwork:2222\n", the digests in name order
+    Group known;
+    known.m_group_id = "config";
+    known.m_integrity_scheme = INTEGRITY_SCHEME_MERKLE;
+    known.m_features = {make_feature ("network", "{}"), make_feature ("alert", "{}")};
+    known.m_features_integrity = {{"alert", "1111"}, {"network", "2222"}};
+    known.m_data_integrity = "265b68c9f0df1ac1ae74cd28d733bc9a0210437ced51fe421e7d29799cab50a5";
+    assert (checkFeaturesIntegrity (known, {"2222", "1111"}).empty ());
+    assert (checkFeaturesIntegrity (known, {"2222", "9999"}) == std::vector<std::string> {"alert"});
+    assert (throws ([&] { checkFeaturesIntegrity (known, {"2222"}); }));
+
+    //  without a valid root, no feature digest can be trusted
+    Group wrongRoot = known;
+    wrongRoot.m_data_integrity [0] = wrongRoot.m_data_integrity [0] == '0' ? '1' : '0';
+    assert (checkFeaturesIntegrity (wrongRoot, {"2222", "1111"}).size () == 2);
+
+    //  a feature missing from the payload is reported too
+    Group removed = known;
+    removed.m_features.pop_back ();
+    assert (checkFeaturesIntegrity (removed, {"2222"}) == std::vector<std::string> {"alert"});
+
+    //  evaluated digests
+    Group group;
+    group.m_group_id = "config";
+    group.m_integrity_scheme = INTEGRITY_SCHEME_MERKLE;
+    group.m_features = {make_feature ("network", R"({"dhcp":"true"})"), make_feature ("alert", "threshold=5")};
+    evalDataIntegrity (group);
+
+    assert (group.m_features_integrity.size () == 2);
+    std::string leaves;
+    for (const auto &feature : group.m_features)
+        assert (group.m_features_integrity.at (feature.m_feature_name) == evalFeatureIntegrity (feature));
+    for (const auto &digest : group.m_features_integrity)
+        leaves += digest.first + ":" + digest.second + "\n";
+    assert (group.m_data_integrity == evalSha256 (leaves));
+    assert (checkDataIntegrity (group));
+    assert (checkFeaturesIntegrity (group).empty ());
+
+    //  the root does not depend on the order of the features
+    Group reversed = group;
+    std::reverse (reversed.m_features.begin (), reversed.m_features.end ());
+    reversed.m_features_integrity.clear ();
+    evalDataIntegrity (reversed);
+    assert (reversed.m_data_integrity == group.m_data_integrity);
+
+    //  a modified feature is the only one reported
+    Group modified = group;
+    for (auto &feature : modified.m_features) {
+        if (feature.m_feature_name == "alert")
+            feature.m_feature_and_status.mutable_feature ()->set_data ("threshold=6");
+    }
+    assert (!checkDataIntegrity (modified));
+    assert (checkFeaturesIntegrity (modified) == std::vector<std::string> {"alert"});
+
+    Group unknown = group;
+    unknown.m_integrity_scheme = "md5";
+    assert (throws ([&] { checkDataIntegrity (unknown); }));
+
+    printf ("OK\n");
+    if (verbose)
+        printf ("   root %s\n", group.m_data_integrity.c_str ());
+}
+
+//  -------------------------------------------------------------------------
+//  Local store: deduplicated features, snapshots and garbage collection.
+//
+
+static SrrSaveResponse
+make_payload (const std::vector<SrrFeature> &features)
+{
+    SrrSaveResponse payload;
+    payload.m_version = "2.2";
+    payload.m_status = dto::srr::statusToString (dto::srr::Status::SUCCESS);
+    payload.m_checksum = "checksum";
+
+    Group group;
+    group.m_group_id = "config";
+    group.m_group_name = "Configuration";
+    group.m_features = features;
+    evalDataIntegrity (group);
+    payload.m_data.push_back (group);
+    return payload;
+}
+
+static void
+store_test (bool verbose)
+{
+    printf (" * store: ");
+
+    char temp [] = "/tmp/fty-srr-store-XXXXXX";
+    assert (mkdtemp (temp));
+    //  missing parents are created
+    const std::string root = std::string (temp) + "/state/store";
+    const std::string objects = root + "/objects";
+
+    SrrStore store (root, 0);
+
+    //  the shared feature is stored once
+    const SrrSaveResponse first =
+        make_payload ({make_feature ("alert", "threshold=5"), make_feature ("ntp", "{}")});
+    const SrrSaveResponse second =
+        make_payload ({make_feature ("alert", "threshold=5"), make_feature ("network", "dhcp")});
+    const SnapshotInfo firstInfo = store.store (first, {{"alert", "r1"}});
+    const SnapshotInfo secondInfo = store.store (second);
+    assert (firstInfo.m_id != secondInfo.m_id);
+    assert (firstInfo.m_groups == std::vector<std::string> {"config"});
+    assert (list_directory (objects).size () == 3);
+    assert (store.list ().size () == 2);
+
+    std::map<std::string, std::string> revisions;
+    const SrrSaveResponse loaded = store.load (firstInfo.m_id, &revisions);
+    assert (loaded.m_version == first.m_version);
+    assert (loaded.m_checksum == first.m_checksum);
+    assert (loaded.m_data.size () == 1);
+    assert (loaded.m_data [0].m_data_integrity == first.m_data [0].m_data_integrity);
+    assert (checkDataIntegrity (loaded.m_data [0]));
+    assert (revisions == (std::map<std::string, std::string> {{"alert", "r1"}}));
+
+    //  removing a snapshot removes the features only it referenced
+    store.remove (firstInfo.m_id);
+    assert (list_directory (objects).size () == 2);
+    assert (store.collectGarbage () == 0);
+    assert (store.list ().size () == 1);
+    assert (throws ([&] { store.load (firstInfo.m_id); }));
+    assert (throws ([&] { store.load ("../" + secondInfo.m_id); }));
+
+    //  an unreferenced object is collected
+    {
+        std::ofstream orphan (objects + "/orphan");
+        orphan << "orphan";
+    }
+    assert (store.collectGarbage () == 1);
+    assert (list_directory (objects).size () == 2);
+
+    //  a corrupted object is detected when loaded
+    {
+        std::ofstream corrupted (objects + "/" + list_directory (objects).front (), std::ios::trunc);
+        corrupted << "corrupted";
+    }
+    assert (throws ([&] { store.load (secondInfo.m_id); }));
+
+    //  ... and written again by the next snapshot referencing it
+    const SnapshotInfo thirdInfo = store.store (second);
+    assert (list_directory (objects).size () == 2);
+    assert (checkDataIntegrity (store.load (thirdInfo.m_id).m_data [0]));
+    assert (store.load (secondInfo.m_id).m_data [0].m_features.size () == 2);
+
+    //  retention: the objects of the snapshots dropped are collected
+    SrrStore retained (std::string (temp) + "/retained", 1);
+    retained.store (first);
+    retained.store (second);
+    const std::vector<SnapshotInfo> kept = retained.list ();
+    assert (kept.size () == 1);
+    assert (list_directory (std::string (temp) + "/retained/objects").size () == 2);
+    assert (retained.load (kept.front ().m_id).m_data [0].m_features.size () == 2);
+
+    std::system (("rm -rf " + std::string (temp)).c_str ());
+
+    printf ("OK\n");
+    if (verbose)
+        printf ("   snapshots %s, %s\n", firstInfo.m_id.c_str (), secondInfo.m_id.c_str ());
+}
+
+//  -------------------------------------------------------------------------
+//  Job registry: requests coalesced by idempotency key, results kept for the retries.
+//
+
+static void
+registry_test (bool verbose)
+{
+    printf (" * registry: ");
+
+    SrrJobRegistry<int> registry (std::chrono::seconds (60));
+    std::atomic<int> runs {0};
+    auto job = [&] { return ++runs; };
+
+    //  without key, every request runs
+    assert (registry.run ("", "", true, job) == 1);
+    assert (registry.run ("", "", true, job) == 2);
+
+    //  a retry gets the result kept for the key
+    assert (registry.run ("key", "request", true, job) == 3);
+    assert (registry.run ("key", "request", true, job) == 3);
+
+    //  the key of another request is refused, whatever its result
+    assert (throws ([&] { registry.run ("key", "other request", true, job); }));
+    assert (runs == 3);
+
+    //  result not kept: the next request runs again
+    assert (registry.run ("once", "request", false, job) == 4);
+    assert (registry.run ("once", "request", false, job) == 5);
+
+    //  a failed job is not kept, its retry runs again
+    assert (throws ([&] {
+        registry.run ("failed", "request", true, [] () -> int { throw SrrException ("failed"); });
+    }));
+    assert (registry.run ("failed", "request", true, job) == 6);
+
+    //  a request with the key of a running job waits for its result
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future ().share ();
+    int ownerResult = 0;
+    int waiterResult = 0;
+
+    std::thread owner ([&] {
+        ownerResult = registry.run ("running", "request", true, [&] {
+            started.set_value ();
+            released.wait ();
+            return ++runs;
+        });
+    });
+    started.get_future ().wait ();
+
+    std::thread waiter ([&] { waiterResult = registry.run ("running", "request", true, job); });
+    assert (throws ([&] { registry.run ("running", "other request", true, job); }));
+    std::this_thread::sleep_for (std::chrono::milliseconds (50));
+    release.set_value ();
+    owner.join ();
+    waiter.join ();
+
+    assert (ownerResult == 7);
+    assert (waiterResult == 7);
+    assert (runs == 7);
+
+    //  results expire after the retention time, the key is free again
+    SrrJobRegistry<int> expiring (std::chrono::seconds (0));
+    assert (expiring.run ("key", "request", true, job) == 8);
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    assert (expiring.run ("key", "request", true, job) == 9);
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    assert (expiring.run ("key", "other request", true, job) == 10);
+
+    printf ("OK\n");
+    if (verbose)
+        printf ("   %d jobs run\n", runs.load ());
+}
+
+//  -------------------------------------------------------------------------
+//  Timer wheel, event loop and steps, on a virtual clock.
+//
+
+static void
+steps_test (bool verbose)
+{
+    printf (" * steps: ");
+
+    //  timers expire after the number of ticks of their delay, rounded up, turns of the wheel included
+    TimerWheel wheel (std::chrono::milliseconds (10), 4);
+    std::vector<int> fired;
+    wheel.add (std::chrono::milliseconds (25), [&] { fired.push_back (25); });
+    wheel.add (std::chrono::milliseconds (100), [&] { fired.push_back (100); });
+    const TimerWheel::TimerId cancelled = wheel.add (std::chrono::milliseconds (0), [&] { fired.push_back (0); });
+    assert (wheel.cancel (cancelled));
+    assert (!wheel.cancel (cancelled));
+
+    std::vector<size_t> expiredAt;
+    for (size_t tick = 1; tick <= 10; tick++) {
+        for (auto &task : wheel.advance ()) {
+            task ();
+            expiredAt.push_back (tick);
+        }
+    }
+    assert (fired == (std::vector<int> {25, 100}));
+    assert (expiredAt == (std::vector<size_t> {3, 10}));
+    assert (wheel.empty ());
+
+    auto clock = std::make_shared<VirtualClock> ();
+    EventLoop loop (clock);
+
+    //  a delay takes no wall time on the virtual clock
+    std::vector<int> order;
+    const Clock::time_point start = clock->now ();
+    runSync (loop, sequence ({
+        call ([&] { order.push_back (1); }),
+        delay (loop, std::chrono::seconds (5)),
+        call ([&] { order.push_back (2); })
+    }));
+    assert (order == (std::vector<int> {1, 2}));
+    assert (elapsedMs (*clock, start) >= 5000);
+
+    //  steps made in order, one after the other
+    order.clear ();
+    runSync (loop, forEach (3, [&] (size_t i) { return call ([&order, i] { order.push_back (int (i)); }); }));
+    assert (order == (std::vector<int> {0, 1, 2}));
+
+    //  parallel steps are bounded by their concurrency
+    int running = 0;
+    int maxRunning = 0;
+    int done = 0;
+    runSync (loop, parallel (6, 2, [&] (size_t i) {
+        return sequence ({
+            call ([&] { maxRunning = std::max (maxRunning, ++running); }),
+            delay (loop, std::chrono::milliseconds (10 * (i + 1))),
+            call ([&] { running--; done++; })
+        });
+    }));
+    assert (maxRunning == 2);
+    assert (done == 6);
+
+    //  the first error stops the sequence and is rethrown by runSync, finally runs anyway
+    bool ran = false;
+    bool cleaned = false;
+    Step failing = call ([] { throw SrrException ("step failed"); });
+    try {
+        runSync (loop, finally (sequence ({failing, call ([&] { ran = true; })}), [&] { cleaned = true; }));
+        assert (false);
+    }
+    catch (const SrrException &e) {
+        assert (streq (e.what (), "step failed"));
+    }
+    assert (!ran);
+    assert (cleaned);
+
+    //  an error handled by attempt, a step skipped by when
+    std::string handled;
+    runSync (loop, sequence ({
+        attempt (failing, [&] (std::exception_ptr error) -> std::exception_ptr {
+            handled = errorMessage (error);
+            return nullptr;
+        }),
+        when ([] { return false; }, call ([&] { ran = true; }))
+    }));
+    assert (handled == "step failed");
+    assert (!ran);
+
+    printf ("OK\n");
+    if (verbose)
+        printf ("   virtual time %llu ms\n", static_cast<unsigned long long> (elapsedMs (*clock, start)));
+}
 
 typedef struct {
     const char *testname;           // test name, can be called from command line this way
@@ -39,6 +649,12 @@ typedef struct {
 
 static test_item_t
 all_tests [] = {
+    {"base64", base64_test, true, false, NULL},
+    {"diff", diff_test, true, false, NULL},
+    {"merkle", merkle_test, true, false, NULL},
+    {"store", store_test, true, false, NULL},
+    {"registry", registry_test, true, false, NULL},
+    {"steps", steps_test, true, false, NULL},
     {NULL, NULL, 0, 0, NULL}          //  Sentinel
 };
 